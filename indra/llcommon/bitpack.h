@@ -188,6 +188,41 @@ public:
 		return mBufferSize;
 	}
 
+	// Same bits as bitUnpack() into a zeroed little-endian U32, but moves up
+	// to a byte at a time instead of a bit at a time. total_dsize <= 32.
+	U32 bitUnpackU32(U32 total_dsize)
+	{
+		U32 value = 0;
+		U32 shift = 0;
+
+		while (total_dsize > 0)
+		{
+			U32 dsize = total_dsize > MAX_DATA_BITS ? MAX_DATA_BITS : total_dsize;
+			U32 data;
+			total_dsize -= dsize;
+
+			if (dsize <= mLoadSize)
+			{
+				data = (U32)mLoad >> (MAX_DATA_BITS - dsize);
+				mLoad <<= dsize;
+				mLoadSize -= dsize;
+			}
+			else
+			{
+				// Take what is left of the current byte, then the rest from the next one.
+				U32 rest = dsize - mLoadSize;
+				U8 next = *(mBuffer + mBufferSize++);
+				data = mLoadSize ? ((U32)mLoad >> (MAX_DATA_BITS - mLoadSize)) << rest : 0;
+				data |= (U32)next >> (MAX_DATA_BITS - rest);
+				mLoad = (U8)(next << rest);
+				mLoadSize = MAX_DATA_BITS - rest;
+			}
+			value |= data << shift;
+			shift += MAX_DATA_BITS;
+		}
+		return value;
+	}
+
 	U32 flushBitPack()
 	{
 		if (mLoadSize) 
@@ -0,0 +1,157 @@
+/** 
+ * @file lljobpool.cpp
+ * @brief Runs batches of independent jobs on a few worker threads.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "lljobpool.h"
+#include "llformat.h"
+
+#include <thread>
+
+LLJobPool::LLJobPool(const std::string& name, U32 thread_count)
+	: mFunc(NULL),
+	  mData(NULL),
+	  mCount(0),
+	  mNextJob(0),
+	  mJobsLeft(0),
+	  mPending(0)
+{
+	for (U32 i = 0; i < thread_count; ++i)
+	{
+		PoolThread* thread = new PoolThread(llformat("%s %d", name.c_str(), i), this);
+		mThreads.push_back(thread);
+		thread->start();
+	}
+}
+
+LLJobPool::~LLJobPool()
+{
+	for (std::vector<PoolThread*>::iterator iter = mThreads.begin(); iter != mThreads.end(); ++iter)
+	{
+		(*iter)->setQuitting();
+	}
+	for (std::vector<PoolThread*>::iterator iter = mThreads.begin(); iter != mThreads.end(); ++iter)
+	{
+		delete *iter; // waits for the thread to exit
+	}
+}
+
+//static
+U32 LLJobPool::getDefaultThreadCount(U32 reserved, U32 max_threads)
+{
+	U32 cores = std::thread::hardware_concurrency();
+	U32 count = cores > reserved + 1 ? cores - reserved - 1 : 0;
+	return llmin(count, max_threads);
+}
+
+void LLJobPool::run(job_func_t func, void* data, U32 count)
+{
+	if (!count)
+	{
+		return;
+	}
+
+	if (mThreads.empty() || count == 1)
+	{
+		for (U32 i = 0; i < count; ++i)
+		{
+			func(data, i);
+		}
+		return;
+	}
+
+	mCondition.lock();
+	mFunc = func;
+	mData = data;
+	mCount = count;
+	mNextJob = 0;
+	mJobsLeft = count;
+	mPending = count;
+	mCondition.unlock();
+
+	for (std::vector<PoolThread*>::iterator iter = mThreads.begin(); iter != mThreads.end(); ++iter)
+	{
+		(*iter)->wake();
+	}
+
+	// Help with the batch instead of just waiting for it.
+	while (runJob())
+	{
+	}
+
+	mCondition.lock();
+	while (mJobsLeft)
+	{
+		mCondition.wait();
+	}
+	mCondition.unlock();
+}
+
+bool LLJobPool::runJob()
+{
+	job_func_t func;
+	void* data;
+	U32 index;
+	{
+		LLMutexLock lock(mCondition);
+		if (mNextJob >= mCount)
+		{
+			return false;
+		}
+		func = mFunc;
+		data = mData;
+		index = mNextJob++;
+		mPending = mCount - mNextJob;
+	}
+
+	func(data, index);
+
+	LLMutexLock lock(mCondition);
+	if (!--mJobsLeft)
+	{
+		mCondition.signal(); // only run() waits on it
+	}
+	return true;
+}
+
+//virtual
+void LLJobPool::PoolThread::run()
+{
+	while (1)
+	{
+		// Sleeps until run() hands out a batch.
+		checkPause();
+
+		if (isQuitting())
+		{
+			break;
+		}
+
+		while (mPool->runJob())
+		{
+		}
+	}
+}
@@ -0,0 +1,92 @@
+/** 
+ * @file lljobpool.h
+ * @brief Runs batches of independent jobs on a few worker threads.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLJOBPOOL_H
+#define LL_LLJOBPOOL_H
+
+#include "llatomic.h"
+#include "llthread.h"
+
+#include <vector>
+
+//
+// A fork-join pool for work the main thread waits for within a frame, such
+// as skinning or culling. run() hands out the jobs of one batch to the pool
+// threads, runs jobs itself until none are left and returns once all of
+// them are done. Unlike LLQueuedThread there are no handles, priorities or
+// completion polling; jobs are just indices into the caller's data.
+//
+class LL_COMMON_API LLJobPool
+{
+public:
+	typedef void (*job_func_t)(void* data, U32 index);
+
+	// thread_count threads are started besides the thread calling run(),
+	// none if it is 0.
+	LLJobPool(const std::string& name, U32 thread_count);
+	~LLJobPool();
+
+	// Calls func(data, i) for every i < count, in no particular order and
+	// on any of the pool threads. Only one thread may call run() at a time.
+	void run(job_func_t func, void* data, U32 count);
+
+	U32 getThreadCount() const						{ return mThreads.size(); }
+
+	// One pool thread per core, less one for the thread calling run() and
+	// reserved for other busy threads, capped at max_threads.
+	static U32 getDefaultThreadCount(U32 reserved, U32 max_threads);
+
+private:
+	class PoolThread : public LLThread
+	{
+	public:
+		PoolThread(const std::string& name, LLJobPool* pool) : LLThread(name), mPool(pool) {}
+
+	protected:
+		/*virtual*/ bool runCondition()				{ return mPool->hasJobs(); }
+		/*virtual*/ void run();
+
+	private:
+		LLJobPool* mPool;
+	};
+
+	// Runs one job of the current batch, returns false if none was left.
+	bool runJob();
+	bool hasJobs() const							{ return mPending > 0; }
+
+	// The current batch, protected by mCondition.
+	job_func_t mFunc;
+	void* mData;
+	U32 mCount;
+	U32 mNextJob;
+	U32 mJobsLeft;
+
+	LLAtomicU32 mPending;							// Jobs nobody has started yet.
+	LLCondition mCondition;
+	std::vector<PoolThread*> mThreads;
+};
+
+#endif
@@ -0,0 +1,232 @@
+/** 
+ * @file lljobscheduler.cpp
+ * @brief Worker threads shared by the LLQueuedThreads that have no thread of their own.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "lljobscheduler.h"
+#include "llformat.h"
+
+#include <algorithm>
+#include <thread>
+
+static const U32 MAX_SCHEDULER_THREADS = 16;
+
+// 1 + the index of the worker running on this thread, 0 on other threads.
+static LL_THREAD_LOCAL U32 sWorkerSlot = 0;
+
+LLJobScheduler* LLJobScheduler::sInstance = NULL;
+
+//static
+void LLJobScheduler::initClass(U32 thread_count)
+{
+	llassert(!sInstance);
+	sInstance = new LLJobScheduler(thread_count ? llmin(thread_count, MAX_SCHEDULER_THREADS) : getDefaultThreadCount());
+	LL_INFOS() << "Job scheduler threads: " << sInstance->getThreadCount() << LL_ENDL;
+}
+
+//static
+void LLJobScheduler::cleanupClass()
+{
+	delete sInstance;
+	sInstance = NULL;
+}
+
+//static
+U32 LLJobScheduler::getDefaultThreadCount()
+{
+	U32 cores = std::thread::hardware_concurrency();
+	return llclamp(cores > 1 ? cores - 1 : 1, (U32)1, MAX_SCHEDULER_THREADS);
+}
+
+LLJobScheduler::LLJobScheduler(U32 thread_count)
+	: mQueuedJobs(0),
+	  mQuitting(false),
+	  mStolenJobs(0)
+{
+	for (U32 i = 0; i < thread_count; ++i)
+	{
+		mWorkers.push_back(new Worker(llformat("Job scheduler %d", i), this, i));
+	}
+	// Only start them once mWorkers is complete, they steal from each other.
+	for (U32 i = 0; i < thread_count; ++i)
+	{
+		mWorkers[i]->start();
+	}
+}
+
+LLJobScheduler::~LLJobScheduler()
+{
+	mCondition.lock();
+	mQuitting = true;
+	mCondition.broadcast();
+	mCondition.unlock();
+	for (std::vector<Worker*>::iterator iter = mWorkers.begin(); iter != mWorkers.end(); ++iter)
+	{
+		(*iter)->setQuitting();
+	}
+	for (std::vector<Worker*>::iterator iter = mWorkers.begin(); iter != mWorkers.end(); ++iter)
+	{
+		delete *iter; // waits for the thread to exit
+	}
+	if (mQueuedJobs)
+	{
+		LL_WARNS() << "Job scheduler destroyed with " << (U32)mQueuedJobs << " queued jobs." << LL_ENDL;
+	}
+}
+
+void LLJobScheduler::submit(Client* client, ELane lane)
+{
+	U32 slot = sWorkerSlot;
+	bool local = slot && lane != LANE_LOW;
+	if (local)
+	{
+		Worker* worker = mWorkers[slot - 1];
+		LLMutexLock lock(&worker->mJobsMutex);
+		worker->mJobs.push_back(client);
+		mQueuedJobs++;
+	}
+
+	LLMutexLock lock(mCondition);
+	if (!local)
+	{
+		mLanes[lane].push_back(client);
+		mQueuedJobs++;
+	}
+	// The count went up before the signal, so a worker about to wait sees it.
+	mCondition.signal();
+}
+
+U32 LLJobScheduler::cancel(Client* client)
+{
+	U32 cancelled = 0;
+	{
+		LLMutexLock lock(mCondition);
+		for (U32 lane = 0; lane < LANE_COUNT; ++lane)
+		{
+			std::deque<Client*>& jobs = mLanes[lane];
+			std::deque<Client*>::iterator end = std::remove(jobs.begin(), jobs.end(), client);
+			cancelled += jobs.end() - end;
+			jobs.erase(end, jobs.end());
+		}
+	}
+	for (std::vector<Worker*>::iterator iter = mWorkers.begin(); iter != mWorkers.end(); ++iter)
+	{
+		LLMutexLock lock(&(*iter)->mJobsMutex);
+		std::deque<Client*>& jobs = (*iter)->mJobs;
+		std::deque<Client*>::iterator end = std::remove(jobs.begin(), jobs.end(), client);
+		cancelled += jobs.end() - end;
+		jobs.erase(end, jobs.end());
+	}
+	mQueuedJobs -= cancelled;
+	return cancelled;
+}
+
+LLJobScheduler::Client* LLJobScheduler::takeJob(U32 index)
+{
+	Client* client = NULL;
+	Worker* self = mWorkers[index];
+	{
+		// Newest first: its data is most likely still in this core's cache.
+		LLMutexLock lock(&self->mJobsMutex);
+		if (!self->mJobs.empty())
+		{
+			client = self->mJobs.back();
+			self->mJobs.pop_back();
+		}
+	}
+	if (!client)
+	{
+		LLMutexLock lock(mCondition);
+		for (U32 lane = 0; lane < LANE_COUNT; ++lane)
+		{
+			if (!mLanes[lane].empty())
+			{
+				client = mLanes[lane].front();
+				mLanes[lane].pop_front();
+				break;
+			}
+		}
+	}
+	for (U32 i = 1; !client && i < mWorkers.size(); ++i)
+	{
+		Worker* victim = mWorkers[(index + i) % mWorkers.size()];
+		LLMutexLock lock(&victim->mJobsMutex);
+		if (!victim->mJobs.empty())
+		{
+			client = victim->mJobs.front();
+			victim->mJobs.pop_front();
+			mStolenJobs++;
+		}
+	}
+	if (client)
+	{
+		--mQueuedJobs;
+	}
+	return client;
+}
+
+LLJobScheduler::Client* LLJobScheduler::getJob(U32 index)
+{
+	while (1)
+	{
+		Client* client = takeJob(index);
+		if (client)
+		{
+			return client;
+		}
+
+		LLMutexLock lock(mCondition);
+		while (!mQueuedJobs && !mQuitting)
+		{
+			mCondition.wait();
+		}
+		if (mQuitting)
+		{
+			return NULL;
+		}
+	}
+}
+
+//----------------------------------------------------------------------------
+
+LLJobScheduler::Worker::Worker(const std::string& name, LLJobScheduler* scheduler, U32 index)
+	: LLThread(name),
+	  mScheduler(scheduler),
+	  mIndex(index)
+{
+}
+
+//virtual
+void LLJobScheduler::Worker::run()
+{
+	sWorkerSlot = mIndex + 1;
+	while (Client* client = mScheduler->getJob(mIndex))
+	{
+		client->runJob();
+	}
+	sWorkerSlot = 0;
+	LL_INFOS() << "LLJobScheduler " << mName << " EXITING." << LL_ENDL;
+}
@@ -0,0 +1,124 @@
+/** 
+ * @file lljobscheduler.h
+ * @brief Worker threads shared by the LLQueuedThreads that have no thread of their own.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+
+#ifndef LL_LLJOBSCHEDULER_H
+#define LL_LLJOBSCHEDULER_H
+
+#include "llatomic.h"
+#include "llthread.h"
+
+#include <deque>
+#include <vector>
+
+//
+// A pool of worker threads shared by the LLQueuedThreads that do not run a
+// thread of their own, so cores left idle by one subsystem are free for the
+// others. A job is just "process the next request of this queue": the queues
+// keep their own request priorities, handles and status tracking and submit
+// one job per request they want processed, at most as many at a time as the
+// requests they may process concurrently.
+//
+// Jobs submitted from outside the pool go to a shared queue per priority lane.
+// A job a worker submits while running one (a queue rescheduling itself) goes
+// to that worker's own deque, unless it is in the low lane. Idle workers run
+// the newest job of their own deque first, then the oldest job of the highest
+// priority lane, then steal the oldest job of another worker.
+//
+class LL_COMMON_API LLJobScheduler
+{
+public:
+	enum ELane
+	{
+		LANE_HIGH,
+		LANE_NORMAL,
+		LANE_LOW,
+		LANE_COUNT
+	};
+
+	class LL_COMMON_API Client
+	{
+	public:
+		virtual ~Client() {}
+
+		// WORKER THREAD, once per submitted job.
+		virtual void runJob() = 0;
+	};
+
+	// thread_count 0 uses getDefaultThreadCount(). Without a scheduler the
+	// queues run their own threads.
+	static void initClass(U32 thread_count);
+	// All clients must be gone and their jobs done.
+	static void cleanupClass();
+	static LLJobScheduler* getInstance()			{ return sInstance; }
+
+	// May be called from any thread.
+	void submit(Client* client, ELane lane);
+	// Takes back the jobs of client that no worker took yet, returns how many.
+	// May be called from any thread.
+	U32 cancel(Client* client);
+
+	U32 getThreadCount() const						{ return mWorkers.size(); }
+	U32 getStolenJobs() const						{ return mStolenJobs; }
+
+	// One worker per core, less one for the main thread, capped at 16.
+	static U32 getDefaultThreadCount();
+
+private:
+	LLJobScheduler(U32 thread_count);
+	~LLJobScheduler();
+
+	class Worker : public LLThread
+	{
+	public:
+		Worker(const std::string& name, LLJobScheduler* scheduler, U32 index);
+
+		std::deque<Client*> mJobs;					// Protected by mJobsMutex.
+		LLMutex mJobsMutex;
+
+	protected:
+		/*virtual*/ void run();
+
+	private:
+		LLJobScheduler* mScheduler;
+		U32 mIndex;
+	};
+
+	// Blocks until there is a job for worker index, returns NULL when quitting.
+	Client* getJob(U32 index);
+	Client* takeJob(U32 index);
+
+	std::deque<Client*> mLanes[LANE_COUNT];			// Protected by mCondition.
+	LLCondition mCondition;
+	LLAtomicU32 mQueuedJobs;						// In the lanes and the worker deques.
+	bool mQuitting;									// Protected by mCondition.
+	std::vector<Worker*> mWorkers;
+	LLAtomicU32 mStolenJobs;
+
+	static LLJobScheduler* sInstance;
+};
+
+#endif
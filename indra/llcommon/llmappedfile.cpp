@@ -0,0 +1,125 @@
+/** 
+ * @file llmappedfile.cpp
+ * @brief Read-mostly memory mapping of a byte range of a file.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#if LL_WINDOWS
+#include "llwin32headerslean.h"
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "linden_common.h"
+#include "llmappedfile.h"
+#include "llstring.h"
+
+LLMappedFileView::LLMappedFileView(const std::string& filename, U32 offset, U32 size)
+:	mData(NULL),
+	mSize(0),
+	mMappedBase(NULL),
+	mMappedSize(0)
+{
+	if (!size)
+	{
+		return;
+	}
+
+#if LL_WINDOWS
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	U32 aligned_offset = offset - offset % info.dwAllocationGranularity;
+
+	llutf16string utf16filename = utf8str_to_utf16str(filename);
+	HANDLE file = CreateFileW(utf16filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+							  NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		LL_WARNS() << "Could not open " << filename << " for mapping." << LL_ENDL;
+		return;
+	}
+	HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+	CloseHandle(file);
+	if (!mapping)
+	{
+		LL_WARNS() << "Could not create a file mapping for " << filename << LL_ENDL;
+		return;
+	}
+	mMappedSize = (size_t)(offset - aligned_offset) + size;
+	mMappedBase = MapViewOfFile(mapping, FILE_MAP_COPY, 0, aligned_offset, mMappedSize);
+	// The view keeps the mapping object alive.
+	CloseHandle(mapping);
+	if (!mMappedBase)
+	{
+		LL_WARNS() << "Could not map " << size << " bytes at offset " << offset << " of " << filename << LL_ENDL;
+		mMappedSize = 0;
+		return;
+	}
+#else
+	U32 page_size = (U32)sysconf(_SC_PAGESIZE);
+	U32 aligned_offset = offset - offset % page_size;
+
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		LL_WARNS() << "Could not open " << filename << " for mapping: " << LLFile::strerr() << LL_ENDL;
+		return;
+	}
+	// Refuse to map beyond the end of the file; touching such pages raises SIGBUS.
+	llstat file_status;
+	if (fstat(fd, &file_status) != 0 || (U64)file_status.st_size < (U64)offset + size)
+	{
+		LL_WARNS() << "Range [" << offset << ", " << (U64)offset + size << ") lies outside of " << filename << LL_ENDL;
+		::close(fd);
+		return;
+	}
+	mMappedSize = (size_t)(offset - aligned_offset) + size;
+	void* base = mmap(NULL, mMappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, aligned_offset);
+	// The mapping keeps its own reference to the file.
+	::close(fd);
+	if (base == MAP_FAILED)
+	{
+		LL_WARNS() << "Could not map " << size << " bytes at offset " << offset << " of " << filename << ": " << LLFile::strerr() << LL_ENDL;
+		mMappedSize = 0;
+		return;
+	}
+	mMappedBase = base;
+#endif
+
+	mData = (U8*)mMappedBase + (offset - aligned_offset);
+	mSize = size;
+}
+
+LLMappedFileView::~LLMappedFileView()
+{
+	if (mMappedBase)
+	{
+#if LL_WINDOWS
+		UnmapViewOfFile(mMappedBase);
+#else
+		munmap(mMappedBase, mMappedSize);
+#endif
+	}
+}
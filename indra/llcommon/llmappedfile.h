@@ -0,0 +1,65 @@
+/** 
+ * @file llmappedfile.h
+ * @brief Read-mostly memory mapping of a byte range of a file.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLMAPPEDFILE_H
+#define LL_LLMAPPEDFILE_H
+
+#include "llthread.h"	// LLThreadSafeRefCount
+
+//
+// Maps [offset, offset + size) of a file into memory.
+//
+// The mapping is private (copy-on-write): the pages can be written to, but
+// such writes are never carried through to the file, and writes done to the
+// file through regular file I/O after the mapping was made may or may not be
+// visible through it. Callers that keep a view alive must therefore never
+// rewrite, in place, any bytes of the mapped range that they still read
+// through the view; either value may be seen.
+//
+// The file itself is closed as soon as the mapping is made, so a view does
+// not keep a file handle open. Views are reference counted and may be
+// handed between threads.
+//
+class LL_COMMON_API LLMappedFileView : public LLThreadSafeRefCount
+{
+public:
+	LLMappedFileView(const std::string& filename, U32 offset, U32 size);
+
+	bool isValid() const			{ return mData != NULL; }
+	U8* getData() const				{ return mData; }
+	U32 getSize() const				{ return mSize; }
+
+protected:
+	/*virtual*/ ~LLMappedFileView();
+
+private:
+	U8*		mData;			// Start of the requested range.
+	U32		mSize;			// Size of the requested range.
+	void*	mMappedBase;	// Start of the mapping (aligned down to the allocation granularity).
+	size_t	mMappedSize;	// Size of the whole mapping.
+};
+
+#endif // LL_LLMAPPEDFILE_H
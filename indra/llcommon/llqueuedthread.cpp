@@ -31,13 +31,21 @@
 
 //============================================================================
 
+static const F32 QUEUE_STATS_SMOOTHING = 0.05f;
+
 // MAIN THREAD
-LLQueuedThread::LLQueuedThread(const std::string& name, bool threaded, bool should_pause) :
+LLQueuedThread::LLQueuedThread(const std::string& name, bool threaded, bool should_pause, U32 shared_jobs) :
 	LLThread(name),
 	mThreaded(threaded),
 	mIdleThread(true),
 	mNextHandle(0),
-	mStarted(FALSE)
+	mStarted(FALSE),
+	mSharedJobs(threaded && LLJobScheduler::getInstance() ? shared_jobs : 0),
+	mScheduledJobs(0),
+	mRunningJobs(0),
+	mAvgWaitTime(0.f),
+	mAvgRunTime(0.f),
+	mProcessedCount(0)
 {
 	if (mThreaded)
 	{
@@ -46,7 +54,16 @@ LLQueuedThread::LLQueuedThread(const std::string& name, bool threaded, bool shou
 			pause() ; //call this before start the thread.
 		}
 
-		start();
+		if (mSharedJobs)
+		{
+			// No thread to start, but the queue runs.
+			mStatus = RUNNING;
+			mStarted = TRUE;
+		}
+		else
+		{
+			start();
+		}
 	}
 }
 
@@ -66,7 +83,34 @@ void LLQueuedThread::shutdown()
 	setQuitting();
 
 	unpause(); // MAIN THREAD
-	if (mThreaded)
+	if (mSharedJobs)
+	{
+		// Take back the jobs that did not start. The running ones still hold on
+		// to this queue: wait for them, they only abort the remaining requests
+		// now. Like a thread that does not stop, give up after a while.
+		U32 cancelled = LLJobScheduler::getInstance()->cancel(this);
+		lockData();
+		mScheduledJobs -= cancelled;
+		unlockData();
+		S32 timeout = 100;
+		for ( ; timeout>0; timeout--)
+		{
+			lockData();
+			bool done = !mScheduledJobs && !mRunningJobs;
+			unlockData();
+			if (done)
+			{
+				break;
+			}
+			ms_sleep(100);
+		}
+		if (timeout == 0)
+		{
+			LL_WARNS() << "~LLQueuedThread (" << mName << ") timed out waiting for its jobs!" << LL_ENDL;
+		}
+		mStatus = STOPPED;
+	}
+	else if (mThreaded)
 	{
 		S32 timeout = 100;
 		for ( ; timeout>0; timeout--)
@@ -135,6 +179,12 @@ S32 LLQueuedThread::updateQueue(F32 max_time_ms)
 		if(pending > 0)
 		{
 			unpause();
+			if (mSharedJobs)
+			{
+				lockData();
+				scheduleJobsLocked();
+				unlockData();
+			}
 		}
 	}
 	else
@@ -154,13 +204,77 @@ void LLQueuedThread::incQueue()
 	// Something has been added to the queue
 	if (!isPaused())
 	{
-		if (mThreaded)
+		if (mSharedJobs)
+		{
+			lockData();
+			scheduleJobsLocked();
+			unlockData();
+		}
+		else if (mThreaded)
 		{
 			wake(); // Wake the thread up if necessary.
 		}
 	}
 }
 
+// Any thread, with lockData() held
+void LLQueuedThread::scheduleJobsLocked()
+{
+	LLJobScheduler* scheduler = LLJobScheduler::getInstance();
+	while (mScheduledJobs + mRunningJobs < mSharedJobs && mScheduledJobs < mRequestQueue.size()
+		   && !isPaused() && !isQuitting())
+	{
+		// The lane follows the best request waiting, so a low priority request
+		// that was put back after its time slice lets other subsystems go first.
+		U32 priority = (*mRequestQueue.begin())->getPriority();
+		LLJobScheduler::ELane lane = priority >= PRIORITY_HIGH ? LLJobScheduler::LANE_HIGH
+									 : priority >= PRIORITY_NORMAL ? LLJobScheduler::LANE_NORMAL
+									 : LLJobScheduler::LANE_LOW;
+		++mScheduledJobs;
+		mIdleThread = false;
+		scheduler->submit(this, lane);
+	}
+}
+
+// WORKER THREAD
+//virtual
+void LLQueuedThread::runJob()
+{
+	lockData();
+	--mScheduledJobs;
+	++mRunningJobs;
+	unlockData();
+
+	processNextRequest();
+
+	lockData();
+	--mRunningJobs;
+	scheduleJobsLocked();
+	if (!mScheduledJobs && !mRunningJobs && mRequestQueue.empty())
+	{
+		mIdleThread = true;
+	}
+	// shutdown() may delete this as soon as the lock is released.
+	unlockData();
+}
+
+// Any thread, with lockData() held
+void LLQueuedThread::recordStatsLocked(F64 wait_time, F64 run_time)
+{
+	mAvgWaitTime += ((F32)wait_time - mAvgWaitTime) * QUEUE_STATS_SMOOTHING;
+	mAvgRunTime += ((F32)run_time - mAvgRunTime) * QUEUE_STATS_SMOOTHING;
+	++mProcessedCount;
+}
+
+void LLQueuedThread::getQueueStats(F32& wait_time, F32& run_time, U32& processed)
+{
+	lockData();
+	wait_time = mAvgWaitTime;
+	run_time = mAvgRunTime;
+	processed = mProcessedCount;
+	unlockData();
+}
+
 //virtual
 // May be called from any thread
 S32 LLQueuedThread::getPending()
@@ -230,6 +344,7 @@ bool LLQueuedThread::addRequest(QueuedRequest* req)
 	
 	lockData();
 	req->setStatus(STATUS_QUEUED);
+	req->mQueuedTime = LLTimer::getElapsedSeconds();
 	mRequestQueue.insert(req);
 	mRequestHash.insert(req);
 #if _DEBUG
@@ -468,10 +583,14 @@ S32 LLQueuedThread::processNextRequest()
 		break;
 	}
 	U32 start_priority = 0 ;
+	F64 start_time = 0.0;
+	F64 wait_time = 0.0;
 	if (req)
 	{
 		req->setStatus(STATUS_INPROGRESS);
 		start_priority = req->getPriority();
+		start_time = LLTimer::getElapsedSeconds();
+		wait_time = start_time - req->mQueuedTime;
 	}
 	unlockData();
 
@@ -482,10 +601,12 @@ S32 LLQueuedThread::processNextRequest()
 	{
 		// process request
 		bool complete = req->processRequest();
+		F64 run_time = LLTimer::getElapsedSeconds() - start_time;
 
 		if (complete)
 		{
 			lockData();
+			recordStatsLocked(wait_time, run_time);
 			req->setStatus(STATUS_COMPLETE);
 			req->setFlags(FLAG_LOCKED);
 			unlockData();
@@ -508,10 +629,13 @@ S32 LLQueuedThread::processNextRequest()
 		else
 		{
 			lockData();
+			recordStatsLocked(wait_time, run_time);
 			req->setStatus(STATUS_QUEUED);
+			req->mQueuedTime = LLTimer::getElapsedSeconds();
 			mRequestQueue.insert(req);
 			unlockData();
-			if (mThreaded && start_priority < PRIORITY_NORMAL)
+			// Shared jobs do not sleep, scheduleJobsLocked() puts them in the low lane.
+			if (mThreaded && !mSharedJobs && start_priority < PRIORITY_NORMAL)
 			{
 				ms_sleep(1); // sleep the thread a little
 			}
@@ -589,7 +713,8 @@ LLQueuedThread::QueuedRequest::QueuedRequest(LLQueuedThread::handle_t handle, U3
 	LLSimpleHashEntry<LLQueuedThread::handle_t>(handle),
 	mStatus(STATUS_UNKNOWN),
 	mPriority(priority),
-	mFlags(flags)
+	mFlags(flags),
+	mQueuedTime(0.0)
 {
 }
 
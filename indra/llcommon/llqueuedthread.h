@@ -32,6 +32,7 @@
 #include <map>
 #include <set>
 
+#include "lljobscheduler.h"
 #include "llthread.h"
 #include "llsimplehash.h"
 
@@ -39,7 +40,7 @@
 // Note: ~LLQueuedThread is O(N) N=# of queued threads, assumed to be small
 //   It is assumed that LLQueuedThreads are rarely created/destroyed.
 
-class LL_COMMON_API LLQueuedThread : public LLThread
+class LL_COMMON_API LLQueuedThread : public LLThread, protected LLJobScheduler::Client
 {
 	//------------------------------------------------------------------------
 public:
@@ -135,6 +136,7 @@ public:
 		LLAtomic32<status_t> mStatus;
 		U32 mPriority;
 		U32 mFlags;
+		F64 mQueuedTime; // when it last entered the queue, for the stats
 	};
 
 protected:
@@ -153,7 +155,11 @@ public:
 	static handle_t nullHandle() { return handle_t(0); }
 	
 public:
-	LLQueuedThread(const std::string& name, bool threaded = true, bool should_pause = false);
+	// When threaded and shared_jobs is not 0, the requests are processed by
+	// the LLJobScheduler, up to shared_jobs at a time, instead of by a thread
+	// of its own. Such queues never call startThread(), endThread() or
+	// threadedUpdate(). Without a scheduler they run their own thread.
+	LLQueuedThread(const std::string& name, bool threaded = true, bool should_pause = false, U32 shared_jobs = 0);
 	virtual ~LLQueuedThread();	
 	virtual void shutdown();
 	
@@ -168,6 +174,10 @@ private:
 	virtual void endThread(void);
 	virtual void threadedUpdate(void);
 
+	/*virtual*/ void runJob();
+	void scheduleJobsLocked();
+	void recordStatsLocked(F64 wait_time, F64 run_time);
+
 protected:
 	handle_t generateHandle();
 	bool addRequest(QueuedRequest* req);
@@ -185,6 +195,12 @@ public:
 
 	virtual S32 getPending();
 	bool getThreaded() { return mThreaded ? true : false; }
+	// Requests processed at once by the LLJobScheduler, 0 if it has its own thread.
+	U32 getSharedJobs() const { return mSharedJobs; }
+
+	// Smoothed seconds requests waited in the queue and spent in
+	// processRequest(), and the number of requests processed so far.
+	void getQueueStats(F32& wait_time, F32& run_time, U32& processed);
 
 	// Request accessors
 	status_t getRequestStatus(handle_t handle);
@@ -212,6 +228,15 @@ protected:
 	request_hash_t mRequestHash;
 
 	handle_t mNextHandle;
+
+private:
+	U32 mSharedJobs;		// 0 when running a thread of its own
+	// Protected by lockData()
+	U32 mScheduledJobs;		// submitted to the scheduler and not started
+	U32 mRunningJobs;
+	F32 mAvgWaitTime;
+	F32 mAvgRunTime;
+	U32 mProcessedCount;
 };
 
 #endif // LL_LLQUEUEDTHREAD_H
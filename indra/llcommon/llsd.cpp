@@ -30,11 +30,19 @@
 #include "linden_common.h"
 #include "llsd.h"
 
+#include "llatomic.h"
 #include "llerror.h"
 #include "llformat.h"
 #include "llsdserialize.h"
 #include "stringize.h"
 
+#if LL_WINDOWS
+#include <malloc.h>
+#else
+#include <stdlib.h>
+#endif
+#include <new>
+
 #ifndef LL_RELEASE_FOR_DOWNLOAD
 #define NAME_UNNAMED_NAMESPACE
 #endif
@@ -87,8 +95,13 @@ protected:
 	bool shared() const							{ return (mUseCount > 1) && (mUseCount != STATIC_USAGE_COUNT); }
 	
 	U32 mUseCount;
+	bool mInArena;		// allocated from an LLSDArenaScope slab
 
 public:
+	static void* operator new(size_t size);
+	static void operator delete(void* p);
+		///< take the storage from the current LLSDArenaScope, if any
+
 	static void reset(Impl*& var, Impl* impl);
 		///< safely set var to refer to the new impl (possibly shared)
 		
@@ -624,15 +637,177 @@ namespace
 	}
 }
 
+namespace
+{
+	// Slabs are aligned to their size, so the slab of a value is found by
+	// masking its address. The header counts the live values in the slab,
+	// plus one while it is the slab a scope allocates from.
+	const size_t ARENA_SLAB_SIZE = 16 * 1024;
+	const size_t ARENA_HEADER_SIZE = 16;
+	const size_t ARENA_ALIGNMENT = 16;
+	const size_t ARENA_MAX_VALUE_SIZE = 256;
+	const U32 ARENA_HEAP_VALUES = 64;
+
+	struct ArenaSlabHeader
+	{
+		LLAtomicU32 mLive;
+	};
+
+	LL_THREAD_LOCAL LLSDArenaScope* sArenaScope = NULL;
+	// Set by LLSD::Impl::operator new for the Impl constructor to pick up.
+	LL_THREAD_LOCAL void* sArenaAllocation = NULL;
+
+	char* allocate_slab()
+	{
+		void* slab = NULL;
+#if LL_WINDOWS
+		slab = _aligned_malloc(ARENA_SLAB_SIZE, ARENA_SLAB_SIZE);
+#else
+		if (posix_memalign(&slab, ARENA_SLAB_SIZE, ARENA_SLAB_SIZE) != 0)
+		{
+			slab = NULL;
+		}
+#endif
+		if (slab)
+		{
+			ArenaSlabHeader* header = new (slab) ArenaSlabHeader;
+			header->mLive = 1;
+		}
+		return (char*)slab;
+	}
+
+	void free_slab(char* slab)
+	{
+		((ArenaSlabHeader*)slab)->~ArenaSlabHeader();
+#if LL_WINDOWS
+		_aligned_free(slab);
+#else
+		free(slab);
+#endif
+	}
+
+	void release_slab(char* slab)
+	{
+		if (!--((ArenaSlabHeader*)slab)->mLive)
+		{
+			free_slab(slab);
+		}
+	}
+}
+
+bool LLSDArenaScope::sEnabled = true;
+
+LLSDArenaScope::LLSDArenaScope()
+	: mActive(false),
+	  mHeapValues(0),
+	  mSlab(NULL),
+	  mUsed(0)
+{
+	if (sEnabled && !sArenaScope)
+	{
+		sArenaScope = this;
+		mActive = true;
+	}
+}
+
+LLSDArenaScope::~LLSDArenaScope()
+{
+	if (mActive)
+	{
+		retireSlab();
+		sArenaScope = NULL;
+	}
+}
+
+void* LLSDArenaScope::allocate(size_t size)
+{
+	if (mHeapValues < ARENA_HEAP_VALUES)
+	{
+		++mHeapValues;
+		return NULL;
+	}
+	size = (size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+	if (size > ARENA_MAX_VALUE_SIZE)
+	{
+		return NULL;
+	}
+	if (!mSlab || mUsed + size > ARENA_SLAB_SIZE)
+	{
+		retireSlab();
+		mSlab = allocate_slab();
+		if (!mSlab)
+		{
+			return NULL;
+		}
+		mUsed = ARENA_HEADER_SIZE;
+	}
+	((ArenaSlabHeader*)mSlab)->mLive++;
+	void* p = mSlab + mUsed;
+	mUsed += size;
+	return p;
+}
+
+bool LLSDArenaScope::owns(const void* p) const
+{
+	return mSlab && (const char*)p >= mSlab && (const char*)p < mSlab + ARENA_SLAB_SIZE;
+}
+
+//static
+void LLSDArenaScope::release(void* p)
+{
+	release_slab((char*)((uintptr_t)p & ~(uintptr_t)(ARENA_SLAB_SIZE - 1)));
+}
+
+void LLSDArenaScope::retireSlab()
+{
+	if (mSlab)
+	{
+		release_slab(mSlab);
+		mSlab = NULL;
+	}
+}
+
+//static
+void* LLSD::Impl::operator new(size_t size)
+{
+	LLSDArenaScope* scope = sArenaScope;
+	void* p = scope ? scope->allocate(size) : NULL;
+	if (p)
+	{
+		sArenaAllocation = p;
+		return p;
+	}
+	return ::operator new(size);
+}
+
+//static
+void LLSD::Impl::operator delete(void* p)
+{
+	// Arena values are destroyed by reset(); this only sees them when a
+	// constructor throws, while their slab is still the current one.
+	LLSDArenaScope* scope = sArenaScope;
+	if (scope && scope->owns(p))
+	{
+		LLSDArenaScope::release(p);
+	}
+	else
+	{
+		::operator delete(p);
+	}
+}
+
 LLSD::Impl::Impl()
-	: mUseCount(0)
+	: mUseCount(0),
+	  mInArena(sArenaAllocation == this)
 {
+	sArenaAllocation = NULL;
 	++sAllocationCount;
 	++sOutstandingCount;
 }
 
 LLSD::Impl::Impl(StaticAllocationMarker)
-	: mUseCount(0)
+	: mUseCount(0),
+	  mInArena(false)
 {
 }
 
@@ -649,7 +824,15 @@ void LLSD::Impl::reset(Impl*& var, Impl* impl)
 	}
 	if (var  &&  var->mUseCount != STATIC_USAGE_COUNT && --var->mUseCount == 0)
 	{
-		delete var;
+		if (var->mInArena)
+		{
+			var->~Impl();
+			LLSDArenaScope::release(var);
+		}
+		else
+		{
+			delete var;
+		}
 	}
 	var = impl;
 }
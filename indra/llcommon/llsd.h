@@ -415,6 +415,46 @@ public:
 	static std::string		typeString(Type type);		// Return human-readable type as a string
 };
 
+/**
+ * While an LLSDArenaScope is alive, the LLSD values created on its thread
+ * are carved out of shared 16KB slabs instead of taking one heap allocation
+ * each. A slab is freed when the last value in it is destroyed, so values
+ * may outlive the scope and be handed to other threads like any other LLSD.
+ * The first values of a scope still come from the heap, so that small trees
+ * which are kept around for long do not pin a whole slab. Scopes nested on
+ * the same thread do nothing; the outermost one owns the arena.
+ */
+class LL_COMMON_API LLSDArenaScope
+{
+public:
+	LLSDArenaScope();
+	~LLSDArenaScope();
+
+	// Arena allocation is on by default; this only affects scopes created
+	// after the call.
+	static void setEnabled(bool enabled)	{ sEnabled = enabled; }
+	static bool isEnabled()					{ return sEnabled; }
+
+private:
+	friend class LLSD::Impl;
+
+	// Returns NULL when the value should come from the heap.
+	void* allocate(size_t size);
+	bool owns(const void* p) const;
+	static void release(void* p);
+	void retireSlab();
+
+	LLSDArenaScope(const LLSDArenaScope&);
+	LLSDArenaScope& operator=(const LLSDArenaScope&);
+
+	bool mActive;
+	U32 mHeapValues;
+	char* mSlab;
+	size_t mUsed;
+
+	static bool sEnabled;
+};
+
 struct llsd_select_bool : public std::unary_function<LLSD, LLSD::Boolean>
 {
 	LLSD::Boolean operator()(const LLSD& sd) const
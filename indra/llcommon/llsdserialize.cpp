@@ -31,6 +31,7 @@
 #include "llpointer.h"
 #include "llstreamtools.h" // for fullread
 #include "llbase64.h"
+#include "llmemorystream.h"
 
 #include <iostream>
 
@@ -52,6 +53,8 @@
 
 // File constants
 static const int MAX_HDR_LEN = 20;
+// Array counts beyond this are not trusted for pre-sizing unchecked parses.
+static const S32 MAX_ARRAY_RESERVE = 4096;
 static const char LEGACY_NON_HEADER[] = "<llsd>";
 const std::string LLSD_BINARY_HEADER("LLSD/Binary");
 const std::string LLSD_XML_HEADER("LLSD/XML");
@@ -888,6 +891,10 @@ S32 LLSDBinaryParser::doParse(std::istream& istr, LLSD& data) const
  *  map keys are serialized as s + 4 byte integer size + string or in the
  *  notation format.
  */
+	// Big payloads (inventory, object properties) make one value per
+	// field; take them from slabs. This does nothing when nested.
+	LLSDArenaScope arena;
+
 	char c;
 	c = get(istr);
 	if(!istr.good())
@@ -1160,25 +1167,27 @@ S32 LLSDBinaryParser::parseArray(std::istream& istr, LLSD& array) const
 	read(istr, (char*)&value_nbo, sizeof(U32));		 /*Flawfinder: ignore*/
 	S32 size = (S32)ntohl(value_nbo);
 
-	// *FIX: This would be a good place to reserve some space in the
-	// array...
+	// Size the array up front, but do not trust the count further than
+	// the bytes left (every value takes at least one) or a sane limit.
+	S32 reserve = llmin(size, mCheckLimits ? mMaxBytesLeft : MAX_ARRAY_RESERVE);
+	if(reserve > 0)
+	{
+		array.set(reserve - 1, LLSD());
+	}
 
 	S32 parse_count = 0;
 	S32 count = 0;
 	char c = istr.peek();
 	while((c != ']') && (count < size) && istr.good())
 	{
-		LLSD child;
-		S32 child_count = doParse(istr, child);
+		// Every element is parsed in place. A child that parses to
+		// nothing means the stream ended, which fails below anyway.
+		S32 child_count = doParse(istr, array[count]);
 		if(PARSE_FAILURE == child_count)
 		{
 			return PARSE_FAILURE;
 		}
-		if(child_count)
-		{
-			parse_count += child_count;
-			array.append(child);
-		}
+		parse_count += child_count;
 		++count;
 		c = istr.peek();
 	}
@@ -1196,17 +1205,16 @@ bool LLSDBinaryParser::parseString(
 	std::istream& istr,
 	std::string& value) const
 {
-	// *FIX: This is memory inefficient.
 	U32 value_nbo = 0;
 	read(istr, (char*)&value_nbo, sizeof(U32));		 /*Flawfinder: ignore*/
 	S32 size = (S32)ntohl(value_nbo);
 	if(mCheckLimits && (size > mMaxBytesLeft)) return false;
-	std::vector<char> buf;
-	if(size)
+	if(size > 0)
 	{
-		buf.resize(size);
-		account((int)fullread(istr, &buf[0], size));
-		value.assign(buf.begin(), buf.end());
+		value.resize(size);
+		S32 count = (S32)fullread(istr, &value[0], size);
+		account(count);
+		value.resize(count);
 	}
 	return true;
 }
@@ -2122,17 +2130,41 @@ std::string zip_llsd(LLSD& data)
 // and deserializes from that copy using LLSDSerialize
 bool unzip_llsd(LLSD& data, std::istream& is, S32 size)
 {
-	U8* result = NULL;
 	U32 cur_size = 0;
-	z_stream strm;
+	U8* result = unzip_llsd_binary(cur_size, is, size);
+	if (!result)
+	{
+		return false;
+	}
+
+	//result now points to the decompressed LLSD block
+	{
+		LLMemoryStream istr(result, cur_size);
 		
-	const U32 CHUNK = 65536;
+		if (!LLSDSerialize::fromBinary(data, istr, cur_size))
+		{
+			LL_WARNS() << "Failed to unzip LLSD block" << LL_ENDL;
+			free(result);
+			return false;
+		}		
+	}
+
+	free(result);
+	return true;
+}
+
+U8* unzip_llsd_binary(U32& outsize, std::istream& is, S32 size)
+{
+	outsize = 0;
+	if (size <= 0)
+	{
+		return NULL;
+	}
 
 	U8 *in = new U8[size];
 	is.read((char*) in, size); 
 
-	U8 out[CHUNK];
-		
+	z_stream strm;
 	strm.zalloc = Z_NULL;
 	strm.zfree = Z_NULL;
 	strm.opaque = Z_NULL;
@@ -2140,33 +2172,38 @@ bool unzip_llsd(LLSD& data, std::istream& is, S32 size)
 	strm.next_in = in;
 
 	S32 ret = inflateInit(&strm);
-	
+	if (ret != Z_OK)
+	{
+		delete [] in;
+		return NULL;
+	}
+
+	// Inflate straight into the result, meshes typically compress about 1:4.
+	U32 capacity = llmax((U32)size * 4, (U32)65536);
+	U8* result = (U8*) malloc(capacity);
+	U32 cur_size = 0;
 	do
 	{
-		strm.avail_out = CHUNK;
-		strm.next_out = out;
-		ret = inflate(&strm, Z_NO_FLUSH);
-		
-		switch (ret)
+		if (result && cur_size == capacity)
 		{
-		case Z_NEED_DICT:
-			ret = Z_DATA_ERROR;
-		case Z_DATA_ERROR:
-		case Z_MEM_ERROR:
-		case Z_STREAM_ERROR:
-			inflateEnd(&strm);
-			free(result);
-			delete [] in;
-			return false;
+			capacity *= 2;
+			U8* grown = (U8*) realloc(result, capacity);
+			if (!grown)
+			{
+				free(result);
+			}
+			result = grown;
+		}
+		if (!result)
+		{
+			ret = Z_MEM_ERROR;
 			break;
 		}
 
-		U32 have = CHUNK-strm.avail_out;
-
-		result = (U8*) realloc(result, cur_size + have);
-		memcpy(result+cur_size, out, have);
-		cur_size += have;
-
+		strm.avail_out = capacity - cur_size;
+		strm.next_out = result + cur_size;
+		ret = inflate(&strm, Z_NO_FLUSH);
+		cur_size = capacity - strm.avail_out;
 	} while (ret == Z_OK);
 
 	inflateEnd(&strm);
@@ -2175,33 +2212,19 @@ bool unzip_llsd(LLSD& data, std::istream& is, S32 size)
 	if (ret != Z_STREAM_END)
 	{
 		free(result);
-		return false;
+		return NULL;
 	}
 
-	//result now points to the decompressed LLSD block
+	static const char deprecated_header[] = "<? LLSD/Binary ?>";
+	const U32 header_size = sizeof(deprecated_header) - 1;
+	if (cur_size > header_size && !memcmp(result, deprecated_header, header_size))
 	{
-		std::string res_str((char*) result, cur_size);
-
-		std::string deprecated_header("<? LLSD/Binary ?>");
-
-		if (res_str.substr(0, deprecated_header.size()) == deprecated_header)
-		{
-			res_str = res_str.substr(deprecated_header.size()+1, cur_size);
-		}
-		cur_size = res_str.size();
-
-		std::istringstream istr(res_str);
-		
-		if (!LLSDSerialize::fromBinary(data, istr, cur_size))
-		{
-			LL_WARNS() << "Failed to unzip LLSD block" << LL_ENDL;
-			free(result);
-			return false;
-		}		
+		cur_size -= header_size + 1;
+		memmove(result, result + header_size + 1, cur_size);
 	}
 
-	free(result);
-	return true;
+	outsize = cur_size;
+	return result;
 }
 
 //This unzip function will only work with a gzip header and trailer - while the contents
@@ -284,6 +284,28 @@ private:
 	bool parseBinary(std::istream& istr, LLSD& data) const;
 };
 
+/** 
+ * @class LLSDStreamVisitor
+ * @brief Takes values out of an XML LLSD document while it is parsed.
+ *
+ * shouldSplit() is asked about every value when its start tag is seen,
+ * with the path of map keys (strings) and array indices (integers) that
+ * leads to it. A value it accepts is built on its own, handed to visit()
+ * as soon as its end tag is parsed and then dropped; it does not become
+ * part of the parse result. This keeps only one element of a long list
+ * in memory at a time.
+ */
+class LL_COMMON_API LLSDStreamVisitor
+{
+public:
+	typedef std::vector<LLSD> path_t;
+
+	virtual ~LLSDStreamVisitor() { }
+
+	virtual bool shouldSplit(const path_t& path) = 0;
+	virtual void visit(const path_t& path, const LLSD& value) = 0;
+};
+
 /** 
  * @class LLSDXMLParser
  * @brief Parser which handles XML format LLSD.
@@ -302,6 +324,33 @@ public:
 	 */
 	LLSDXMLParser(bool emit_errors=true);
 
+	/** 
+	 * @brief Streams the values the visitor splits off through it.
+	 *
+	 * Applies to all parsing by this parser, stream or chunked. The
+	 * visitor must outlive the parse.
+	 */
+	void setVisitor(LLSDStreamVisitor* visitor);
+
+	/** 
+	 * @brief Parses the next piece of a document.
+	 *
+	 * The document may be cut anywhere, so the pieces can be passed on
+	 * as they arrive. Anything after the closing llsd tag is ignored.
+	 * @return Returns false once the document turned out to be bad.
+	 */
+	bool parseChunk(const char* buf, int len);
+
+	/** 
+	 * @brief Ends a document passed in with parseChunk().
+	 *
+	 * @param data[out] What is left of the document after the visitor
+	 * took its values. Undefined on failure.
+	 * @return Returns the number of LLSD objects parsed, or
+	 * PARSE_FAILURE (-1) on failure.
+	 */
+	S32 finishChunks(LLSD& data);
+
 protected:
 	/** 
 	 * @brief Call this method to parse a stream for LLSD.
@@ -817,5 +866,8 @@ public:
 //dirty little zip functions -- yell at davep
 LL_COMMON_API std::string zip_llsd(LLSD& data);
 LL_COMMON_API bool unzip_llsd(LLSD& data, std::istream& is, S32 size);
+// Inflates a zipped LLSD block without parsing it. Returns the binary LLSD
+// (deprecated header stripped) in a buffer to free(), or NULL on failure.
+LL_COMMON_API U8* unzip_llsd_binary(U32& outsize, std::istream& is, S32 size);
 LL_COMMON_API U8* unzip_llsdNavMesh( bool& valid, unsigned int& outsize,std::istream& is, S32 size);
 #endif // LL_LLSDSERIALIZE_H
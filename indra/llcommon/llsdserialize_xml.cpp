@@ -248,6 +248,11 @@ public:
 	S32 parseLines(std::istream& input, LLSD& data);
 
 	void parsePart(const char *buf, int len);
+
+	bool parseChunk(const char* buf, int len);
+	S32 finishChunks(LLSD& data);
+
+	void setVisitor(LLSDStreamVisitor* visitor)	{ mVisitor = visitor; }
 	
 	void reset();
 
@@ -264,6 +269,10 @@ private:
 		void* userData, const XML_Char* data, int length);
 
 	void startSkipping();
+
+	void pushValue(LLSD& value);
+	void pushVisited(LLSD& parent, const LLSD& step);
+	void popVisited(const LLSD& value);
 	
 	enum Element {
 		ELEMENT_LLSD,
@@ -304,11 +313,20 @@ private:
 	
 	std::string mCurrentKey;		// Current XML <tag>
 	std::string mCurrentContent;	// String data between <tag> and </tag>
+
+	// Only kept up while there is a visitor.
+	LLSDStreamVisitor* mVisitor;
+	LLSDStreamVisitor::path_t mPath;	// Path to mStack.back()
+	std::vector<S32> mChildCounts;		// Values started in each of mStack
+	std::deque<LLSD> mSplitValues;		// Values the visitor split off
+	std::vector<size_t> mSplitDepths;	// mStack sizes of mSplitValues
+	bool mChunkError;
 };
 
 
 LLSDXMLParser::Impl::Impl(bool emit_errors)
-	: mEmitErrors(emit_errors)
+	: mEmitErrors(emit_errors),
+	  mVisitor(NULL)
 {
 	mParser = XML_ParserCreate(NULL);
 	reset();
@@ -501,6 +519,12 @@ void LLSDXMLParser::Impl::reset()
 	mSkipping = false;
 	
 	mCurrentKey.clear();
+
+	mPath.clear();
+	mChildCounts.clear();
+	mSplitValues.clear();
+	mSplitDepths.clear();
+	mChunkError = false;
 	
 	XML_ParserReset(mParser, "utf-8");
 	XML_SetUserData(mParser, this);
@@ -542,6 +566,92 @@ void LLSDXMLParser::Impl::parsePart(const char* buf, int len)
 	}
 }
 
+bool LLSDXMLParser::Impl::parseChunk(const char* buf, int len)
+{
+	if (!mChunkError && !mGracefullStop)
+	{
+		XML_Status status = XML_Parse(mParser, buf, len, false);
+		if (status == XML_STATUS_ERROR && !mGracefullStop)
+		{
+			if (mEmitErrors)
+			{
+				LL_INFOS() << "LLSDXMLParser::Impl::parseChunk: " << XML_ErrorString(XML_GetErrorCode(mParser))
+						   << " at line " << XML_GetCurrentLineNumber(mParser) << LL_ENDL;
+			}
+			mChunkError = true;
+		}
+	}
+	return !mChunkError;
+}
+
+S32 LLSDXMLParser::Impl::finishChunks(LLSD& data)
+{
+	if (!mChunkError && !mGracefullStop)
+	{
+		XML_Status status = XML_Parse(mParser, NULL, 0, true);
+		mChunkError = status == XML_STATUS_ERROR && !mGracefullStop;
+		if (mChunkError && mEmitErrors)
+		{
+			LL_INFOS() << "LLSDXMLParser::Impl::finishChunks: " << XML_ErrorString(XML_GetErrorCode(mParser)) << LL_ENDL;
+		}
+	}
+	if (mChunkError)
+	{
+		data = LLSD();
+		return LLSDParser::PARSE_FAILURE;
+	}
+	data = mResult;
+	return mParseCount;
+}
+
+void LLSDXMLParser::Impl::pushValue(LLSD& value)
+{
+	mStack.push_back(&value);
+	if (mVisitor)
+	{
+		mChildCounts.push_back(0);
+	}
+}
+
+// Extends the path by step and pushes the value there: parent[step], or a
+// value of its own if the visitor splits it off.
+void LLSDXMLParser::Impl::pushVisited(LLSD& parent, const LLSD& step)
+{
+	mPath.push_back(step);
+	++mChildCounts.back();
+	if (mVisitor->shouldSplit(mPath))
+	{
+		mSplitValues.push_back(LLSD());
+		pushValue(mSplitValues.back());
+		mSplitDepths.push_back(mStack.size());
+	}
+	else if (step.isInteger())
+	{
+		parent.append(LLSD());
+		pushValue(parent[parent.size() - 1]);
+	}
+	else
+	{
+		pushValue(parent[step.asStringRef()]);
+	}
+}
+
+// Called with the value just popped off mStack.
+void LLSDXMLParser::Impl::popVisited(const LLSD& value)
+{
+	mChildCounts.pop_back();
+	if (!mSplitDepths.empty() && mSplitDepths.back() == mStack.size() + 1)
+	{
+		mVisitor->visit(mPath, value);
+		mSplitDepths.pop_back();
+		mSplitValues.pop_back();
+	}
+	if (!mPath.empty())
+	{
+		mPath.pop_back();
+	}
+}
+
 // Performance testing code
 //#define	XML_PARSER_PERFORMANCE_TESTS
 
@@ -618,24 +728,38 @@ void LLSDXMLParser::Impl::startElementHandler(const XML_Char* name, const XML_Ch
 	
 	if (mStack.empty())
 	{
-		mStack.push_back(&mResult);
+		pushValue(mResult);
 	}
 	else if (mStack.back()->isMap())
 	{
 		if (mCurrentKey.empty()) { return startSkipping(); }
 		
 		LLSD& map = *mStack.back();
-		LLSD& newElement = map[mCurrentKey];
-		mStack.push_back(&newElement);		
+		if (mVisitor)
+		{
+			pushVisited(map, LLSD(mCurrentKey));
+		}
+		else
+		{
+			LLSD& newElement = map[mCurrentKey];
+			mStack.push_back(&newElement);		
+		}
 
 		mCurrentKey.clear();
 	}
 	else if (mStack.back()->isArray())
 	{
 		LLSD& array = *mStack.back();
-		array.append(LLSD());
-		LLSD& newElement = array[array.size()-1];
-		mStack.push_back(&newElement);
+		if (mVisitor)
+		{
+			pushVisited(array, LLSD(mChildCounts.back()));
+		}
+		else
+		{
+			array.append(LLSD());
+			LLSD& newElement = array[array.size()-1];
+			mStack.push_back(&newElement);
+		}
 	}
 	else {
 		// improperly nested value in a non-structure
@@ -788,6 +912,11 @@ void LLSDXMLParser::Impl::endElementHandler(const XML_Char* name)
 			break;
 	}
 
+	if (mVisitor)
+	{
+		popVisited(value);
+	}
+
 	mCurrentContent.clear();
 }
 
@@ -907,6 +1036,21 @@ void LLSDXMLParser::parsePart(const char *buf, int len)
 	impl.parsePart(buf, len);
 }
 
+void LLSDXMLParser::setVisitor(LLSDStreamVisitor* visitor)
+{
+	impl.setVisitor(visitor);
+}
+
+bool LLSDXMLParser::parseChunk(const char* buf, int len)
+{
+	return impl.parseChunk(buf, len);
+}
+
+S32 LLSDXMLParser::finishChunks(LLSD& data)
+{
+	return impl.finishChunks(data);
+}
+
 // virtual
 S32 LLSDXMLParser::doParse(std::istream& input, LLSD& data) const
 {
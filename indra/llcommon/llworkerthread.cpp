@@ -34,8 +34,8 @@
 //============================================================================
 // Run on MAIN thread
 
-LLWorkerThread::LLWorkerThread(const std::string& name, bool threaded, bool should_pause) :
-	LLQueuedThread(name, threaded, should_pause)
+LLWorkerThread::LLWorkerThread(const std::string& name, bool threaded, bool should_pause, U32 shared_jobs) :
+	LLQueuedThread(name, threaded, should_pause, shared_jobs)
 {
 	mDeleteMutex = new LLMutex();
 }
@@ -83,7 +83,7 @@ private:
 	LLMutex* mDeleteMutex;
 	
 public:
-	LLWorkerThread(const std::string& name, bool threaded = true, bool should_pause = false);
+	LLWorkerThread(const std::string& name, bool threaded = true, bool should_pause = false, U32 shared_jobs = 0);
 	~LLWorkerThread();
 
 	/*virtual*/ S32 update(F32 max_time_ms);
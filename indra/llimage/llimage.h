@@ -325,6 +325,8 @@ public:
 	virtual BOOL decode(LLImageRaw* raw_image, F32 decode_time) = 0;  
 	// Subclasses that can handle more than 4 channels should override this function.
 	virtual BOOL decodeChannels(LLImageRaw* raw_image, F32 decode_time, S32 first_channel, S32 max_channel);
+	// Frees whatever a decoder kept between decodeChannels() calls on the same data.
+	virtual void releaseDecodeState() {}
 
 	virtual BOOL encode(const LLImageRaw* raw_image, F32 encode_time) = 0;
 
@@ -261,7 +261,10 @@ BOOL LLImageJ2C::updateData()
 	else 
 	{
 		if (mImpl)
+		{
+			mImpl->releaseDecodeState();
 			res = mImpl->getMetadata(*this);
+		}
 		else res = FALSE;
 	}
 
@@ -281,6 +284,15 @@ BOOL LLImageJ2C::updateData()
 }
 
 
+void LLImageJ2C::releaseDecodeState()
+{
+	if (mImpl)
+	{
+		mImpl->releaseDecodeState();
+	}
+}
+
+
 BOOL LLImageJ2C::decode(LLImageRaw *raw_imagep, F32 decode_time)
 {
 	return decodeChannels(raw_imagep, decode_time, 0, 4);
@@ -300,6 +312,14 @@ BOOL LLImageJ2C::decodeChannels(LLImageRaw *raw_imagep, F32 decode_time, S32 fir
 		setLastError("LLImageJ2C uninitialized");
 		res = TRUE; // done
 	}
+	else if (getComponents() > 0 && first_channel >= getComponents())
+	{
+		// The header already tells us the channels are not there (e.g. the aux
+		// channel of a 4 component image): fail without running the decoder.
+		LL_DEBUGS("Texture") << "decodeChannels: first_channel " << first_channel << " >= components " << (S32)getComponents() << LL_ENDL;
+		mDecoding = FALSE;
+		res = TRUE; // done
+	}
 	else
 	{
 		// Update the raw discard level
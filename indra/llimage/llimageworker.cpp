@@ -28,22 +28,76 @@
 
 #include "llimageworker.h"
 #include "llimagedxt.h"
+#include "lltimer.h"
+
+#include <thread>
+
+static const U32 MAX_DECODE_POOL_SIZE = 16;
+
+static U32 get_decode_pool_size(U32 pool_size)
+{
+	if (!pool_size)
+	{
+		U32 cores = std::thread::hardware_concurrency();
+		pool_size = cores > 1 ? cores - 1 : 1;
+	}
+	return llclamp(pool_size, (U32)1, MAX_DECODE_POOL_SIZE);
+}
 
 //----------------------------------------------------------------------------
 
 // MAIN THREAD
-LLImageDecodeThread::LLImageDecodeThread(bool threaded)
-	: LLQueuedThread("imagedecode", threaded)
+LLImageDecodeThread::LLImageDecodeThread(bool threaded, U32 pool_size)
+	: LLQueuedThread("imagedecode", threaded, false, get_decode_pool_size(pool_size))
 {
 	mCreationMutex = new LLMutex();
+
+	if (getSharedJobs())
+	{
+		LL_INFOS() << "Image decode jobs: " << getSharedJobs() << LL_ENDL;
+	}
+	else if (threaded)
+	{
+		// No job scheduler, run a pool of our own.
+		pool_size = get_decode_pool_size(pool_size);
+		for (U32 i = 1; i < pool_size; ++i)
+		{
+			PoolThread* thread = new PoolThread(llformat("imagedecode %d", i), this);
+			mPoolThreads.push_back(thread);
+			thread->start();
+		}
+		LL_INFOS() << "Image decode pool size: " << pool_size << LL_ENDL;
+	}
 }
 
 //virtual 
 LLImageDecodeThread::~LLImageDecodeThread()
 {
+	stopPool();
 	delete mCreationMutex ;
 }
 
+//virtual
+void LLImageDecodeThread::shutdown()
+{
+	// Stop the pool first, LLQueuedThread::shutdown() deletes the requests it may be working on.
+	stopPool();
+	LLQueuedThread::shutdown();
+}
+
+void LLImageDecodeThread::stopPool()
+{
+	for (pool_thread_list_t::iterator iter = mPoolThreads.begin(); iter != mPoolThreads.end(); ++iter)
+	{
+		(*iter)->setQuitting();
+	}
+	for (pool_thread_list_t::iterator iter = mPoolThreads.begin(); iter != mPoolThreads.end(); ++iter)
+	{
+		delete *iter; // waits for the thread to finish its current request
+	}
+	mPoolThreads.clear();
+}
+
 // MAIN THREAD
 // virtual
 S32 LLImageDecodeThread::update(F32 max_time_ms)
@@ -63,6 +117,13 @@ S32 LLImageDecodeThread::update(F32 max_time_ms)
 			LL_ERRS() << "request added after LLLFSThread::cleanupClass()" << LL_ENDL;
 		}
 	}
+	if (!mCreationList.empty())
+	{
+		for (pool_thread_list_t::iterator iter = mPoolThreads.begin(); iter != mPoolThreads.end(); ++iter)
+		{
+			(*iter)->wake();
+		}
+	}
 	mCreationList.clear();
 	S32 res = LLQueuedThread::update(max_time_ms);
 	return res;
@@ -92,6 +153,39 @@ LLImageDecodeThread::Responder::~Responder()
 
 //----------------------------------------------------------------------------
 
+LLImageDecodeThread::PoolThread::PoolThread(const std::string& name, LLImageDecodeThread* owner)
+	: LLThread(name),
+	  mOwner(owner)
+{
+}
+
+//virtual
+bool LLImageDecodeThread::PoolThread::runCondition()
+{
+	// mRunCondition must be locked here
+	return mOwner->getPending() > 0;
+}
+
+//virtual
+void LLImageDecodeThread::PoolThread::run()
+{
+	while (1)
+	{
+		// Sleeps until the pool has queued requests.
+		checkPause();
+
+		if (isQuitting())
+		{
+			break;
+		}
+
+		mOwner->processNextRequest();
+	}
+	LL_INFOS() << "LLImageDecodeThread " << mName << " EXITING." << LL_ENDL;
+}
+
+//----------------------------------------------------------------------------
+
 LLImageDecodeThread::ImageRequest::ImageRequest(handle_t handle, LLImageFormatted* image, 
 												U32 priority, S32 discard, BOOL needs_aux,
 												LLImageDecodeThread::Responder* responder)
@@ -157,6 +251,11 @@ bool LLImageDecodeThread::ImageRequest::processRequest()
 		done = mFormattedImage->decodeChannels(mDecodedImageAux, decode_time_slice, 4, 4); // 1ms
 		mDecodedAux = done;
 	}
+	if (done && mFormattedImage.notNull())
+	{
+		// The aux decode above reuses the primary decode; drop it now.
+		mFormattedImage->releaseDecodeState();
+	}
 
 	return done;
 }
@@ -72,8 +72,13 @@ public:
 	};
 	
 public:
-	LLImageDecodeThread(bool threaded = true);
+	// pool_size is the number of images decoded at once when threaded, 0 uses
+	// one per core minus one for the main thread. They are decoded on the
+	// LLJobScheduler threads if there is a scheduler, on a pool of threads
+	// of this decode thread otherwise.
+	LLImageDecodeThread(bool threaded = true, U32 pool_size = 1);
 	virtual ~LLImageDecodeThread();
+	/*virtual*/ void shutdown();
 
 	handle_t decodeImage(LLImageFormatted* image,
 						 U32 priority, S32 discard, BOOL needs_aux,
@@ -82,8 +87,29 @@ public:
 
 	// Used by unit tests to check the consistency of the thread instance
 	S32 tut_size();
+
+	U32 getPoolSize() const { return getSharedJobs() ? getSharedJobs() : mPoolThreads.size() + 1; }
 	
 private:
+	// Additional thread of the decode pool. It processes the requests of
+	// its LLImageDecodeThread, so the whole pool honors the request priorities.
+	class PoolThread : public LLThread
+	{
+	public:
+		PoolThread(const std::string& name, LLImageDecodeThread* owner);
+
+	protected:
+		/*virtual*/ bool runCondition();
+		/*virtual*/ void run();
+
+	private:
+		LLImageDecodeThread* mOwner;
+	};
+	typedef std::vector<PoolThread*> pool_thread_list_t;
+	pool_thread_list_t mPoolThreads;
+
+	void stopPool();
+
 	struct creation_info
 	{
 		handle_t handle;
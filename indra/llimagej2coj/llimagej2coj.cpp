@@ -96,13 +96,31 @@ int ceildivpow2(int a, int b)
 
 
 LLImageJ2COJ::LLImageJ2COJ()
-	: LLImageJ2CImpl()
+	: LLImageJ2CImpl(),
+	  mImage(NULL),
+	  mImageData(NULL),
+	  mImageDataSize(0),
+	  mImageDiscard(-1)
 {
 }
 
 
 LLImageJ2COJ::~LLImageJ2COJ()
 {
+	releaseDecodeState();
+}
+
+
+void LLImageJ2COJ::releaseDecodeState()
+{
+	if (mImage)
+	{
+		opj_image_destroy(mImage);
+		mImage = NULL;
+	}
+	mImageData = NULL;
+	mImageDataSize = 0;
+	mImageDiscard = -1;
 }
 
 
@@ -114,6 +132,117 @@ BOOL LLImageJ2COJ::decodeImpl(LLImageJ2C &base, LLImageRaw &raw_image, F32 decod
 
 	LLTimer decode_timer;
 
+	opj_image_t *image = NULL;
+
+	if (mImage && mImageData == base.getData() && mImageDataSize == base.getDataSize() &&
+		mImageDiscard == base.getRawDiscardLevel())
+	{
+		// Same codestream at the same discard level as the last call: only
+		// the channels differ, so copy them out of the kept decode.
+		image = mImage;
+	}
+	else
+	{
+		releaseDecodeState();
+		image = decodeCodestream(base);
+		if (!image)
+		{
+			base.decodeFailed();
+			return TRUE; // done
+		}
+	}
+
+	if(image->numcomps <= first_channel)
+	{
+		LL_WARNS("Texture") << "trying to decode more channels than are present in image: numcomps: " << image->numcomps << " first_channel: " << first_channel << LL_ENDL;
+		destroyImage(image);
+		base.decodeFailed();
+		return TRUE;
+	}
+
+	// Copy image data into our raw image format (instead of the separate channel format
+
+	S32 img_components = image->numcomps;
+	S32 channels = img_components - first_channel;
+	if( channels > max_channel_count )
+		channels = max_channel_count;
+
+	// Component buffers are allocated in an image width by height buffer.
+	// The image placed in that buffer is ceil(width/2^factor) by
+	// ceil(height/2^factor) and if the factor isn't zero it will be at the
+	// top left of the buffer with black filled in the rest of the pixels.
+	// It is integer math so the formula is written in ceildivpo2.
+	// (Assuming all the components have the same width, height and
+	// factor.)
+	S32 comp_width = image->comps[0].w;
+	S32 f=image->comps[0].factor;
+	S32 width = ceildivpow2(image->x1 - image->x0, f);
+	S32 height = ceildivpow2(image->y1 - image->y0, f);
+	raw_image.resize(width, height, channels);
+	U8 *rawp = raw_image.getData();
+
+	// first_channel is what channel to start copying from
+	// dest is what channel to copy to.  first_channel comes from the
+	// argument, dest always starts writing at channel zero.
+	for (S32 comp = first_channel, dest=0; comp < first_channel + channels;
+		comp++, dest++)
+	{
+		if (image->comps[comp].data)
+		{
+			S32 offset = dest;
+			for (S32 y = (height - 1); y >= 0; y--)
+			{
+				for (S32 x = 0; x < width; x++)
+				{
+					rawp[offset] = image->comps[comp].data[y*comp_width + x];
+					offset += channels;
+				}
+			}
+		}
+		else // Some rare OpenJPEG versions have this bug.
+		{
+			LL_WARNS("Texture") << "ERROR -> decodeImpl: failed to decode image! (NULL comp data - OpenJPEG bug)" << LL_ENDL;
+			destroyImage(image);
+			
+			base.decodeFailed();
+			return TRUE; // done
+		}
+	}
+
+	if (first_channel + channels < img_components)
+	{
+		// Channels are left over (the aux channel of a 5 component image):
+		// keep the decode for the next call.
+		mImage = image;
+		mImageData = base.getData();
+		mImageDataSize = base.getDataSize();
+		mImageDiscard = base.getRawDiscardLevel();
+	}
+	else
+	{
+		/* free image data structure */
+		destroyImage(image);
+	}
+
+	return TRUE; // done
+}
+
+void LLImageJ2COJ::destroyImage(opj_image_t* image)
+{
+	if (image == mImage)
+	{
+		releaseDecodeState();
+	}
+	else
+	{
+		opj_image_destroy(image);
+	}
+}
+
+// Runs OpenJPEG on the whole codestream of base at its raw discard level.
+// Returns NULL if the decode failed.
+opj_image_t* LLImageJ2COJ::decodeCodestream(LLImageJ2C &base)
+{
 	opj_dparameters_t parameters;	/* decompression parameters */
 	opj_event_mgr_t event_mgr;		/* event manager */
 	opj_image_t *image = NULL;
@@ -146,9 +275,7 @@ BOOL LLImageJ2COJ::decodeImpl(LLImageJ2C &base, LLImageRaw &raw_image, F32 decod
 		}
 		if(failed)
 		{
-			opj_image_destroy(image);
-			base.decodeFailed();
-			return TRUE;
+			return NULL;
 		}
 	}
 
@@ -168,19 +295,7 @@ BOOL LLImageJ2COJ::decodeImpl(LLImageJ2C &base, LLImageRaw &raw_image, F32 decod
 	opj_setup_decoder(dinfo, &parameters);
 
 	/* open a byte stream */
-#if 0
-	std::vector<U8> data(base.getData(), base.getData()+base.getDataSize());
-	S32 size = data.size();
-	if (data[size-1] == 0xFF) {
-		data.push_back((U8)0xD9);
-	} else if (data[size-2] != 0xFF || data[size-1] != 0xD9) {
-		data.push_back((U8)0xFF);
-		data.push_back((U8)0xD9);
-	}
-	cio = opj_cio_open((opj_common_ptr)dinfo, &data[0], data.size());
-#else
 	cio = opj_cio_open((opj_common_ptr)dinfo, base.getData(), base.getDataSize());
-#endif
 
 	/* decode the stream and fill the image structure */
 	image = opj_decode(dinfo, cio);
@@ -204,17 +319,7 @@ BOOL LLImageJ2COJ::decodeImpl(LLImageJ2C &base, LLImageRaw &raw_image, F32 decod
 		{
 			opj_image_destroy(image);
 		}
-#if 0
-		std::stringstream filename;
-		filename << "err" << (int)base.getRawDiscardLevel() << "_" << rand() << ".jp2";
-		FILE* file = fopen(filename.str().c_str(), "wb");
-		if (file) {
-			fwrite(base.getData(), base.getDataSize(), 1, file);
-			fclose(file);
-		}
-#endif
-		base.decodeFailed();
-		return TRUE; // done
+		return NULL;
 	}
 
 	// sometimes we get bad data out of the cache - check to see if the decode succeeded
@@ -225,76 +330,11 @@ BOOL LLImageJ2COJ::decodeImpl(LLImageJ2C &base, LLImageRaw &raw_image, F32 decod
 			LL_WARNS("Texture") <<  "Expected discard level not reached!" << LL_ENDL;			
 			// if we didn't get the discard level we're expecting, fail
 			opj_image_destroy(image);
-			base.decodeFailed();
-			return TRUE;
-		}
-	}
-	
-	if(image->numcomps <= first_channel)
-	{
-		LL_WARNS("Texture") << "trying to decode more channels than are present in image: numcomps: " << image->numcomps << " first_channel: " << first_channel << LL_ENDL;
-		if (image)
-		{
-			opj_image_destroy(image);
-		}
-
-		base.decodeFailed();
-		return TRUE;
-	}
-
-	// Copy image data into our raw image format (instead of the separate channel format
-
-	S32 img_components = image->numcomps;
-	S32 channels = img_components - first_channel;
-	if( channels > max_channel_count )
-		channels = max_channel_count;
-
-	// Component buffers are allocated in an image width by height buffer.
-	// The image placed in that buffer is ceil(width/2^factor) by
-	// ceil(height/2^factor) and if the factor isn't zero it will be at the
-	// top left of the buffer with black filled in the rest of the pixels.
-	// It is integer math so the formula is written in ceildivpo2.
-	// (Assuming all the components have the same width, height and
-	// factor.)
-	S32 comp_width = image->comps[0].w;
-	S32 f=image->comps[0].factor;
-	S32 width = ceildivpow2(image->x1 - image->x0, f);
-	S32 height = ceildivpow2(image->y1 - image->y0, f);
-	raw_image.resize(width, height, channels);
-	U8 *rawp = raw_image.getData();
-
-	// first_channel is what channel to start copying from
-	// dest is what channel to copy to.  first_channel comes from the
-	// argument, dest always starts writing at channel zero.
-	for (S32 comp = first_channel, dest=0; comp < first_channel + channels;
-		comp++, dest++)
-	{
-		if (image->comps[comp].data)
-		{
-			S32 offset = dest;
-			for (S32 y = (height - 1); y >= 0; y--)
-			{
-				for (S32 x = 0; x < width; x++)
-				{
-					rawp[offset] = image->comps[comp].data[y*comp_width + x];
-					offset += channels;
-				}
-			}
-		}
-		else // Some rare OpenJPEG versions have this bug.
-		{
-			LL_WARNS("Texture") << "ERROR -> decodeImpl: failed to decode image! (NULL comp data - OpenJPEG bug)" << LL_ENDL;
-			opj_image_destroy(image);
-			
-			base.decodeFailed();
-			return TRUE; // done
+			return NULL;
 		}
 	}
 
-	/* free image data structure */
-	opj_image_destroy(image);
-
-	return TRUE; // done
+	return image;
 }
 
 
@@ -35,6 +35,8 @@
 
 #include "llimagej2c.h"
 
+struct opj_image;
+
 class LLImageJ2COJ : public LLImageJ2CImpl
 {	
 public:
@@ -46,12 +48,24 @@ protected:
 	/*virtual*/ BOOL decodeImpl(LLImageJ2C &base, LLImageRaw &raw_image, F32 decode_time, S32 first_channel, S32 max_channel_count);
 	/*virtual*/ BOOL encodeImpl(LLImageJ2C &base, const LLImageRaw &raw_image, const char* comment_text, F32 encode_time=0.0,
 								BOOL reversible = FALSE);
+	/*virtual*/ void releaseDecodeState();
 	int ceildivpow2(int a, int b)
 	{
 		// Divide a by b to the power of 2 and round upwards.
 		return (a + (1 << b) - 1) >> b;
 	}
 
+private:
+	struct opj_image* decodeCodestream(LLImageJ2C &base);
+	void destroyImage(struct opj_image* image);
+
+	// The last decoded codestream, kept while channels of it remain to be
+	// copied out (e.g. the aux channel of a 5 component image) so that the
+	// next decodeChannels() call on the same data does not decode it again.
+	struct opj_image* mImage;
+	const U8* mImageData;
+	S32 mImageDataSize;
+	S8 mImageDiscard;
 };
 
 #endif
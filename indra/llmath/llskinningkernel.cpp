@@ -0,0 +1,248 @@
+/** 
+ * @file llskinningkernel.cpp
+ * @brief Batched SSE2 skinning of vertex arrays against a matrix palette.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llskinningkernel.h"
+
+#include "llmath.h"
+#include "llmatrix4a.h"
+
+namespace
+{
+	// Joint indices and normalized weights of a group of four vertices,
+	// indexed [influence][vertex].
+	struct SkinWeights4
+	{
+		LL_ALIGN_16(F32 mWeight[4][4]);
+		S32 mIndex[4][4];
+	};
+
+	// Unpacks the weights of four vertices at once. Each register holds one
+	// influence of all four vertices, so the fraction, the weight sum and the
+	// normalization run once per group instead of once per vertex. A vertex
+	// whose weights sum to zero is given all of its first joint.
+	void unpack_weights4(const LLVector4a* weights, U32 palette_size, SkinWeights4& out)
+	{
+		__m128 w0 = weights[0];
+		__m128 w1 = weights[1];
+		__m128 w2 = weights[2];
+		__m128 w3 = weights[3];
+		_MM_TRANSPOSE4_PS(w0, w1, w2, w3);
+
+		__m128 zero = _mm_setzero_ps();
+		w0 = _mm_max_ps(w0, zero);
+		w1 = _mm_max_ps(w1, zero);
+		w2 = _mm_max_ps(w2, zero);
+		w3 = _mm_max_ps(w3, zero);
+
+		// The weights are non-negative, so truncation is floor().
+		__m128i i0 = _mm_cvttps_epi32(w0);
+		__m128i i1 = _mm_cvttps_epi32(w1);
+		__m128i i2 = _mm_cvttps_epi32(w2);
+		__m128i i3 = _mm_cvttps_epi32(w3);
+
+		__m128 f0 = _mm_sub_ps(w0, _mm_cvtepi32_ps(i0));
+		__m128 f1 = _mm_sub_ps(w1, _mm_cvtepi32_ps(i1));
+		__m128 f2 = _mm_sub_ps(w2, _mm_cvtepi32_ps(i2));
+		__m128 f3 = _mm_sub_ps(w3, _mm_cvtepi32_ps(i3));
+
+		__m128 sum = _mm_add_ps(_mm_add_ps(f0, f1), _mm_add_ps(f2, f3));
+		__m128 valid = _mm_cmpgt_ps(sum, zero);
+		__m128 scale = _mm_and_ps(valid, _mm_div_ps(_mm_set1_ps(1.f), _mm_or_ps(sum, _mm_andnot_ps(valid, _mm_set1_ps(1.f)))));
+
+		f0 = _mm_or_ps(_mm_mul_ps(f0, scale), _mm_andnot_ps(valid, _mm_set1_ps(1.f)));
+		f1 = _mm_mul_ps(f1, scale);
+		f2 = _mm_mul_ps(f2, scale);
+		f3 = _mm_mul_ps(f3, scale);
+
+		_mm_store_ps(out.mWeight[0], f0);
+		_mm_store_ps(out.mWeight[1], f1);
+		_mm_store_ps(out.mWeight[2], f2);
+		_mm_store_ps(out.mWeight[3], f3);
+
+		_mm_storeu_si128((__m128i*)out.mIndex[0], i0);
+		_mm_storeu_si128((__m128i*)out.mIndex[1], i1);
+		_mm_storeu_si128((__m128i*)out.mIndex[2], i2);
+		_mm_storeu_si128((__m128i*)out.mIndex[3], i3);
+
+		const S32 max_index = (S32)palette_size - 1;
+		for (U32 k = 0; k < 4; ++k)
+		{
+			for (U32 v = 0; v < 4; ++v)
+			{
+				out.mIndex[k][v] = llmin(out.mIndex[k][v], max_index);
+			}
+		}
+	}
+
+	// Runs skin(vertex, weights) over count vertices in groups of four.
+	// The skinning functors apply all four influences without branching on
+	// zero weights; unused influences point at joint 0 with weight 0.
+	// The last partial group is padded with copies of its first vertex.
+	template<typename T>
+	void for_each_group4(const LLVector4a* weights, U32 palette_size, U32 count, T& skin)
+	{
+		SkinWeights4 unpacked;
+		U32 i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			unpack_weights4(weights + i, palette_size, unpacked);
+			for (U32 v = 0; v < 4; ++v)
+			{
+				skin(i + v, unpacked, v);
+			}
+		}
+
+		if (i < count)
+		{
+			LLVector4a tail[4];
+			for (U32 v = 0; v < 4; ++v)
+			{
+				tail[v] = weights[i + v < count ? i + v : i];
+			}
+			unpack_weights4(tail, palette_size, unpacked);
+			for (U32 v = 0; i + v < count; ++v)
+			{
+				skin(i + v, unpacked, v);
+			}
+		}
+	}
+
+	struct SkinPosition
+	{
+		const LLMatrix4a* mPalette;
+		const LLVector4a* mSrc;
+		LLVector4a* mDst;
+		LLVector4a mOffset;
+
+		inline void operator()(U32 vertex, const SkinWeights4& unpacked, U32 v)
+		{
+			const LLVector4a& src = mSrc[vertex];
+			LLVector4a res = mOffset;
+			for (U32 k = 0; k < 4; ++k)
+			{
+				LLVector4a t;
+				mPalette[unpacked.mIndex[k][v]].affineTransform(src, t);
+				t.mul(_mm_load1_ps(&unpacked.mWeight[k][v]));
+				res.add(t);
+			}
+			mDst[vertex] = res;
+		}
+	};
+
+	struct SkinPositionNormal
+	{
+		const LLMatrix4a* mPalette;
+		const LLVector4a* mSrc;
+		const LLVector4a* mSrcNormals;
+		LLVector4a* mDst;
+		LLVector4a* mDstNormals;
+		LLVector4a mOffset;
+
+		inline void operator()(U32 vertex, const SkinWeights4& unpacked, U32 v)
+		{
+			LLMatrix4a final_mat;
+			final_mat.clear();
+			for (U32 k = 0; k < 4; ++k)
+			{
+				LLMatrix4a src;
+				src.setMul(mPalette[unpacked.mIndex[k][v]], unpacked.mWeight[k][v]);
+				final_mat.add(src);
+			}
+
+			final_mat.affineTransform(mSrc[vertex], mDst[vertex]);
+			mDst[vertex].add(mOffset);
+
+			if (mDstNormals)
+			{
+				final_mat.invert();
+				final_mat.transpose();
+				final_mat.affineTransform(mSrcNormals[vertex], mDstNormals[vertex]);
+			}
+		}
+	};
+}
+
+//static
+void LLSkinningKernel::premultiplyPalette(LLMatrix4a* palette, U32 count, const LLMatrix4a& bind_shape)
+{
+	for (U32 i = 0; i < count; ++i)
+	{
+		LLMatrix4a joint = palette[i];
+		palette[i].setMul(joint, bind_shape);
+	}
+}
+
+//static
+void LLSkinningKernel::skinPositions(const LLMatrix4a* palette, U32 palette_size,
+									 const LLVector4a* weights, const LLVector4a* src,
+									 LLVector4a* dst, U32 count, const LLVector4a& offset,
+									 LLVector4a& min, LLVector4a& max)
+{
+	if (!count || !palette_size)
+	{
+		min = offset;
+		max = offset;
+		return;
+	}
+
+	SkinPosition skin;
+	skin.mPalette = palette;
+	skin.mSrc = src;
+	skin.mDst = dst;
+	skin.mOffset = offset;
+	for_each_group4(weights, palette_size, count, skin);
+
+	min = dst[0];
+	max = dst[0];
+	for (U32 i = 1; i < count; ++i)
+	{
+		min.setMin(min, dst[i]);
+		max.setMax(max, dst[i]);
+	}
+}
+
+//static
+void LLSkinningKernel::skinPositionsNormals(const LLMatrix4a* palette, U32 palette_size,
+											const LLVector4a* weights, const LLVector4a* src,
+											const LLVector4a* src_normals, LLVector4a* dst,
+											LLVector4a* dst_normals, U32 count, const LLVector4a& offset)
+{
+	if (!palette_size)
+	{
+		return;
+	}
+
+	SkinPositionNormal skin;
+	skin.mPalette = palette;
+	skin.mSrc = src;
+	skin.mSrcNormals = src_normals;
+	skin.mDst = dst;
+	skin.mDstNormals = src_normals ? dst_normals : NULL;
+	skin.mOffset = offset;
+	for_each_group4(weights, palette_size, count, skin);
+}
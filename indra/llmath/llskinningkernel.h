@@ -0,0 +1,65 @@
+/** 
+ * @file llskinningkernel.h
+ * @brief Batched SSE2 skinning of vertex arrays against a matrix palette.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef	LL_LLSKINNINGKERNEL_H
+#define	LL_LLSKINNINGKERNEL_H
+
+class LLMatrix4a;
+class LLVector4a;
+
+// Skins whole vertex arrays at once. The weights are in the packed format of
+// LLVolumeFace::mWeights: the integer part of each component is a joint
+// index, the fraction its weight. The weights of four vertices are unpacked
+// and normalized together in SSE registers, then each vertex is transformed
+// by its four palette matrices.
+//
+// The palette matrices must already include the bind shape matrix
+// (see premultiplyPalette()), so a position costs four affine transforms
+// and no blended matrix or second transform.
+class LLSkinningKernel
+{
+public:
+	// palette[i] = palette[i] * bind_shape for the first count matrices.
+	static void premultiplyPalette(LLMatrix4a* palette, U32 count, const LLMatrix4a& bind_shape);
+
+	// Skins count positions from src into dst and adds offset to each.
+	// min and max receive the extents of the skinned positions. Joint
+	// indices are clamped to palette_size. dst may not alias src.
+	static void skinPositions(const LLMatrix4a* palette, U32 palette_size,
+							  const LLVector4a* weights, const LLVector4a* src,
+							  LLVector4a* dst, U32 count, const LLVector4a& offset,
+							  LLVector4a& min, LLVector4a& max);
+
+	// Like skinPositions() but also transforms normals by the inverse
+	// transpose of each vertex's blended matrix. src_normals and
+	// dst_normals may be NULL.
+	static void skinPositionsNormals(const LLMatrix4a* palette, U32 palette_size,
+									 const LLVector4a* weights, const LLVector4a* src,
+									 const LLVector4a* src_normals, LLVector4a* dst,
+									 LLVector4a* dst_normals, U32 count, const LLVector4a& offset);
+};
+
+#endif
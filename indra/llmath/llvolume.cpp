@@ -48,6 +48,7 @@
 #include "llvolumeoctree.h"
 #include "llstl.h"
 #include "llsdserialize.h"
+#include "llmemorystream.h"
 #include "llvector4a.h"
 #include "lltimer.h"
 
@@ -684,7 +685,8 @@ LLProfile::Face* LLProfile::addHole(const LLProfileParams& params, BOOL flat, F3
 
 	Face *face = addFace(mTotalOut, mTotal-mTotalOut,0,LL_FACE_INNER_SIDE, flat);
 
-	static LLAlignedArray<LLVector4a,64> pt;
+	// Not static, volumes are also generated on the volume build thread.
+	LLAlignedArray<LLVector4a,64> pt;
 	pt.resize(mTotal) ;
 
 	for (S32 i=mTotalOut;i<mTotal;i++)
@@ -2043,7 +2045,7 @@ LLProfile::~LLProfile()
 }
 
 
-S32 LLVolume::sNumMeshPoints = 0;
+LLAtomicS32 LLVolume::sNumMeshPoints(0);
 
 LLVolume::LLVolume(const LLVolumeParams &params, const F32 detail, const BOOL generate_single_face, const BOOL is_unique)
 	: mParams(params)
@@ -2363,19 +2365,457 @@ bool LLVolumeFace::VertexData::compareNormal(const LLVolumeFace::VertexData& rhs
 	return retval;
 }
 
+// The geometry of one face of a mesh LOD. The blobs point into the inflated
+// binary LLSD, or into the parsed LLSD when it had to be parsed.
+struct LLMeshFaceBlobs
+{
+	LLMeshFaceBlobs()
+	:	mPosition(NULL), mPositionSize(0),
+		mNormal(NULL), mNormalSize(0),
+		mTexCoord(NULL), mTexCoordSize(0),
+		mIndices(NULL), mIndicesSize(0),
+		mWeights(NULL), mWeightsSize(0),
+		mNoGeometry(false)
+	{
+		// Missing domains read as zero, like an undefined LLSD.
+		memset(mPositionMin, 0, sizeof(mPositionMin));
+		memset(mPositionMax, 0, sizeof(mPositionMax));
+		memset(mTexCoordMin, 0, sizeof(mTexCoordMin));
+		memset(mTexCoordMax, 0, sizeof(mTexCoordMax));
+	}
+
+	const U8* mPosition;
+	U32 mPositionSize;
+	const U8* mNormal;
+	U32 mNormalSize;
+	const U8* mTexCoord;
+	U32 mTexCoordSize;
+	const U8* mIndices;
+	U32 mIndicesSize;
+	const U8* mWeights;
+	U32 mWeightsSize;
+	F32 mPositionMin[3];
+	F32 mPositionMax[3];
+	F32 mTexCoordMin[2];
+	F32 mTexCoordMax[2];
+	bool mNoGeometry;
+};
+
+// Walks the binary LLSD of a mesh LOD, an array with a map per face, in
+// place. Anything the mesh format does not use (notation style strings)
+// fails the walk, the caller then parses the LLSD instead.
+class LLMeshLODReader
+{
+public:
+	LLMeshLODReader(const U8* data, U32 size)
+	:	mCur(data), mEnd(data + size)
+	{
+	}
+
+	bool readFaces(std::vector<LLMeshFaceBlobs>& faces)
+	{
+		U32 face_count;
+		if (!expect('[') || !readU32(face_count) || face_count > (U32)(mEnd - mCur))
+		{
+			return false;
+		}
+		faces.resize(face_count);
+		for (U32 i = 0; i < face_count; ++i)
+		{
+			if (!readFace(faces[i]))
+			{
+				return false;
+			}
+		}
+		return expect(']');
+	}
+
+private:
+	enum { MAX_DEPTH = 32 };
+
+	bool has(U32 bytes) const
+	{
+		return bytes <= (U32)(mEnd - mCur);
+	}
+
+	bool skip(U32 bytes)
+	{
+		if (!has(bytes))
+		{
+			return false;
+		}
+		mCur += bytes;
+		return true;
+	}
+
+	bool expect(U8 c)
+	{
+		if (mCur < mEnd && *mCur == c)
+		{
+			++mCur;
+			return true;
+		}
+		return false;
+	}
+
+	static bool isKey(const U8* key, U32 length, const char* name)
+	{
+		return length == strlen(name) && !memcmp(key, name, length);
+	}
+
+	// Network byte order, like LLSDBinaryFormatter writes it.
+	bool readU32(U32& value)
+	{
+		if (!has(4))
+		{
+			return false;
+		}
+		value = ((U32)mCur[0] << 24) | ((U32)mCur[1] << 16) | ((U32)mCur[2] << 8) | (U32)mCur[3];
+		mCur += 4;
+		return true;
+	}
+
+	// 's', 'l', 'b' and 'k' values: a size and that many bytes.
+	bool readSized(const U8*& data, U32& size)
+	{
+		if (!readU32(size) || !has(size))
+		{
+			return false;
+		}
+		data = mCur;
+		mCur += size;
+		return true;
+	}
+
+	bool readBinary(const U8*& data, U32& size)
+	{
+		return expect('b') && readSized(data, size);
+	}
+
+	bool readReal(F32& value)
+	{
+		if (expect('r'))
+		{
+			if (!has(8))
+			{
+				return false;
+			}
+			U64 bits = 0;
+			for (S32 i = 0; i < 8; ++i)
+			{
+				bits = (bits << 8) | mCur[i];
+			}
+			mCur += 8;
+			F64 real;
+			memcpy(&real, &bits, sizeof(F64));
+			value = (F32)real;
+			return true;
+		}
+		U32 integer;
+		if (expect('i') && readU32(integer))
+		{
+			value = (F32)(S32)integer;
+			return true;
+		}
+		return false;
+	}
+
+	// An array of up to count reals, missing elements are zero.
+	bool readReals(F32* values, U32 count)
+	{
+		U32 size;
+		if (!expect('[') || !readU32(size))
+		{
+			return false;
+		}
+		for (U32 i = 0; i < size; ++i)
+		{
+			F32 value;
+			if (i < count ? !readReal(value) : !skipValue(1))
+			{
+				return false;
+			}
+			if (i < count)
+			{
+				values[i] = value;
+			}
+		}
+		return expect(']');
+	}
+
+	// A map of Min and Max arrays.
+	bool readDomain(F32* min, F32* max, U32 count)
+	{
+		U32 size;
+		if (!expect('{') || !readU32(size))
+		{
+			return false;
+		}
+		for (U32 i = 0; i < size; ++i)
+		{
+			const U8* key;
+			U32 length;
+			if (!expect('k') || !readSized(key, length))
+			{
+				return false;
+			}
+			bool ok;
+			if (isKey(key, length, "Min"))
+			{
+				ok = readReals(min, count);
+			}
+			else if (isKey(key, length, "Max"))
+			{
+				ok = readReals(max, count);
+			}
+			else
+			{
+				ok = skipValue(1);
+			}
+			if (!ok)
+			{
+				return false;
+			}
+		}
+		return expect('}');
+	}
+
+	bool readFace(LLMeshFaceBlobs& face)
+	{
+		U32 size;
+		if (!expect('{') || !readU32(size))
+		{
+			return false;
+		}
+		for (U32 i = 0; i < size; ++i)
+		{
+			const U8* key;
+			U32 length;
+			if (!expect('k') || !readSized(key, length))
+			{
+				return false;
+			}
+			bool ok;
+			if (isKey(key, length, "Position"))
+			{
+				ok = readBinary(face.mPosition, face.mPositionSize);
+			}
+			else if (isKey(key, length, "Normal"))
+			{
+				ok = readBinary(face.mNormal, face.mNormalSize);
+			}
+			else if (isKey(key, length, "TexCoord0"))
+			{
+				ok = readBinary(face.mTexCoord, face.mTexCoordSize);
+			}
+			else if (isKey(key, length, "TriangleList"))
+			{
+				ok = readBinary(face.mIndices, face.mIndicesSize);
+			}
+			else if (isKey(key, length, "Weights"))
+			{
+				ok = readBinary(face.mWeights, face.mWeightsSize);
+			}
+			else if (isKey(key, length, "PositionDomain"))
+			{
+				ok = readDomain(face.mPositionMin, face.mPositionMax, 3);
+			}
+			else if (isKey(key, length, "TexCoord0Domain"))
+			{
+				ok = readDomain(face.mTexCoordMin, face.mTexCoordMax, 2);
+			}
+			else
+			{
+				face.mNoGeometry |= isKey(key, length, "NoGeometry");
+				ok = skipValue(1);
+			}
+			if (!ok)
+			{
+				return false;
+			}
+		}
+		return expect('}');
+	}
+
+	bool skipValue(S32 depth)
+	{
+		if (mCur >= mEnd || depth > MAX_DEPTH)
+		{
+			return false;
+		}
+		const U8* data;
+		U32 size;
+		switch (*mCur++)
+		{
+		case '!':
+		case '0':
+		case '1':
+			return true;
+		case 'i':
+			return skip(4);
+		case 'r':
+		case 'd':
+			return skip(8);
+		case 'u':
+			return skip(16);
+		case 's':
+		case 'l':
+		case 'b':
+			return readSized(data, size);
+		case '[':
+			if (!readU32(size))
+			{
+				return false;
+			}
+			for (U32 i = 0; i < size; ++i)
+			{
+				if (!skipValue(depth + 1))
+				{
+					return false;
+				}
+			}
+			return expect(']');
+		case '{':
+			if (!readU32(size))
+			{
+				return false;
+			}
+			for (U32 i = 0; i < size; ++i)
+			{
+				U32 length;
+				if (!expect('k') || !readSized(data, length) || !skipValue(depth + 1))
+				{
+					return false;
+				}
+			}
+			return expect('}');
+		default:
+			return false;
+		}
+	}
+
+	const U8* mCur;
+	const U8* mEnd;
+};
+
+static void set_mesh_blob(const LLSD::Binary& binary, const U8*& data, U32& size)
+{
+	data = binary.empty() ? NULL : &binary[0];
+	size = binary.size();
+}
+
+static void get_mesh_reals(const LLSD& sd, F32* values, U32 count)
+{
+	for (U32 i = 0; i < count; ++i)
+	{
+		values[i] = (F32)sd[(LLSD::Integer)i].asReal();
+	}
+}
+
+// The faces of a parsed mesh LOD, the blobs stay owned by mdl.
+static void get_mesh_faces(const LLSD& mdl, std::vector<LLMeshFaceBlobs>& faces)
+{
+	faces.resize(mdl.size());
+	for (U32 i = 0; i < faces.size(); ++i)
+	{
+		const LLSD& sd = mdl[(LLSD::Integer)i];
+		LLMeshFaceBlobs& face = faces[i];
+		face.mNoGeometry = sd.has("NoGeometry");
+		set_mesh_blob(sd["Position"].asBinary(), face.mPosition, face.mPositionSize);
+		set_mesh_blob(sd["Normal"].asBinary(), face.mNormal, face.mNormalSize);
+		set_mesh_blob(sd["TexCoord0"].asBinary(), face.mTexCoord, face.mTexCoordSize);
+		set_mesh_blob(sd["TriangleList"].asBinary(), face.mIndices, face.mIndicesSize);
+		set_mesh_blob(sd["Weights"].asBinary(), face.mWeights, face.mWeightsSize);
+		get_mesh_reals(sd["PositionDomain"]["Min"], face.mPositionMin, 3);
+		get_mesh_reals(sd["PositionDomain"]["Max"], face.mPositionMax, 3);
+		get_mesh_reals(sd["TexCoord0Domain"]["Min"], face.mTexCoordMin, 2);
+		get_mesh_reals(sd["TexCoord0Domain"]["Max"], face.mTexCoordMax, 2);
+	}
+}
+
+// out[i] = offset + scale * (x, y, z, 0) for count little endian U16
+// triplets at src. All but the last triplet are read with an 8 byte load,
+// the extra U16 lands in w where scale is 0.
+static void dequantize_u16x3(LLVector4a* out, const U8* src, U32 count, const LLVector4a& scale, const LLVector4a& offset)
+{
+	const __m128i zero = _mm_setzero_si128();
+	U32 i = 0;
+	for (; i + 1 < count; ++i, src += 6)
+	{
+		__m128i v = _mm_loadl_epi64((const __m128i*)src);
+		__m128 f = _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero));
+		out[i] = _mm_add_ps(_mm_mul_ps(f, scale), offset);
+	}
+	if (i < count)
+	{
+		U16 last[4] = { 0, 0, 0, 0 };
+		memcpy(last, src, 3 * sizeof(U16));
+		__m128i v = _mm_loadl_epi64((const __m128i*)last);
+		__m128 f = _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero));
+		out[i] = _mm_add_ps(_mm_mul_ps(f, scale), offset);
+	}
+}
+
+// Texture coordinates, two vertices (four U16) per LLVector4a.
+static void dequantize_tex_coords(LLVector2* out, const U8* src, U32 count, const LLVector4a& scale, const LLVector4a& offset)
+{
+	const __m128i zero = _mm_setzero_si128();
+	LLVector4a* out4 = (LLVector4a*)out;
+	U32 pairs = count / 2;
+	for (U32 i = 0; i < pairs; ++i, src += 8)
+	{
+		__m128i v = _mm_loadl_epi64((const __m128i*)src);
+		__m128 f = _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero));
+		out4[i] = _mm_add_ps(_mm_mul_ps(f, scale), offset);
+	}
+	if (count & 1)
+	{
+		U16 last[4] = { 0, 0, 0, 0 };
+		memcpy(last, src, 2 * sizeof(U16));
+		__m128i v = _mm_loadl_epi64((const __m128i*)last);
+		__m128 f = _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero));
+		out4[pairs] = _mm_add_ps(_mm_mul_ps(f, scale), offset);
+	}
+}
+
 bool LLVolume::unpackVolumeFaces(std::istream& is, S32 size)
 {
 	//input stream is now pointing at a zlib compressed block of LLSD
 	//decompress block
-	LLSD mdl;
-	if (!unzip_llsd(mdl, is, size))
+	U32 data_size = 0;
+	U8* data = unzip_llsd_binary(data_size, is, size);
+	if (!data)
 	{
 		LL_DEBUGS("MeshStreaming") << "Failed to unzip LLSD blob for LoD, will probably fetch from sim again." << LL_ENDL;
 		return false;
 	}
-	
+
+	// Decode straight from the binary LLSD, without building the LLSD tree.
+	std::vector<LLMeshFaceBlobs> faces;
+	LLSD mdl;
+	LLMeshLODReader reader(data, data_size);
+	if (!reader.readFaces(faces))
+	{
+		faces.clear();
+		LLMemoryStream istr(data, data_size);
+		if (!LLSDSerialize::fromBinary(mdl, istr, data_size))
+		{
+			LL_DEBUGS("MeshStreaming") << "Failed to parse LLSD blob for LoD, will probably fetch from sim again." << LL_ENDL;
+			free(data);
+			return false;
+		}
+		get_mesh_faces(mdl, faces);
+	}
+
+	bool success = unpackMeshFaces(faces);
+	free(data);
+	return success;
+}
+
+bool LLVolume::unpackMeshFaces(const std::vector<LLMeshFaceBlobs>& faces)
+{
 	{
-		U32 face_count = mdl.size();
+		U32 face_count = faces.size();
 
 		if (face_count == 0)
 		{ //no faces unpacked, treat as failed decode
@@ -2388,8 +2828,9 @@ bool LLVolume::unpackVolumeFaces(std::istream& is, S32 size)
 		for (U32 i = 0; i < face_count; ++i)
 		{
 			LLVolumeFace& face = mVolumeFaces[i];
+			const LLMeshFaceBlobs& blobs = faces[i];
 
-			if (mdl[i].has("NoGeometry"))
+			if (blobs.mNoGeometry)
 			{ //face has no geometry, continue
 				face.resizeIndices(3);
 				face.resizeVertices(1);
@@ -2400,132 +2841,79 @@ bool LLVolume::unpackVolumeFaces(std::istream& is, S32 size)
 				continue;
 			}
 
-			LLSD::Binary pos = mdl[i]["Position"];
-			LLSD::Binary norm = mdl[i]["Normal"];
-			LLSD::Binary tc = mdl[i]["TexCoord0"];
-			LLSD::Binary idx = mdl[i]["TriangleList"];
-
-			
-
 			//copy out indices
-			face.resizeIndices(idx.size()/2);
+			face.resizeIndices(blobs.mIndicesSize/2);
 			
-			if (idx.empty() || face.mNumIndices < 3)
+			if (!blobs.mIndicesSize || face.mNumIndices < 3)
 			{ //why is there an empty index list?
 				LL_WARNS() <<"Empty face present!" << LL_ENDL;
 				continue;
 			}
 
-			U16* indices = (U16*) &(idx[0]);
-			U32 count = idx.size()/2;
-			for (U32 j = 0; j < count; ++j)
-			{
-				face.mIndices[j] = indices[j];
-			}
+			memcpy(face.mIndices, blobs.mIndices, face.mNumIndices * sizeof(U16));
 
 			//copy out vertices
-			U32 num_verts = pos.size()/(3*2);
+			U32 num_verts = blobs.mPositionSize/(3*2);
 			face.resizeVertices(num_verts);
 
-			LLVector3 minp;
-			LLVector3 maxp;
-			LLVector2 min_tc; 
-			LLVector2 max_tc; 
-		
-			minp.setValue(mdl[i]["PositionDomain"]["Min"]);
-			maxp.setValue(mdl[i]["PositionDomain"]["Max"]);
 			LLVector4a min_pos, max_pos;
-			min_pos.load3(minp.mV);
-			max_pos.load3(maxp.mV);
-
-			min_tc.setValue(mdl[i]["TexCoord0Domain"]["Min"]);
-			max_tc.setValue(mdl[i]["TexCoord0Domain"]["Max"]);
+			min_pos.load3(blobs.mPositionMin);
+			max_pos.load3(blobs.mPositionMax);
 
 			LLVector4a pos_range;
 			pos_range.setSub(max_pos, min_pos);
-			LLVector2 tc_range2 = max_tc - min_tc;
-			LLVector4a tc_range;
-			tc_range.set(tc_range2[0], tc_range2[1], tc_range2[0], tc_range2[1]);
-			LLVector4a min_tc4(min_tc[0], min_tc[1], min_tc[0], min_tc[1]);
-
-			LLVector4a* pos_out = face.mPositions;
-			LLVector4a* norm_out = face.mNormals;
-			LLVector4a* tc_out = (LLVector4a*) face.mTexCoords;
 
 			{
-				U16* v = (U16*) &(pos[0]);
-				for (U32 j = 0; j < num_verts; ++j)
-				{
-					pos_out->set((F32) v[0], (F32) v[1], (F32) v[2]);
-					pos_out->div(65535.f);
-					pos_out->mul(pos_range);
-					pos_out->add(min_pos);
-					pos_out++;
-					v += 3;
-				}
-
+				LLVector4a pos_scale;
+				pos_scale.set(1.f / 65535.f, 1.f / 65535.f, 1.f / 65535.f, 0.f);
+				pos_scale.mul(pos_range);
+				dequantize_u16x3(face.mPositions, blobs.mPosition, num_verts, pos_scale, min_pos);
 			}
 
 			{
-				if (!norm.empty())
+				if (blobs.mNormalSize >= num_verts * 3 * sizeof(U16))
 				{
-					U16* n = (U16*) &(norm[0]);
-					for (U32 j = 0; j < num_verts; ++j)
-					{
-						norm_out->set((F32) n[0], (F32) n[1], (F32) n[2]);
-						norm_out->div(65535.f);
-						norm_out->mul(2.f);
-						norm_out->sub(1.f);
-						norm_out++;
-						n += 3;
-					}
+					LLVector4a norm_scale;
+					norm_scale.set(2.f / 65535.f, 2.f / 65535.f, 2.f / 65535.f, 0.f);
+					LLVector4a norm_offset;
+					norm_offset.splat(-1.f);
+					dequantize_u16x3(face.mNormals, blobs.mNormal, num_verts, norm_scale, norm_offset);
 				}
 				else
 				{
-					memset(norm_out, 0, sizeof(LLVector4a)*num_verts);
+					memset(face.mNormals, 0, sizeof(LLVector4a)*num_verts);
 				}
 			}
 
 			{
-				if (!tc.empty())
+				if (blobs.mTexCoordSize >= num_verts * 2 * sizeof(U16))
 				{
-					U16* t = (U16*) &(tc[0]);
-					for (U32 j = 0; j < num_verts; j+=2)
-					{
-						if (j < num_verts-1)
-						{
-							tc_out->set((F32) t[0], (F32) t[1], (F32) t[2], (F32) t[3]);
-						}
-						else
-						{
-							tc_out->set((F32) t[0], (F32) t[1], 0.f, 0.f);
-						}
-
-						t += 4;
-
-						tc_out->div(65535.f);
-						tc_out->mul(tc_range);
-						tc_out->add(min_tc4);
-
-						tc_out++;
-					}
+					LLVector2 min_tc(blobs.mTexCoordMin);
+					LLVector2 max_tc(blobs.mTexCoordMax);
+					LLVector2 tc_range2 = max_tc - min_tc;
+					LLVector4a tc_scale;
+					tc_scale.set(tc_range2[0], tc_range2[1], tc_range2[0], tc_range2[1]);
+					tc_scale.mul(1.f / 65535.f);
+					LLVector4a min_tc4(min_tc[0], min_tc[1], min_tc[0], min_tc[1]);
+					dequantize_tex_coords(face.mTexCoords, blobs.mTexCoord, num_verts, tc_scale, min_tc4);
 				}
 				else
 				{
-					memset(tc_out, 0, sizeof(LLVector2)*num_verts);
+					memset(face.mTexCoords, 0, sizeof(LLVector2)*num_verts);
 				}
 			}
 
-			if (mdl[i].has("Weights"))
+			if (blobs.mWeights)
 			{
 				face.allocateWeights(num_verts);
 
-				LLSD::Binary weights = mdl[i]["Weights"];
+				const U8* weights = blobs.mWeights;
+				U32 weights_size = blobs.mWeightsSize;
 
 				U32 idx = 0;
 
 				U32 cur_vertex = 0;
-				while (idx < weights.size() && cur_vertex < num_verts)
+				while (idx < weights_size && cur_vertex < num_verts)
 				{
 					const U8 END_INFLUENCES = 0xFF;
 					U8 joint = weights[idx++];
@@ -2535,7 +2923,7 @@ bool LLVolume::unpackVolumeFaces(std::istream& is, S32 size)
                     U32 joints[4] = {0,0,0,0};
 					LLVector4 joints_with_weights(0,0,0,0);
 
-					while (joint != END_INFLUENCES && idx < weights.size())
+					while (joint != END_INFLUENCES && idx + 1 < weights_size)
 					{
 						U16 influence = weights[idx++];
 						influence |= ((U16) weights[idx++] << 8);
@@ -2545,7 +2933,7 @@ bool LLVolume::unpackVolumeFaces(std::istream& is, S32 size)
 						joints[cur_influence] = joint;
 						cur_influence++;
 
-						if (cur_influence >= 4)
+						if (cur_influence >= 4 || idx >= weights_size)
 						{
 							joint = END_INFLUENCES;
 						}
@@ -2572,7 +2960,7 @@ bool LLVolume::unpackVolumeFaces(std::istream& is, S32 size)
 					cur_vertex++;
 				}
 
-				if (cur_vertex != num_verts || idx != weights.size())
+				if (cur_vertex != num_verts || idx != weights_size)
 				{
 					LL_WARNS() << "Vertex weight count does not match vertex count!" << LL_ENDL;
 				}
@@ -2720,6 +3108,109 @@ void LLVolume::cacheOptimize()
 	}
 }
 
+// Flags of the optional streams in packOptimizedVolumeFaces()
+static const U8 PACKED_FACE_WEIGHTS = 0x01;
+static const U8 PACKED_FACE_TANGENTS = 0x02;
+
+bool LLVolume::packOptimizedVolumeFaces(std::ostream& os) const
+{
+	U32 face_count = mVolumeFaces.size();
+	if (face_count == 0 || face_count > (U32)LL_SCULPT_MESH_MAX_FACES)
+	{
+		return false;
+	}
+	os.write((const char*)&face_count, sizeof(U32));
+	for (U32 i = 0; i < face_count; ++i)
+	{
+		const LLVolumeFace& face = mVolumeFaces[i];
+		if (!face.mOptimized || face.mNumVertices <= 0 || face.mNumIndices < 3)
+		{ //unpackOptimizedVolumeFaces() rejects empty faces
+			return false;
+		}
+
+		S32 counts[2] = { face.mNumVertices, face.mNumIndices };
+		U8 flags = (face.mWeights ? PACKED_FACE_WEIGHTS : 0) | (face.mTangents ? PACKED_FACE_TANGENTS : 0);
+		os.write((const char*)counts, sizeof(counts));
+		os.write((const char*)&flags, sizeof(U8));
+		os.write((const char*)face.mExtents, 2 * sizeof(LLVector4a));
+		os.write((const char*)face.mTexCoordExtents, 2 * sizeof(LLVector2));
+
+		// Positions, normals and texture coordinates share one buffer.
+		os.write((const char*)face.mPositions, 2 * face.mNumVertices * sizeof(LLVector4a));
+		os.write((const char*)face.mTexCoords, face.mNumVertices * sizeof(LLVector2));
+		os.write((const char*)face.mIndices, face.mNumIndices * sizeof(U16));
+		if (face.mWeights)
+		{
+			os.write((const char*)face.mWeights, face.mNumVertices * sizeof(LLVector4a));
+		}
+		if (face.mTangents)
+		{
+			os.write((const char*)face.mTangents, face.mNumVertices * sizeof(LLVector4a));
+		}
+	}
+	return os.good();
+}
+
+bool LLVolume::unpackOptimizedVolumeFaces(std::istream& is)
+{
+	U32 face_count = 0;
+	if (!is.read((char*)&face_count, sizeof(U32)) || face_count == 0 || face_count > (U32)LL_SCULPT_MESH_MAX_FACES)
+	{
+		return false;
+	}
+
+	mVolumeFaces.resize(face_count);
+	for (U32 i = 0; i < face_count; ++i)
+	{
+		LLVolumeFace& face = mVolumeFaces[i];
+
+		S32 counts[2];
+		U8 flags = 0;
+		if (!is.read((char*)counts, sizeof(counts)) || !is.read((char*)&flags, sizeof(U8))
+			|| counts[0] <= 0 || counts[0] > 65536 || counts[1] < 3 || counts[1] % 3)
+		{
+			mVolumeFaces.clear();
+			return false;
+		}
+
+		face.resizeVertices(counts[0]);
+		face.resizeIndices(counts[1]);
+		is.read((char*)face.mExtents, 2 * sizeof(LLVector4a));
+		is.read((char*)face.mTexCoordExtents, 2 * sizeof(LLVector2));
+		is.read((char*)face.mPositions, 2 * face.mNumVertices * sizeof(LLVector4a));
+		is.read((char*)face.mTexCoords, face.mNumVertices * sizeof(LLVector2));
+		is.read((char*)face.mIndices, face.mNumIndices * sizeof(U16));
+		if (flags & PACKED_FACE_WEIGHTS)
+		{
+			face.allocateWeights(face.mNumVertices);
+			is.read((char*)face.mWeights, face.mNumVertices * sizeof(LLVector4a));
+		}
+		if (flags & PACKED_FACE_TANGENTS)
+		{
+			face.allocateTangents(face.mNumVertices);
+			is.read((char*)face.mTangents, face.mNumVertices * sizeof(LLVector4a));
+		}
+		if (!is)
+		{
+			mVolumeFaces.clear();
+			return false;
+		}
+
+		for (S32 j = 0; j < face.mNumIndices; ++j)
+		{
+			if (face.mIndices[j] >= face.mNumVertices)
+			{ //corrupt entry, never hand out of range indices to the renderer
+				mVolumeFaces.clear();
+				return false;
+			}
+		}
+		face.mOptimized = TRUE;
+	}
+
+	mSculptLevel = 0;
+	return true;
+}
+
 
 S32	LLVolume::getNumFaces() const
 {
@@ -6532,7 +7023,7 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 
 	LLVector4a* norm = mNormals;
 
-	static LLAlignedArray<LLVector4a, 64> triangle_normals;
+	LLAlignedArray<LLVector4a, 64> triangle_normals;
 	triangle_normals.resize(count);
 	LLVector4a* output = triangle_normals.mArray;
 	LLVector4a* end_output = output+count;
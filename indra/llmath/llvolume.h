@@ -43,6 +43,7 @@ template <class T> class LLOctreeNode;
 class LLVolumeFace;
 class LLVolume;
 class LLVolumeTriangle;
+struct LLMeshFaceBlobs;
 
 #include "lluuid.h"
 #include "v4color.h"
@@ -60,6 +61,7 @@ class LLVolumeTriangle;
 #include "llpointer.h"
 #include "llfile.h"
 #include "llalignedarray.h"
+#include "llatomic.h"
 
 //============================================================================
 
@@ -1046,7 +1048,7 @@ public:
 	LLFaceID generateFaceMask();
 
 	BOOL isFaceMaskValid(LLFaceID face_mask);
-	static S32 sNumMeshPoints;
+	static LLAtomicS32 sNumMeshPoints;
 
 	friend std::ostream& operator<<(std::ostream &s, const LLVolume &volume);
 	friend std::ostream& operator<<(std::ostream &s, const LLVolume *volumep);		// HACK to bypass Windoze confusion over 
@@ -1075,8 +1077,12 @@ private:
 protected:
 	BOOL generate();
 	void createVolumeFaces();
+	bool unpackMeshFaces(const std::vector<LLMeshFaceBlobs>& faces);
 public:
 	virtual bool unpackVolumeFaces(std::istream& is, S32 size);
+	// Raw copy of the optimized volume faces, for caches local to this machine.
+	bool packOptimizedVolumeFaces(std::ostream& os) const;
+	bool unpackOptimizedVolumeFaces(std::istream& is);
 
 	virtual void setMeshAssetLoaded(BOOL loaded);
 	virtual BOOL isMeshAssetLoaded();
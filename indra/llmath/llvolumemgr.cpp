@@ -112,6 +112,19 @@ LLVolume* LLVolumeMgr::refVolume(const LLVolumeParams &volume_params, const S32
 	return volgroupp->refLOD(detail);
 }
 
+bool LLVolumeMgr::hasVolume(const LLVolumeParams& volume_params, const S32 detail) const
+{
+	LLVolumeLODGroup* volgroupp = getGroup(volume_params);
+	return volgroupp && volgroupp->hasLOD(detail);
+}
+
+bool LLVolumeMgr::addVolume(LLVolume* volumep, const S32 detail)
+{
+	LLPointer<LLVolume> volume = volumep; // releases the volume if no group takes it
+	LLVolumeLODGroup* volgroupp = getGroup(volumep->getParams());
+	return volgroupp && volgroupp->setLOD(detail, volumep);
+}
+
 // virtual
 LLVolumeLODGroup* LLVolumeMgr::getGroup( const LLVolumeParams& volume_params ) const
 {
@@ -301,6 +314,23 @@ LLVolume* LLVolumeLODGroup::refLOD(const S32 detail)
 	return mVolumeLODs[detail];
 }
 
+bool LLVolumeLODGroup::hasLOD(const S32 detail) const
+{
+	llassert(detail >=0 && detail < NUM_LODS);
+	return mVolumeLODs[detail].notNull();
+}
+
+bool LLVolumeLODGroup::setLOD(const S32 detail, LLVolume* volumep)
+{
+	llassert(detail >=0 && detail < NUM_LODS);
+	if (mVolumeLODs[detail].notNull())
+	{
+		return false;
+	}
+	mVolumeLODs[detail] = volumep;
+	return true;
+}
+
 BOOL LLVolumeLODGroup::derefLOD(LLVolume *volumep)
 {
 	llassert_always(mRefs > 0);
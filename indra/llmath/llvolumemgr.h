@@ -57,6 +57,9 @@ public:
 
 	LLVolume* refLOD(const S32 detail);
 	BOOL derefLOD(LLVolume *volumep);
+	bool hasLOD(const S32 detail) const;
+	// Installs a volume generated elsewhere, returns false if the LOD already exists.
+	bool setLOD(const S32 detail, LLVolume* volumep);
 	S32 getNumRefs() const { return mRefs; }
 	
 	const LLVolumeParams* getVolumeParams() const { return &mVolumeParams; };
@@ -90,6 +93,12 @@ public:
 	virtual LLVolume *refVolume(const LLVolumeParams &volume_params, const S32 detail);
 	virtual void unrefVolume(LLVolume *volumep);
 
+	// Whether refVolume() would return without generating the volume.
+	bool hasVolume(const LLVolumeParams& volume_params, const S32 detail) const;
+	// Hands a volume generated off the main thread to its LOD group. The volume
+	// is dropped if its group is gone or already has that LOD.
+	bool addVolume(LLVolume* volumep, const S32 detail);
+
 	void dump();
 
 	// manually call this for mutex magic
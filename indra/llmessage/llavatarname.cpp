@@ -126,6 +126,35 @@ void LLAvatarName::fromLLSD(const LLSD& sd)
 	}
 }
 
+void LLAvatarName::toRecord(LLNameStore::Record& record) const
+{
+	record.mFlags = mIsDisplayNameDefault ? 1 : 0;
+	record.mTimes[0] = mExpires;
+	record.mTimes[1] = mNextUpdate;
+	record.mStrings.resize(4);
+	record.mStrings[0] = mUsername;
+	record.mStrings[1] = mDisplayName;
+	record.mStrings[2] = mLegacyFirstName;
+	record.mStrings[3] = mLegacyLastName;
+}
+
+bool LLAvatarName::fromRecord(const LLNameStore::Record& record)
+{
+	if (record.mStrings.size() != 4)
+	{
+		return false;
+	}
+	mUsername = record.mStrings[0];
+	mDisplayName = record.mStrings[1];
+	mLegacyFirstName = record.mStrings[2];
+	mLegacyLastName = record.mStrings[3];
+	mIsDisplayNameDefault = (record.mFlags & 1) != 0;
+	mIsTemporaryName = false;
+	mExpires = record.mTimes[0];
+	mNextUpdate = record.mTimes[1];
+	return true;
+}
+
 // Transform a string (typically provided by the legacy service) into a decent
 // avatar name instance.
 void LLAvatarName::fromString(const std::string& full_name)
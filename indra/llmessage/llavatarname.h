@@ -28,6 +28,8 @@
 #ifndef LLAVATARNAME_H
 #define LLAVATARNAME_H
 
+#include "llnamestore.h"
+
 #include <string>
 
 const S32& main_name_system();
@@ -45,6 +47,10 @@ public:
 	LLSD asLLSD() const;
 	void fromLLSD(const LLSD& sd);
 
+	// Conversion to and from a name store record
+	void toRecord(LLNameStore::Record& record) const;
+	bool fromRecord(const LLNameStore::Record& record);
+
 	// Used only in legacy mode when the display name capability is not provided server side
 	// or to otherwise create a temporary valid item.
 	void fromString(const std::string& full_name);
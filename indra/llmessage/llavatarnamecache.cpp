@@ -28,10 +28,12 @@
 
 #include "llavatarnamecache.h"
 
+#include "llatomic.h"
 #include "llcachename.h"		// we wrap this system
 #include "llcontrol.h"		// For LLCachedControl
 #include "llframetimer.h"
 #include "llhttpclient.h"
+#include "llnamestore.h"
 #include "llsd.h"
 #include "llsdserialize.h"
 
@@ -67,6 +69,13 @@ namespace LLAvatarNameCache
 	typedef std::set<LLUUID> ask_queue_t;
 	ask_queue_t sAskQueue;
 
+	// Agent IDs of names on screen, asked for before the ones in sAskQueue.
+	ask_queue_t sUrgentQueue;
+
+	// Number of capability requests that did not finish yet. Atomic since
+	// a responder may be destroyed off the main thread.
+	LLAtomicU32 sRequestsInFlight(0);
+
 	// Agent IDs that have been requested, but with no reply.
 	// Maps agent ID to frame time request was made.
 	typedef std::map<LLUUID, F64> pending_queue_t;
@@ -83,10 +92,13 @@ namespace LLAvatarNameCache
 	typedef std::map<LLUUID, LLAvatarName> cache_t;
 	cache_t sCache;
 
-	// Send bulk lookup requests a few times a second at most.
-	// Only need per-frame timing resolution.
+	// Send bulk lookup requests a few times a second at most, unless they
+	// are full or urgent. Only need per-frame timing resolution.
 	LLFrameTimer sRequestTimer;
 
+	// About the number of ids that fit in a request URL.
+	const U32 IDS_PER_REQUEST = 80;
+
     // Maximum time an unrefreshed cache entry is allowed.
     const F64 MAX_UNREFRESHED_TIME = 20.0 * 60.0;
 
@@ -128,6 +140,11 @@ namespace LLAvatarNameCache
 	void eraseUnrefreshed();
 
 	bool expirationFromCacheControl(AIHTTPReceivedHeaders const& headers, F64* expires);
+
+	// Returns the cached name, from sCache or from the name store if it was
+	// resolved in an earlier session. NULL if neither has it.
+	LLAvatarName* findName(const LLUUID& agent_id);
+	void storeName(const LLUUID& agent_id, const LLAvatarName& av_name);
 }
 
 /* Sample response:
@@ -177,18 +194,40 @@ private:
 	// an error, so we can flag them as unavailable
 	std::vector<LLUUID> mAgentIDs;
 
+	// httpSuccess() may fail the request after all.
+	bool mFinished;
+
 	// Need the headers to look up Expires: and Retry-After:
 	/*virtual*/ bool needsHeaders() const { return true; }
 	/*virtual*/ char const* getName() const { return "LLAvatarNameResponder"; }
 
+	void setFinished()
+	{
+		if (!mFinished)
+		{
+			mFinished = true;
+			--LLAvatarNameCache::sRequestsInFlight;
+		}
+	}
+
 public:
 	LLAvatarNameResponder(const std::vector<LLUUID>& agent_ids)
-	:	mAgentIDs(agent_ids)
-	{ }
+	:	mAgentIDs(agent_ids),
+		mFinished(false)
+	{
+		LLAvatarNameCache::sRequestsInFlight++;
+	}
+
+	// A request that is dropped without a reply frees its slot too.
+	~LLAvatarNameResponder()
+	{
+		setFinished();
+	}
 
 protected:
 	/*virtual*/ void httpSuccess()
 	{
+		setFinished();
 		const LLSD& content = getContent();
 		if (!content.isMap())
 		{
@@ -246,6 +285,7 @@ protected:
 
 	/*virtual*/ void httpFailure()
 	{
+		setFinished();
 		// If there's an error, it might be caused by PeopleApi,
 		// or when loading textures on startup and using a very slow 
 		// network, this query may time out.
@@ -295,6 +335,7 @@ void LLAvatarNameCache::processName(const LLUUID& agent_id, const LLAvatarName&
 {
 	// Add to the cache
 	sCache[agent_id] = av_name;
+	storeName(agent_id, av_name);
 
 	// Suppress request from the queue
 	sPendingQueue.erase(agent_id);
@@ -324,48 +365,46 @@ void LLAvatarNameCache::requestNamesViaCapability()
 	static const U32 NAME_URL_MAX = 4096;
 	static const U32 NAME_URL_SEND_THRESHOLD = 3500;
 
+	// More requests than the service takes connections would only wait in
+	// the curl queue, where urgent ids can no longer overtake them.
+	static const LLCachedControl<U32> connections_per_service("CurlConcurrentConnectionsPerService", 8);
+	const U32 max_requests = llmax((U32)connections_per_service, (U32)1);
+
 	std::string url;
 	url.reserve(NAME_URL_MAX);
 
 	std::vector<LLUUID> agent_ids;
 	agent_ids.reserve(128);
 	
-	U32 ids = 0;
-	ask_queue_t::const_iterator it;
-	while(!sAskQueue.empty())
+	while (sRequestsInFlight < max_requests && (!sUrgentQueue.empty() || !sAskQueue.empty()))
 	{
-		it = sAskQueue.begin();
-		const LLUUID& agent_id = *it;
-		sAskQueue.erase(it);
-
-		if (url.empty())
+		// The remaining background ids wait for more unless they fill a request.
+		if (sUrgentQueue.empty() && sAskQueue.size() < IDS_PER_REQUEST && !sRequestTimer.hasExpired())
 		{
-			// ...starting new request
-			url += sNameLookupURL;
-			url += "?ids=";
-			ids = 1;
+			break;
 		}
-		else
+
+		url = sNameLookupURL;
+		url += "?ids=";
+		agent_ids.clear();
+		while (url.size() <= NAME_URL_SEND_THRESHOLD && (!sUrgentQueue.empty() || !sAskQueue.empty()))
 		{
-			// ...continuing existing request
-			url += "&ids=";
-			ids++;
-		}
-		url += agent_id.asString();
-		agent_ids.push_back(agent_id);
+			ask_queue_t& queue = sUrgentQueue.empty() ? sAskQueue : sUrgentQueue;
+			const LLUUID agent_id = *queue.begin();
+			queue.erase(queue.begin());
 
-		// mark request as pending
-		sPendingQueue[agent_id] = now;
+			if (!agent_ids.empty())
+			{
+				url += "&ids=";
+			}
+			url += agent_id.asString();
+			agent_ids.push_back(agent_id);
 
-		if (url.size() > NAME_URL_SEND_THRESHOLD)
-		{
-			break;
+			// mark request as pending
+			sPendingQueue[agent_id] = now;
 		}
-	}
 
-	if (!url.empty())
-	{
-		LL_INFOS("AvNameCache") << "LLAvatarNameCache::requestNamesViaCapability getting " << ids << " ids" << LL_ENDL;
+		LL_INFOS("AvNameCache") << "LLAvatarNameCache::requestNamesViaCapability getting " << agent_ids.size() << " ids" << LL_ENDL;
 		LLHTTPClient::get(url, new LLAvatarNameResponder(agent_ids));
 	}
 }
@@ -408,11 +447,12 @@ void LLAvatarNameCache::requestNamesViaLegacy()
 	F64 now = LLFrameTimer::getTotalSeconds();
 	std::string full_name;
 	ask_queue_t::const_iterator it;
-	for (S32 requests = 0; !sAskQueue.empty() && requests < MAX_REQUESTS; ++requests)
+	for (S32 requests = 0; (!sUrgentQueue.empty() || !sAskQueue.empty()) && requests < MAX_REQUESTS; ++requests)
 	{
-		it = sAskQueue.begin();
-		const LLUUID& agent_id = *it;
-		sAskQueue.erase(it);
+		ask_queue_t& queue = sUrgentQueue.empty() ? sAskQueue : sUrgentQueue;
+		it = queue.begin();
+		const LLUUID agent_id = *it;
+		queue.erase(it);
 
 		// Mark as pending first, just in case the callback is immediately
 		// invoked below.  This should never happen in practice.
@@ -434,6 +474,7 @@ void LLAvatarNameCache::initClass(bool running, bool usePeopleAPI)
 void LLAvatarNameCache::cleanupClass()
 {
 	sCache.clear();
+	sUrgentQueue.clear();
 }
 
 bool LLAvatarNameCache::importFile(std::istream& istr)
@@ -457,6 +498,7 @@ bool LLAvatarNameCache::importFile(std::istream& istr)
 		agent_id.set(it->first);
 		av_name.fromLLSD( it->second );
 		sCache[agent_id] = av_name;
+		storeName(agent_id, av_name);
 	}
     LL_INFOS("AvNameCache") << "LLAvatarNameCache loaded " << sCache.size() << LL_ENDL;
 	// Some entries may have expired since the cache was stored,
@@ -509,36 +551,35 @@ void LLAvatarNameCache::idle()
 	// By convention, start running at first idle() call
 	sRunning = true;
 
-	// *TODO: Possibly re-enabled this based on People API load measurements
 	// 100 ms is the threshold for "user speed" operations, so we can
 	// stall for about that long to batch up requests.
 	const F32 SECS_BETWEEN_REQUESTS = 0.1f;
-	if (!sRequestTimer.hasExpired())
+
+	if (sAskQueue.empty() && sUrgentQueue.empty())
 	{
-		return;
+		// Start batching up with the next id asked for.
+		sRequestTimer.resetWithExpiry(SECS_BETWEEN_REQUESTS);
 	}
-
-	if (!sAskQueue.empty())
+	else if (usePeopleAPI())
 	{
-        if (usePeopleAPI())
-        {
-            requestNamesViaCapability();
-        }
-        else
-        {
-            LL_WARNS_ONCE("AvNameCache") << "LLAvatarNameCache still using legacy api" << LL_ENDL;
-            requestNamesViaLegacy();
-        }
+		// Urgent ids and full requests go out right away, several requests
+		// may be in flight.
+		if (!sUrgentQueue.empty() || sAskQueue.size() >= IDS_PER_REQUEST || sRequestTimer.hasExpired())
+		{
+			requestNamesViaCapability();
+		}
 	}
-
-	if (sAskQueue.empty())
+	else if (!sUrgentQueue.empty() || sRequestTimer.hasExpired())
 	{
-		// cleared the list, reset the request timer.
-		sRequestTimer.resetWithExpiry(SECS_BETWEEN_REQUESTS);
+		LL_WARNS_ONCE("AvNameCache") << "LLAvatarNameCache still using legacy api" << LL_ENDL;
+		requestNamesViaLegacy();
 	}
 
     // erase anything that has not been refreshed for more than MAX_UNREFRESHED_TIME
     eraseUnrefreshed();
+
+	// Write the names resolved so far, including those of LLCacheName.
+	LLNameStore::getInstance()->idle();
 }
 
 bool LLAvatarNameCache::isRequestPending(const LLUUID& agent_id)
@@ -594,10 +635,9 @@ bool LLAvatarNameCache::get(const LLUUID& agent_id, LLAvatarName *av_name)
 	if (sRunning)
 	{
 		// ...only do immediate lookups when cache is running
-		std::map<LLUUID,LLAvatarName>::iterator it = sCache.find(agent_id);
-		if (it != sCache.end())
+		if (LLAvatarName* cached = findName(agent_id))
 		{
-			*av_name = it->second;
+			*av_name = *cached;
 
 			// re-request name if entry is expired
 			if (av_name->mExpires < LLFrameTimer::getTotalSeconds())
@@ -665,10 +705,9 @@ LLAvatarNameCache::callback_connection_t LLAvatarNameCache::get(const LLUUID& ag
 	if (sRunning)
 	{
 		// ...only do immediate lookups when cache is running
-		std::map<LLUUID,LLAvatarName>::iterator it = sCache.find(agent_id);
-		if (it != sCache.end())
+		if (LLAvatarName* cached = findName(agent_id))
 		{
-			const LLAvatarName& av_name = it->second;
+			const LLAvatarName& av_name = *cached;
 			
 			if (av_name.mExpires > LLFrameTimer::getTotalSeconds())
 			{
@@ -742,15 +781,58 @@ void LLAvatarNameCache::setUseUsernames(bool use)
 	}
 }
 
+void LLAvatarNameCache::prioritize(const LLUUID& agent_id)
+{
+	// Names in flight or not asked for are left alone.
+	if (sAskQueue.erase(agent_id))
+	{
+		sUrgentQueue.insert(agent_id);
+	}
+}
+
 void LLAvatarNameCache::erase(const LLUUID& agent_id)
 {
 	sCache.erase(agent_id);
+	LLNameStore::getInstance()->erase(LLNameStore::KIND_AVATAR_NAME, agent_id);
 }
 
 void LLAvatarNameCache::insert(const LLUUID& agent_id, const LLAvatarName& av_name)
 {
 	// *TODO: update timestamp if zero?
 	sCache[agent_id] = av_name;
+	storeName(agent_id, av_name);
+}
+
+LLAvatarName* LLAvatarNameCache::findName(const LLUUID& agent_id)
+{
+	cache_t::iterator it = sCache.find(agent_id);
+	if (it != sCache.end())
+	{
+		return &it->second;
+	}
+
+	LLNameStore::Record record;
+	LLAvatarName av_name;
+	if (!LLNameStore::getInstance()->find(LLNameStore::KIND_AVATAR_NAME, agent_id, record)
+		|| !av_name.fromRecord(record)
+		// Same expiration as eraseUnrefreshed()
+		|| av_name.mExpires < LLFrameTimer::getTotalSeconds() - MAX_UNREFRESHED_TIME)
+	{
+		return NULL;
+	}
+	return &(sCache[agent_id] = av_name);
+}
+
+void LLAvatarNameCache::storeName(const LLUUID& agent_id, const LLAvatarName& av_name)
+{
+	// Same filter as exportFile(), the store drops expired names itself.
+	if (av_name.isValidName())
+	{
+		LLNameStore::Record record;
+		av_name.toRecord(record);
+		record.mDropAfter = av_name.mExpires + MAX_UNREFRESHED_TIME;
+		LLNameStore::getInstance()->put(LLNameStore::KIND_AVATAR_NAME, agent_id, record);
+	}
 }
 
 F64 LLAvatarNameCache::nameExpirationFromHeaders(AIHTTPReceivedHeaders const& headers)
@@ -79,6 +79,11 @@ namespace LLAvatarNameCache
 	// If name information is in cache, callbacks will be called immediately.
 	callback_connection_t get(const LLUUID& agent_id, callback_slot_t slot);
 
+	// Moves a name that get() could not return ahead of the other queued
+	// ones and sends it without waiting for a full request. For names that
+	// are on screen right now, like name tags and chat.
+	void prioritize(const LLUUID& agent_id);
+
 	// Set display name: flips the switch and triggers the callbacks.
 	void setUseDisplayNames(bool use);
 
@@ -33,6 +33,7 @@
 #include "lldbstrings.h"
 #include "llframetimer.h"
 #include "llhost.h"
+#include "llnamestore.h"
 #include "llrand.h"
 #include "llsdserialize.h"
 #include "lluuid.h"
@@ -55,6 +56,9 @@ const U32 PENDING_TIMEOUT_SECS = 5 * 60;
 // File version number
 const S32 CN_FILE_VERSION = 2;
 
+// Names are kept in the name store for a week
+const U32 STORE_SECS = 7 * 24 * 60 * 60;
+
 // Globals
 LLCacheName* gCacheName = NULL;
 std::map<std::string, std::string> LLCacheName::sCacheName;
@@ -221,6 +225,11 @@ public:
 
 	BOOL getName(const LLUUID& id, std::string& first, std::string& last);
 
+	// Returns the entry from mCache, or from the name store if it was
+	// resolved in an earlier session. NULL if neither has it.
+	LLCacheNameEntry* findEntry(const LLUUID& id);
+	void storeEntry(const LLUUID& id, const LLCacheNameEntry& entry);
+
 	boost::signals2::connection addPending(const LLUUID& id, const LLCacheNameCallback& callback);
 	void addPending(const LLUUID& id, const LLHost& host);
 	
@@ -341,6 +350,7 @@ bool LLCacheName::importFile(std::istream& istr)
 		impl.mCache[id] = entry;
 		std::string fullname = buildFullName(entry->mFirstName, entry->mLastName);
 		impl.mReverseCache[fullname] = id;
+		impl.storeEntry(id, *entry);
 
 		++count;
 	}
@@ -363,6 +373,7 @@ bool LLCacheName::importFile(std::istream& istr)
 		entry->mGroupName = group[NAME].asString();
 		impl.mCache[id] = entry;
 		impl.mReverseCache[entry->mGroupName] = id;
+		impl.storeEntry(id, *entry);
 		++count;
 	}
 	LL_INFOS() << "LLCacheName loaded " << count << " group names" << LL_ENDL;
@@ -415,7 +426,7 @@ BOOL LLCacheName::Impl::getName(const LLUUID& id, std::string& first, std::strin
 		return TRUE;
 	}
 
-	LLCacheNameEntry* entry = get_ptr_in_map(mCache, id );
+	LLCacheNameEntry* entry = findEntry(id);
 	if (entry)
 	{
 		first = entry->mFirstName;
@@ -462,7 +473,7 @@ BOOL LLCacheName::getGroupName(const LLUUID& id, std::string& group)
 		return TRUE;
 	}
 
-	LLCacheNameEntry* entry = get_ptr_in_map(impl.mCache,id);
+	LLCacheNameEntry* entry = impl.findEntry(id);
 	if (entry && entry->mGroupName.empty())
 	{
 		// COUNTER-HACK to combat James' HACK in exportFile()...
@@ -488,6 +499,18 @@ BOOL LLCacheName::getGroupName(const LLUUID& id, std::string& group)
 	}
 }
 
+static bool match_agent_name(const LLNameStore::Record& record, const std::string& full_name, U32 oldest)
+{
+	return record.mStrings.size() == 2 && (U32)record.mTimes[0] >= oldest
+		   && LLCacheName::buildFullName(record.mStrings[0], record.mStrings[1]) == full_name;
+}
+
+static bool match_group_name(const LLNameStore::Record& record, const std::string& group_name, U32 oldest)
+{
+	return record.mStrings.size() == 1 && (U32)record.mTimes[0] >= oldest
+		   && record.mStrings[0] == group_name;
+}
+
 BOOL LLCacheName::getUUID(const std::string& first, const std::string& last, LLUUID& id)
 {
 	std::string full_name = buildFullName(first, last);
@@ -502,10 +525,17 @@ BOOL LLCacheName::getUUID(const std::string& full_name, LLUUID& id)
 		id = iter->second;
 		return TRUE;
 	}
-	else
+
+	// Names resolved in an earlier session are only in the name store.
+	LLNameStore* store = LLNameStore::getInstance();
+	U32 oldest = (U32)time(NULL) - STORE_SECS;
+	if (store->findIf(LLNameStore::KIND_AGENT, boost::bind(&match_agent_name, _2, boost::cref(full_name), oldest), id)
+		|| store->findIf(LLNameStore::KIND_GROUP, boost::bind(&match_group_name, _2, boost::cref(full_name), oldest), id))
 	{
-		return FALSE;
+		impl.findEntry(id);
+		return TRUE;
 	}
+	return FALSE;
 }
 
 //static
@@ -624,7 +654,7 @@ boost::signals2::connection LLCacheName::get(const LLUUID& id, bool is_group, co
 		return res;
 	}
 
-	LLCacheNameEntry* entry = get_ptr_in_map(impl.mCache, id );
+	LLCacheNameEntry* entry = impl.findEntry(id);
 	if (entry)
 	{
 		LLCacheNameSignal signal;
@@ -675,7 +705,7 @@ boost::signals2::connection LLCacheName::get(const LLUUID& id, bool is_group, ol
 bool LLCacheName::getIfThere(const LLUUID& id, std::string& fullname, BOOL& is_group)
 {
 	if (id.notNull())
-	if (LLCacheNameEntry* entry = get_ptr_in_map(impl.mCache, id))
+	if (LLCacheNameEntry* entry = impl.findEntry(id))
 	{
 		fullname = (is_group = entry->mIsGroup) ? entry->mGroupName : entry->mFirstName + " " + entry->mLastName;
 		return true;
@@ -918,7 +948,7 @@ void LLCacheName::Impl::processUUIDRequest(LLMessageSystem* msg, bool isGroup)
 	{
 		LLUUID id;
 		msg->getUUIDFast(_PREHASH_UUIDNameBlock, _PREHASH_ID, id, i);
-		LLCacheNameEntry* entry = get_ptr_in_map(mCache, id);
+		LLCacheNameEntry* entry = findEntry(id);
 		if(entry)
 		{
 			if (isGroup != entry->mIsGroup)
@@ -1014,6 +1044,71 @@ void LLCacheName::Impl::processUUIDReply(LLMessageSystem* msg, bool isGroup)
 			mSignal(id, entry->mGroupName, true);
 			mReverseCache[entry->mGroupName] = id;
 		}
+		storeEntry(id, *entry);
+	}
+}
+
+LLCacheNameEntry* LLCacheName::Impl::findEntry(const LLUUID& id)
+{
+	LLCacheNameEntry* entry = get_ptr_in_map(mCache, id);
+	if (entry || id.isNull())
+	{
+		return entry;
+	}
+
+	LLNameStore* store = LLNameStore::getInstance();
+	LLNameStore::Record record;
+	bool is_group = false;
+	if (!store->find(LLNameStore::KIND_AGENT, id, record) || record.mStrings.size() != 2)
+	{
+		is_group = true;
+		if (!store->find(LLNameStore::KIND_GROUP, id, record) || record.mStrings.size() != 1)
+		{
+			return NULL;
+		}
+	}
+	// Same expiration as importFile()
+	if ((U32)record.mTimes[0] < (U32)time(NULL) - STORE_SECS)
+	{
+		return NULL;
+	}
+
+	entry = new LLCacheNameEntry;
+	entry->mIsGroup = is_group;
+	entry->mCreateTime = (U32)record.mTimes[0];
+	if (is_group)
+	{
+		entry->mGroupName = record.mStrings[0];
+		mReverseCache[entry->mGroupName] = id;
+	}
+	else
+	{
+		entry->mFirstName = record.mStrings[0];
+		entry->mLastName = record.mStrings[1];
+		mReverseCache[LLCacheName::buildFullName(entry->mFirstName, entry->mLastName)] = id;
+	}
+	mCache[id] = entry;
+	return entry;
+}
+
+void LLCacheName::Impl::storeEntry(const LLUUID& id, const LLCacheNameEntry& entry)
+{
+	// Same filter as exportFile()
+	LLNameStore::Record record;
+	record.mTimes[0] = entry.mCreateTime;
+	record.mDropAfter = (F64)entry.mCreateTime + STORE_SECS;
+	if (!entry.mFirstName.empty() && !entry.mLastName.empty()
+		&& std::string::npos == entry.mFirstName.find('?'))
+	{
+		record.mStrings.push_back(entry.mFirstName);
+		record.mStrings.push_back(entry.mLastName);
+		LLNameStore::getInstance()->put(LLNameStore::KIND_AGENT, id, record);
+	}
+	else if (entry.mIsGroup && !entry.mGroupName.empty()
+			 && std::string::npos == entry.mGroupName.find('?'))
+	{
+		record.mStrings.push_back(entry.mGroupName);
+		LLNameStore::getInstance()->put(LLNameStore::KIND_GROUP, id, record);
 	}
 }
 
@@ -324,6 +324,30 @@ void LLHTTPClient::ResponderBase::decode_llsd_body(LLChannelDescriptors const& c
 	}
 	// If the status indicates success (and we get here) then we expect the body to be LLSD.
 	bool const should_be_llsd = isGoodStatus(mStatus);
+	LLSDStreamVisitor* visitor = should_be_llsd ? getContentVisitor() : NULL;
+	if (visitor)
+	{
+		// Feed the segments straight to the parser, the visitor takes the large parts as they complete.
+		LLPointer<LLSDXMLParser> parser = new LLSDXMLParser;
+		parser->setVisitor(visitor);
+		{
+			LLMutexLock lock(buffer->getMutex());
+			LLBufferArray::const_segment_iterator_t const end = buffer->endSegment();
+			for (LLBufferArray::const_segment_iterator_t iter = buffer->beginSegment(); iter != end; ++iter)
+			{
+				if (iter->isOnChannel(channels.in()) && !parser->parseChunk((char const*)iter->data(), iter->size()))
+				{
+					break;
+				}
+			}
+		}
+		if (parser->finishChunks(mContent) == LLSDParser::PARSE_FAILURE)
+		{
+			LL_WARNS() << "Failed to deserialize LLSD. " << mURL << " [" << mStatus << "]: " << mReason << LL_ENDL;
+			AICurlInterface::Stats::llsd_body_parse_error++;
+		}
+		return;
+	}
 	if (should_be_llsd)
 	{
 		LLBufferStream istr(channels, buffer.get());
@@ -43,6 +43,7 @@
 class LLUUID;
 class LLPumpIO;
 class LLSD;
+class LLSDStreamVisitor;
 class AIHTTPTimeoutPolicy;
 class LLBufferArray;
 class LLChannelDescriptors;
@@ -164,6 +165,10 @@ public:
 		// Read body from buffer and put it into content. Always copy it as-is.
 		void decode_raw_body(LLChannelDescriptors const& channels, buffer_ptr_t const& buffer, std::string& content);
 
+		// Derived classes can return a visitor here to have the values it splits off a large LLSD body
+		// streamed through it while the body is parsed; mContent then only gets what is left.
+		virtual LLSDStreamVisitor* getContentVisitor(void) { return NULL; }
+
 	protected:
 		// Associated URL, used for debug output.
 		std::string mURL;
@@ -45,8 +45,9 @@ void LLMsgVarData::addData(const void *data, S32 size, EMsgVariableType type, S3
 	}
 	if(size)
 	{
-		delete[] mData; // Delete it if it already exists
+		deleteData(); // Delete it if it already exists
 		mData = new U8[size];
+		mOwnsData = true;
 		htonmemcpy(mData, data, mType, size);
 	}
 }
@@ -171,6 +172,53 @@ std::ostream& operator<<(std::ostream& s, LLMessageTemplate &msg)
 	return s;
 }
 
+void LLMessageTemplate::buildDecodePlan()
+{
+	mDecodeBlocks.clear();
+	mDecodeVariables.clear();
+	for (message_block_map_t::const_iterator iter = mMemberBlocks.begin();
+		 iter != mMemberBlocks.end(); ++iter)
+	{
+		const LLMessageBlock* blockp = *iter;
+		LLMessageDecodeBlock block;
+		block.mName = blockp->mName;
+		block.mType = blockp->mType;
+		block.mNumber = blockp->mNumber;
+		block.mFixedSize = 0;
+		block.mFirstVariable = mDecodeVariables.size();
+		block.mVariableCount = blockp->mMemberVariables.size();
+		for (LLMessageBlock::message_variable_map_t::const_iterator var_iter = blockp->mMemberVariables.begin();
+			 var_iter != blockp->mMemberVariables.end(); ++var_iter)
+		{
+			const LLMessageVariable* varp = *var_iter;
+			LLMessageDecodeVariable var;
+			var.mName = varp->getName();
+			var.mType = varp->getType();
+			var.mSize = varp->getSize();
+			var.mOffset = block.mFixedSize;
+			if (var.mType == MVT_VARIABLE)
+			{
+				block.mFixedSize = -1;
+			}
+			else if (block.mFixedSize >= 0)
+			{
+				block.mFixedSize += var.mSize;
+			}
+			mDecodeVariables.push_back(var);
+		}
+		if (block.mFixedSize < 0)
+		{
+			// Offsets depend on the variable size fields in the packet.
+			for (U32 i = block.mFirstVariable; i < mDecodeVariables.size(); ++i)
+			{
+				mDecodeVariables[i].mOffset = -1;
+			}
+		}
+		mDecodeBlocks.push_back(block);
+	}
+	mDecodePlanBuilt = true;
+}
+
 void LLMessageTemplate::banUdp()
 {
 	static const char* deprecation[] = {
@@ -35,11 +35,11 @@
 class LLMsgVarData
 {
 public:
-	LLMsgVarData() : mName(NULL), mSize(-1), mDataSize(-1), mData(NULL), mType(MVT_U8)
+	LLMsgVarData() : mName(NULL), mSize(-1), mDataSize(-1), mData(NULL), mType(MVT_U8), mOwnsData(true)
 	{
 	}
 
-	LLMsgVarData(const char *name, EMsgVariableType type) : mSize(-1), mDataSize(-1), mData(NULL), mType(type)
+	LLMsgVarData(const char *name, EMsgVariableType type) : mSize(-1), mDataSize(-1), mData(NULL), mType(type), mOwnsData(true)
 	{
 		mName = (char *)name; 
 	}
@@ -51,11 +51,22 @@ public:
 	
 	void deleteData() 
 	{
-		delete[] mData;
+		if (mOwnsData)
+		{
+			delete[] mData;
+		}
 		mData = NULL;
 	}
 	
 	void addData(const void *indata, S32 size, EMsgVariableType type, S32 data_size = -1);
+	// Points the variable at size bytes that live in someone else's storage.
+	void setDataInPlace(U8 *data, S32 size)
+	{
+		deleteData();
+		mSize = size;
+		mData = size ? data : NULL;
+		mOwnsData = false;
+	}
 
 	char *getName() const	{ return mName; }
 	S32 getSize() const		{ return mSize; }
@@ -71,6 +82,7 @@ protected:
 
 	U8					*mData;
 	EMsgVariableType	mType;
+	bool				mOwnsData;
 };
 
 class LLMsgBlkData
@@ -102,6 +114,15 @@ public:
 		temp->addData(data, size, type, data_size);
 	}
 
+	// addVariable() and addData() in one lookup, for data already copied into
+	// the owning LLMsgData's buffer.
+	void addVariableInPlace(const char *name, EMsgVariableType type, U8 *data, S32 size)
+	{
+		LLMsgVarData& var = mMemberVarData[name];
+		var = LLMsgVarData(name, type);
+		var.setDataInPlace(data, size);
+	}
+
 	S32									mBlockNumber;
 	typedef LLIndexedVector<LLMsgVarData, const char *, 8> msg_var_data_map_t;
 	msg_var_data_map_t					mMemberVarData;
@@ -134,6 +155,9 @@ public:
 	msg_blk_data_map_t					mMemberBlocks;
 	char								*mName;
 	S32									mTotalSize;
+	// Backing store of the variables the template reader added in place.
+	// Sized once per message so the pointers into it stay valid.
+	std::vector<U8>						mBuffer;
 };
 
 // LLMessage* classes store the template of messages
@@ -264,6 +288,27 @@ enum EMsgDeprecation
 	MD_DEPRECATED
 };
 
+// Flattened form of a message template, built once per template and walked
+// by LLTemplateMessageReader::decodeData() instead of the block and variable
+// maps.
+struct LLMessageDecodeVariable
+{
+	char				*mName;
+	EMsgVariableType	mType;
+	S32					mSize;		// Fixed size, or bytes of size info for MVT_VARIABLE
+	S32					mOffset;	// Offset in the block when the block is all fixed size, else -1
+};
+
+struct LLMessageDecodeBlock
+{
+	char				*mName;
+	EMsgBlockType		mType;
+	S32					mNumber;
+	S32					mFixedSize;	// Size of one block when no variable is MVT_VARIABLE, else -1
+	U32					mFirstVariable;
+	U32					mVariableCount;
+};
+
 class LLMessageTemplate
 {
 public:
@@ -286,6 +331,7 @@ public:
 		mMaxDecodeTimePerMsg(0.f),
 		mBanFromTrusted(false),
 		mBanFromUntrusted(false),
+		mDecodePlanBuilt(false),
 		mHandlerFunc(NULL), 
 		mUserData(NULL)
 	{ 
@@ -306,6 +352,7 @@ public:
 				<< "has already been used as a block name!" << LL_ENDL;
 		}
 		*member_blockp = blockp;
+		mDecodePlanBuilt = false;
 		if (  (mTotalSize != -1)
 			&&(blockp->mTotalSize != -1)
 			&&(  (blockp->mType == MBT_SINGLE)
@@ -391,6 +438,18 @@ public:
 		return iter != mMemberBlocks.end()? *iter : NULL;
 	}
 
+	typedef std::vector<LLMessageDecodeBlock> decode_block_vec_t;
+	typedef std::vector<LLMessageDecodeVariable> decode_variable_vec_t;
+	const decode_block_vec_t& getDecodeBlocks()
+	{
+		if (!mDecodePlanBuilt)
+		{
+			buildDecodePlan();
+		}
+		return mDecodeBlocks;
+	}
+	const decode_variable_vec_t& getDecodeVariables() const { return mDecodeVariables; }
+
 public:
 	typedef LLIndexedVector<LLMessageBlock*, char*, 8> message_block_map_t;
 	message_block_map_t						mMemberBlocks;
@@ -413,6 +472,12 @@ public:
 	bool									mBanFromUntrusted;
 
 private:
+	void buildDecodePlan();
+
+	decode_block_vec_t						mDecodeBlocks;
+	decode_variable_vec_t					mDecodeVariables;
+	bool									mDecodePlanBuilt;
+
 	// message handler function (this is set by each application)
 	void									(*mHandlerFunc)(LLMessageSystem *msgsystem, void **user_data);
 	void									**mUserData;
@@ -0,0 +1,624 @@
+/**
+ * @file llnamestore.cpp
+ * @brief Memory mapped store of the names known to LLCacheName and LLAvatarNameCache.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+
+#include "linden_common.h"
+
+#include "llnamestore.h"
+
+#include "llfile.h"
+#include "lltimer.h"
+
+#include <time.h>
+
+static const U32 STORE_MAGIC = 0x534d414e; // "NAMS"
+const S32 LLNameStore::STORE_VERSION = 1;
+
+// However many records expire, the store is compacted at most this often.
+static const F64 MIN_COMPACT_INTERVAL = 24.0 * 60.0 * 60.0;
+
+typedef LLNameStore::Header store_header_t;
+typedef LLNameStore::RecordHeader record_header_t;
+typedef LLNameStore::IndexEntry index_entry_t;
+
+static F64 get_now()
+{
+	return (F64)time(NULL);
+}
+
+static U32 get_key_hash(U32 kind, const LLUUID& id)
+{
+	return (U32)id.hash() ^ (kind * 0x9e3779b9U);
+}
+
+// At most half full, so the probe sequences stay short.
+static U32 get_index_size(U32 num_records)
+{
+	U32 size = 16;
+	while (size < num_records * 2)
+	{
+		size <<= 1;
+	}
+	return size;
+}
+
+static void insert_index_entry(std::vector<index_entry_t>& index, U32 hash, U32 offset)
+{
+	const U32 mask = index.size() - 1;
+	U32 bucket = hash & mask;
+	while (index[bucket].mOffset)
+	{
+		bucket = (bucket + 1) & mask;
+	}
+	index[bucket].mHash = hash;
+	index[bucket].mOffset = offset;
+}
+
+static void pack_record(U32 kind, const LLUUID& id, const LLNameStore::Record& record, std::string& data)
+{
+	record_header_t header;
+	memset(&header, 0, sizeof(header));
+	header.mID = id;
+	header.mKind = kind;
+	header.mFlags = record.mFlags;
+	header.mNumStrings = record.mStrings.size();
+	header.mTimes[0] = record.mTimes[0];
+	header.mTimes[1] = record.mTimes[1];
+	header.mDropAfter = record.mDropAfter;
+	U32 size = sizeof(header);
+	for (std::vector<std::string>::const_iterator iter = record.mStrings.begin(); iter != record.mStrings.end(); ++iter)
+	{
+		size += sizeof(U32) + iter->size();
+	}
+	header.mSize = (size + 7) & ~7;
+
+	const std::string::size_type start = data.size();
+	data.append((const char*)&header, sizeof(header));
+	for (std::vector<std::string>::const_iterator iter = record.mStrings.begin(); iter != record.mStrings.end(); ++iter)
+	{
+		U32 length = iter->size();
+		data.append((const char*)&length, sizeof(length));
+		data.append(*iter);
+	}
+	data.append(start + header.mSize - data.size(), '\0');
+}
+
+// Returns NULL if no record fits at offset.
+static const record_header_t* get_record(const U8* base, U32 data_end, U32 offset)
+{
+	if (offset < sizeof(store_header_t) || (offset & 7) || data_end < sizeof(record_header_t)
+		|| offset > data_end - sizeof(record_header_t))
+	{
+		return NULL;
+	}
+	const record_header_t* header = (const record_header_t*)(base + offset);
+	if (header->mSize < sizeof(record_header_t) || header->mSize > data_end - offset)
+	{
+		return NULL;
+	}
+	return header;
+}
+
+// Returns false if the strings run past the record.
+static bool unpack_record(const record_header_t* header, LLNameStore::Record& record)
+{
+	record.mFlags = header->mFlags;
+	record.mTimes[0] = header->mTimes[0];
+	record.mTimes[1] = header->mTimes[1];
+	record.mDropAfter = header->mDropAfter;
+
+	const U8* ptr = (const U8*)(header + 1);
+	const U8* end = (const U8*)header + header->mSize;
+	if (header->mNumStrings > (U32)(end - ptr) / sizeof(U32))
+	{
+		return false;
+	}
+	record.mStrings.resize(header->mNumStrings);
+	for (U32 i = 0; i < header->mNumStrings; ++i)
+	{
+		U32 length;
+		if ((size_t)(end - ptr) < sizeof(length))
+		{
+			return false;
+		}
+		memcpy(&length, ptr, sizeof(length));
+		ptr += sizeof(length);
+		if ((U32)(end - ptr) < length)
+		{
+			return false;
+		}
+		record.mStrings[i].assign((const char*)ptr, length);
+		ptr += length;
+	}
+	return true;
+}
+
+static bool write_file(LLFILE* fp, const void* data, size_t size)
+{
+	return !size || fwrite(data, size, 1, fp) == 1;
+}
+
+// Writes the index and then the header, which makes the new data live.
+static bool write_index_and_header(LLFILE* fp, const std::vector<index_entry_t>& index, const store_header_t& header)
+{
+	return write_file(fp, &index[0], index.size() * sizeof(index_entry_t))
+		   && fflush(fp) == 0
+		   && fseek(fp, 0, SEEK_SET) == 0
+		   && write_file(fp, &header, sizeof(header));
+}
+
+static void init_header(store_header_t& header)
+{
+	memset(&header, 0, sizeof(header));
+	header.mMagic = STORE_MAGIC;
+	header.mVersion = LLNameStore::STORE_VERSION;
+}
+
+//----------------------------------------------------------------------------
+
+LLNameStore::Record::Record()
+	: mFlags(0),
+	  mDropAfter(0.0)
+{
+	mTimes[0] = mTimes[1] = 0.0;
+}
+
+LLNameStore::LLNameStore()
+	: mHeader(NULL),
+	  mIndex(NULL),
+	  mCompactor(NULL)
+{
+}
+
+LLNameStore::~LLNameStore()
+{
+	finishCompaction(true);
+}
+
+bool LLNameStore::open(const std::string& filename)
+{
+	// Records put before the store was opened are kept for the first flush.
+	if (isOpen())
+	{
+		close();
+	}
+	mFilename = filename;
+	map();
+	if (!mHeader)
+	{
+		return false;
+	}
+
+	const U32 dead_size = mHeader->mDataEnd - mHeader->mLiveSize;
+	if (dead_size > mHeader->mLiveSize || get_now() >= mHeader->mCompactAfter)
+	{
+		mCompactor = new LLNameStoreCompactor(mView, mFilename + ".t");
+		mCompactor->start();
+	}
+	LL_INFOS("NameStore") << "Mapped " << mHeader->mNumRecords << " names from " << mFilename << LL_ENDL;
+	return true;
+}
+
+void LLNameStore::close()
+{
+	if (isOpen())
+	{
+		flush();
+	}
+	finishCompaction(true);
+	unmap();
+	mPending.clear();
+	mFilename.clear();
+}
+
+void LLNameStore::idle()
+{
+	// Every flush appends a whole new index, so do not flush too often.
+	const U32 FLUSH_PENDING_RECORDS = 512;
+	const F32 FLUSH_INTERVAL = 300.f;
+
+	if (!isOpen() || mPending.empty())
+	{
+		mFlushTimer.reset();
+		return;
+	}
+	if (mPending.size() < FLUSH_PENDING_RECORDS && mFlushTimer.getElapsedTimeF32() < FLUSH_INTERVAL)
+	{
+		return;
+	}
+	// The records go to the compacted file, try again once it landed.
+	finishCompaction(false);
+	if (mCompactor)
+	{
+		return;
+	}
+	flush();
+	mFlushTimer.reset();
+}
+
+void LLNameStore::map()
+{
+	unmap();
+
+	llstat file_status;
+	if (LLFile::stat(mFilename, &file_status) != 0
+		|| (U64)file_status.st_size < sizeof(store_header_t)
+		|| (U64)file_status.st_size > U32_MAX)
+	{
+		return;
+	}
+	LLPointer<LLMappedFileView> view = new LLMappedFileView(mFilename, 0, (U32)file_status.st_size);
+	if (!view->isValid())
+	{
+		return;
+	}
+
+	const store_header_t* header = (const store_header_t*)view->getData();
+	if (header->mMagic != STORE_MAGIC
+		|| header->mVersion != STORE_VERSION
+		|| header->mDataEnd > view->getSize()
+		|| header->mLiveSize > header->mDataEnd
+		|| !header->mIndexSize
+		|| (header->mIndexSize & (header->mIndexSize - 1))
+		|| header->mIndexOffset < sizeof(store_header_t)
+		|| (header->mIndexOffset & 7)
+		|| (U64)header->mIndexOffset + (U64)header->mIndexSize * sizeof(index_entry_t) > header->mDataEnd)
+	{
+		LL_WARNS("NameStore") << "Ignoring obsolete or damaged " << mFilename << LL_ENDL;
+		return;
+	}
+
+	mView = view;
+	mHeader = header;
+	mIndex = (const index_entry_t*)(view->getData() + header->mIndexOffset);
+}
+
+void LLNameStore::unmap()
+{
+	mHeader = NULL;
+	mIndex = NULL;
+	mView = NULL;
+}
+
+void LLNameStore::finishCompaction(bool wait)
+{
+	if (!mCompactor || (!wait && !mCompactor->isStopped()))
+	{
+		return;
+	}
+	while (!mCompactor->isStopped())
+	{
+		ms_sleep(1);
+	}
+	const bool succeeded = mCompactor->succeeded();
+	delete mCompactor;
+	mCompactor = NULL;
+	if (!succeeded || mFilename.empty())
+	{
+		return;
+	}
+
+	const std::string temp_filename(mFilename + ".t");
+	unmap();
+#if LL_WINDOWS
+	// Rename in windows needs the destination to not exist.
+	LLFile::remove_nowarn(mFilename);
+#endif
+	if (LLFile::rename(temp_filename, mFilename) != 0)
+	{
+		LL_WARNS("NameStore") << "Unable to replace " << mFilename << " with its compacted copy" << LL_ENDL;
+		LLFile::remove(temp_filename);
+	}
+	map();
+}
+
+const LLNameStore::RecordHeader* LLNameStore::findRecord(U32 kind, const LLUUID& id) const
+{
+	if (!mHeader)
+	{
+		return NULL;
+	}
+
+	const U32 hash = get_key_hash(kind, id);
+	const U32 mask = mHeader->mIndexSize - 1;
+	for (U32 probe = 0, bucket = hash & mask; probe < mHeader->mIndexSize; ++probe, bucket = (bucket + 1) & mask)
+	{
+		const index_entry_t& entry = mIndex[bucket];
+		if (!entry.mOffset)
+		{
+			break;
+		}
+		if (entry.mHash != hash)
+		{
+			continue;
+		}
+		const record_header_t* header = get_record(mView->getData(), mHeader->mDataEnd, entry.mOffset);
+		if (header && header->mKind == kind && header->mID == id)
+		{
+			return header;
+		}
+	}
+	return NULL;
+}
+
+bool LLNameStore::find(EKind kind, const LLUUID& id, Record& record) const
+{
+	pending_map_t::const_iterator pending = mPending.find(key_t(kind, id));
+	if (pending != mPending.end())
+	{
+		if (pending->second.mErased)
+		{
+			return false;
+		}
+		record = pending->second.mRecord;
+		return true;
+	}
+
+	const record_header_t* header = findRecord(kind, id);
+	return header && unpack_record(header, record);
+}
+
+bool LLNameStore::findIf(EKind kind, const match_func_t& match, LLUUID& id) const
+{
+	for (pending_map_t::const_iterator iter = mPending.begin(); iter != mPending.end(); ++iter)
+	{
+		if (iter->first.first == (U32)kind && !iter->second.mErased && match(iter->first.second, iter->second.mRecord))
+		{
+			id = iter->first.second;
+			return true;
+		}
+	}
+
+	if (!mHeader)
+	{
+		return false;
+	}
+	Record record;
+	for (U32 i = 0; i < mHeader->mIndexSize; ++i)
+	{
+		const record_header_t* header = get_record(mView->getData(), mHeader->mDataEnd, mIndex[i].mOffset);
+		if (header && header->mKind == (U32)kind
+			&& !mPending.count(key_t(kind, header->mID))
+			&& unpack_record(header, record)
+			&& match(header->mID, record))
+		{
+			id = header->mID;
+			return true;
+		}
+	}
+	return false;
+}
+
+void LLNameStore::put(EKind kind, const LLUUID& id, const Record& record)
+{
+	PendingRecord& pending = mPending[key_t(kind, id)];
+	pending.mRecord = record;
+	pending.mErased = false;
+}
+
+void LLNameStore::erase(EKind kind, const LLUUID& id)
+{
+	PendingRecord& pending = mPending[key_t(kind, id)];
+	pending.mRecord = Record();
+	pending.mErased = true;
+}
+
+U32 LLNameStore::getNumRecords() const
+{
+	return (mHeader ? mHeader->mNumRecords : 0) + mPending.size();
+}
+
+bool LLNameStore::flush()
+{
+	if (!isOpen())
+	{
+		return false;
+	}
+	// A finished compaction must land first, the records go to the new file.
+	finishCompaction(true);
+	if (mPending.empty())
+	{
+		return true;
+	}
+
+	const F64 now = get_now();
+	store_header_t header;
+	init_header(header);
+	header.mLiveSize = sizeof(store_header_t);
+	F64 first_drop = mHeader ? mHeader->mCompactAfter : F64_MAX;
+
+	// The records of the file that were not replaced.
+	std::vector<index_entry_t> kept;
+	if (mHeader)
+	{
+		for (U32 i = 0; i < mHeader->mIndexSize; ++i)
+		{
+			const record_header_t* record = get_record(mView->getData(), mHeader->mDataEnd, mIndex[i].mOffset);
+			if (record && !mPending.count(key_t(record->mKind, record->mID)))
+			{
+				kept.push_back(mIndex[i]);
+				header.mLiveSize += record->mSize;
+			}
+		}
+	}
+
+	// The new records, at offsets relative to the end of the old data.
+	std::string data;
+	std::vector<index_entry_t> added;
+	for (pending_map_t::const_iterator iter = mPending.begin(); iter != mPending.end(); ++iter)
+	{
+		if (iter->second.mErased)
+		{
+			continue;
+		}
+		index_entry_t entry;
+		entry.mHash = get_key_hash(iter->first.first, iter->first.second);
+		entry.mOffset = data.size();
+		added.push_back(entry);
+		pack_record(iter->first.first, iter->first.second, iter->second.mRecord, data);
+		first_drop = llmin(first_drop, iter->second.mRecord.mDropAfter);
+	}
+
+	header.mNumRecords = kept.size() + added.size();
+	header.mIndexSize = get_index_size(header.mNumRecords);
+	header.mCompactAfter = llmax(first_drop, now + MIN_COMPACT_INTERVAL);
+	const U32 data_start = mHeader ? mHeader->mDataEnd : sizeof(store_header_t);
+	const U64 data_end = (U64)data_start + data.size() + (U64)header.mIndexSize * sizeof(index_entry_t);
+	if (data_end > U32_MAX)
+	{
+		LL_WARNS("NameStore") << "Name store too large, discarding " << mFilename << LL_ENDL;
+		unmap();
+		LLFile::remove(mFilename);
+		mPending.clear();
+		return false;
+	}
+	header.mIndexOffset = data_start + data.size();
+	header.mDataEnd = (U32)data_end;
+	header.mLiveSize += data.size() + header.mIndexSize * sizeof(index_entry_t);
+
+	std::vector<index_entry_t> index(header.mIndexSize);
+	memset(&index[0], 0, index.size() * sizeof(index_entry_t));
+	for (std::vector<index_entry_t>::const_iterator iter = kept.begin(); iter != kept.end(); ++iter)
+	{
+		insert_index_entry(index, iter->mHash, iter->mOffset);
+	}
+	for (std::vector<index_entry_t>::const_iterator iter = added.begin(); iter != added.end(); ++iter)
+	{
+		insert_index_entry(index, iter->mHash, data_start + iter->mOffset);
+	}
+
+	const bool append = mHeader != NULL;
+	unmap();
+	mPending.clear();
+
+	bool ok;
+	if (append)
+	{
+		// Leave the old records in place, only the header changes in the
+		// range that was mapped.
+		LLFILE* fp = LLFile::fopen(mFilename, "r+b");
+		ok = fp
+			 && fseek(fp, data_start, SEEK_SET) == 0
+			 && write_file(fp, data.data(), data.size())
+			 && write_index_and_header(fp, index, header);
+		ok = fp && LLFile::close(fp) == 0 && ok;
+	}
+	else
+	{
+		LLFILE* fp = LLFile::fopen(mFilename, "wb");
+		store_header_t empty_header;
+		memset(&empty_header, 0, sizeof(empty_header));
+		ok = fp
+			 && write_file(fp, &empty_header, sizeof(empty_header)) // rewritten last
+			 && write_file(fp, data.data(), data.size())
+			 && write_index_and_header(fp, index, header);
+		ok = fp && LLFile::close(fp) == 0 && ok;
+	}
+	if (!ok)
+	{
+		// The header may be half written, do not trust the file anymore.
+		LL_WARNS("NameStore") << "Unable to write " << mFilename << LL_ENDL;
+		LLFile::remove(mFilename);
+		return false;
+	}
+	LL_INFOS("NameStore") << "Wrote " << added.size() << " names, " << header.mNumRecords << " in " << mFilename << LL_ENDL;
+
+	map();
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+LLNameStoreCompactor::LLNameStoreCompactor(const LLPointer<LLMappedFileView>& view, const std::string& filename)
+	: LLThread("Name store compaction"),
+	  mView(view),
+	  mFilename(filename),
+	  mNow(get_now()),
+	  mSucceeded(false)
+{
+}
+
+//virtual
+void LLNameStoreCompactor::run()
+{
+	const U8* base = mView->getData();
+	const store_header_t* old_header = (const store_header_t*)base;
+	const index_entry_t* old_index = (const index_entry_t*)(base + old_header->mIndexOffset);
+
+	LLFILE* fp = LLFile::fopen(mFilename, "wb");
+	if (!fp)
+	{
+		LL_WARNS("NameStore") << "Unable to write " << mFilename << LL_ENDL;
+		return;
+	}
+
+	store_header_t header;
+	init_header(header);
+	bool ok = write_file(fp, &header, sizeof(header)); // rewritten last
+
+	// Copy the records that did not expire, in index order.
+	std::vector<index_entry_t> entries;
+	U32 offset = sizeof(header);
+	F64 first_drop = F64_MAX;
+	for (U32 i = 0; ok && i < old_header->mIndexSize; ++i)
+	{
+		const record_header_t* record = get_record(base, old_header->mDataEnd, old_index[i].mOffset);
+		if (!record || record->mDropAfter <= mNow)
+		{
+			continue;
+		}
+		index_entry_t entry;
+		entry.mHash = old_index[i].mHash;
+		entry.mOffset = offset;
+		entries.push_back(entry);
+		ok = write_file(fp, record, record->mSize);
+		offset += record->mSize;
+		first_drop = llmin(first_drop, record->mDropAfter);
+	}
+
+	header.mNumRecords = entries.size();
+	header.mIndexSize = get_index_size(header.mNumRecords);
+	header.mIndexOffset = offset;
+	header.mDataEnd = offset + header.mIndexSize * sizeof(index_entry_t);
+	header.mLiveSize = header.mDataEnd;
+	header.mCompactAfter = llmax(first_drop, mNow + MIN_COMPACT_INTERVAL);
+	std::vector<index_entry_t> index(header.mIndexSize);
+	memset(&index[0], 0, index.size() * sizeof(index_entry_t));
+	for (std::vector<index_entry_t>::const_iterator iter = entries.begin(); iter != entries.end(); ++iter)
+	{
+		insert_index_entry(index, iter->mHash, iter->mOffset);
+	}
+	ok = ok && write_index_and_header(fp, index, header);
+	ok = LLFile::close(fp) == 0 && ok;
+	if (!ok)
+	{
+		LL_WARNS("NameStore") << "Unable to write " << mFilename << LL_ENDL;
+		LLFile::remove(mFilename);
+		return;
+	}
+	LL_INFOS("NameStore") << "Compacted " << old_header->mNumRecords << " names to " << header.mNumRecords << LL_ENDL;
+	mSucceeded = true;
+}
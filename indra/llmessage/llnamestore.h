@@ -0,0 +1,183 @@
+/**
+ * @file llnamestore.h
+ * @brief Memory mapped store of the names known to LLCacheName and LLAvatarNameCache.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+
+#ifndef LL_LLNAMESTORE_H
+#define LL_LLNAMESTORE_H
+
+#include "llframetimer.h"
+#include "llmappedfile.h"
+#include "llpointer.h"
+#include "llsingleton.h"
+#include "llthread.h"
+#include "lluuid.h"
+
+#include <boost/function.hpp>
+#include <map>
+#include <string>
+#include <vector>
+
+class LLNameStoreCompactor;
+
+// The names LLCacheName and LLAvatarNameCache resolved, kept in one file
+// that is mapped rather than parsed at login. Lookups go straight to the
+// record through a hash index in the file.
+//
+// The file is a Header, the records, each a RecordHeader followed by its
+// strings, and the index: a power of two sized table of IndexEntry, probed
+// linearly from the hash of the kind and id. Records put during the session
+// are appended with a new index at flush(), and only then is the header
+// pointed at it. Superseded records and old indices are dead space, once
+// there is more dead than live data, or a record expired, the live records
+// are copied to a new file on a background thread.
+class LLNameStore : public LLSingleton<LLNameStore>
+{
+	friend class LLNameStoreCompactor;
+
+public:
+	enum EKind
+	{
+		KIND_AGENT = 1,			// LLCacheName agent: first and last name
+		KIND_GROUP = 2,			// LLCacheName group: group name
+		KIND_AVATAR_NAME = 3	// LLAvatarNameCache entry
+	};
+
+	struct Record
+	{
+		Record();
+
+		U32 mFlags;
+		F64 mTimes[2];
+		F64 mDropAfter;		// Seconds since epoch after which the record is discarded
+		std::vector<std::string> mStrings;
+	};
+
+	typedef boost::function<bool (const LLUUID& id, const Record& record)> match_func_t;
+
+	LLNameStore();
+	~LLNameStore();
+
+	// Maps filename, an existing file that is obsolete or damaged is
+	// replaced at the next flush(). Returns false if filename held no store.
+	// Until then lookups only see the records put during the session.
+	bool open(const std::string& filename);
+	bool isOpen() const { return !mFilename.empty(); }
+
+	// Writes the records put since the last flush, returns false on failure.
+	bool flush();
+	// Flushes and unmaps the store.
+	void close();
+	// Call once per frame. Flushes once enough records are pending or the
+	// first of them waited long enough, so a crash loses few names. Never
+	// waits for a running compaction.
+	void idle();
+
+	// Returns false if there is no record of kind for id.
+	bool find(EKind kind, const LLUUID& id, Record& record) const;
+	// Looks at every record of kind until match returns true, for lookups
+	// by name. Slow, returns false if none matched.
+	bool findIf(EKind kind, const match_func_t& match, LLUUID& id) const;
+
+	void put(EKind kind, const LLUUID& id, const Record& record);
+	void erase(EKind kind, const LLUUID& id);
+
+	U32 getNumRecords() const;
+
+	static const S32 STORE_VERSION;
+
+	struct Header
+	{
+		U32 mMagic;
+		S32 mVersion;
+		U32 mDataEnd;
+		U32 mIndexOffset;
+		U32 mIndexSize;		// Entries, a power of two
+		U32 mNumRecords;
+		U32 mLiveSize;		// Bytes of the header, live records and index
+		U32 mReserved;
+		F64 mCompactAfter;	// Seconds since epoch
+	};
+
+	struct RecordHeader
+	{
+		LLUUID mID;
+		U32 mKind;
+		U32 mFlags;
+		U32 mSize;			// Including the strings, a multiple of 8
+		U32 mNumStrings;
+		F64 mTimes[2];
+		F64 mDropAfter;
+	};
+
+	struct IndexEntry
+	{
+		U32 mHash;
+		U32 mOffset;		// 0 if empty
+	};
+
+private:
+	typedef std::pair<U32, LLUUID> key_t;
+
+	struct PendingRecord
+	{
+		Record mRecord;
+		bool mErased;
+	};
+	typedef std::map<key_t, PendingRecord> pending_map_t;
+
+	void map();
+	void unmap();
+	void finishCompaction(bool wait);
+	const RecordHeader* findRecord(U32 kind, const LLUUID& id) const;
+
+	std::string mFilename;
+	LLPointer<LLMappedFileView> mView;
+	const Header* mHeader;		// NULL if there is no usable file
+	const IndexEntry* mIndex;
+	pending_map_t mPending;
+	LLFrameTimer mFlushTimer;	// Since mPending was last empty
+	LLNameStoreCompactor* mCompactor;
+};
+
+// Copies the live records of a store to a new file.
+class LLNameStoreCompactor : public LLThread
+{
+public:
+	LLNameStoreCompactor(const LLPointer<LLMappedFileView>& view, const std::string& filename);
+
+	// Only valid once the thread stopped.
+	bool succeeded() const { return mSucceeded; }
+
+private:
+	/*virtual*/ void run();
+
+	LLPointer<LLMappedFileView> mView;
+	std::string mFilename;
+	F64 mNow;
+	bool mSucceeded;
+};
+
+#endif // LL_LLNAMESTORE_H
@@ -59,6 +59,10 @@ LLPacketBuffer::LLPacketBuffer (S32 hSocket)
 	init(hSocket);
 }
 
+LLPacketBuffer::LLPacketBuffer() : mSize(0)
+{
+}
+
 ///////////////////////////////////////////////////////////
 
 LLPacketBuffer::~LLPacketBuffer ()
@@ -74,3 +78,26 @@ void LLPacketBuffer::init (S32 hSocket)
 	mReceivingIF = ::get_receiving_interface();
 }
 
+// static
+S32 LLPacketBuffer::receiveBatch(S32 hSocket, LLPacketBuffer* buffers, S32 count)
+{
+	const S32 MAX_BATCH = 64;
+	char* datas[MAX_BATCH];
+	S32 sizes[MAX_BATCH];
+	LLHost senders[MAX_BATCH];
+	LLHost receiving_ifs[MAX_BATCH];
+
+	count = llmin(count, MAX_BATCH);
+	for (S32 i = 0; i < count; ++i)
+	{
+		datas[i] = buffers[i].mData;
+	}
+	S32 received = receive_packets(hSocket, datas, sizes, senders, receiving_ifs, count);
+	for (S32 i = 0; i < received; ++i)
+	{
+		buffers[i].mSize = sizes[i];
+		buffers[i].mHost = senders[i];
+		buffers[i].mReceivingIF = receiving_ifs[i];
+	}
+	return received;
+}
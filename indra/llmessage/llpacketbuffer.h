@@ -36,14 +36,20 @@ class LLPacketBuffer
 public:
 	LLPacketBuffer(const LLHost &host, const char *datap, const S32 size);
 	LLPacketBuffer(S32 hSocket);           // receive a packet
+	LLPacketBuffer();                      // empty slot for receiveBatch()
 	~LLPacketBuffer();
 
 	S32			getSize() const					{ return mSize; }
 	const char	*getData() const				{ return mData; }
 	LLHost		getHost() const					{ return mHost; }
 	LLHost		getReceivingInterface() const	{ return mReceivingIF; }
+	char		*getData()						{ return mData; }
 	void init(S32 hSocket);
 
+	// Receives up to count waiting packets into buffers with one system call.
+	// Returns the number received, or -1 if batching is not supported.
+	static S32 receiveBatch(S32 hSocket, LLPacketBuffer* buffers, S32 count);
+
 protected:
 	char	mData[NET_BUFFER_SIZE];        // packet data		/* Flawfinder : ignore */
 	S32		mSize;          // size of buffer in bytes
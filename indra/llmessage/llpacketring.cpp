@@ -59,7 +59,11 @@ LLPacketRing::LLPacketRing () :
 	mInBufferLength(0),
 	mOutBufferLength(0),
 	mDropPercentage(0.0f),
-	mPacketsToDrop(0x0)
+	mPacketsToDrop(0x0),
+	mUseBatchReceive(FALSE),
+	mReceiveSlots(NULL),
+	mReceiveSlotCount(0),
+	mReceiveSlotNext(0)
 {
 }
 
@@ -87,6 +91,10 @@ void LLPacketRing::cleanup ()
 		delete packetp;
 		mSendQueue.pop();
 	}
+
+	delete[] mReceiveSlots;
+	mReceiveSlots = NULL;
+	mReceiveSlotCount = mReceiveSlotNext = 0;
 }
 
 ///////////////////////////////////////////////////////////
@@ -111,6 +119,11 @@ void LLPacketRing::setUseOutThrottle(const BOOL use_throttle)
 	mUseOutThrottle = use_throttle;
 }
 
+void LLPacketRing::setUseBatchReceive(const BOOL use_batch)
+{
+	mUseBatchReceive = use_batch;
+}
+
 void LLPacketRing::setInBandwidth(const F32 bps)
 {
 	mInThrottle.setRate(bps);
@@ -157,10 +170,50 @@ S32 LLPacketRing::receiveFromRing (S32 socket, char *datap)
 	return packet_size;
 }
 
+///////////////////////////////////////////////////////////
+// Returns the next packet waiting on the socket, refilling the receive
+// slots with one batch when they run out, or NULL if there is none.
+LLPacketBuffer* LLPacketRing::nextBatchSlot(S32 socket)
+{
+	if (mReceiveSlotNext >= mReceiveSlotCount)
+	{
+		if (!mReceiveSlots)
+		{
+			mReceiveSlots = new LLPacketBuffer[RECEIVE_BATCH_SIZE];
+		}
+		mReceiveSlotNext = 0;
+		mReceiveSlotCount = LLPacketBuffer::receiveBatch(socket, mReceiveSlots, RECEIVE_BATCH_SIZE);
+		if (mReceiveSlotCount < 0)
+		{
+			LL_INFOS() << "Batched packet receive not available, receiving one packet at a time" << LL_ENDL;
+			mUseBatchReceive = FALSE;
+			mReceiveSlotCount = 0;
+		}
+		if (!mReceiveSlotCount)
+		{
+			return NULL;
+		}
+	}
+	return &mReceiveSlots[mReceiveSlotNext++];
+}
+
 ///////////////////////////////////////////////////////////
 S32 LLPacketRing::receivePacket (S32 socket, char *datap)
+{
+	char* packetp = datap;
+	S32 packet_size = receivePacketInPlace(socket, datap, &packetp);
+	if (packet_size > 0 && packetp != datap)
+	{
+		memcpy(datap, packetp, packet_size);	/*Flawfinder: ignore*/
+	}
+	return packet_size;
+}
+
+///////////////////////////////////////////////////////////
+S32 LLPacketRing::receivePacketInPlace (S32 socket, char *datap, char **in_placep)
 {
 	S32 packet_size = 0;
+	*in_placep = datap;
 
 	// If using the throttle, simulate a limited size input buffer.
 	if (mUseInThrottle)
@@ -171,7 +224,19 @@ S32 LLPacketRing::receivePacket (S32 socket, char *datap)
 		while (!done)
 		{
 			LLPacketBuffer *packetp;
-			packetp = new LLPacketBuffer(socket);
+			LLPacketBuffer *slotp = mUseBatchReceive ? nextBatchSlot(socket) : NULL;
+			if (slotp)
+			{
+				packetp = new LLPacketBuffer(*slotp);
+			}
+			else if (mUseBatchReceive)
+			{
+				packetp = new LLPacketBuffer();	// nothing waiting
+			}
+			else
+			{
+				packetp = new LLPacketBuffer(socket);
+			}
 
 			if (packetp->getSize())
 			{
@@ -247,15 +312,27 @@ S32 LLPacketRing::receivePacket (S32 socket, char *datap)
 			{
 				packet_size = 0;
 			}
+			mLastReceivingIF = ::get_receiving_interface();
 		}
 		else
 		{
-			packet_size = receive_packet(socket, datap);
-			mLastSender = ::get_sender();
+			LLPacketBuffer *slotp = mUseBatchReceive ? nextBatchSlot(socket) : NULL;
+			if (slotp)
+			{
+				// decoded in place, no copy
+				packet_size = slotp->getSize();
+				*in_placep = slotp->getData();
+				mLastSender = slotp->getHost();
+				mLastReceivingIF = slotp->getReceivingInterface();
+			}
+			else if (!mUseBatchReceive)
+			{
+				packet_size = receive_packet(socket, datap);
+				mLastSender = ::get_sender();
+				mLastReceivingIF = ::get_receiving_interface();
+			}
 		}
 
-		mLastReceivingIF = ::get_receiving_interface();
-
 		if (packet_size)  // did we actually get a packet?
 		{
 			if (mDropPercentage && (ll_frand(100.f) < mDropPercentage))
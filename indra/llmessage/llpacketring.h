@@ -48,9 +48,14 @@ public:
 	void setDropPercentage (F32 percent_to_drop);
 	void setUseInThrottle(const BOOL use_throttle);
 	void setUseOutThrottle(const BOOL use_throttle);
+	void setUseBatchReceive(const BOOL use_batch);
 	void setInBandwidth(const F32 bps);
 	void setOutBandwidth(const F32 bps);
 	S32  receivePacket (S32 socket, char *datap);
+	// As receivePacket(), but a packet that is already in the batch receive
+	// ring is not copied: *in_placep is set to it, or to datap otherwise.
+	// The packet stays valid until the next receive.
+	S32  receivePacketInPlace (S32 socket, char *datap, char **in_placep);
 	S32  receiveFromRing (S32 socket, char *datap);
 
 	BOOL sendPacket(int h_socket, char * send_buffer, S32 buf_size, LLHost host);
@@ -80,11 +85,20 @@ protected:
 	std::queue<LLPacketBuffer *> mReceiveQueue;
 	std::queue<LLPacketBuffer *> mSendQueue;
 
+	// Batch receive: waiting packets are drained from the socket
+	// RECEIVE_BATCH_SIZE at a time into these slots and handed out in order.
+	enum { RECEIVE_BATCH_SIZE = 32 };
+	BOOL mUseBatchReceive;
+	LLPacketBuffer* mReceiveSlots;
+	S32 mReceiveSlotCount;			// slots filled by the last batch
+	S32 mReceiveSlotNext;			// next slot to hand out
+
 	LLHost mLastSender;
 	LLHost mLastReceivingIF;
 
 private:
 	BOOL sendPacketImpl(int h_socket, const char * send_buffer, S32 buf_size, LLHost host);
+	LLPacketBuffer* nextBatchSlot(S32 socket);
 };
 
 
@@ -548,29 +548,38 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender,
 	// create base working data set
 	mCurrentRMessageData = new LLMsgData(mCurrentRMessageTemplate->mName);
 	
-	// loop through the template building the data structure as we go
-	LLMessageTemplate::message_block_map_t::const_iterator iter;
-	for(iter = mCurrentRMessageTemplate->mMemberBlocks.begin();
-		iter != mCurrentRMessageTemplate->mMemberBlocks.end();
-		++iter)
+	// Everything copied out of the packet fits in what is left of it, so
+	// the variables can point into a single buffer sized once here.
+	std::vector<U8>& flat_buffer = mCurrentRMessageData->mBuffer;
+	flat_buffer.resize(llmax(mReceiveSize - decode_pos, 0));
+	U8* flat_data = flat_buffer.empty() ? NULL : &flat_buffer[0];
+	S32 flat_pos = 0;
+
+	// walk the template's decode plan building the data structure as we go
+	const LLMessageTemplate::decode_block_vec_t& blocks = mCurrentRMessageTemplate->getDecodeBlocks();
+	const LLMessageTemplate::decode_variable_vec_t& variables = mCurrentRMessageTemplate->getDecodeVariables();
+	for (LLMessageTemplate::decode_block_vec_t::const_iterator iter = blocks.begin();
+		 iter != blocks.end(); ++iter)
 	{
-		LLMessageBlock* mbci = *iter;
+		const LLMessageDecodeBlock& mbci = *iter;
+		const LLMessageDecodeVariable* first_var = variables.empty() ? NULL : &variables[mbci.mFirstVariable];
+		const LLMessageDecodeVariable* end_var = first_var ? first_var + mbci.mVariableCount : NULL;
 		U8	repeat_number;
 		S32	i;
 
 		// how many of this block?
 
-		if (mbci->mType == MBT_SINGLE)
+		if (mbci.mType == MBT_SINGLE)
 		{
 			// just one
 			repeat_number = 1;
 		}
-		else if (mbci->mType == MBT_MULTIPLE)
+		else if (mbci.mType == MBT_MULTIPLE)
 		{
 			// a known number
-			repeat_number = mbci->mNumber;
+			repeat_number = mbci.mNumber;
 		}
-		else if (mbci->mType == MBT_VARIABLE)
+		else if (mbci.mType == MBT_VARIABLE)
 		{
 			// need to read the number from the message
 			// repeat number is a single byte
@@ -601,37 +610,47 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender,
 		// now loop through the block
 		for (i = 0; i < repeat_number; i++)
 		{
+			cur_data_block = new LLMsgBlkData(mbci.mName, repeat_number);
 			if (i)
 			{
 				// build new name to prevent collisions
 				// TODO: This should really change to a vector
-				cur_data_block = new LLMsgBlkData(mbci->mName, repeat_number);
-				cur_data_block->mName = mbci->mName + i;
-			}
-			else
-			{
-				cur_data_block = new LLMsgBlkData(mbci->mName, repeat_number);
+				cur_data_block->mName = mbci.mName + i;
 			}
 
 			// add the block to the message
 			mCurrentRMessageData->addBlock(cur_data_block);
 
-			// now read the variables
-			for (LLMessageBlock::message_variable_map_t::const_iterator iter = 
-					 mbci->mMemberVariables.begin();
-				 iter != mbci->mMemberVariables.end(); iter++)
+			if (mbci.mFixedSize >= 0 && (decode_pos + mbci.mFixedSize) <= mReceiveSize)
 			{
-				const LLMessageVariable& mvci = **iter;
-
-				// ok, build out the variables
-				// add variable block
-				cur_data_block->addVariable(mvci.getName(), mvci.getType());
+				// All fixed size and all in the packet: one copy, and the
+				// variables sit at the offsets the plan worked out.
+				U8* block_data = flat_data + flat_pos;
+#ifdef LL_BIG_ENDIAN
+				for (const LLMessageDecodeVariable* mvci = first_var; mvci != end_var; ++mvci)
+				{
+					htonmemcpy(block_data + mvci->mOffset, &buffer[decode_pos + mvci->mOffset], mvci->mType, mvci->mSize);
+				}
+#else
+				memcpy(block_data, &buffer[decode_pos], mbci.mFixedSize);	/* Flawfinder: ignore */
+#endif
+				for (const LLMessageDecodeVariable* mvci = first_var; mvci != end_var; ++mvci)
+				{
+					cur_data_block->addVariableInPlace(mvci->mName, mvci->mType, block_data + mvci->mOffset, mvci->mSize);
+				}
+				decode_pos += mbci.mFixedSize;
+				flat_pos += mbci.mFixedSize;
+				continue;
+			}
 
+			// now read the variables
+			for (const LLMessageDecodeVariable* mvci = first_var; mvci != end_var; ++mvci)
+			{
 				// what type of variable?
-				if (mvci.getType() == MVT_VARIABLE)
+				if (mvci->mType == MVT_VARIABLE)
 				{
 					// variable, get the number of bytes to read from the template
-					S32 data_size = mvci.getSize();
+					S32 data_size = mvci->mSize;
 					U8 tsizeb = 0;
 					U16 tsizeh = 0;
 					U32 tsize = 0;
@@ -666,32 +685,48 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender,
 					}
 					decode_pos += data_size;
 
-					cur_data_block->addData(mvci.getName(), &buffer[decode_pos], tsize, mvci.getType());
+					// Unsigned: a 4 byte length of 2^31 or more must not pass as negative.
+					const S32 remaining = mReceiveSize - decode_pos;
+					if (remaining >= 0 && tsize <= (U32)remaining &&
+						tsize <= (U32)(flat_buffer.size() - flat_pos))
+					{
+						U8* var_data = flat_data + flat_pos;
+						htonmemcpy(var_data, &buffer[decode_pos], mvci->mType, tsize);
+						cur_data_block->addVariableInPlace(mvci->mName, mvci->mType, var_data, tsize);
+						flat_pos += tsize;
+					}
+					else
+					{
+						// Claims more than the packet holds; copy it as before.
+						cur_data_block->addVariable(mvci->mName, mvci->mType);
+						cur_data_block->addData(mvci->mName, &buffer[decode_pos], tsize, mvci->mType);
+					}
 					decode_pos += tsize;
 				}
 				else
 				{
 					// fixed!
 					// so, copy data pointer and set data size to fixed size
-					if ((decode_pos + mvci.getSize()) > mReceiveSize)
+					if ((decode_pos + mvci->mSize) > mReceiveSize)
 					{
 						if(!custom)
-							logRanOffEndOfPacket(sender, decode_pos, mvci.getSize());
+							logRanOffEndOfPacket(sender, decode_pos, mvci->mSize);
 
 						// default to 0s.
-						U32 size = mvci.getSize();
+						U32 size = mvci->mSize;
 						std::vector<U8> data(size, 0);
-						cur_data_block->addData(mvci.getName(), &(data[0]), 
-												size, mvci.getType());
+						cur_data_block->addVariable(mvci->mName, mvci->mType);
+						cur_data_block->addData(mvci->mName, &(data[0]), 
+												size, mvci->mType);
 					}
 					else
 					{
-						cur_data_block->addData(mvci.getName(), 
-												&buffer[decode_pos], 
-												mvci.getSize(), 
-												mvci.getType());
+						U8* var_data = flat_data + flat_pos;
+						htonmemcpy(var_data, &buffer[decode_pos], mvci->mType, mvci->mSize);
+						cur_data_block->addVariableInPlace(mvci->mName, mvci->mType, var_data, mvci->mSize);
+						flat_pos += mvci->mSize;
 					}
-					decode_pos += mvci.getSize();
+					decode_pos += mvci->mSize;
 				}
 			}
 		}
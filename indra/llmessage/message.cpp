@@ -36,6 +36,10 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #endif
+#if LL_WINDOWS
+#include <intrin.h>
+#endif
+#include <emmintrin.h>
 #include <iomanip>
 #include <iterator>
 #include <sstream>
@@ -318,6 +322,7 @@ LLMessageSystem::LLMessageSystem(const std::string& filename, U32 port,
 	mMaxMessageCounts = 200; // >= 0 means dump warnings
 	mMaxMessageTime   = F32Seconds(1.f);
 
+	mTrueReceiveData = mTrueReceiveBuffer;
 	mTrueReceiveSize = 0;
 
 	mReceiveTime = F32Seconds(0.f);
@@ -554,9 +559,10 @@ BOOL LLMessageSystem::checkMessages( S64 frame_count )
 		S32 acks = 0;
 		S32 true_rcv_size = 0;
 
-		U8* buffer = mTrueReceiveBuffer;
-
-		mTrueReceiveSize = mPacketRing->receivePacket(mSocket, (char *)mTrueReceiveBuffer);
+		char* packet = (char *)mTrueReceiveBuffer;
+		mTrueReceiveSize = mPacketRing->receivePacketInPlace(mSocket, (char *)mTrueReceiveBuffer, &packet);
+		mTrueReceiveData = (U8*)packet;
+		U8* buffer = mTrueReceiveData;
 		// If you want to dump all received packets into SecondLife.log, uncomment this
 		//dumpPacketToLog();
 
@@ -621,7 +627,7 @@ BOOL LLMessageSystem::checkMessages( S64 frame_count )
 				for(S32 i = 0; i < acks; ++i)
 				{
 					true_rcv_size -= sizeof(TPACKETID);
-					memcpy(&mem_id, &mTrueReceiveBuffer[true_rcv_size], /* Flawfinder: ignore*/
+					memcpy(&mem_id, &mTrueReceiveData[true_rcv_size], /* Flawfinder: ignore*/
 					     sizeof(TPACKETID));
 					packet_id = ntohl(mem_id);
 					//LL_INFOS("Messaging") << "got ack: " << packet_id << LL_ENDL;
@@ -2876,6 +2882,88 @@ S32 LLMessageSystem::zeroCodeAdjustCurrentSendTotal()
 
 
 
+// Index of the first zero byte in data[begin, end), or end if there is none.
+// Literal runs between zeros are long in most packets, so test 16 bytes at a time.
+static inline S32 find_zero_byte(const U8* data, S32 begin, S32 end)
+{
+	const __m128i zero = _mm_setzero_si128();
+	S32 i = begin;
+	for (; i + 16 <= end; i += 16)
+	{
+		U32 mask = (U32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(data + i)), zero));
+		if (mask)
+		{
+#if LL_WINDOWS
+			unsigned long bit;
+			_BitScanForward(&bit, mask);
+			return i + (S32)bit;
+#else
+			return i + __builtin_ctz(mask);
+#endif
+		}
+	}
+	while (i < end && data[i])
+	{
+		++i;
+	}
+	return i;
+}
+
+// static
+S32 LLMessageSystem::zeroCodeExpandBuffer(const U8* in, S32 in_size, U8* out, S32 out_size)
+{
+	// skip the packet id field
+	S32 in_pos = llmin(in_size, (S32)LL_PACKET_ID_SIZE);
+	if (in_pos > out_size)
+	{
+		return -1;
+	}
+	memcpy(out, in, in_pos);		/* Flawfinder: ignore */
+	S32 out_pos = in_pos;
+
+	// sequential zero bytes are encoded as 0 [U8 count]
+	// with 0 0 [count] representing wrap (>256 zeroes)
+	while (in_pos < in_size)
+	{
+		// copy the literal bytes up to the next zero
+		S32 zero_pos = find_zero_byte(in, in_pos, in_size);
+		S32 literal = zero_pos - in_pos;
+		if (literal > out_size - out_pos)
+		{
+			return -1;
+		}
+		memcpy(out + out_pos, in + in_pos, literal);	/* Flawfinder: ignore */
+		out_pos += literal;
+		in_pos = zero_pos;
+		if (in_pos >= in_size)
+		{
+			break;
+		}
+
+		// expand the zero run: the zero itself, 256 per wrap byte, then count - 1
+		S32 zeros = 1;
+		++in_pos;
+		while (in_pos < in_size && !in[in_pos])
+		{
+			zeros += 256;
+			++in_pos;
+		}
+		if (in_pos < in_size)
+		{
+			zeros += in[in_pos] - 1;
+			++in_pos;
+		}
+		if (zeros > out_size - out_pos)
+		{
+			return -1;
+		}
+		memset(out + out_pos, 0, zeros);
+		out_pos += zeros;
+	}
+
+	return out_pos;
+}
+
 S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
 {
 	if ((*data_size ) < LL_MINIMUM_VALID_PACKET_SIZE)
@@ -2898,72 +2986,16 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
 	
 	*data[0] &= (~LL_ZERO_CODE_FLAG);
 
-	S32 count = (*data_size);  
-	
-	U8 *inptr = (U8 *)*data;
-	U8 *outptr = (U8 *)mEncodedRecvBuffer;
-
-// skip the packet id field
-
-	for (U32 ii = 0; ii < LL_PACKET_ID_SIZE; ++ii)
+	S32 out_size = zeroCodeExpandBuffer(*data, in_size, mEncodedRecvBuffer, MAX_BUFFER_SIZE);
+	if (out_size < 0)
 	{
-		count--;
-		*outptr++ = *inptr++;
+		LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size" << LL_ENDL;
+		callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
+		out_size = 0;
 	}
 
-// reconstruct encoded packet, keeping track of net size gain
-
-// sequential zero bytes are encoded as 0 [U8 count] 
-// with 0 0 [count] representing wrap (>256 zeroes)
-
-	while (count--)
-	{
-		if (outptr > (&mEncodedRecvBuffer[MAX_BUFFER_SIZE-1]))
-		{
-			LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size 1" << LL_ENDL;
-			callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
-			outptr = mEncodedRecvBuffer;					
-			break;
-		}
-		if (!((*outptr++ = *inptr++)))
-		{
-			while (((count--)) && (!(*inptr)))
-			{
-				*outptr++ = *inptr++;
-  				if (outptr > (&mEncodedRecvBuffer[MAX_BUFFER_SIZE-256]))
-  				{
-  					LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size 2" << LL_ENDL;
-					callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
-					outptr = mEncodedRecvBuffer;
-					count = -1;
-					break;
-  				}
-				memset(outptr,0,255);
-				outptr += 255;
-			}
-			
-			if (count < 0)
-			{
-				break;
-			}
-
-			else
-			{
-  				if (outptr > (&mEncodedRecvBuffer[MAX_BUFFER_SIZE-(*inptr)]))
-				{
-  					LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size 3" << LL_ENDL;
-					callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
-					outptr = mEncodedRecvBuffer;					
-				}
-				memset(outptr,0,(*inptr) - 1);
-				outptr += ((*inptr) - 1);
-				inptr++;
-			}
-		}		
-	}
-	
 	*data = mEncodedRecvBuffer;
-	*data_size = (S32)(outptr - mEncodedRecvBuffer);
+	*data_size = out_size;
 	mUncompressedBytesIn += *data_size;
 
 	return(in_size);
@@ -3395,7 +3427,7 @@ void LLMessageSystem::dumpPacketToLog()
 	{
 		S32 offset = cur_line_pos * 3;
 		snprintf(line_buffer + offset, sizeof(line_buffer) - offset,
-				 "%02x ", mTrueReceiveBuffer[i]);	/* Flawfinder: ignore */
+				 "%02x ", mTrueReceiveData[i]);	/* Flawfinder: ignore */
 		cur_line_pos++;
 		if (cur_line_pos >= 16)
 		{
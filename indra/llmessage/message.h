@@ -463,6 +463,9 @@ public:
 
 	S32     zeroCode(U8 **data, S32 *data_size);
 	S32		zeroCodeExpand(U8 **data, S32 *data_size);
+	// Expands the zero coded packet in into out, packet id header included.
+	// Returns the expanded size, or -1 if it does not fit in out_size bytes.
+	static S32 zeroCodeExpandBuffer(const U8* in, S32 in_size, U8* out, S32 out_size);
 	S32		zeroCodeAdjustCurrentSendTotal();
 
 	// Uses ping-based retry
@@ -782,6 +785,7 @@ private:
 
 	U8	mEncodedRecvBuffer[MAX_BUFFER_SIZE];
 	U8	mTrueReceiveBuffer[MAX_BUFFER_SIZE];
+	U8*	mTrueReceiveData;	// mTrueReceiveBuffer, or the packet ring slot holding the packet
 	S32	mTrueReceiveSize;
 
 	// Must be valid during decode
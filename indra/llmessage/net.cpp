@@ -338,6 +338,12 @@ S32 receive_packet(int hSocket, char * receiveBuffer)
 	return nRet;
 }
 
+S32 receive_packets(int hSocket, char** buffers, S32* sizes, LLHost* senders, LLHost* receiving_ifs, S32 count)
+{
+	// No batched receive on this platform
+	return -1;
+}
+
 // Returns TRUE on success.
 BOOL send_packet(int hSocket, const char *sendBuffer, int size, U32 recipient, int nPort)
 {
@@ -598,6 +604,77 @@ int receive_packet(int hSocket, char * receiveBuffer)
 	return nRet;
 }
 
+#if LL_LINUX
+// Destination address from the IP_PKTINFO control message, if any.
+static U32 get_pktinfo_destip(struct msghdr *msg)
+{
+	U32 dstip = INVALID_HOST_IP_ADDRESS;
+	for (struct cmsghdr *cmsgptr = CMSG_FIRSTHDR(msg); cmsgptr != NULL; cmsgptr = CMSG_NXTHDR(msg, cmsgptr))
+	{
+		if( cmsgptr->cmsg_level == SOL_IP && cmsgptr->cmsg_type == IP_PKTINFO )
+		{
+			in_pktinfo *pktinfo = (in_pktinfo *)CMSG_DATA(cmsgptr);
+			if( pktinfo )
+			{
+				dstip = pktinfo->ipi_spec_dst.s_addr;
+			}
+		}
+	}
+	return dstip;
+}
+
+S32 receive_packets(int hSocket, char** buffers, S32* sizes, LLHost* senders, LLHost* receiving_ifs, S32 count)
+{
+	const S32 MAX_RECEIVE_BATCH = 64;
+	struct mmsghdr msgs[MAX_RECEIVE_BATCH];
+	struct iovec iovs[MAX_RECEIVE_BATCH];
+	struct sockaddr_in addrs[MAX_RECEIVE_BATCH];
+	char cmsgs[MAX_RECEIVE_BATCH][CMSG_SPACE(sizeof(struct in_pktinfo))];
+
+	count = llmin(count, MAX_RECEIVE_BATCH);
+	memset(msgs, 0, sizeof(struct mmsghdr) * count);
+	for (S32 i = 0; i < count; ++i)
+	{
+		iovs[i].iov_base = buffers[i];
+		iovs[i].iov_len = NET_BUFFER_SIZE;
+		msgs[i].msg_hdr.msg_name = &addrs[i];
+		msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+		msgs[i].msg_hdr.msg_iov = &iovs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+		msgs[i].msg_hdr.msg_control = cmsgs[i];
+		msgs[i].msg_hdr.msg_controllen = sizeof(cmsgs[i]);
+	}
+
+	int received = recvmmsg(hSocket, msgs, count, MSG_DONTWAIT, NULL);
+	if (received < 0)
+	{
+		// ENOSYS: kernel without recvmmsg, use receive_packet() instead.
+		// Anything else is treated like receive_packet() treats errors.
+		return (errno == ENOSYS) ? -1 : 0;
+	}
+
+	for (S32 i = 0; i < received; ++i)
+	{
+		sizes[i] = msgs[i].msg_len;
+		senders[i] = LLHost(addrs[i].sin_addr.s_addr, ntohs(addrs[i].sin_port));
+		receiving_ifs[i] = LLHost(get_pktinfo_destip(&msgs[i].msg_hdr), INVALID_PORT);
+	}
+	if (received > 0)
+	{
+		// Keep get_sender() and get_receiving_interface() consistent with receive_packet().
+		stSrcAddr = addrs[received - 1];
+		gsnReceivingIFAddr = receiving_ifs[received - 1].getAddress();
+	}
+	return received;
+}
+#else
+S32 receive_packets(int hSocket, char** buffers, S32* sizes, LLHost* senders, LLHost* receiving_ifs, S32 count)
+{
+	// No batched receive on this platform
+	return -1;
+}
+#endif
+
 BOOL send_packet(int hSocket, const char * sendBuffer, int size, U32 recipient, int nPort)
 {
 	int		ret;
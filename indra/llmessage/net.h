@@ -43,6 +43,12 @@ void	end_net(S32& socket_out);
 // returns size of packet or -1 in case of error
 S32		receive_packet(int hSocket, char * receiveBuffer);
 
+// Receives up to count packets with one system call (recvmmsg on Linux)
+// into buffers of NET_BUFFER_SIZE bytes each, filling in their sizes,
+// senders and receiving interfaces.  Returns the number received, 0 when
+// none are waiting, or -1 if the platform cannot receive in batches.
+S32		receive_packets(int hSocket, char** buffers, S32* sizes, LLHost* senders, LLHost* receiving_ifs, S32 count);
+
 BOOL	send_packet(int hSocket, const char *sendBuffer, int size, U32 recipient, int nPort);	// Returns TRUE on success.
 
 //void	get_sender(char * tmp);
@@ -378,50 +378,34 @@ void	decode_patch(LLBitPack &bitpack, S32 *patches)
 		}
 	}
 #else
-	S32		i, j, patch_size = gPatchSize, wbits = gWordBits;
+	S32		i, patch_size = gPatchSize, wbits = gWordBits;
+	S32		count = patch_size*patch_size;
 	U32		temp;
-	for (i = 0; i < patch_size*patch_size; i++)
+	for (i = 0; i < count; i++)
 	{
-		temp = 0;
-		bitpack.bitUnpack((U8 *)&temp, 1);
-		if (temp)
+		if (!bitpack.bitUnpackU32(1))
 		{
-			// either 0 EOB or Value
-			temp = 0;
-			bitpack.bitUnpack((U8 *)&temp, 1);
-			if (temp)
+			patches[i] = 0;
+		}
+		else if (bitpack.bitUnpackU32(1))
+		{
+			// value, sign bit first
+			if (bitpack.bitUnpackU32(1))
 			{
-				// value
-				temp = 0;
-				bitpack.bitUnpack((U8 *)&temp, 1);
-				if (temp)
-				{
-					// negative
-					temp = 0;
-					bitpack.bitUnpack((U8 *)&temp, wbits);
-					patches[i] = temp;
-					patches[i] *= -1;
-				}
-				else
-				{
-					// positive
-					temp = 0;
-					bitpack.bitUnpack((U8 *)&temp, wbits);
-					patches[i] = temp;
-				}
+				temp = bitpack.bitUnpackU32(wbits);
+				patches[i] = -(S32)temp;
 			}
 			else
 			{
-				for (j = i; j < patch_size*patch_size; j++)
-				{
-					patches[j] = 0;
-				}
-				return;
+				temp = bitpack.bitUnpackU32(wbits);
+				patches[i] = (S32)temp;
 			}
 		}
 		else
 		{
-			patches[i] = 0;
+			// 0 EOB
+			memset(patches + i, 0, (count - i)*sizeof(S32));
+			return;
 		}
 	}
 #endif
@@ -91,4 +91,29 @@ void init_patch_decompressor(S32 size);
 void decompress_patch(F32 *patch, S32 *cpatch, LLPatchHeader *ph);
 void decompress_patchv(LLVector3 *v, S32 *cpatch, LLPatchHeader *ph);
 
+// Selects the SSE2 IDCT (the default) or the original scalar one for the
+// functions above. Only meant for comparing the two.
+void set_patch_idct_sse2(BOOL enable);
+
+// Decompresses batches of patches of one size. Unlike the functions above it
+// keeps its tables to itself rather than in the globals that go with the
+// current group header, so it may be used from any thread.
+class LLPatchDecompressor
+{
+public:
+	LLPatchDecompressor(S32 size);
+
+	S32 getSize() const					{ return mSize; }
+
+	// cpatches holds size*size coefficients per patch, as left by decode_patch().
+	// Patch i is written to patches[i], stride floats apart per row.
+	void decompress(F32 **patches, S32 stride, const S32 *cpatches, const LLPatchHeader *headers, S32 count) const;
+
+private:
+	S32	mSize;
+	F32	mDequantizeTable[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
+	F32	mBasis[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
+	S32	mDeCopyMatrix[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
+};
+
 #endif
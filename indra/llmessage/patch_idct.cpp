@@ -31,6 +31,8 @@
 #include "v3math.h"
 #include "patch_dct.h"
 
+#include <emmintrin.h>
+
 LLGroupHeader	*gGOPP;
 
 void set_group_of_patch_header(LLGroupHeader *gopp)
@@ -39,14 +41,14 @@ void set_group_of_patch_header(LLGroupHeader *gopp)
 }
 
 F32 gPatchDequantizeTable[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
-void build_patch_dequantize_table(S32 size)
+void build_patch_dequantize_table(F32 *table, S32 size)
 {
 	S32 i, j;
 	for (j = 0; j < size; j++)
 	{
 		for (i = 0; i < size; i++)
 		{
-			gPatchDequantizeTable[j*size + i] = (1.f + 2.f*(i+j));
+			table[j*size + i] = (1.f + 2.f*(i+j));
 		}
 	}
 }
@@ -55,7 +57,7 @@ S32	gCurrentDeSize = 0;
 
 F32	gPatchICosines[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
 
-void setup_patch_icosines(S32 size)
+void setup_patch_icosines(F32 *cosines, S32 size)
 {
 	S32 n, u;
 	F32 oosob = F_PI*0.5f/size;
@@ -64,14 +66,29 @@ void setup_patch_icosines(S32 size)
 	{
 		for (n = 0; n < size; n++)
 		{
-			gPatchICosines[u*size+n] = cosf((2.f*n+1.f)*u*oosob);
+			cosines[u*size+n] = cosf((2.f*n+1.f)*u*oosob);
 		}
 	}
 }
 
+// The cosines with the first row replaced by the OO_SQRT2 weight of the DC
+// term, which turns both IDCT passes into plain matrix products.
+F32	gPatchIDCTBasis[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
+
+void setup_patch_idct_basis(F32 *basis, S32 size)
+{
+	S32 n;
+
+	setup_patch_icosines(basis, size);
+	for (n = 0; n < size; n++)
+	{
+		basis[n] = OO_SQRT2;
+	}
+}
+
 S32	gDeCopyMatrix[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
 
-void build_decopy_matrix(S32 size)
+void build_decopy_matrix(S32 *matrix, S32 size)
 {
 	S32 i, j, count;
 	BOOL	b_diag = FALSE;
@@ -84,7 +101,7 @@ void build_decopy_matrix(S32 size)
 	while (  (i < size)
 		   &&(j < size))
 	{
-		gDeCopyMatrix[j*size + i] = count;
+		matrix[j*size + i] = count;
 
 		count++;
 
@@ -140,9 +157,10 @@ void init_patch_decompressor(S32 size)
 	if (size != gCurrentDeSize)
 	{
 		gCurrentDeSize = size;
-		build_patch_dequantize_table(size);
-		setup_patch_icosines(size);
-		build_decopy_matrix(size);
+		build_patch_dequantize_table(gPatchDequantizeTable, size);
+		setup_patch_icosines(gPatchICosines, size);
+		setup_patch_idct_basis(gPatchIDCTBasis, size);
+		build_decopy_matrix(gDeCopyMatrix, size);
 	}
 }
 
@@ -588,88 +606,185 @@ inline void idct_patch_large(F32 *block)
 
 S32	gDitherNoise = 128;
 
-void decompress_patch(F32 *patch, S32 *cpatch, LLPatchHeader *ph)
+BOOL gPatchIDCTSSE2 = TRUE;
+
+void set_patch_idct_sse2(BOOL enable)
 {
-	S32		i, j;
+	gPatchIDCTSSE2 = enable;
+}
 
-	F32		block[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE], *tblock = block;
-	F32		*tpatch;
+// SSE2 version of idct_patch()/idct_patch_large(). Both passes multiply by
+// the basis sixteen outputs at a time, in four registers. After quantization
+// most of the coefficients are zero, so rows past the last non-zero one are
+// skipped in the column pass, and groups of sixteen columns that are all
+// zero (and stay zero through the column pass) in the line pass.
+static const S32 IDCT_GROUP = 16;
 
-	LLGroupHeader	*gopp = gGOPP;
-	S32		size = gopp->patch_size;
-	F32		range = ph->range;
-	S32		prequant = (ph->quant_wbits >> 4) + 2;
-	S32		quantize = 1<<prequant;
-	F32		hmin = ph->dc_offset;
-	S32		stride = gopp->stride;
+static inline void idct_accumulate(__m128 *acc, const __m128 &c, const F32 *in)
+{
+	acc[0] = _mm_add_ps(acc[0], _mm_mul_ps(c, _mm_loadu_ps(in)));
+	acc[1] = _mm_add_ps(acc[1], _mm_mul_ps(c, _mm_loadu_ps(in + 4)));
+	acc[2] = _mm_add_ps(acc[2], _mm_mul_ps(c, _mm_loadu_ps(in + 8)));
+	acc[3] = _mm_add_ps(acc[3], _mm_mul_ps(c, _mm_loadu_ps(in + 12)));
+}
 
-	F32		ooq = 1.f/(F32)quantize;
-	F32     *dq = gPatchDequantizeTable;
-	S32		*decopy_matrix = gDeCopyMatrix;
+template <S32 SIZE>
+static void idct_patch_sse2(F32 *block, const F32 *basis)
+{
+	const S32 GROUPS = SIZE/IDCT_GROUP;
+	const __m128i zero = _mm_setzero_si128();
+	F32 temp[SIZE*SIZE];
+	__m128 acc[4];
+	S32 n, u, g, i, rows = 0, groups = 0;
 
-	F32		mult = ooq*range;
-	F32		addval = mult*(F32)(1<<(prequant - 1))+hmin;
+	for (g = 0; g < GROUPS; g++)
+	{
+		__m128i group_bits = zero;
+		for (u = 0; u < SIZE; u++)
+		{
+			const F32 *in = block + u*SIZE + g*IDCT_GROUP;
+			__m128i row_bits = _mm_or_si128(_mm_or_si128(_mm_castps_si128(_mm_loadu_ps(in)), _mm_castps_si128(_mm_loadu_ps(in + 4))),
+											_mm_or_si128(_mm_castps_si128(_mm_loadu_ps(in + 8)), _mm_castps_si128(_mm_loadu_ps(in + 12))));
+			if (_mm_movemask_epi8(_mm_cmpeq_epi32(row_bits, zero)) != 0xFFFF)
+			{
+				rows = llmax(rows, u + 1);
+			}
+			group_bits = _mm_or_si128(group_bits, row_bits);
+		}
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(group_bits, zero)) != 0xFFFF)
+		{
+			groups = g + 1;
+		}
+	}
+	if (!rows)
+	{
+		// All zero, and so is the transform.
+		return;
+	}
 
-	for (i = 0; i < size*size; i++)
+	// Columns: temp row n = sum over u of basis[u][n] * block row u.
+	for (n = 0; n < SIZE; n++)
 	{
-		*(tblock++) = *(cpatch + *(decopy_matrix++))*(*dq++);
+		for (g = 0; g < groups; g++)
+		{
+			acc[0] = acc[1] = acc[2] = acc[3] = _mm_setzero_ps();
+			for (u = 0; u < rows; u++)
+			{
+				idct_accumulate(acc, _mm_set1_ps(basis[u*SIZE + n]), block + u*SIZE + g*IDCT_GROUP);
+			}
+			for (i = 0; i < 4; i++)
+			{
+				_mm_storeu_ps(temp + n*SIZE + g*IDCT_GROUP + i*4, acc[i]);
+			}
+		}
 	}
 
-	if (size == 16)
+	// Lines: block row n = oosob * sum over u of temp[n][u] * basis row u.
+	const __m128 oosob = _mm_set1_ps(2.f/SIZE);
+	const S32 columns = groups*IDCT_GROUP;
+	for (n = 0; n < SIZE; n++)
 	{
-		idct_patch(block);
+		const F32 *in = temp + n*SIZE;
+		for (g = 0; g < GROUPS; g++)
+		{
+			acc[0] = acc[1] = acc[2] = acc[3] = _mm_setzero_ps();
+			for (u = 0; u < columns; u++)
+			{
+				idct_accumulate(acc, _mm_set1_ps(in[u]), basis + u*SIZE + g*IDCT_GROUP);
+			}
+			for (i = 0; i < 4; i++)
+			{
+				_mm_storeu_ps(block + n*SIZE + g*IDCT_GROUP + i*4, _mm_mul_ps(acc[i], oosob));
+			}
+		}
 	}
-	else
+}
+
+static void dequantize_patch(F32 *block, const S32 *cpatch, S32 size, const F32 *dq, const S32 *decopy_matrix)
+{
+	S32 i;
+	for (i = 0; i < size*size; i++)
 	{
-		idct_patch_large(block);
+		*(block++) = *(cpatch + *(decopy_matrix++))*(*dq++);
 	}
+}
+
+static void get_patch_scale(const LLPatchHeader *ph, F32 &mult, F32 &addval)
+{
+	S32		prequant = (ph->quant_wbits >> 4) + 2;
+	S32		quantize = 1<<prequant;
+	F32		ooq = 1.f/(F32)quantize;
+
+	mult = ooq*ph->range;
+	addval = mult*(F32)(1<<(prequant - 1))+ph->dc_offset;
+}
+
+static void store_patch(F32 *patch, S32 stride, const F32 *block, S32 size, F32 mult, F32 addval)
+{
+	S32 i, j;
+	const __m128 m = _mm_set1_ps(mult);
+	const __m128 a = _mm_set1_ps(addval);
 
 	for (j = 0; j < size; j++)
 	{
-		tpatch = patch + j*stride;
-		tblock = block + j*size;
-		for (i = 0; i < size; i++)
+		F32 *tpatch = patch + j*stride;
+		const F32 *tblock = block + j*size;
+		for (i = 0; i < size; i += 4)
 		{
-			*(tpatch++) = *(tblock++)*mult+addval;
+			_mm_storeu_ps(tpatch + i, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(tblock + i), m), a));
 		}
 	}
 }
 
-
-void decompress_patchv(LLVector3 *v, S32 *cpatch, LLPatchHeader *ph)
+static void idct_block(F32 *block, S32 size)
 {
-	S32		i, j;
+	if (gPatchIDCTSSE2)
+	{
+		if (size == 16)
+			idct_patch_sse2<NORMAL_PATCH_SIZE>(block, gPatchIDCTBasis);
+		else
+			idct_patch_sse2<LARGE_PATCH_SIZE>(block, gPatchIDCTBasis);
+	}
+	else
+	{
+		if (size == 16)
+			idct_patch(block);
+		else
+			idct_patch_large(block);
+	}
+}
 
-	F32			block[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE], *tblock = block;
-	LLVector3	*tvec;
+void decompress_patch(F32 *patch, S32 *cpatch, LLPatchHeader *ph)
+{
+	F32		block[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
 
 	LLGroupHeader	*gopp = gGOPP;
 	S32		size = gopp->patch_size;
-	F32		range = ph->range;
-	S32		prequant = (ph->quant_wbits >> 4) + 2;
-	S32		quantize = 1<<prequant;
-	F32		hmin = ph->dc_offset;
 	S32		stride = gopp->stride;
+	F32		mult, addval;
 
-	F32		ooq = 1.f/(F32)quantize;
-	F32     *dq = gPatchDequantizeTable;
-	S32		*decopy_matrix = gDeCopyMatrix;
+	get_patch_scale(ph, mult, addval);
+	dequantize_patch(block, cpatch, size, gPatchDequantizeTable, gDeCopyMatrix);
+	idct_block(block, size);
+	store_patch(patch, stride, block, size, mult, addval);
+}
 
-	F32		mult = ooq*range;
-	F32		addval = mult*(F32)(1<<(prequant - 1))+hmin;
 
-//	BOOL	b_diag = FALSE;
-//	BOOL	b_right = TRUE;
+void decompress_patchv(LLVector3 *v, S32 *cpatch, LLPatchHeader *ph)
+{
+	S32		i, j;
 
-	for (i = 0; i < size*size; i++)
-	{
-		*(tblock++) = *(cpatch + *(decopy_matrix++))*(*dq++);
-	}
+	F32			block[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE], *tblock;
+	LLVector3	*tvec;
 
-	if (size == 16)
-		idct_patch(block);
-	else
-		idct_patch_large(block);
+	LLGroupHeader	*gopp = gGOPP;
+	S32		size = gopp->patch_size;
+	S32		stride = gopp->stride;
+	F32		mult, addval;
+
+	get_patch_scale(ph, mult, addval);
+	dequantize_patch(block, cpatch, size, gPatchDequantizeTable, gDeCopyMatrix);
+	idct_block(block, size);
 
 	for (j = 0; j < size; j++)
 	{
@@ -682,3 +797,33 @@ void decompress_patchv(LLVector3 *v, S32 *cpatch, LLPatchHeader *ph)
 	}
 }
 
+//-----------------------------------------------------------------------------
+// LLPatchDecompressor
+//-----------------------------------------------------------------------------
+
+LLPatchDecompressor::LLPatchDecompressor(S32 size)
+:	mSize(size)
+{
+	llassert_always(size == NORMAL_PATCH_SIZE || size == LARGE_PATCH_SIZE);
+	build_patch_dequantize_table(mDequantizeTable, size);
+	setup_patch_idct_basis(mBasis, size);
+	build_decopy_matrix(mDeCopyMatrix, size);
+}
+
+void LLPatchDecompressor::decompress(F32 **patches, S32 stride, const S32 *cpatches, const LLPatchHeader *headers, S32 count) const
+{
+	F32		block[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
+	S32		i;
+	F32		mult, addval;
+
+	for (i = 0; i < count; i++)
+	{
+		get_patch_scale(headers + i, mult, addval);
+		dequantize_patch(block, cpatches + i*mSize*mSize, mSize, mDequantizeTable, mDeCopyMatrix);
+		if (mSize == NORMAL_PATCH_SIZE)
+			idct_patch_sse2<NORMAL_PATCH_SIZE>(block, mBasis);
+		else
+			idct_patch_sse2<LARGE_PATCH_SIZE>(block, mBasis);
+		store_patch(patches[i], stride, block, mSize, mult, addval);
+	}
+}
@@ -79,9 +79,7 @@ struct SortScrollListItem
 
 			S32 order = sort_ascending ? 1 : -1; // ascending or descending sort for this column?
 
-			const LLScrollListCell *cell1 = i1->getColumn(col_idx);
-			const LLScrollListCell *cell2 = i2->getColumn(col_idx);
-			if (cell1 && cell2)
+			if (i1->hasColumn(col_idx) && i2->hasColumn(col_idx))
 			{
 				if(mSortSignal)
 				{
@@ -89,7 +87,7 @@ struct SortScrollListItem
 				}
 				else
 				{
-					sort_result = order * LLStringUtil::compareDict(cell1->getValue().asString(), cell2->getValue().asString());
+					sort_result = order * LLStringUtil::compareDict(i1->getColumnValue(col_idx).asString(), i2->getColumnValue(col_idx).asString());
 				}
 				if (sort_result != 0)
 				{
@@ -107,6 +105,50 @@ struct SortScrollListItem
 	const sort_order_t& mSortOrders;
 };
 
+// The string an item is sorted by in one column.
+struct ScrollListSortKey
+{
+	ScrollListSortKey() : mValid(false) {}
+
+	std::string mValue;
+	bool mValid;		// the item has the column
+};
+
+// Orders item indices like SortScrollListItem orders the items, on sort
+// keys read once per item and column: keys[item * columns + column].
+struct SortScrollListKeys
+{
+	typedef std::vector<std::pair<S32, BOOL> > sort_order_t;
+
+	SortScrollListKeys(const std::vector<ScrollListSortKey>& keys, const sort_order_t& sort_orders)
+	:	mKeys(keys),
+		mSortOrders(sort_orders)
+	{}
+
+	bool operator()(U32 i1, U32 i2) const
+	{
+		const U32 num_keys = mSortOrders.size();
+		for (S32 key = num_keys - 1; key >= 0; --key)
+		{
+			const ScrollListSortKey& key1 = mKeys[i1 * num_keys + key];
+			const ScrollListSortKey& key2 = mKeys[i2 * num_keys + key];
+			if (key1.mValid && key2.mValid)
+			{
+				S32 order = mSortOrders[key].second ? 1 : -1;
+				S32 sort_result = order * LLStringUtil::compareDict(key1.mValue, key2.mValue);
+				if (sort_result != 0)
+				{
+					return sort_result < 0;
+				}
+			}
+		}
+		return false;
+	}
+
+	const std::vector<ScrollListSortKey>& mKeys;
+	const sort_order_t& mSortOrders;
+};
+
 //---------------------------------------------------------------------------
 // LLScrollListCtrl
 //---------------------------------------------------------------------------
@@ -508,7 +550,7 @@ BOOL LLScrollListCtrl::addItem( LLScrollListItem* item, EAddPosition pos, BOOL r
 				if (mSortColumns.empty() || mSortColumns[0].first != 0)
 				{
 					// sort by column 0, in ascending order
-					std::stable_sort(mItemList.begin(), mItemList.end(), SortScrollListItem({ {0,true} }, mSortCallback));
+					sortItems(std::vector<sort_column_t>(1, sort_column_t(0, TRUE)));
 				}
 
 				// ADD_SORTED just sorts by first column...
@@ -538,13 +580,10 @@ BOOL LLScrollListCtrl::addItem( LLScrollListItem* item, EAddPosition pos, BOOL r
 			addColumn(col_params);
 		}
 
-		S32 num_cols = item->getNumColumns();
-		S32 i = 0;
-		for (LLScrollListCell* cell = item->getColumn(i); i < num_cols; cell = item->getColumn(++i))
+		S32 num_cols = llmin(item->getNumColumns(), (S32)mColumnsIndexed.size());
+		for (S32 i = 0; i < num_cols; ++i)
 		{
-			if (i >= (S32)mColumnsIndexed.size()) break;
-
-			cell->setWidth(mColumnsIndexed[i]->getWidth());
+			item->setColumnWidth(i, mColumnsIndexed[i]->getWidth());
 		}
 
 		updateLineHeightInsert(item);
@@ -578,10 +617,9 @@ S32 LLScrollListCtrl::calcMaxContentWidth()
 			item_list::iterator iter;
 			for (iter = mItemList.begin(); iter != mItemList.end(); iter++)
 			{
-				LLScrollListCell* cellp = (*iter)->getColumn(column->mIndex);
-				if (!cellp) continue;
+				if (!(*iter)->hasColumn(column->mIndex)) continue;
 
-				column->mMaxContentWidth = llmax(LLFontGL::getFontSansSerifSmall()->getWidth(cellp->getValue().asString()) + mColumnPadding + COLUMN_TEXT_PADDING, column->mMaxContentWidth);
+				column->mMaxContentWidth = llmax(LLFontGL::getFontSansSerifSmall()->getWidth((*iter)->getColumnValue(column->mIndex).asString()) + mColumnPadding + COLUMN_TEXT_PADDING, column->mMaxContentWidth);
 			}
 		}
 		max_item_width += column->mMaxContentWidth;
@@ -634,13 +672,7 @@ void LLScrollListCtrl::updateLineHeight()
 	item_list::iterator iter;
 	for (iter = mItemList.begin(); iter != mItemList.end(); iter++)
 	{
-		LLScrollListItem *itemp = *iter;
-		S32 num_cols = itemp->getNumColumns();
-		S32 i = 0;
-		for (const LLScrollListCell* cell = itemp->getColumn(i); i < num_cols; cell = itemp->getColumn(++i))
-		{
-			mLineHeight = llmax( mLineHeight, cell->getHeight() + SCROLL_LIST_ROW_PAD );
-		}
+		updateLineHeightInsert(*iter);
 	}
 }
 
@@ -648,10 +680,9 @@ void LLScrollListCtrl::updateLineHeight()
 void LLScrollListCtrl::updateLineHeightInsert(LLScrollListItem* itemp)
 {
 	S32 num_cols = itemp->getNumColumns();
-	S32 i = 0;
-	for (const LLScrollListCell* cell = itemp->getColumn(i); i < num_cols; cell = itemp->getColumn(++i))
+	for (S32 i = 0; i < num_cols; ++i)
 	{
-		mLineHeight = llmax( mLineHeight, cell->getHeight() + SCROLL_LIST_ROW_PAD );
+		mLineHeight = llmax( mLineHeight, itemp->getColumnHeight(i) + SCROLL_LIST_ROW_PAD );
 	}
 }
 
@@ -718,13 +749,10 @@ void LLScrollListCtrl::updateColumns(bool force_update)
 		for (iter = mItemList.begin(); iter != mItemList.end(); iter++)
 		{
 			LLScrollListItem *itemp = *iter;
-			S32 num_cols = itemp->getNumColumns();
-			S32 i = 0;
-			for (LLScrollListCell* cell = itemp->getColumn(i); i < num_cols; cell = itemp->getColumn(++i))
+			S32 num_cols = llmin(itemp->getNumColumns(), (S32)mColumnsIndexed.size());
+			for (S32 i = 0; i < num_cols; ++i)
 			{
-				if (i >= (S32)mColumnsIndexed.size()) break;
-
-				cell->setWidth(mColumnsIndexed[i]->getWidth());
+				itemp->setColumnWidth(i, mColumnsIndexed[i]->getWidth());
 			}
 		}
 	}
@@ -2356,10 +2384,7 @@ void LLScrollListCtrl::updateSort() const
 	if (hasSortOrder() && !isSorted())
 	{
 		// do stable sort to preserve any previous sorts
-		std::stable_sort(
-			mItemList.begin(), 
-			mItemList.end(), 
-			SortScrollListItem(mSortColumns,mSortCallback));
+		sortItems(mSortColumns);
 
 		mSorted = true;
 	}
@@ -2372,10 +2397,49 @@ void LLScrollListCtrl::sortOnce(S32 column, BOOL ascending)
 	sort_column.push_back(std::make_pair(column, ascending));
 
 	// do stable sort to preserve any previous sorts
-	std::stable_sort(
-		mItemList.begin(), 
-		mItemList.end(), 
-		SortScrollListItem(sort_column,mSortCallback));
+	sortItems(sort_column);
+}
+
+void LLScrollListCtrl::sortItems(const std::vector<sort_column_t>& sort_orders) const
+{
+	if (mSortCallback)
+	{
+		// the callback compares the items themselves
+		std::stable_sort(
+			mItemList.begin(), 
+			mItemList.end(), 
+			SortScrollListItem(sort_orders,mSortCallback));
+		return;
+	}
+
+	// read each sort string once, not on every comparison
+	const U32 num_items = mItemList.size();
+	const U32 num_keys = sort_orders.size();
+	std::vector<ScrollListSortKey> keys(num_items * num_keys);
+	std::vector<U32> order(num_items);
+	for (U32 i = 0; i < num_items; ++i)
+	{
+		const LLScrollListItem* itemp = mItemList[i];
+		for (U32 key = 0; key < num_keys; ++key)
+		{
+			const S32 column = sort_orders[key].first;
+			if (itemp->hasColumn(column))
+			{
+				keys[i * num_keys + key].mValue = itemp->getColumnValue(column).asString();
+				keys[i * num_keys + key].mValid = true;
+			}
+		}
+		order[i] = i;
+	}
+
+	std::stable_sort(order.begin(), order.end(), SortScrollListKeys(keys, sort_orders));
+
+	item_list sorted_items;
+	for (U32 i = 0; i < num_items; ++i)
+	{
+		sorted_items.push_back(mItemList[order[i]]);
+	}
+	mItemList.swap(sorted_items);
 }
 
 void LLScrollListCtrl::dirtyColumns() 
@@ -3100,6 +3164,18 @@ LLScrollListItem* LLScrollListCtrl::addRow(LLScrollListItem *new_item, const LLS
 		}
 		cell_p.font_halign = columnp->mFontAlignment;
 
+		if (LLScrollListItem::canDeferColumn(cell_p))
+		{
+			new_item->setDeferredColumn(index, cell_p);
+			if (columnp->mHeader
+				&& !cell_p.value().asString().empty())
+			{
+				columnp->mHeader->setHasResizableElement(TRUE);
+			}
+			col_index++;
+			continue;
+		}
+
 		LLScrollListCell* cell = LLScrollListCell::create(cell_p);
 
 		if (cell)
@@ -3146,7 +3222,7 @@ LLScrollListItem* LLScrollListCtrl::addRow(LLScrollListItem *new_item, const LLS
 	for (column_map_t::iterator column_it = mColumns.begin(); column_it != mColumns.end(); ++column_it)
 	{
 		S32 column_idx = column_it->second->mIndex;
-		if (new_item->getColumn(column_idx) == NULL)
+		if (!new_item->hasColumn(column_idx))
 		{
 			LLScrollListColumn* column_ptr = column_it->second;
 			LLScrollListCell::Params cell_p;
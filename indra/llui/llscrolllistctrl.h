@@ -481,6 +481,9 @@ private:
 	typedef std::pair<S32, BOOL> sort_column_t;
 	std::vector<sort_column_t>	mSortColumns;
 
+	// stable sort of mItemList by sort_orders, last one first
+	void			sortItems(const std::vector<sort_column_t>& sort_orders) const;
+
 	sort_signal_t*	mSortCallback;
 }; // end class LLScrollListCtrl
 
@@ -47,11 +47,13 @@ LLScrollListItem::LLScrollListItem( const Params& p )
 LLScrollListItem::~LLScrollListItem()
 {
 	std::for_each(mColumns.begin(), mColumns.end(), DeletePointer());
+	std::for_each(mDeferredColumns.begin(), mDeferredColumns.end(), DeletePointer());
 }
 
 void LLScrollListItem::addColumn(const LLScrollListCell::Params& p)
 {
 	mColumns.push_back(LLScrollListCell::create(p));
+	mDeferredColumns.push_back(NULL);
 }
 
 void LLScrollListItem::setNumColumns(S32 columns)
@@ -60,13 +62,16 @@ void LLScrollListItem::setNumColumns(S32 columns)
 	if (columns < prev_columns)
 	{
 		std::for_each(mColumns.begin()+columns, mColumns.end(), DeletePointer());
+		std::for_each(mDeferredColumns.begin()+columns, mDeferredColumns.end(), DeletePointer());
 	}
 
 	mColumns.resize(columns);
+	mDeferredColumns.resize(columns);
 
 	for (S32 col = prev_columns; col < columns; ++col)
 	{
 		mColumns[col] = NULL;
+		mDeferredColumns[col] = NULL;
 	}
 }
 
@@ -76,6 +81,8 @@ void LLScrollListItem::setColumn( S32 column, LLScrollListCell *cell )
 	{
 		delete mColumns[column];
 		mColumns[column] = cell;
+		delete mDeferredColumns[column];
+		mDeferredColumns[column] = NULL;
 	}
 	else
 	{
@@ -83,6 +90,30 @@ void LLScrollListItem::setColumn( S32 column, LLScrollListCell *cell )
 	}
 }
 
+void LLScrollListItem::setDeferredColumn( S32 column, const LLScrollListCell::Params& p )
+{
+	setColumn(column, NULL);
+	DeferredText* text = new DeferredText;
+	text->mText = p.value().asString();
+	text->mColor = p.color;
+	text->mWidth = p.width;
+	text->mHAlign = p.font_halign;
+	text->mFontStyle = LLFontGL::getStyleFromString(p.font_style);
+	text->mUseColor = p.color.isProvided();
+	mDeferredColumns[column] = text;
+}
+
+//static
+bool LLScrollListItem::canDeferColumn(const LLScrollListCell::Params& p)
+{
+	// LLScrollListCell::create() makes an LLScrollListText of any other
+	// type, its height then only depends on the font. Hidden cells and
+	// tool tips are rare enough to always get a real cell.
+	const std::string& type = p.type();
+	return type != "icon" && type != "checkbox" && type != "date"
+		&& !p.font.isProvided() && p.visible && p.tool_tip().empty();
+}
+
 
 S32 LLScrollListItem::getNumColumns() const
 {
@@ -93,11 +124,92 @@ LLScrollListCell* LLScrollListItem::getColumn(const S32 i) const
 {
 	if (0 <= i && i < (S32)mColumns.size())
 	{
+		if (!mColumns[i] && mDeferredColumns[i])
+		{
+			const DeferredText* text = mDeferredColumns[i];
+			LLScrollListCell::Params p;
+			p.value = text->mText;
+			p.width = text->mWidth;
+			p.font_halign = text->mHAlign;
+			if (text->mUseColor)
+			{
+				p.color = text->mColor;
+			}
+			LLScrollListText* cell = new LLScrollListText(p);
+			cell->setFontStyle(text->mFontStyle);
+			mColumns[i] = cell;
+			delete text;
+			mDeferredColumns[i] = NULL;
+		}
 		return mColumns[i];
 	}
 	return NULL;
 }
 
+bool LLScrollListItem::hasColumn(const S32 i) const
+{
+	return 0 <= i && i < (S32)mColumns.size() && (mColumns[i] || mDeferredColumns[i]);
+}
+
+LLSD LLScrollListItem::getColumnValue(const S32 i) const
+{
+	if (!hasColumn(i))
+	{
+		return LLSD();
+	}
+	if (mDeferredColumns[i])
+	{
+		// What LLScrollListText::getValue() will return
+		return LLSD(mDeferredColumns[i]->mText);
+	}
+	return mColumns[i]->getValue();
+}
+
+S32 LLScrollListItem::getColumnHeight(const S32 i) const
+{
+	if (!hasColumn(i))
+	{
+		return 0;
+	}
+	if (mDeferredColumns[i])
+	{
+		return ll_round(LLFontGL::getFontSansSerifSmall()->getLineHeight());
+	}
+	return mColumns[i]->getHeight();
+}
+
+void LLScrollListItem::setColumnWidth(const S32 i, S32 width)
+{
+	if (!hasColumn(i))
+	{
+		return;
+	}
+	if (mDeferredColumns[i])
+	{
+		mDeferredColumns[i]->mWidth = width;
+	}
+	else
+	{
+		mColumns[i]->setWidth(width);
+	}
+}
+
+void LLScrollListItem::setColumnValue(const S32 i, const LLSD& value)
+{
+	if (!hasColumn(i))
+	{
+		return;
+	}
+	if (mDeferredColumns[i])
+	{
+		mDeferredColumns[i]->mText = value.asString();
+	}
+	else
+	{
+		mColumns[i]->setValue(value);
+	}
+}
+
 std::string LLScrollListItem::getContentsCSV() const
 {
 	std::string ret;
@@ -105,7 +217,7 @@ std::string LLScrollListItem::getContentsCSV() const
 	S32 count = getNumColumns();
 	for (S32 i=0; i<count; ++i)
 	{
-		ret += getColumn(i)->getValue().asString();
+		ret += getColumnValue(i).asString();
 		if (i < count-1)
 		{
 			ret += ", ";
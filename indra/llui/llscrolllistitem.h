@@ -86,10 +86,25 @@ public:
 
 	void	setColumn( S32 column, LLScrollListCell *cell );
 
+	// Keeps only the text, width, alignment, colour and style of a plain
+	// text cell, the cell is only created when getColumn() is first called
+	// for it, usually to draw it.
+	void	setDeferredColumn( S32 column, const LLScrollListCell::Params& p );
+
+	// True if a text cell with these params can be deferred.
+	static bool canDeferColumn(const LLScrollListCell::Params& p);
+
 	S32		getNumColumns() const;
 
 	LLScrollListCell *getColumn(const S32 i) const;
 
+	// These do not create deferred cells.
+	bool	hasColumn(const S32 i) const;
+	LLSD	getColumnValue(const S32 i) const;
+	S32		getColumnHeight(const S32 i) const;
+	void	setColumnWidth(const S32 i, S32 width);
+	void	setColumnValue(const S32 i, const LLSD& value);
+
 	std::string getContentsCSV() const;
 
 	virtual void draw(const LLRect& rect, const LLColor4& fg_color, const LLColor4& bg_color, const LLColor4& highlight_color, S32 column_padding);
@@ -102,7 +117,18 @@ private:
 	BOOL	mEnabled;
 	void*	mUserdata;
 	LLSD	mItemValue;
-	std::vector<LLScrollListCell *> mColumns;
+	mutable std::vector<LLScrollListCell *> mColumns;
+	// What LLScrollListText takes from the params canDeferColumn() accepts.
+	struct DeferredText
+	{
+		std::string			mText;
+		LLColor4			mColor;
+		S32					mWidth;
+		LLFontGL::HAlign	mHAlign;
+		U8					mFontStyle;
+		bool				mUseColor;
+	};
+	mutable std::vector<DeferredText *> mDeferredColumns;
 	LLRect  mRectangle;
 };
 
@@ -53,6 +53,7 @@
 #include "llmarketplacenotifications.h"
 #include "llmd5.h"
 #include "llmeshrepository.h"
+#include "llvolumebuildthread.h"
 #include "llmodaldialog.h"
 #include "llpumpio.h"
 #include "llmimetypes.h"
@@ -100,6 +101,7 @@
 #include "lldiriterator.h"
 #include "llimagej2c.h"
 #include "llmemory.h"
+#include "llnamestore.h"
 #include "llprimitive.h"
 #include "llurlaction.h"
 #include "llurlentry.h"
@@ -125,6 +127,7 @@
 #include "lltexturecache.h"
 #include "lltexturefetch.h"
 #include "llimageworker.h"
+#include "lljobscheduler.h"
 
 // <edit>
 #include "aicurleasyrequeststatemachine.h"
@@ -544,6 +547,7 @@ const std::string LLAppViewer::sCrashSettingsName = "CrashSettings";
 
 LLTextureCache* LLAppViewer::sTextureCache = NULL; 
 LLImageDecodeThread* LLAppViewer::sImageDecodeThread = NULL; 
+LLVolumeBuildThread* LLAppViewer::sVolumeBuildThread = NULL;
 LLTextureFetch* LLAppViewer::sTextureFetch = NULL; 
 
 LLAppViewer::LLAppViewer() : 
@@ -1534,6 +1538,14 @@ bool LLAppViewer::cleanup()
 	// shut down mesh streamer
 	gMeshRepo.shutdown();
 
+	// Stop building volumes before the volume manager is cleaned up.
+	if (sVolumeBuildThread)
+	{
+		sVolumeBuildThread->shutdown();
+		delete sVolumeBuildThread;
+		sVolumeBuildThread = NULL;
+	}
+
 	// Must clean up texture references before viewer window is destroyed.
 	if(LLHUDManager::instanceExists())
 	{
@@ -1681,6 +1693,8 @@ bool LLAppViewer::cleanup()
 	//LLVolumeMgr::cleanupClass();
 	LLPrimitive::cleanupVolumeManager();
 	LLWorldMapView::cleanupClass();
+	LLSurface::cleanupClass();
+	LLSkinningUtil::cleanupClass();
 	LLFolderViewItem::cleanupClass();
 	LLUI::cleanupClass();
 	
@@ -1826,6 +1840,7 @@ bool LLAppViewer::cleanup()
 	LLImage::cleanupClass();
 	LLVFSThread::cleanupClass();
 	LLLFSThread::cleanupClass();
+	LLJobScheduler::cleanupClass();
 
 	LL_INFOS() << "VFS Thread finished" << LL_ENDL;
 
@@ -1939,12 +1954,18 @@ bool LLAppViewer::initThreads()
 	AICurlInterface::startCurlThread(&gSavedSettings);
 
 	LLImage::initClass();
+
+	// Shared by the queues below, before any of them is created.
+	if (enable_threads)
+	{
+		LLJobScheduler::initClass(gSavedSettings.getU32("JobSchedulerThreads"));
+	}
 	
 	LLVFSThread::initClass(enable_threads && false);
 	LLLFSThread::initClass(enable_threads && false);
 
 	// Image decoding
-	LLAppViewer::sImageDecodeThread = new LLImageDecodeThread(enable_threads && true);
+	LLAppViewer::sImageDecodeThread = new LLImageDecodeThread(enable_threads && true, gSavedSettings.getU32("ImageDecodeThreads"));
 	LLAppViewer::sTextureCache = new LLTextureCache(enable_threads && true);
 	LLAppViewer::sTextureFetch = new LLTextureFetch(LLAppViewer::getTextureCache(),
 													sImageDecodeThread,
@@ -1955,6 +1976,12 @@ bool LLAppViewer::initThreads()
 	// Mesh streaming and caching
 	gMeshRepo.init();
 
+	// Prim volumes of LOD switches
+	if (enable_threads && gSavedSettings.getBOOL("RenderAsyncVolumeBuild"))
+	{
+		LLAppViewer::sVolumeBuildThread = new LLVolumeBuildThread();
+	}
+
 	// *FIX: no error handling here!
 	return true;
 }
@@ -3388,6 +3415,7 @@ bool LLAppViewer::initCache()
 	texture_cache_size -= extra;
 
 	LLVOCache::getInstance()->initCache(LL_PATH_CACHE, gSavedSettings.getU32("CacheNumberOfRegionsForObjects"), getObjectCacheVersion()) ;
+	gMeshRepo.initFaceCache(read_only);
 
 	LLSplashScreen::update(LLTrans::getString("StartupInitializingVFS"));
 	
@@ -3553,6 +3581,7 @@ void LLAppViewer::purgeCache()
 	LL_INFOS("AppCache") << "Purging Cache and Texture Cache..." << LL_ENDL;
 	LLAppViewer::getTextureCache()->purgeCache(LL_PATH_CACHE);
 	LLVOCache::getInstance()->removeCache(LL_PATH_CACHE);
+	LLMeshRepository::purgeFaceCache();
 	std::string mask = "*.*";
 	gDirUtilp->deleteFilesInDir(gDirUtilp->getExpandedFilename(LL_PATH_CACHE, ""), mask);
 }
@@ -3679,6 +3708,13 @@ void LLAppViewer::saveFinalSnapshot()
 
 void LLAppViewer::loadNameCache()
 {
+	// Both caches live in the name store, the XML caches of older versions
+	// are imported once and removed when the store was saved.
+	if (LLNameStore::getInstance()->open(gDirUtilp->getExpandedFilename(LL_PATH_CACHE, "names.db")))
+	{
+		return;
+	}
+
 	// Phoenix: Wolfspirit: Loads the Display Name Cache. And set if we are using Display Names.
 	std::string filename =
 		gDirUtilp->getExpandedFilename(LL_PATH_CACHE, "avatar_name_cache.xml");
@@ -3702,24 +3738,17 @@ void LLAppViewer::loadNameCache()
 
 void LLAppViewer::saveNameCache()
 {
-	// Phoenix: Wolfspirit: Saves the Display Name Cache.
-	std::string filename =
-		gDirUtilp->getExpandedFilename(LL_PATH_CACHE, "avatar_name_cache.xml");
-	llofstream name_cache_stream(filename);
-	if(name_cache_stream.is_open())
+	LLNameStore* store = LLNameStore::getInstance();
+	if (!store->isOpen())
 	{
-		LLAvatarNameCache::exportFile(name_cache_stream);
+		return;
 	}
-
-	if (!gCacheName) return;
-
-	std::string name_cache;
-	name_cache = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, "name.cache");
-	llofstream cache_file(name_cache);
-	if(cache_file.is_open())
+	if (store->flush())
 	{
-		gCacheName->exportFile(cache_file);
+		LLFile::remove_nowarn(gDirUtilp->getExpandedFilename(LL_PATH_CACHE, "avatar_name_cache.xml"));
+		LLFile::remove_nowarn(gDirUtilp->getExpandedFilename(LL_PATH_CACHE, "name.cache"));
 	}
+	store->close();
 }
 
 /*!	@brief		This class is an LLFrameTimer that can be created with
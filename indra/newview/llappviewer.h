@@ -41,6 +41,7 @@ class LLCommandLineParser;
 class LLTextureCache;
 class LLImageDecodeThread;
 class LLTextureFetch;
+class LLVolumeBuildThread;
 class LLWatchdogTimeout;
 
 class LLAppViewer : public LLApp
@@ -93,6 +94,7 @@ public:
 	static LLTextureCache* getTextureCache() { return sTextureCache; }
 	static LLImageDecodeThread* getImageDecodeThread() { return sImageDecodeThread; }
 	static LLTextureFetch* getTextureFetch() { return sTextureFetch; }
+	static LLVolumeBuildThread* getVolumeBuildThread() { return sVolumeBuildThread; }
 
 	static U32 getTextureCacheVersion() ;
 	static U32 getObjectCacheVersion() ;
@@ -236,6 +238,7 @@ private:
 	static LLTextureCache* sTextureCache; 
 	static LLImageDecodeThread* sImageDecodeThread; 
 	static LLTextureFetch* sTextureFetch;
+	static LLVolumeBuildThread* sVolumeBuildThread; // NULL when volumes are built on the main thread
 
 	S32 mNumSessions;
 
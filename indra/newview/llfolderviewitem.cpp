@@ -118,7 +118,8 @@ LLFolderViewItem::LLFolderViewItem( const std::string& name, LLUIImagePtr icon,
 	mIconOverlay(icon_overlay),
 	mListener(listener),
 	mShowLoadStatus(true),
-	mSearchType(0)
+	mSearchType(0),
+	mSearchIndexed(false)
 {
 	postBuild();//Not parsing xml file yet.
 }
@@ -295,6 +296,7 @@ void LLFolderViewItem::refresh()
 	std::string searchable_label(mLabel);
 	searchable_label.append(mLabelSuffix);
 	LLStringUtil::toUpper(searchable_label);
+	mSearchIndexed = mListener && mLabelSuffix.empty() && mLabel == mListener->getName();
 
 	if (mSearchableLabel.compare(searchable_label))
 	{
@@ -658,6 +660,11 @@ const std::string& LLFolderViewItem::getSearchableLabel()
 	return mSearchable;
 }
 
+bool LLFolderViewItem::isSearchIndexed() const
+{
+	return mSearchIndexed && !(mRoot->getSearchType() & 4);
+}
+
 LLViewerInventoryItem * LLFolderViewItem::getInventoryItem(void)
 {
 	if (!getListener()) return NULL;
@@ -1485,6 +1492,17 @@ void LLFolderViewFolder::filter( LLInventoryFilter& filter)
 			continue;
 		}
 
+		if (!filter.checkAgainstSearchIndex(item))
+		{
+			// ruled out by the search index, without using up a filter iteration
+			if (item->getVisible())
+			{
+				requestArrange();
+			}
+			item->setFiltered(FALSE, filter_generation);
+			continue;
+		}
+
 		item->filter( filter );
 
 		if (item->getFiltered(filter.getFirstSuccessGeneration()))
@@ -142,6 +142,7 @@ protected:
 
 	std::string					mSearchable;
 	U32							mSearchType;
+	bool						mSearchIndexed;
 	
 	// helper function to change the selection from the root.
 	void changeSelectionFromRoot(LLFolderViewItem* selection, BOOL selected);
@@ -254,6 +255,10 @@ public:
 
 	const std::string& getSearchableLabel( void );
 
+	// True if the searchable label is what LLInventorySearchIndex indexes
+	// for the item: its name and description, without suffix or creator.
+	bool isSearchIndexed() const;
+
 	// This method returns the label displayed on the view. This
 	// method was primarily added to allow sorting on the folder
 	// contents possible before the entire view has been constructed.
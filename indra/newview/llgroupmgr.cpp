@@ -53,6 +53,7 @@
 #include "llnotificationsutil.h"
 #include "lluictrlfactory.h"
 #include "lltrans.h"
+#include "llsdserialize.h"
 #include <boost/regex.hpp>
 
 #if LL_MSVC
@@ -2176,7 +2177,9 @@ void LLGroupMgr::processGroupBanRequest(const LLSD& content)
 
 
 // Responder class for capability group management
-class GroupMemberDataResponder : public LLHTTPClient::ResponderWithResult
+// Large groups send many megabytes of members; they are streamed out of
+// the reply into CapMemberData as they are parsed.
+class GroupMemberDataResponder : public LLHTTPClient::ResponderWithResult, public LLSDStreamVisitor
 {
 	LOG_CLASS(GroupMemberDataResponder);
 public:
@@ -2187,8 +2190,18 @@ private:
 	/* virtual */ void httpSuccess();
 	/* virtual */ void httpFailure();
 	/* virtual */ char const* getName() const { return "GroupMemberDataResponder"; }
+	/* virtual */ LLSDStreamVisitor* getContentVisitor() { return this; }
 
-	LLSD mMemberData;
+	/* virtual */ bool shouldSplit(const path_t& path)
+	{
+		return path.size() == 2 && path[0].asStringRef() == "members";
+	}
+	/* virtual */ void visit(const path_t& path, const LLSD& value)
+	{
+		mMembers.push_back(LLGroupMgr::CapMemberData(LLUUID(path[1].asStringRef()), value));
+	}
+
+	LLGroupMgr::cap_member_list_t mMembers;
 };
 
 void GroupMemberDataResponder::httpFailure()
@@ -2205,7 +2218,7 @@ void GroupMemberDataResponder::httpSuccess()
 		failureResult(HTTP_INTERNAL_ERROR_OTHER, "Malformed response contents", content);
 		return;
 	}
-	LLGroupMgr::processCapGroupMembersRequest(content);
+	LLGroupMgr::processCapGroupMembersRequest(content, mMembers);
 }
 
 
@@ -2255,8 +2268,23 @@ void LLGroupMgr::sendCapGroupMembersRequest(const LLUUID& group_id)
 }
 
 
+LLGroupMgr::CapMemberData::CapMemberData(const LLUUID& id, const LLSD& member_info)
+:	mID(id),
+	mLastLogin(member_info.has("last_login") ? member_info["last_login"].asString() : std::string("unknown")),
+	mTitle(member_info.has("title") ? member_info["title"].asInteger() : 0),
+	mPowers(0),
+	mHasPowers(member_info.has("powers")),
+	mContribution(member_info.has("donated_square_meters") ? member_info["donated_square_meters"].asInteger() : 0),
+	mIsOwner(member_info.has("owner"))
+{
+	if (mHasPowers)
+	{
+		mPowers = llstrtou64(member_info["powers"].asString().c_str(), NULL, 16);
+	}
+}
+
 // static
-void LLGroupMgr::processCapGroupMembersRequest(const LLSD& content)
+void LLGroupMgr::processCapGroupMembersRequest(const LLSD& content, const cap_member_list_t& members)
 {
 	// Did we get anything in content?
 	if (!content.size())
@@ -2288,63 +2316,37 @@ void LLGroupMgr::processCapGroupMembersRequest(const LLSD& content)
 
 	group_datap->mMemberCount = num_members;
 
-	LLSD member_list = content["members"];
 	LLSD titles = content["titles"];
 	LLSD defaults = content["defaults"];
 
 	std::string online_status;
 	std::string title;
-	S32 contribution;
 	U64 member_powers;
-	// If this is changed to a bool, make sure to change the LLGroupMemberData constructor
-	BOOL is_owner;
 
 	// Compute this once, rather than every time.
 	U64 default_powers = llstrtou64(defaults["default_powers"].asString().c_str(), NULL, 16);
 
-	LLSD::map_const_iterator member_iter_start = member_list.beginMap();
-	LLSD::map_const_iterator member_iter_end = member_list.endMap();
-	for ( ; member_iter_start != member_iter_end; ++member_iter_start)
+	for (cap_member_list_t::const_iterator member_iter = members.begin(); member_iter != members.end(); ++member_iter)
 	{
-		// Reset defaults
-		online_status = localized_unknown();
-		title = titles[0].asString();
-		contribution = 0;
-		member_powers = default_powers;
-		is_owner = false;
-
-		const LLUUID member_id(member_iter_start->first);
-		LLSD member_info = member_iter_start->second;
+		const LLUUID& member_id = member_iter->mID;
 
-		if (member_info.has("last_login"))
-		{
-			online_status = member_info["last_login"].asString();
-			if (online_status == "Online")
-				online_status = localized_online();
-			else if (online_status == "unknown")
-				online_status = localized_unknown();
-			else
-				formatDateString(online_status);
-		}
-
-		if (member_info.has("title"))
-			title = titles[member_info["title"].asInteger()].asString();
-
-		if (member_info.has("powers"))
-			member_powers = llstrtou64(member_info["powers"].asString().c_str(), NULL, 16);
-
-		if (member_info.has("donated_square_meters"))
-			contribution = member_info["donated_square_meters"];
+		online_status = member_iter->mLastLogin;
+		if (online_status == "Online")
+			online_status = localized_online();
+		else if (online_status == "unknown")
+			online_status = localized_unknown();
+		else
+			formatDateString(online_status);
 
-		if (member_info.has("owner"))
-			is_owner = true;
+		title = titles[member_iter->mTitle].asString();
+		member_powers = member_iter->mHasPowers ? member_iter->mPowers : default_powers;
 
 		LLGroupMemberData* data = new LLGroupMemberData(member_id, 
-			contribution,
+			member_iter->mContribution,
 			member_powers,
 			title,
 			online_status,
-			is_owner);
+			member_iter->mIsOwner);
 
 		LLGroupMemberData* member_old = group_datap->mMembers[member_id];
 		if (member_old && group_datap->mRoleMemberDataComplete)
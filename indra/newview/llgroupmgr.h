@@ -405,8 +405,24 @@ public:
 
 	static void processGroupBanRequest(const LLSD& content);
 
+	// One member of a GroupMemberData reply, taken out of the reply while
+	// it is parsed so that the member list is never held as LLSD.
+	struct CapMemberData
+	{
+		CapMemberData(const LLUUID& id, const LLSD& member_info);
+
+		LLUUID mID;
+		std::string mLastLogin;
+		S32 mTitle;				// Index into the titles of the reply
+		U64 mPowers;
+		bool mHasPowers;		// Otherwise the group default powers apply
+		S32 mContribution;
+		bool mIsOwner;
+	};
+	typedef std::vector<CapMemberData> cap_member_list_t;
+
 	void sendCapGroupMembersRequest(const LLUUID& group_id);
-	static void processCapGroupMembersRequest(const LLSD& content);
+	static void processCapGroupMembersRequest(const LLSD& content, const cap_member_list_t& members);
 
 	void cancelGroupRoleChanges(const LLUUID& group_id);
 
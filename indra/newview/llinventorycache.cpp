@@ -0,0 +1,511 @@
+/**
+ * @file llinventorycache.cpp
+ * @brief Memory mapped inventory cache, read on a background thread at login.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "llinventorycache.h"
+
+static const char * const LOG_INV("Inventory");
+
+static const U32 CACHE_MAGIC = 0x434e5649; // "IVNC"
+
+const S32 LLInventoryCacheLoader::CACHE_VERSION = 4;
+
+typedef LLInventoryCacheFile::Header cache_header_t;
+typedef LLInventoryCacheFile::DirectoryEntry cache_entry_t;
+
+LL_STATIC_ASSERT(sizeof(LLInventoryCacheCategoryRecord) % 4 == 0, "Cache records must keep blocks aligned");
+LL_STATIC_ASSERT(sizeof(LLInventoryCacheItemRecord) % 4 == 0, "Cache records must keep blocks aligned");
+LL_STATIC_ASSERT(sizeof(cache_header_t) % 4 == 0, "The cache header must keep blocks aligned");
+
+//----------------------------------------------------------------------------
+
+void LLInventoryCacheStringPool::add(const std::string& str, U32& offset, U32& size)
+{
+	size = str.size();
+	if (str.empty())
+	{
+		offset = 0;
+		return;
+	}
+	std::map<std::string, U32>::iterator iter = mOffsets.find(str);
+	if (iter == mOffsets.end())
+	{
+		iter = mOffsets.insert(std::make_pair(str, (U32)mData.size())).first;
+		mData.append(str);
+	}
+	offset = iter->second;
+}
+
+void LLInventoryCacheStringPool::clear()
+{
+	mData.clear();
+	mOffsets.clear();
+}
+
+bool LLInventoryCacheBlock::getString(U32 offset, U32 size, std::string& str) const
+{
+	if (offset > mCategory->mPoolSize || size > mCategory->mPoolSize - offset)
+	{
+		return false;
+	}
+	str.assign(mPool + offset, size);
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+LLInventoryCacheFile::LLInventoryCacheFile()
+	: mHeader(NULL),
+	  mDirectory(NULL),
+	  mObsolete(false)
+{
+}
+
+bool LLInventoryCacheFile::map(const std::string& filename)
+{
+	unmap();
+
+	llstat file_status;
+	if (LLFile::stat(filename, &file_status) != 0)
+	{
+		return false;
+	}
+	if ((U64)file_status.st_size < sizeof(cache_header_t) || (U64)file_status.st_size > U32_MAX)
+	{
+		mObsolete = true;
+		return false;
+	}
+
+	LLPointer<LLMappedFileView> view = new LLMappedFileView(filename, 0, (U32)file_status.st_size);
+	if (!view->isValid())
+	{
+		return false;
+	}
+	const cache_header_t* header = (const cache_header_t*)view->getData();
+	if (header->mMagic != CACHE_MAGIC || header->mVersion != LLInventoryCacheLoader::CACHE_VERSION)
+	{
+		mObsolete = true;
+		return false;
+	}
+	if (header->mDataEnd > view->getSize() || header->mDirectoryOffset < sizeof(cache_header_t)
+		|| header->mDirectoryOffset > header->mDataEnd || (header->mDirectoryOffset & 3)
+		|| header->mNumBlocks > (header->mDataEnd - header->mDirectoryOffset) / sizeof(cache_entry_t))
+	{
+		LL_WARNS(LOG_INV) << "Damaged inventory cache " << filename << LL_ENDL;
+		return false;
+	}
+
+	mView = view;
+	mHeader = header;
+	mDirectory = (const cache_entry_t*)(view->getData() + header->mDirectoryOffset);
+	return true;
+}
+
+void LLInventoryCacheFile::unmap()
+{
+	mHeader = NULL;
+	mDirectory = NULL;
+	mView = NULL;
+	mObsolete = false;
+}
+
+bool LLInventoryCacheFile::getBlock(U32 index, LLInventoryCacheBlock& block) const
+{
+	const cache_entry_t& entry = mDirectory[index];
+	if (entry.mOffset < sizeof(cache_header_t) || (entry.mOffset & 3) || entry.mOffset > mHeader->mDataEnd
+		|| entry.mSize > mHeader->mDataEnd - entry.mOffset || entry.mSize < sizeof(LLInventoryCacheCategoryRecord))
+	{
+		return false;
+	}
+	const U8* data = mView->getData() + entry.mOffset;
+	block.mCategory = (const LLInventoryCacheCategoryRecord*)data;
+	U64 size = sizeof(LLInventoryCacheCategoryRecord)
+		+ (U64)block.mCategory->mNumItems * sizeof(LLInventoryCacheItemRecord)
+		+ block.mCategory->mPoolSize;
+	if (size > entry.mSize)
+	{
+		return false;
+	}
+	block.mItems = (const LLInventoryCacheItemRecord*)(data + sizeof(LLInventoryCacheCategoryRecord));
+	block.mPool = (const char*)(block.mItems + block.mCategory->mNumItems);
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+LLInventoryCacheLoader::LLInventoryCacheLoader(const std::string& filename)
+	: LLThread("Inventory cache"),
+	  mFilename(filename),
+	  mObsolete(false),
+	  mStage(STAGE_LOADING),
+	  mCancelled(0)
+{
+}
+
+LLInventoryCacheLoader::~LLInventoryCacheLoader()
+{
+	cancel();
+}
+
+// MAIN THREAD
+void LLInventoryCacheLoader::cancel()
+{
+	mCancelled = 1;
+	waitForStop();
+}
+
+// MAIN THREAD
+void LLInventoryCacheLoader::waitForStop()
+{
+	while (!isStopped())
+	{
+		ms_sleep(1);
+	}
+}
+
+void LLInventoryCacheLoader::setStage(EStage stage)
+{
+	mStageCondition.lock();
+	mStage = stage;
+	mStageCondition.broadcast();
+	mStageCondition.unlock();
+}
+
+// MAIN THREAD
+LLInventoryCacheLoader::EStage LLInventoryCacheLoader::waitForStage(EStage stage)
+{
+	mStageCondition.lock();
+	while (mStage < stage)
+	{
+		mStageCondition.wait();
+	}
+	EStage reached = mStage;
+	mStageCondition.unlock();
+	return reached;
+}
+
+// MAIN THREAD
+bool LLInventoryCacheLoader::waitForCategories(LLViewerInventoryCategory::cat_array_t& categories)
+{
+	if (waitForStage(STAGE_CATEGORIES) == STAGE_FAILED)
+	{
+		waitForStop();
+		return false;
+	}
+	// The thread is done with mCategories once it moved on to the items.
+	categories.swap(mCategories);
+	return true;
+}
+
+// MAIN THREAD
+bool LLInventoryCacheLoader::waitForItems(LLViewerInventoryItem::item_array_t& items)
+{
+	EStage reached = waitForStage(STAGE_DONE);
+	waitForStop();
+	if (reached == STAGE_FAILED)
+	{
+		return false;
+	}
+	items.swap(mItems);
+	return true;
+}
+
+//virtual
+void LLInventoryCacheLoader::run()
+{
+	LLInventoryCacheFile file;
+	if (!file.map(mFilename))
+	{
+		mObsolete = file.isObsolete();
+		LL_INFOS(LOG_INV) << "unable to load inventory from: " << mFilename << LL_ENDL;
+		setStage(STAGE_FAILED);
+		return;
+	}
+
+	// What was read when loading fails is dropped with the loader, on the main thread.
+	setStage(load(file) ? STAGE_DONE : STAGE_FAILED);
+}
+
+bool LLInventoryCacheLoader::load(const LLInventoryCacheFile& file)
+{
+	LLTimer timer;
+	const U32 num_blocks = file.getNumBlocks();
+	LLInventoryCacheBlock block;
+	U32 num_items = 0;
+	mCategories.reserve(num_blocks);
+	for (U32 i = 0; i < num_blocks; ++i)
+	{
+		if (mCancelled)
+		{
+			return false;
+		}
+		LLPointer<LLViewerInventoryCategory> cat = new LLViewerInventoryCategory(LLUUID::null);
+		if (!file.getBlock(i, block) || !cat->unpackCacheRecord(block))
+		{
+			LL_WARNS(LOG_INV) << "Damaged inventory cache " << mFilename << LL_ENDL;
+			return false;
+		}
+		mCategories.push_back(cat);
+		// Bounded by the file size, getBlock() checked the records fit.
+		num_items += block.mCategory->mNumItems;
+	}
+	// Hand the categories over, the items follow.
+	setStage(STAGE_CATEGORIES);
+
+	mItems.reserve(num_items);
+	for (U32 i = 0; i < num_blocks; ++i)
+	{
+		if (mCancelled)
+		{
+			return false;
+		}
+		file.getBlock(i, block);
+		for (U32 j = 0; j < block.mCategory->mNumItems; ++j)
+		{
+			LLPointer<LLViewerInventoryItem> item = new LLViewerInventoryItem;
+			if (!item->unpackCacheRecord(block.mItems[j], block))
+			{
+				LL_WARNS(LOG_INV) << "Damaged inventory cache " << mFilename << LL_ENDL;
+				return false;
+			}
+			if (item->getUUID().isNull())
+			{
+				LL_WARNS(LOG_INV) << "Ignoring inventory with null item id: " << item->getName() << LL_ENDL;
+				continue;
+			}
+			mItems.push_back(item);
+		}
+	}
+	LL_INFOS(LOG_INV) << "Read " << num_blocks << " categories and " << mItems.size()
+					  << " items from " << mFilename << " in " << timer.getElapsedTimeF32() << "s" << LL_ENDL;
+	return true;
+}
+
+// Appends the block of cat and its items to data.
+static void pack_block(const LLViewerInventoryCategory* cat,
+					   const std::vector<LLViewerInventoryItem*>& items,
+					   LLInventoryCacheStringPool& pool,
+					   std::string& data)
+{
+	pool.clear();
+	LLInventoryCacheCategoryRecord cat_record;
+	cat->packCacheRecord(cat_record, pool);
+	std::vector<LLInventoryCacheItemRecord> item_records(items.size());
+	for (U32 i = 0; i < items.size(); ++i)
+	{
+		items[i]->packCacheRecord(item_records[i], pool);
+	}
+	cat_record.mNumItems = items.size();
+	cat_record.mPoolSize = (pool.getData().size() + 3) & ~3;
+
+	data.append((const char*)&cat_record, sizeof(cat_record));
+	if (!item_records.empty())
+	{
+		data.append((const char*)&item_records[0], item_records.size() * sizeof(LLInventoryCacheItemRecord));
+	}
+	data.append(pool.getData());
+	data.append(cat_record.mPoolSize - pool.getData().size(), '\0');
+}
+
+static bool write_file(LLFILE* fp, const void* data, size_t size)
+{
+	return !size || fwrite(data, size, 1, fp) == 1;
+}
+
+//static
+bool LLInventoryCacheLoader::save(const std::string& filename,
+								  const LLViewerInventoryCategory::cat_array_t& categories,
+								  const LLViewerInventoryItem::item_array_t& items,
+								  const std::set<LLUUID>& dirty)
+{
+	// Only categories with a known version are cached, and so are their items.
+	std::map<LLUUID, U32> cat_index;
+	std::vector<LLViewerInventoryCategory*> cats;
+	for (LLViewerInventoryCategory::cat_array_t::const_iterator iter = categories.begin(); iter != categories.end(); ++iter)
+	{
+		if ((*iter)->getVersion() != LLViewerInventoryCategory::VERSION_UNKNOWN
+			&& cat_index.insert(std::make_pair((*iter)->getUUID(), (U32)cats.size())).second)
+		{
+			cats.push_back(*iter);
+		}
+	}
+	std::vector<std::vector<LLViewerInventoryItem*> > cat_items(cats.size());
+	for (LLViewerInventoryItem::item_array_t::const_iterator iter = items.begin(); iter != items.end(); ++iter)
+	{
+		std::map<LLUUID, U32>::iterator cat = cat_index.find((*iter)->getParentUUID());
+		if (cat != cat_index.end())
+		{
+			cat_items[cat->second].push_back(*iter);
+		}
+	}
+
+	// Keep the blocks of the last save that are still up to date.
+	LLInventoryCacheFile old_file;
+	const bool have_old_file = old_file.map(filename);
+	std::vector<S32> kept(cats.size(), -1);
+	LLInventoryCacheBlock block;
+	std::string name;
+	for (U32 i = 0; i < old_file.getNumBlocks(); ++i)
+	{
+		if (!old_file.getBlock(i, block))
+		{
+			continue;
+		}
+		const LLInventoryCacheCategoryRecord* record = block.mCategory;
+		std::map<LLUUID, U32>::iterator cat_it = cat_index.find(record->mUUID);
+		if (cat_it == cat_index.end() || kept[cat_it->second] >= 0 || dirty.count(record->mUUID))
+		{
+			continue;
+		}
+		const LLViewerInventoryCategory* cat = cats[cat_it->second];
+		if (record->mVersion == cat->getVersion()
+			&& record->mNumItems == cat_items[cat_it->second].size()
+			&& record->mParentUUID == cat->getParentUUID()
+			&& record->mPreferredType == cat->getPreferredType()
+			&& block.getString(record->mNameOffset, record->mNameSize, name)
+			&& name == cat->getName())
+		{
+			kept[cat_it->second] = i;
+		}
+	}
+
+	// Pack the dirty blocks, their offsets are relative to the start of data for now.
+	std::string data;
+	LLInventoryCacheStringPool pool;
+	std::vector<cache_entry_t> directory(cats.size());
+	U32 live_size = sizeof(cache_header_t) + cats.size() * sizeof(cache_entry_t);
+	U32 num_dirty = 0;
+	for (U32 i = 0; i < cats.size(); ++i)
+	{
+		if (kept[i] >= 0)
+		{
+			directory[i] = old_file.getDirectoryEntry(kept[i]);
+		}
+		else
+		{
+			directory[i].mOffset = data.size();
+			pack_block(cats[i], cat_items[i], pool, data);
+			directory[i].mSize = data.size() - directory[i].mOffset;
+			++num_dirty;
+		}
+		live_size += directory[i].mSize;
+	}
+
+	cache_header_t header;
+	header.mMagic = CACHE_MAGIC;
+	header.mVersion = CACHE_VERSION;
+	header.mNumBlocks = cats.size();
+	header.mReserved = 0;
+
+	U32 append_at = old_file.getDataEnd();
+	if (have_old_file && (U64)append_at + data.size() + directory.size() * sizeof(cache_entry_t) <= 2 * (U64)live_size)
+	{
+		// Append the dirty blocks and the new directory, then switch the header over.
+		for (U32 i = 0; i < cats.size(); ++i)
+		{
+			if (kept[i] < 0)
+			{
+				directory[i].mOffset += append_at;
+			}
+		}
+		old_file.unmap();
+		header.mDirectoryOffset = append_at + data.size();
+		header.mDataEnd = header.mDirectoryOffset + directory.size() * sizeof(cache_entry_t);
+
+		LLFILE* fp = LLFile::fopen(filename, "r+b");
+		if (!fp)
+		{
+			LL_WARNS(LOG_INV) << "unable to save inventory to: " << filename << LL_ENDL;
+			return false;
+		}
+		bool ok = fseek(fp, append_at, SEEK_SET) == 0
+				  && write_file(fp, data.data(), data.size())
+				  && write_file(fp, directory.empty() ? NULL : &directory[0], directory.size() * sizeof(cache_entry_t))
+				  && fflush(fp) == 0
+				  && fseek(fp, 0, SEEK_SET) == 0
+				  && write_file(fp, &header, sizeof(header));
+		ok = LLFile::close(fp) == 0 && ok;
+		if (!ok)
+		{
+			// The header may be half written, do not trust the file anymore.
+			LL_WARNS(LOG_INV) << "unable to save inventory to: " << filename << LL_ENDL;
+			LLFile::remove(filename);
+			return false;
+		}
+		LL_INFOS(LOG_INV) << "Updated " << num_dirty << " of " << cats.size() << " categories in " << filename << LL_ENDL;
+		return true;
+	}
+
+	// Too much dead space, or no usable file: write everything anew, copying
+	// the kept blocks from the old file.
+	std::string temp_filename(filename + ".t");
+	LLFILE* fp = LLFile::fopen(temp_filename, "wb");
+	if (!fp)
+	{
+		LL_WARNS(LOG_INV) << "unable to save inventory to: " << filename << LL_ENDL;
+		return false;
+	}
+	bool ok = write_file(fp, &header, sizeof(header)); // rewritten below
+	U32 offset = sizeof(header);
+	for (U32 i = 0; ok && i < cats.size(); ++i)
+	{
+		if (kept[i] >= 0)
+		{
+			old_file.getBlock(kept[i], block);
+			ok = write_file(fp, block.mCategory, directory[i].mSize);
+		}
+		else
+		{
+			ok = write_file(fp, data.data() + directory[i].mOffset, directory[i].mSize);
+		}
+		directory[i].mOffset = offset;
+		offset += directory[i].mSize;
+	}
+	old_file.unmap();
+	header.mDirectoryOffset = offset;
+	header.mDataEnd = offset + directory.size() * sizeof(cache_entry_t);
+	ok = ok && write_file(fp, directory.empty() ? NULL : &directory[0], directory.size() * sizeof(cache_entry_t))
+		 && fseek(fp, 0, SEEK_SET) == 0
+		 && write_file(fp, &header, sizeof(header));
+	ok = LLFile::close(fp) == 0 && ok;
+	if (ok)
+	{
+#if LL_WINDOWS
+		// Rename in windows needs the destination to not exist.
+		LLFile::remove_nowarn(filename);
+#endif
+		ok = LLFile::rename(temp_filename, filename) == 0;
+	}
+	if (!ok)
+	{
+		LL_WARNS(LOG_INV) << "unable to save inventory to: " << filename << LL_ENDL;
+		LLFile::remove(temp_filename);
+		return false;
+	}
+	LL_INFOS(LOG_INV) << "Wrote " << cats.size() << " categories to " << filename << LL_ENDL;
+	return true;
+}
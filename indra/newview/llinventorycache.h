@@ -0,0 +1,216 @@
+/**
+ * @file llinventorycache.h
+ * @brief Memory mapped inventory cache, read on a background thread at login.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLINVENTORYCACHE_H
+#define LL_LLINVENTORYCACHE_H
+
+#include "llatomic.h"
+#include "llmappedfile.h"
+#include "llpointer.h"
+#include "llthread.h"
+#include "llviewerinventory.h"
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+// The cache file is a Header, a data area of blocks and a directory of the
+// blocks that are in use, all in host byte order: the cache never leaves
+// the machine. Each category is one block: its CategoryRecord, the fixed
+// size ItemRecords of its items and the string pool holding their names
+// and descriptions, padded to 4 bytes.
+//
+// Blocks are only ever appended. A save keeps the blocks of the categories
+// that did not change, appends the dirty ones and a new directory, and only
+// then points the header at it, so the file is never left half written.
+// Once more than half of the data area is dead the file is rewritten.
+
+struct LLInventoryCacheCategoryRecord
+{
+	LLUUID mUUID;
+	LLUUID mParentUUID;
+	LLUUID mOwnerID;
+	S32 mPreferredType;
+	S32 mVersion;
+	U32 mNameOffset;		// In the string pool of the block
+	U32 mNameSize;
+	U32 mNumItems;
+	U32 mPoolSize;
+};
+
+struct LLInventoryCacheItemRecord
+{
+	LLUUID mUUID;
+	LLUUID mParentUUID;
+	LLUUID mCreatorID;
+	LLUUID mOwnerID;
+	LLUUID mLastOwnerID;
+	LLUUID mGroupID;
+	LLUUID mAssetUUID;
+	U32 mMaskBase;
+	U32 mMaskOwner;
+	U32 mMaskGroup;
+	U32 mMaskEveryone;
+	U32 mMaskNextOwner;
+	U32 mFlags;
+	S32 mSalePrice;
+	S32 mCreationDate;
+	S8 mType;
+	S8 mInventoryType;
+	S8 mSaleType;
+	S8 mGroupOwned;
+	U32 mNameOffset;
+	U32 mNameSize;
+	U32 mDescOffset;
+	U32 mDescSize;
+};
+
+// Collects the strings of one block, each distinct string is stored once.
+class LLInventoryCacheStringPool
+{
+public:
+	void add(const std::string& str, U32& offset, U32& size);
+	const std::string& getData() const { return mData; }
+	void clear();
+
+private:
+	std::string mData;
+	std::map<std::string, U32> mOffsets;
+};
+
+// One category block, pointing into the mapped file.
+struct LLInventoryCacheBlock
+{
+	const LLInventoryCacheCategoryRecord* mCategory;
+	const LLInventoryCacheItemRecord* mItems;
+	const char* mPool;
+
+	// Returns false if the range lies outside of the string pool.
+	bool getString(U32 offset, U32 size, std::string& str) const;
+};
+
+// A validated, read only mapping of a cache file.
+class LLInventoryCacheFile
+{
+public:
+	struct Header
+	{
+		U32 mMagic;
+		S32 mVersion;
+		U32 mDataEnd;		// New blocks are appended here
+		U32 mDirectoryOffset;
+		U32 mNumBlocks;
+		U32 mReserved;
+	};
+
+	struct DirectoryEntry
+	{
+		U32 mOffset;
+		U32 mSize;
+	};
+
+	LLInventoryCacheFile();
+
+	// Maps filename, returns false if it is missing, obsolete or damaged.
+	bool map(const std::string& filename);
+	void unmap();
+
+	// True when the file exists but was written by another version.
+	bool isObsolete() const { return mObsolete; }
+
+	U32 getNumBlocks() const { return mHeader ? mHeader->mNumBlocks : 0; }
+	U32 getDataEnd() const { return mHeader ? mHeader->mDataEnd : 0; }
+	const DirectoryEntry& getDirectoryEntry(U32 index) const { return mDirectory[index]; }
+	// Returns false if the block is damaged.
+	bool getBlock(U32 index, LLInventoryCacheBlock& block) const;
+
+private:
+	LLPointer<LLMappedFileView> mView;
+	const Header* mHeader;
+	const DirectoryEntry* mDirectory;
+	bool mObsolete;
+};
+
+// Builds the inventory of one cache file from its mapping on its own thread.
+// Categories are handed over as soon as they are built so loadSkeleton()
+// can merge them while the items are still being built.
+class LLInventoryCacheLoader : public LLThread
+{
+public:
+	static const S32 CACHE_VERSION;
+
+	LLInventoryCacheLoader(const std::string& filename);
+	~LLInventoryCacheLoader();
+
+	// MAIN THREAD
+	// Block until the categories, then the items, are read. Return false if
+	// the cache is missing, obsolete, damaged or the load was cancelled.
+	bool waitForCategories(LLViewerInventoryCategory::cat_array_t& categories);
+	bool waitForItems(LLViewerInventoryItem::item_array_t& items);
+
+	// MAIN THREAD
+	// True when the file exists but was written by another version.
+	bool isObsolete() const { return mObsolete; }
+
+	// MAIN THREAD
+	// Stops reading at the next record and waits for the thread to end.
+	void cancel();
+
+	// Writes the categories with a known version and their items. The blocks
+	// of categories that are not in dirty and whose version did not change
+	// are kept. Returns false if the cache could not be written.
+	static bool save(const std::string& filename,
+					 const LLViewerInventoryCategory::cat_array_t& categories,
+					 const LLViewerInventoryItem::item_array_t& items,
+					 const std::set<LLUUID>& dirty);
+
+private:
+	enum EStage
+	{
+		STAGE_LOADING,
+		STAGE_CATEGORIES,
+		STAGE_DONE,
+		STAGE_FAILED
+	};
+
+	/*virtual*/ void run();
+	bool load(const LLInventoryCacheFile& file);
+	void setStage(EStage stage);
+	EStage waitForStage(EStage stage);
+	void waitForStop();
+
+	std::string mFilename;
+	LLViewerInventoryCategory::cat_array_t mCategories;
+	LLViewerInventoryItem::item_array_t mItems;
+	bool mObsolete;
+
+	LLCondition mStageCondition;
+	EStage mStage; // protected by mStageCondition
+	LLAtomicU32 mCancelled;
+};
+
+#endif // LL_LLINVENTORYCACHE_H
@@ -33,6 +33,7 @@
 #include "llfolderviewitem.h"
 #include "llinventorymodel.h"
 #include "llinventorymodelbackgroundfetch.h"
+#include "llinventorysearchindex.h"
 #include "llviewercontrol.h"
 #include "llfolderview.h"
 #include "llinventorybridge.h"
@@ -68,6 +69,8 @@ LLInventoryFilter::LLInventoryFilter(const std::string& name)
 	mFilterModified(FILTER_NONE),
 	mFilterOps(),
 	mFilterSubString(),
+	mSearchIndexGeneration(0),
+	mSearchIndexValid(false),
 	mCurrentGeneration(0),
 	mFirstRequiredGeneration(0),
 	mFirstSuccessGeneration(0)
@@ -114,6 +117,28 @@ bool LLInventoryFilter::check(LLFolderViewItem* item)
 	return passed;
 }
 
+bool LLInventoryFilter::checkAgainstSearchIndex(LLFolderViewItem* item)
+{
+	if (mFilterSubString.size() < LLInventorySearchIndex::MIN_SUB_STRING_SIZE || !item->isSearchIndexed())
+	{
+		return true;
+	}
+
+	LLInventorySearchIndex* index = LLInventorySearchIndex::getInstance();
+	if (mSearchIndexString != mFilterSubString || mSearchIndexGeneration != index->getGeneration())
+	{
+		mSearchIndexMatches.clear();
+		mSearchIndexValid = index->find(mFilterSubString, mSearchIndexMatches);
+		mSearchIndexString = mFilterSubString;
+		mSearchIndexGeneration = index->getGeneration();
+	}
+
+	// Items the index does not know, such as those of task inventories, are
+	// checked as usual.
+	const LLUUID& item_id = item->getListener()->getUUID();
+	return !mSearchIndexValid || mSearchIndexMatches.count(item_id) || !index->isIndexed(item_id);
+}
+
 bool LLInventoryFilter::checkFolder(const LLFolderViewFolder* folder) const
 {
 	if (!folder)
@@ -141,6 +141,9 @@ struct FilterOps
 	bool 				check(LLFolderViewItem* item);
 	bool				checkFolder(const LLFolderViewFolder* folder) const;
 	bool				checkFolder(const LLUUID& folder_id) const;
+	// False if the search index shows the item can not match the filter
+	// string, so it fails without being checked.
+	bool				checkAgainstSearchIndex(LLFolderViewItem* item);
 
 	bool				showAllResults() const;
 
@@ -212,6 +215,12 @@ private:
 	std::string				mFilterSubStringOrig;
 	const std::string		mName;
 
+	// Items of LLInventorySearchIndex matching mSearchIndexString
+	uuid_set_t				mSearchIndexMatches;
+	std::string				mSearchIndexString;
+	U32						mSearchIndexGeneration;
+	bool					mSearchIndexValid;
+
 	S32						mCurrentGeneration;
     // The following makes checking for pass/no pass possible even if the item is not checked against the current generation
     // Any item that *did not pass* the "required generation" will *not pass* the current one
@@ -31,6 +31,7 @@
 #include "llagent.h"
 #include "llagentwearables.h"
 #include "llappearancemgr.h"
+#include "llinventorycache.h"
 #include "llinventoryclipboard.h"
 #include "llinventorypanel.h"
 #include "llinventorybridge.h"
@@ -65,7 +66,6 @@
 
 // Increment this if the inventory contents change in a non-backwards-compatible way.
 // For viewers with link items support, former caches are incorrect.
-const S32 LLInventoryModel::sCurrentInvCacheVersion = 2;
 BOOL LLInventoryModel::sFirstTimeInViewer2 = TRUE;
 
 ///----------------------------------------------------------------------------
@@ -73,7 +73,9 @@ BOOL LLInventoryModel::sFirstTimeInViewer2 = TRUE;
 ///----------------------------------------------------------------------------
 
 //BOOL decompress_file(const char* src_filename, const char* dst_filename);
-static const char CACHE_FORMAT_STRING[] = "%s.inv"; 
+static const char CACHE_FORMAT_STRING[] = "%s.invc";
+// Caches of older versions, removed once the current one is written.
+static const char* LEGACY_CACHE_FORMAT_STRINGS[] = { "%s.inv.gz", "%s.invb.gz" };
 static const char * const LOG_INV("Inventory");
 
 struct InventoryIDPtrLess
@@ -159,6 +161,8 @@ LLInventoryModel::~LLInventoryModel()
 
 void LLInventoryModel::cleanupInventory()
 {
+	cancelCacheLoads();
+	mCacheDirtyCategoryIDs.clear();
 	empty();
 	// Deleting one observer might erase others from the list, so always pop off the front
 	while (!mObservers.empty())
@@ -1663,6 +1667,17 @@ void LLInventoryModel::addChangedMask(U32 mask, const LLUUID& referent)
 			mAddedItemIDs.insert(referent);
 		}
 
+		// The cache rewrites the folders whose contents changed.
+		const LLInventoryObject* obj = getObject(referent);
+		if (obj)
+		{
+			mCacheDirtyCategoryIDs.insert(obj->getParentUUID());
+			if (obj->getType() == LLAssetType::AT_CATEGORY)
+			{
+				mCacheDirtyCategoryIDs.insert(referent);
+			}
+		}
+
 		// Update all linked items.  Starting with just LABEL because I'm
 		// not sure what else might need to be accounted for this.
 		if (mask & LLInventoryObserver::LABEL)
@@ -1720,23 +1735,48 @@ void LLInventoryModel::cache(
 		items,
 		INCLUDE_TRASH,
 		can_cache);
-	std::string agent_id_str;
-	std::string inventory_filename;
-	agent_id.toString(agent_id_str);
-	std::string path(gDirUtilp->getExpandedFilename(LL_PATH_CACHE, agent_id_str));
-	inventory_filename = llformat(CACHE_FORMAT_STRING, path.c_str());
-	saveToFile(inventory_filename, categories, items);
-	std::string gzip_filename(inventory_filename);
-	gzip_filename.append(".gz");
-	if(gzip_file(inventory_filename, gzip_filename))
-	{
-		LL_DEBUGS(LOG_INV) << "Successfully compressed " << inventory_filename << LL_ENDL;
-		LLFile::remove(inventory_filename);
+	if (LLInventoryCacheLoader::save(getCacheFilename(agent_id), categories, items, mCacheDirtyCategoryIDs))
+	{
+		LL_DEBUGS(LOG_INV) << "Saved inventory cache for " << agent_id << LL_ENDL;
+		std::string path(gDirUtilp->getExpandedFilename(LL_PATH_CACHE, agent_id.asString()));
+		for (U32 i = 0; i < LL_ARRAY_SIZE(LEGACY_CACHE_FORMAT_STRINGS); ++i)
+		{
+			LLFile::remove_nowarn(llformat(LEGACY_CACHE_FORMAT_STRINGS[i], path.c_str()));
+		}
 	}
-	else
+}
+
+//static
+std::string LLInventoryModel::getCacheFilename(const LLUUID& owner_id)
+{
+	std::string path(gDirUtilp->getExpandedFilename(LL_PATH_CACHE, owner_id.asString()));
+	return llformat(CACHE_FORMAT_STRING, path.c_str());
+}
+
+void LLInventoryModel::startCacheLoad(const LLUUID& owner_id)
+{
+	if (owner_id.isNull() || mCacheLoaders.count(owner_id))
 	{
-		LL_WARNS(LOG_INV) << "Unable to compress " << inventory_filename << LL_ENDL;
+		return;
 	}
+	// The loader checks the type of every item against the inventory and
+	// asset dictionaries. LLSingleton is not thread safe, so build both here
+	// before the loader thread can be the first to use them.
+	LLInventoryType::lookup(LLInventoryType::IT_NONE);
+	LLAssetType::lookup(LLAssetType::AT_NONE);
+
+	LLInventoryCacheLoader* loader = new LLInventoryCacheLoader(getCacheFilename(owner_id));
+	mCacheLoaders[owner_id] = loader;
+	loader->start();
+}
+
+void LLInventoryModel::cancelCacheLoads()
+{
+	for (cache_loader_map_t::iterator iter = mCacheLoaders.begin(); iter != mCacheLoaders.end(); ++iter)
+	{
+		delete iter->second; // cancels
+	}
+	mCacheLoaders.clear();
 }
 
 
@@ -2028,34 +2068,17 @@ bool LLInventoryModel::loadSkeleton(
 		item_array_t items;
 		item_array_t possible_broken_links;
 		cat_set_t invalid_categories; // Used to mark categories that weren't successfully loaded.
-		std::string owner_id_str;
-		owner_id.toString(owner_id_str);
-		std::string path(gDirUtilp->getExpandedFilename(LL_PATH_CACHE, owner_id_str));
-		std::string inventory_filename;
-		inventory_filename = llformat(CACHE_FORMAT_STRING, path.c_str());
 		const S32 NO_VERSION = LLViewerInventoryCategory::VERSION_UNKNOWN;
-		std::string gzip_filename(inventory_filename);
-		gzip_filename.append(".gz");
-		LLFILE* fp = LLFile::fopen(gzip_filename, "rb");
-		bool remove_inventory_file = false;
-		if (fp)
+		// Normally started at login, long before the skeleton arrives.
+		startCacheLoad(owner_id);
+		LLInventoryCacheLoader* loader = NULL;
+		cache_loader_map_t::iterator loader_it = mCacheLoaders.find(owner_id);
+		if (loader_it != mCacheLoaders.end())
 		{
-			fclose(fp);
-			fp = NULL;
-			if (gunzip_file(gzip_filename, inventory_filename))
-			{
-				// we only want to remove the inventory file if it was
-				// gzipped before we loaded, and we successfully
-				// gunziped it.
-				remove_inventory_file = true;
-			}
-			else
-			{
-				LL_INFOS(LOG_INV) << "Unable to gunzip " << gzip_filename << LL_ENDL;
-			}
+			loader = loader_it->second;
+			mCacheLoaders.erase(loader_it);
 		}
-		bool is_cache_obsolete = false;
-		if(loadFromFile(inventory_filename, categories, items, is_cache_obsolete))
+		if (loader && loader->waitForCategories(categories))
 		{
 			// We were able to find a cache of files. So, use what we
 			// found to generate a set of categories we should add. We
@@ -2110,6 +2133,18 @@ bool LLInventoryModel::loadSkeleton(
 				++child_counts[(*it)->getParentUUID()];
 			}
 
+			// The items were read while the categories were merged.
+			if (!loader->waitForItems(items))
+			{
+				// Without their items the cached folders are not complete.
+				LL_WARNS(LOG_INV) << "Unable to load cached items, invalidating cached categories" << LL_ENDL;
+				for (cat_set_t::iterator it = temp_cats.begin(); it != temp_cats.end(); ++it)
+				{
+					(*it)->setVersion(NO_VERSION);
+				}
+				cached_category_count = 0;
+			}
+
 			// Add all the items loaded which are parented to a
 			// category with a correctly cached parent
 			S32 bad_link_count = 0;
@@ -2228,17 +2263,12 @@ bool LLInventoryModel::loadSkeleton(
 			}
 		}
 
-		if (remove_inventory_file)
-		{
-			// clean up the gunzipped file.
-			LLFile::remove(inventory_filename);
-		}
-		if(is_cache_obsolete)
+		if (loader && loader->isObsolete())
 		{
-			// If out of date, remove the gzipped file too.
 			LL_WARNS(LOG_INV) << "Inv cache out of date, removing" << LL_ENDL;
-			LLFile::remove(gzip_filename);
+			LLFile::remove(getCacheFilename(owner_id));
 		}
+		delete loader;
 		categories.clear(); // will unref and delete entries
 	}
 
@@ -2545,146 +2575,6 @@ bool LLUUIDAndName::operator>(const LLUUIDAndName& rhs) const
 	return (mID > rhs.mID);
 }
 
-// static
-bool LLInventoryModel::loadFromFile(const std::string& filename,
-									LLInventoryModel::cat_array_t& categories,
-									LLInventoryModel::item_array_t& items,
-									bool &is_cache_obsolete)
-{
-	if(filename.empty())
-	{
-		LL_ERRS(LOG_INV) << "Filename is Null!" << LL_ENDL;
-		return false;
-	}
-	LL_INFOS(LOG_INV) << "LLInventoryModel::loadFromFile(" << filename << ")" << LL_ENDL;
-	LLFILE* file = LLFile::fopen(filename, "rb");		/*Flawfinder: ignore*/
-	if(!file)
-	{
-		LL_INFOS(LOG_INV) << "unable to load inventory from: " << filename << LL_ENDL;
-		return false;
-	}
-	// *NOTE: This buffer size is hard coded into scanf() below.
-	char buffer[MAX_STRING];		/*Flawfinder: ignore*/
-	char keyword[MAX_STRING];		/*Flawfinder: ignore*/
-	char value[MAX_STRING];			/*Flawfinder: ignore*/
-	is_cache_obsolete = true;  		// Obsolete until proven current
-	while(!feof(file) && fgets(buffer, MAX_STRING, file)) 
-	{
-		sscanf(buffer, " %126s %126s", keyword, value);	/* Flawfinder: ignore */
-		if (0 == strcmp("inv_cache_version", keyword))
-		{
-			S32 version;
-			int succ = sscanf(value,"%d",&version);
-			if ((1 == succ) && (version == sCurrentInvCacheVersion))
-			{
-				// Cache is up to date
-				is_cache_obsolete = false;
-				continue;
-			}
-			else
-			{
-				// Cache is out of date
-				break;
-			}
-		}
-		else if(0 == strcmp("inv_category", keyword))
-		{
-			if (is_cache_obsolete)
-				break;
-			
-			LLPointer<LLViewerInventoryCategory> inv_cat = new LLViewerInventoryCategory(LLUUID::null);
-			if(inv_cat->importFileLocal(file))
-			{
-				categories.push_back(inv_cat);
-			}
-			else
-			{
-				LL_WARNS(LOG_INV) << "loadInventoryFromFile().  Ignoring invalid inventory category: " << inv_cat->getName() << LL_ENDL;
-				//delete inv_cat; // automatic when inv_cat is reassigned or destroyed
-			}
-		}
-		else if(0 == strcmp("inv_item", keyword))
-		{
-			if (is_cache_obsolete)
-				break;
-
-			LLPointer<LLViewerInventoryItem> inv_item = new LLViewerInventoryItem;
-			if( inv_item->importFileLocal(file) )
-			{
-				// *FIX: Need a better solution, this prevents the
-				// application from freezing, but breaks inventory
-				// caching.
-				if(inv_item->getUUID().isNull())
-				{
-					//delete inv_item; // automatic when inv_cat is reassigned or destroyed
-					LL_WARNS(LOG_INV) << "Ignoring inventory with null item id: "
-									  << inv_item->getName() << LL_ENDL;
-						
-				}
-				else
-				{
-					items.push_back(inv_item);
-				}
-			}
-			else
-			{
-				LL_WARNS(LOG_INV) << "loadInventoryFromFile().  Ignoring invalid inventory item: " << inv_item->getName() << LL_ENDL;
-				//delete inv_item; // automatic when inv_cat is reassigned or destroyed
-			}
-		}
-		else
-		{
-			LL_WARNS(LOG_INV) << "Unknown token in inventory file '" << keyword << "'"
-							  << LL_ENDL;
-		}
-	}
-	fclose(file);
-	if (is_cache_obsolete)
-		return false;
-	return true;
-}
-
-// static
-bool LLInventoryModel::saveToFile(const std::string& filename,
-								  const cat_array_t& categories,
-								  const item_array_t& items)
-{
-	if(filename.empty())
-	{
-		LL_ERRS(LOG_INV) << "Filename is Null!" << LL_ENDL;
-		return false;
-	}
-	LL_INFOS(LOG_INV) << "LLInventoryModel::saveToFile(" << filename << ")" << LL_ENDL;
-	LLFILE* file = LLFile::fopen(filename, "wb");		/*Flawfinder: ignore*/
-	if(!file)
-	{
-		LL_WARNS(LOG_INV) << "unable to save inventory to: " << filename << LL_ENDL;
-		return false;
-	}
-
-	fprintf(file, "\tinv_cache_version\t%d\n", sCurrentInvCacheVersion);
-
-	S32 count = categories.size();
-	S32 i;
-	for(i = 0; i < count; ++i)
-	{
-		LLViewerInventoryCategory* cat = categories[i];
-		if(cat->getVersion() != LLViewerInventoryCategory::VERSION_UNKNOWN)
-		{
-			cat->exportFileLocal(file);
-		}
-	}
-
-	count = items.size();
-	for(i = 0; i < count; ++i)
-	{
-		items[i]->exportFile(file);
-	}
-
-	fclose(file);
-	return true;
-}
-
 // message handling functionality
 // static
 void LLInventoryModel::registerCallbacks(LLMessageSystem* msg)
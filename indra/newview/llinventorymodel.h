@@ -51,6 +51,7 @@ class LLInventoryItem;
 class LLInventoryCategory;
 class LLMessageSystem;
 class LLInventoryCollectFunctor;
+class LLInventoryCacheLoader;
 
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 // LLInventoryModel
@@ -143,6 +144,11 @@ public:
 	// Methods to load up inventory skeleton & meat. These are used
 	// during authentication. Returns true if everything parsed.
 	bool loadSkeleton(const LLSD& options, const LLUUID& owner_id);
+	// Start reading the cache of owner_id in the background, ahead of
+	// loadSkeleton(). Loads loadSkeleton() did not pick up are cancelled
+	// by cancelCacheLoads().
+	void startCacheLoad(const LLUUID& owner_id);
+	void cancelCacheLoads();
 	void buildParentChildMap(); // brute force method to rebuild the entire parent-child relations
 	void createCommonSystemCategories();
 	
@@ -180,7 +186,6 @@ public:
 	static BOOL getIsFirstTimeInViewer2();
 private:
 	static BOOL sFirstTimeInViewer2;
-	const static S32 sCurrentInvCacheVersion; // expected inventory cache version
 
 /**                    Initialization/Setup
  **                                                                            **
@@ -562,13 +567,12 @@ public:
 	// File I/O
 	//--------------------------------------------------------------------
 protected:
-	static bool loadFromFile(const std::string& filename,
-							 cat_array_t& categories,
-							 item_array_t& items,
-							 bool& is_cache_obsolete); 
-	static bool saveToFile(const std::string& filename,
-						   const cat_array_t& categories,
-						   const item_array_t& items); 
+	static std::string getCacheFilename(const LLUUID& owner_id);
+private:
+	typedef std::map<LLUUID, LLInventoryCacheLoader*> cache_loader_map_t;
+	cache_loader_map_t mCacheLoaders;
+	// Categories changed since login, their cache blocks are rewritten
+	std::set<LLUUID> mCacheDirtyCategoryIDs;
 
 	//--------------------------------------------------------------------
 	// Message handling functionality
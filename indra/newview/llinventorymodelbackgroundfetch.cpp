@@ -32,6 +32,7 @@
 #include "llcallbacklist.h"
 #include "llinventorypanel.h"
 #include "llinventorymodel.h"
+#include "llsdserialize.h"
 #include "llviewercontrol.h"
 #include "llviewerinventory.h"
 #include "llviewermessage.h"
@@ -96,9 +97,10 @@ protected:
 // Http request handler class for folders.
 //
 // Handler for FetchInventoryDescendents2 and FetchLibDescendents2
-// caps requests for folders.
+// caps requests for folders. Every folder of the reply is processed as
+// soon as it is parsed, so the whole reply is never held as LLSD.
 //
-class BGFolderHttpHandler : public LLHTTPClient::ResponderWithResult
+class BGFolderHttpHandler : public LLHTTPClient::ResponderWithResult, public LLSDStreamVisitor
 {
 	LOG_CLASS(BGFolderHttpHandler);
 	
@@ -124,9 +126,13 @@ protected:
 	BGFolderHttpHandler(const BGFolderHttpHandler &);			// Not defined
 	void operator=(const BGFolderHttpHandler &);				// Not defined
 	BOOL getIsRecursive(const LLUUID& cat_id) const;
+	void processFolder(const LLSD& folder_sd);
 private:
 	/*virtual*/ void httpSuccess(void);
 	/*virtual*/ void httpFailure(void);
+	/*virtual*/ LLSDStreamVisitor* getContentVisitor(void) { return this; }
+	/*virtual*/ bool shouldSplit(const path_t& path) { return path.size() == 2 && path[0].asStringRef() == "folders"; }
+	/*virtual*/ void visit(const path_t& path, const LLSD& value) { processFolder(value); }
 	LLSD mRequestSD;
 	uuid_vec_t mRecursiveCatUUIDs; // hack for storing away which cat fetches are recursive
 };
@@ -730,6 +736,103 @@ bool LLInventoryModelBackgroundFetch::fetchQueueContainsNoDescendentsOf(const LL
 	}
 	return true;
 }
+// Handles one folder of the reply.
+void BGFolderHttpHandler::processFolder(const LLSD& folder_sd)
+{
+	LLInventoryModelBackgroundFetch *fetcher = LLInventoryModelBackgroundFetch::getInstance();
+
+	//LLUUID agent_id = folder_sd["agent_id"];
+
+	//if(agent_id != gAgent.getID())	//This should never happen.
+	//{
+	//	LL_WARNS(LOG_INV) << "Got a UpdateInventoryItem for the wrong agent."
+	//			<< LL_ENDL;
+	//	break;
+	//}
+
+	LLUUID parent_id(folder_sd["folder_id"].asUUID());
+	LLUUID owner_id(folder_sd["owner_id"].asUUID());
+	S32    version(folder_sd["version"].asInteger());
+	S32    descendents(folder_sd["descendents"].asInteger());
+	LLPointer<LLViewerInventoryCategory> tcategory = new LLViewerInventoryCategory(owner_id);
+
+	if (parent_id.isNull())
+	{
+		const LLSD& items(folder_sd["items"]);
+		LLPointer<LLViewerInventoryItem> titem = new LLViewerInventoryItem;
+
+		for (LLSD::array_const_iterator item_it = items.beginArray();
+			item_it != items.endArray();
+			++item_it)
+		{
+			const LLUUID lost_uuid(gInventory.findCategoryUUIDForType(LLFolderType::FT_LOST_AND_FOUND));
+
+			if (lost_uuid.notNull())
+			{
+				LLSD item(*item_it);
+
+				titem->unpackMessage(item);
+
+				LLInventoryModel::update_list_t update;
+				LLInventoryModel::LLCategoryUpdate new_folder(lost_uuid, 1);
+				update.push_back(new_folder);
+				gInventory.accountForUpdate(update);
+
+				titem->setParent(lost_uuid);
+				titem->updateParentOnServer(FALSE);
+				gInventory.updateItem(titem);
+				gInventory.notifyObservers();
+			}
+		}
+	}
+
+	LLViewerInventoryCategory * pcat(gInventory.getCategory(parent_id));
+	if (! pcat)
+	{
+		return;
+	}
+
+	const LLSD& categories(folder_sd["categories"]);
+	for (LLSD::array_const_iterator category_it = categories.beginArray();
+		category_it != categories.endArray();
+		++category_it)
+	{	
+		LLSD category(*category_it);
+		tcategory->fromLLSD(category); 
+		
+		const bool recursive(getIsRecursive(tcategory->getUUID()));
+		if (recursive)
+		{
+			fetcher->addRequestAtBack(tcategory->getUUID(), recursive, true);
+		}
+		else if (! gInventory.isCategoryComplete(tcategory->getUUID()))
+		{
+			gInventory.updateCategory(tcategory);
+		}
+	}
+
+	const LLSD& items(folder_sd["items"]);
+	LLPointer<LLViewerInventoryItem> titem = new LLViewerInventoryItem;
+	for (LLSD::array_const_iterator item_it = items.beginArray();
+		 item_it != items.endArray();
+		 ++item_it)
+	{	
+		LLSD item(*item_it);
+		titem->unpackMessage(item);
+		
+		gInventory.updateItem(titem);
+	}
+
+	// Set version and descendentcount according to message.
+	LLViewerInventoryCategory * cat(gInventory.getCategory(parent_id));
+	if (cat)
+	{
+		cat->setVersion(version);
+		cat->setDescendentCount(descendents);
+		cat->determineFolderType();
+	}
+}
+
 // If we get back a normal response, handle it here.
 void BGFolderHttpHandler::httpSuccess(void)
 {
@@ -738,106 +841,17 @@ void BGFolderHttpHandler::httpSuccess(void)
 	// in response as an application-level error.
 
 	// Instead, we assume success and attempt to extract information.
+	// The folders were normally handled by processFolder() while the reply
+	// was parsed; this only sees those still in the content.
 	if (content.has("folders"))	
 	{
-		LLSD folders(content["folders"]);
+		const LLSD& folders(content["folders"]);
 		
 		for (LLSD::array_const_iterator folder_it = folders.beginArray();
 			folder_it != folders.endArray();
 			++folder_it)
 		{	
-			LLSD folder_sd(*folder_it);
-
-			//LLUUID agent_id = folder_sd["agent_id"];
-
-			//if(agent_id != gAgent.getID())	//This should never happen.
-			//{
-			//	LL_WARNS(LOG_INV) << "Got a UpdateInventoryItem for the wrong agent."
-			//			<< LL_ENDL;
-			//	break;
-			//}
-
-			LLUUID parent_id(folder_sd["folder_id"].asUUID());
-			LLUUID owner_id(folder_sd["owner_id"].asUUID());
-			S32    version(folder_sd["version"].asInteger());
-			S32    descendents(folder_sd["descendents"].asInteger());
-			LLPointer<LLViewerInventoryCategory> tcategory = new LLViewerInventoryCategory(owner_id);
-
-            if (parent_id.isNull())
-            {
-				LLSD items(folder_sd["items"]);
-			    LLPointer<LLViewerInventoryItem> titem = new LLViewerInventoryItem;
-				
-			    for (LLSD::array_const_iterator item_it = items.beginArray();
-				    item_it != items.endArray();
-				    ++item_it)
-			    {	
-                    const LLUUID lost_uuid(gInventory.findCategoryUUIDForType(LLFolderType::FT_LOST_AND_FOUND));
-
-                    if (lost_uuid.notNull())
-                    {
-				        LLSD item(*item_it);
-
-				        titem->unpackMessage(item);
-				
-                        LLInventoryModel::update_list_t update;
-                        LLInventoryModel::LLCategoryUpdate new_folder(lost_uuid, 1);
-                        update.push_back(new_folder);
-                        gInventory.accountForUpdate(update);
-
-                        titem->setParent(lost_uuid);
-                        titem->updateParentOnServer(FALSE);
-                        gInventory.updateItem(titem);
-                        gInventory.notifyObservers();
-                    }
-                }
-            }
-
-	        LLViewerInventoryCategory * pcat(gInventory.getCategory(parent_id));
-			if (! pcat)
-			{
-				continue;
-			}
-
-			LLSD categories(folder_sd["categories"]);
-			for (LLSD::array_const_iterator category_it = categories.beginArray();
-				category_it != categories.endArray();
-				++category_it)
-			{	
-				LLSD category(*category_it);
-				tcategory->fromLLSD(category); 
-				
-				const bool recursive(getIsRecursive(tcategory->getUUID()));
-				if (recursive)
-				{
-					fetcher->addRequestAtBack(tcategory->getUUID(), recursive, true);
-				}
-				else if (! gInventory.isCategoryComplete(tcategory->getUUID()))
-				{
-					gInventory.updateCategory(tcategory);
-				}
-			}
-
-			LLSD items(folder_sd["items"]);
-			LLPointer<LLViewerInventoryItem> titem = new LLViewerInventoryItem;
-			for (LLSD::array_const_iterator item_it = items.beginArray();
-				 item_it != items.endArray();
-				 ++item_it)
-			{	
-				LLSD item(*item_it);
-				titem->unpackMessage(item);
-				
-				gInventory.updateItem(titem);
-			}
-
-			// Set version and descendentcount according to message.
-			LLViewerInventoryCategory * cat(gInventory.getCategory(parent_id));
-			if (cat)
-			{
-				cat->setVersion(version);
-				cat->setDescendentCount(descendents);
-				cat->determineFolderType();
-			}
+			processFolder(*folder_it);
 		}
 	}
 		
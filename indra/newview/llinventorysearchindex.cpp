@@ -0,0 +1,246 @@
+/**
+ * @file llinventorysearchindex.cpp
+ * @brief Trigram index of inventory item names and descriptions.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+
+#include "llviewerprecompiledheaders.h"
+
+#include "llinventorysearchindex.h"
+
+#include "llinventorymodel.h"
+#include "llviewerinventory.h"
+
+#include <algorithm>
+
+// Dead entries are only dropped once there are at least this many.
+static const U32 MIN_COMPACT_ENTRIES = 1024;
+
+static U32 get_trigram(const std::string& text, std::string::size_type pos)
+{
+	return ((U32)(U8)text[pos] << 16) | ((U32)(U8)text[pos + 1] << 8) | (U32)(U8)text[pos + 2];
+}
+
+LLInventorySearchIndex* LLInventorySearchIndex::sInstance = NULL;
+
+//static
+LLInventorySearchIndex* LLInventorySearchIndex::getInstance()
+{
+	if (!sInstance)
+	{
+		sInstance = new LLInventorySearchIndex();
+
+		// Anything loaded later is added as the model reports it.
+		const LLUUID roots[] = { gInventory.getRootFolderID(), gInventory.getLibraryRootFolderID() };
+		for (U32 i = 0; i < LL_ARRAY_SIZE(roots); ++i)
+		{
+			if (roots[i].isNull())
+			{
+				continue;
+			}
+			LLInventoryModel::cat_array_t categories;
+			LLInventoryModel::item_array_t items;
+			gInventory.collectDescendents(roots[i], categories, items, LLInventoryModel::INCLUDE_TRASH);
+			for (LLInventoryModel::item_array_t::const_iterator iter = items.begin(); iter != items.end(); ++iter)
+			{
+				sInstance->addItem((*iter)->getUUID(), (*iter)->getName(), (*iter)->getDescription());
+			}
+		}
+		LL_INFOS("Inventory") << "Indexed " << sInstance->mEntryIndex.size() << " items for searching" << LL_ENDL;
+
+		gInventory.addObserver(sInstance);
+	}
+	return sInstance;
+}
+
+LLInventorySearchIndex::LLInventorySearchIndex()
+:	mDeadEntries(0),
+	mGeneration(0)
+{
+}
+
+//virtual
+LLInventorySearchIndex::~LLInventorySearchIndex()
+{
+	if (sInstance == this)
+	{
+		sInstance = NULL;
+	}
+}
+
+//virtual
+void LLInventorySearchIndex::changed(U32 mask)
+{
+	if (!(mask & (LABEL | DESCRIPTION | INTERNAL | ADD | REMOVE | REBUILD)))
+	{
+		return;
+	}
+
+	const LLInventoryModel::changed_items_t& changed_ids = gInventory.getChangedIDs();
+	for (LLInventoryModel::changed_items_t::const_iterator iter = changed_ids.begin(); iter != changed_ids.end(); ++iter)
+	{
+		const LLViewerInventoryItem* item = gInventory.getItem(*iter);
+		if (item)
+		{
+			addItem(*iter, item->getName(), item->getDescription());
+		}
+		else
+		{
+			removeItem(*iter);
+		}
+	}
+}
+
+bool LLInventorySearchIndex::find(const std::string& sub_string, uuid_set_t& matches) const
+{
+	if (sub_string.size() < MIN_SUB_STRING_SIZE)
+	{
+		return false;
+	}
+
+	// Every item containing sub_string is listed under each of its
+	// sequences, so the shortest list is the one to check.
+	const std::vector<U32>* rarest = NULL;
+	for (std::string::size_type pos = 0; pos + 2 < sub_string.size(); ++pos)
+	{
+		posting_map_t::const_iterator iter = mPostings.find(get_trigram(sub_string, pos));
+		if (iter == mPostings.end())
+		{
+			return true;
+		}
+		if (!rarest || iter->second.size() < rarest->size())
+		{
+			rarest = &iter->second;
+		}
+	}
+
+	for (std::vector<U32>::const_iterator iter = rarest->begin(); iter != rarest->end(); ++iter)
+	{
+		const Entry& entry = mEntries[*iter];
+		if (entry.mID.notNull() && entry.mText.find(sub_string) != std::string::npos)
+		{
+			matches.insert(entry.mID);
+		}
+	}
+	return true;
+}
+
+void LLInventorySearchIndex::addItem(const LLUUID& id, const std::string& name, const std::string& desc)
+{
+	// The same text as LLFolderViewItem::updateSearchLabelType() builds when
+	// searching both: the space is there even when the description is empty.
+	// Whatever is found in the name or the description alone is found in it too.
+	std::string text(name);
+	text += " ";
+	text += desc;
+	LLStringUtil::toUpper(text);
+
+	boost::unordered_map<LLUUID, U32>::iterator found = mEntryIndex.find(id);
+	if (found != mEntryIndex.end())
+	{
+		if (mEntries[found->second].mText == text)
+		{
+			return;
+		}
+		removeItem(id);
+	}
+
+	const U32 entry = mEntries.size();
+	mEntries.push_back(Entry());
+	mEntries.back().mID = id;
+	mEntries.back().mText.swap(text);
+	mEntryIndex[id] = entry;
+	indexEntry(entry);
+	++mGeneration;
+}
+
+void LLInventorySearchIndex::removeItem(const LLUUID& id)
+{
+	boost::unordered_map<LLUUID, U32>::iterator found = mEntryIndex.find(id);
+	if (found == mEntryIndex.end())
+	{
+		return;
+	}
+
+	Entry& entry = mEntries[found->second];
+	entry.mID.setNull();
+	std::string().swap(entry.mText);
+	mEntryIndex.erase(found);
+	++mDeadEntries;
+	++mGeneration;
+
+	if (mDeadEntries >= MIN_COMPACT_ENTRIES && mDeadEntries > mEntryIndex.size())
+	{
+		compact();
+	}
+}
+
+void LLInventorySearchIndex::indexEntry(U32 entry)
+{
+	const std::string& text = mEntries[entry].mText;
+	if (text.size() < MIN_SUB_STRING_SIZE)
+	{
+		return;
+	}
+
+	std::vector<U32> trigrams;
+	trigrams.reserve(text.size() - 2);
+	for (std::string::size_type pos = 0; pos + 2 < text.size(); ++pos)
+	{
+		trigrams.push_back(get_trigram(text, pos));
+	}
+	std::sort(trigrams.begin(), trigrams.end());
+	trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+	// Entries are appended, so every list stays sorted.
+	for (std::vector<U32>::const_iterator iter = trigrams.begin(); iter != trigrams.end(); ++iter)
+	{
+		mPostings[*iter].push_back(entry);
+	}
+}
+
+void LLInventorySearchIndex::compact()
+{
+	std::vector<Entry> entries;
+	entries.reserve(mEntryIndex.size());
+	for (std::vector<Entry>::iterator iter = mEntries.begin(); iter != mEntries.end(); ++iter)
+	{
+		if (iter->mID.notNull())
+		{
+			entries.push_back(Entry());
+			entries.back().mID = iter->mID;
+			entries.back().mText.swap(iter->mText);
+		}
+	}
+	mEntries.swap(entries);
+	mPostings.clear();
+	mEntryIndex.clear();
+	mDeadEntries = 0;
+
+	for (U32 entry = 0; entry < mEntries.size(); ++entry)
+	{
+		mEntryIndex[mEntries[entry].mID] = entry;
+		indexEntry(entry);
+	}
+}
@@ -0,0 +1,91 @@
+/**
+ * @file llinventorysearchindex.h
+ * @brief Trigram index of inventory item names and descriptions.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLINVENTORYSEARCHINDEX_H
+#define LL_LLINVENTORYSEARCHINDEX_H
+
+#include "llinventoryobserver.h"
+#include "lluuid.h"
+
+#include <boost/unordered_map.hpp>
+#include <string>
+#include <vector>
+
+// Maps every three character sequence of the upper case "NAME DESCRIPTION"
+// text of the items in gInventory, the text LLFolderViewItem searches, to
+// the items containing it. A filter string is looked up through its rarest
+// sequence, so only the items listed there are compared against it.
+//
+// Entries are only ever appended: a renamed item gets a new entry and its
+// old one is left dead in the lists until dead entries outnumber live ones
+// and the lists are rebuilt.
+class LLInventorySearchIndex : public LLInventoryObserver
+{
+public:
+	// Shorter filter strings can not be looked up.
+	static const std::string::size_type MIN_SUB_STRING_SIZE = 3;
+
+	// Returns the index of gInventory, building it on first use. It is one
+	// of the model's observers, so it goes away with them at logout.
+	static LLInventorySearchIndex* getInstance();
+
+	/*virtual*/ ~LLInventorySearchIndex();
+	/*virtual*/ void changed(U32 mask);
+
+	// True if the name and description of id are indexed.
+	bool isIndexed(const LLUUID& id) const { return mEntryIndex.count(id) > 0; }
+
+	// Collects the indexed items whose text contains the upper case
+	// sub_string. Returns false if sub_string is too short to be looked up.
+	bool find(const std::string& sub_string, uuid_set_t& matches) const;
+
+	// Changes whenever an item is indexed or dropped.
+	U32 getGeneration() const { return mGeneration; }
+
+private:
+	LLInventorySearchIndex();
+
+	void addItem(const LLUUID& id, const std::string& name, const std::string& desc);
+	void removeItem(const LLUUID& id);
+	void indexEntry(U32 entry);
+	void compact();
+
+	static LLInventorySearchIndex* sInstance;
+
+	struct Entry
+	{
+		LLUUID mID;			// Null once dead
+		std::string mText;
+	};
+	std::vector<Entry> mEntries;
+	boost::unordered_map<LLUUID, U32> mEntryIndex;
+	typedef boost::unordered_map<U32, std::vector<U32> > posting_map_t;
+	posting_map_t mPostings;
+	U32 mDeadEntries;
+	U32 mGeneration;
+};
+
+#endif // LL_LLINVENTORYSEARCHINDEX_H
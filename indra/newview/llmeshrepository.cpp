@@ -38,6 +38,7 @@
 #include "lldatapacker.h"
 #include "llfasttimer.h"
 #include "llfloaterperms.h"
+#include "lldiriterator.h"
 #include "lleconomy.h"
 #include "llimagej2c.h"
 #include "llhost.h"
@@ -72,6 +73,7 @@
 #include "netdb.h"
 #endif
 
+#include <algorithm>
 #include <queue>
 
 class AIHTTPTimeoutPolicy;
@@ -87,6 +89,11 @@ LLMeshRepository gMeshRepo;
 
 const U32 MAX_MESH_REQUESTS_PER_SECOND = 100;
 
+// Request scores (pixel area over distance of the objects waiting on them) at or
+// above which a request counts as high or normal priority in the queue statistics.
+const F32 MESH_PRIORITY_HIGH_SCORE = 100.f;
+const F32 MESH_PRIORITY_NORMAL_SCORE = 1.f;
+
 // Maximum mesh version to support.  Three least significant digits are reserved for the minor version, 
 // with major version changes indicating a format change that is not backwards compatible and should not
 // be parsed by viewers that don't specifically support that version. For example, if the integer "1" is 
@@ -104,6 +111,7 @@ U32 LLMeshRepository::sLODPending = 0;
 U32 LLMeshRepository::sCacheBytesRead = 0;
 U32 LLMeshRepository::sCacheBytesWritten = 0;
 U32 LLMeshRepository::sPeakKbps = 0;
+U32 LLMeshRepository::sCancelledRequests = 0;
 	
 
 const U32 MAX_TEXTURE_UPLOAD_RETRIES = 5;
@@ -126,6 +134,23 @@ std::string header_lod[] =
 };
 const char * const LOG_MESH = "Mesh";
 
+// Optimized volume faces of mesh LODs, see LLMeshRepoThread::saveFaceCache().
+// Bump the version whenever LLVolume::packOptimizedVolumeFaces() or the vertex
+// cache optimization changes.
+const U32 MESH_FACE_CACHE_MAGIC = 0x464d4c4c; // "LLMF"
+const U32 MESH_FACE_CACHE_VERSION = 1;
+const char* const MESH_FACE_CACHE_DIR = "meshfaces";
+
+struct MeshFaceCacheHeader
+{
+	U32 mMagic;
+	U32 mVersion;
+	// The asset block the faces were unpacked from
+	U32 mMeshVersion;
+	S32 mOffset;
+	S32 mSize;
+};
+
 
 //get the number of bytes resident in memory for given volume
 U32 get_volume_memory_size(const LLVolume* volume)
@@ -215,6 +240,8 @@ LLViewerFetchedTexture* LLMeshUploadThread::FindViewerTexture(const LLImportMate
 
 S32 LLMeshRepoThread::sActiveHeaderRequests = 0;
 S32 LLMeshRepoThread::sActiveLODRequests = 0;
+U32 LLMeshRepoThread::sQueueDepth[LLMeshRepoThread::PRIORITY_COUNT] = { 0, 0, 0 };
+F32 LLMeshRepoThread::sQueueLatency[LLMeshRepoThread::PRIORITY_COUNT] = { 0.f, 0.f, 0.f };
 U32	LLMeshRepoThread::sMaxConcurrentRequests = 1;
 
 class LLMeshHeaderResponder : public LLHTTPClient::ResponderWithCompleted
@@ -240,7 +267,7 @@ public:
 				LLMeshRepository::sHTTPRetryCount++;
 				LLMeshRepoThread::HeaderRequest req(mMeshParams);
 				LLMutexLock lock(gMeshRepo.mThread->mMutex);
-				gMeshRepo.mThread->mHeaderReqQ.push(req);
+				gMeshRepo.mThread->mHeaderReqQ.push_back(req);
 			}
 
 			LLMeshRepoThread::decActiveHeaderRequests();
@@ -560,7 +587,10 @@ public:
 };
 
 LLMeshRepoThread::LLMeshRepoThread()
-: LLThread("mesh repo") 
+: LLThread("mesh repo"),
+  mFaceCacheReadOnly(true),
+  mFaceCacheBytes(0),
+  mFaceCacheMaxBytes(0)
 { 
 	mMutex = new LLMutex();
 	mHeaderMutex = new LLMutex();
@@ -608,13 +638,15 @@ void LLMeshRepoThread::run()
 				{
 					mMutex->lock();
 					LODRequest req = mLODReqQ.front();
-					mLODReqQ.pop();
+					mLODReqQ.pop_front();
 					LLMeshRepository::sLODProcessing--;
+					recordQueueLatency(req.mPriority, req.mRequestTime);
 					mMutex->unlock();
 					if (!fetchMeshLOD(req.mMeshParams, req.mLOD, count))//failed, resubmit
 					{
 						mMutex->lock();
-						mLODReqQ.push(req);
+						mLODReqQ.push_back(req);
+						LLMeshRepository::sLODProcessing++;
 						mMutex->unlock();
 					}
 				}
@@ -626,12 +658,13 @@ void LLMeshRepoThread::run()
 				{
 					mMutex->lock();
 					HeaderRequest req = mHeaderReqQ.front();
-					mHeaderReqQ.pop();
+					mHeaderReqQ.pop_front();
+					recordQueueLatency(req.mPriority, req.mRequestTime);
 					mMutex->unlock();
 					if (!fetchMeshHeader(req.mMeshParams, count))//failed, resubmit
 					{
 						mMutex->lock();
-						mHeaderReqQ.push(req) ;
+						mHeaderReqQ.push_back(req);
 						mMutex->unlock();
 					}
 				}
@@ -719,21 +752,29 @@ void LLMeshRepoThread::lockAndLoadMeshLOD(const LLVolumeParams& mesh_params, S32
 
 
 
-void LLMeshRepoThread::loadMeshLOD(const LLVolumeParams& mesh_params, S32 lod)
+void LLMeshRepoThread::loadMeshLOD(const LLVolumeParams& mesh_params, S32 lod, F32 score, F64 request_time)
 { //could be called from any thread
 	LLMutexLock lock(mMutex);
 	mesh_header_map::iterator iter = mMeshHeader.find(mesh_params.getSculptID());
 	if (iter != mMeshHeader.end())
 	{ //if we have the header, request LOD byte range
-		LODRequest req(mesh_params, lod);
+		LODRequest req(mesh_params, lod, score);
+		if (request_time > 0.0)
 		{
-			mLODReqQ.push(req);
+			req.mRequestTime = request_time;
+		}
+		{
+			mLODReqQ.push_back(req);
 			LLMeshRepository::sLODProcessing++;
 		}
 	}
 	else
 	{ 
-		HeaderRequest req(mesh_params);
+		HeaderRequest req(mesh_params, score);
+		if (request_time > 0.0)
+		{
+			req.mRequestTime = request_time;
+		}
 		
 		pending_lod_map::iterator pending = mPendingLOD.find(mesh_params);
 
@@ -744,7 +785,7 @@ void LLMeshRepoThread::loadMeshLOD(const LLVolumeParams& mesh_params, S32 lod)
 		}
 		else
 		{	//if no header request is pending, fetch header
-			mHeaderReqQ.push(req);
+			mHeaderReqQ.push_back(req);
 			mPendingLOD[mesh_params].push_back(lod);
 		}
 	}
@@ -830,6 +871,125 @@ bool LLMeshRepoThread::loadInfoFromVFS(const LLUUID& mesh_id, MeshHeaderInfo& in
 	return false;
 }
 
+std::string LLMeshRepoThread::getFaceCacheFilename(const std::string& dir, const LLVolumeParams& mesh_params, S32 lod) const
+{
+	// Mirror and invert flags change the unpacked faces.
+	return dir + gDirUtilp->getDirDelimiter() +
+		llformat("%s_%d_%d.faces", mesh_params.getSculptID().asString().c_str(), (S32)mesh_params.getSculptType(), lod);
+}
+
+bool LLMeshRepoThread::loadFaceCache(const LLVolumeParams& mesh_params, S32 lod, const MeshHeaderInfo& info)
+{
+	std::string dir;
+	bool read_only;
+	{
+		LLMutexLock lock(mMutex);
+		dir = mFaceCacheDir;
+		read_only = mFaceCacheReadOnly;
+	}
+	if (dir.empty())
+	{
+		return false;
+	}
+
+	std::string filename = getFaceCacheFilename(dir, mesh_params, lod);
+	llifstream file(filename, std::ios::in | std::ios::binary);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	MeshFaceCacheHeader header;
+	if (!file.read((char*)&header, sizeof(header)) ||
+		header.mMagic != MESH_FACE_CACHE_MAGIC || header.mVersion != MESH_FACE_CACHE_VERSION ||
+		header.mMeshVersion != info.mVersion || header.mOffset != info.mOffset || header.mSize != info.mSize)
+	{
+		return false;
+	}
+
+	LLPointer<LLVolume> volume = new LLVolume(mesh_params, LLVolumeLODGroup::getVolumeScaleFromDetail(lod));
+	if (!volume->unpackOptimizedVolumeFaces(file) || volume->getNumFaces() <= 0)
+	{
+		LL_WARNS(LOG_MESH) << "Discarding corrupt mesh face cache entry " << filename << LL_ENDL;
+		file.close();
+		if (!read_only)
+		{
+			LLFile::remove(filename);
+		}
+		return false;
+	}
+	LLMeshRepository::sCacheBytesRead += (U32)file.tellg();
+
+	LoadedMesh mesh(volume, mesh_params, lod);
+	{
+		LLMutexLock lock(mMutex);
+		mLoadedQ.push(mesh);
+	}
+	return true;
+}
+
+void LLMeshRepoThread::saveFaceCache(const LLVolume* volume, const LLVolumeParams& mesh_params, S32 lod)
+{
+	std::string dir;
+	{
+		LLMutexLock lock(mMutex);
+		if (mFaceCacheReadOnly || mFaceCacheBytes >= mFaceCacheMaxBytes)
+		{
+			return;
+		}
+		dir = mFaceCacheDir;
+	}
+	if (dir.empty())
+	{
+		return;
+	}
+
+	MeshHeaderInfo info;
+	if (!getMeshHeaderInfo(mesh_params.getSculptID(), header_lod[lod].c_str(), info) || info.mHeaderSize == 0)
+	{
+		return;
+	}
+
+	MeshFaceCacheHeader header;
+	header.mMagic = MESH_FACE_CACHE_MAGIC;
+	header.mVersion = MESH_FACE_CACHE_VERSION;
+	header.mMeshVersion = info.mVersion;
+	header.mOffset = info.mOffset;
+	header.mSize = info.mSize;
+
+	// Written aside and renamed, a reader never sees a partial entry.
+	std::string filename = getFaceCacheFilename(dir, mesh_params, lod);
+	std::string tmp_filename = filename + ".tmp";
+	bool written;
+	S64 size = 0;
+	{
+		llofstream file(tmp_filename, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			return;
+		}
+		file.write((const char*)&header, sizeof(header));
+		written = volume->packOptimizedVolumeFaces(file);
+		if (written)
+		{
+			size = file.tellp();
+			LLMeshRepository::sCacheBytesWritten += (U32)size;
+		}
+	}
+
+	LLFile::remove_nowarn(filename);
+	if (!written || LLFile::rename_nowarn(tmp_filename, filename) != 0)
+	{
+		LLFile::remove_nowarn(tmp_filename);
+		return;
+	}
+
+	// A replaced entry is counted twice, the next session starts from the
+	// actual size.
+	LLMutexLock lock(mMutex);
+	mFaceCacheBytes += size;
+}
+
 bool LLMeshRepoThread::fetchMeshSkinInfo(const LLUUID& mesh_id)
 {
 	MeshHeaderInfo info;
@@ -956,6 +1116,23 @@ void LLMeshRepoThread::decActiveHeaderRequests()
 	--LLMeshRepoThread::sActiveHeaderRequests;
 }
 
+//static
+S32 LLMeshRepoThread::getRequestPriority(F32 score)
+{
+	if (score >= MESH_PRIORITY_HIGH_SCORE)
+	{
+		return PRIORITY_HIGH;
+	}
+	return score >= MESH_PRIORITY_NORMAL_SCORE ? PRIORITY_NORMAL : PRIORITY_LOW;
+}
+
+//static
+void LLMeshRepoThread::recordQueueLatency(S32 priority, F64 request_time)
+{ //called with mMutex held
+	F32 latency = (F32)(LLFrameTimer::getElapsedSeconds() - request_time);
+	sQueueLatency[priority] = lerp(sQueueLatency[priority], llmax(latency, 0.f), 0.1f);
+}
+
 //return false if failed to get header
 bool LLMeshRepoThread::fetchMeshHeader(const LLVolumeParams& mesh_params, U32& count)
 {
@@ -1014,6 +1191,9 @@ bool LLMeshRepoThread::fetchMeshLOD(const LLVolumeParams& mesh_params, S32 lod,
 	{
 		if(info.mVersion <= MAX_MESH_VERSION && info.mOffset >= 0 && info.mSize > 0)
 		{
+			if (loadFaceCache(mesh_params, lod, info))
+				return true;
+
 			if (loadInfoFromVFS(mesh_id, info, boost::bind(&LLMeshRepoThread::lodReceived, this, mesh_params, lod, _2, _3 )))
 				return true;
 
@@ -1097,7 +1277,7 @@ bool LLMeshRepoThread::headerReceived(const LLVolumeParams& mesh_params, U8* dat
 			for (U32 i = 0; i < iter->second.size(); ++i)
 			{
 				LODRequest req(mesh_params, iter->second[i]);
-				mLODReqQ.push(req);
+				mLODReqQ.push_back(req);
 				LLMeshRepository::sLODProcessing++;
 			}
 			mPendingLOD.erase(iter);
@@ -1120,6 +1300,8 @@ bool LLMeshRepoThread::lodReceived(const LLVolumeParams& mesh_params, S32 lod, U
 		AIStateMachine::StateTimer timer("getNumFaces");
 		if (volume->getNumFaces() > 0)
 		{
+			saveFaceCache(volume, mesh_params, lod);
+
 			AIStateMachine::StateTimer timer("LoadedMesh");
 			LoadedMesh mesh(volume, mesh_params, lod);
 			{
@@ -2225,7 +2407,7 @@ void LLMeshHeaderResponder::completedRaw(LLChannelDescriptors const& channels,
 			LLMeshRepository::sHTTPRetryCount++;
 			LLMeshRepoThread::HeaderRequest req(mMeshParams);
 			LLMutexLock lock(gMeshRepo.mThread->mMutex);
-			gMeshRepo.mThread->mHeaderReqQ.push(req);
+			gMeshRepo.mThread->mHeaderReqQ.push_back(req);
 
 			return;
 		}
@@ -2351,6 +2533,85 @@ void LLMeshRepository::init()
 	mThread->start();
 }
 
+void LLMeshRepository::initFaceCache(bool read_only)
+{
+	if (!gSavedSettings.getBOOL("MeshFaceCache"))
+	{
+		return;
+	}
+
+	std::string dir = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, MESH_FACE_CACHE_DIR);
+	if (!LLFile::isdir(dir) && LLFile::mkdir(dir) != 0)
+	{
+		LL_WARNS(LOG_MESH) << "Unable to create mesh face cache " << dir << LL_ENDL;
+		return;
+	}
+
+	const S64 max_bytes = (S64)gSavedSettings.getU32("MeshFaceCacheMaxMB") * 1024 * 1024;
+	S64 bytes = pruneFaceCache(dir, read_only ? max_bytes : max_bytes * 3 / 4, read_only);
+
+	LLMutexLock lock(mThread->mMutex);
+	mThread->mFaceCacheDir = dir;
+	mThread->mFaceCacheReadOnly = read_only;
+	mThread->mFaceCacheBytes = bytes;
+	mThread->mFaceCacheMaxBytes = max_bytes;
+	LL_INFOS(LOG_MESH) << "Mesh face cache: " << dir << ", " << (bytes >> 20) << " of " << (max_bytes >> 20) << " MB"
+					   << (read_only ? " (read only)" : "") << LL_ENDL;
+}
+
+// Removes the oldest entries until the cache fits in max_bytes, and leftovers
+// of interrupted writes. Returns the size of the cache. Nothing is removed
+// when read_only, another viewer owns the cache then.
+//static
+S64 LLMeshRepository::pruneFaceCache(const std::string& dir, S64 max_bytes, bool read_only)
+{
+	typedef std::pair<time_t, std::pair<S64, std::string> > entry_t;
+	std::vector<entry_t> entries;
+	S64 total = 0;
+	std::string name;
+	LLDirIterator iter(dir, "*");
+	while (iter.next(name))
+	{
+		std::string filename = dir + gDirUtilp->getDirDelimiter() + name;
+		llstat st;
+		if (LLFile::stat(filename, &st) != 0)
+		{
+			continue;
+		}
+		if (!read_only && name.size() > 4 && name.compare(name.size() - 4, 4, ".tmp") == 0)
+		{
+			LLFile::remove_nowarn(filename);
+			continue;
+		}
+		entries.push_back(entry_t(st.st_mtime, std::make_pair((S64)st.st_size, filename)));
+		total += st.st_size;
+	}
+	if (read_only || total <= max_bytes)
+	{
+		return total;
+	}
+
+	// Oldest written first.
+	std::sort(entries.begin(), entries.end());
+	U32 removed = 0;
+	for (std::vector<entry_t>::iterator it = entries.begin(); it != entries.end() && total > max_bytes; ++it)
+	{
+		if (LLFile::remove_nowarn(it->second.second) == 0)
+		{
+			total -= it->second.first;
+			++removed;
+		}
+	}
+	LL_INFOS(LOG_MESH) << "Pruned " << removed << " mesh face cache entries" << LL_ENDL;
+	return total;
+}
+
+//static
+void LLMeshRepository::purgeFaceCache()
+{
+	gDirUtilp->deleteFilesInDir(gDirUtilp->getExpandedFilename(LL_PATH_CACHE, MESH_FACE_CACHE_DIR), "*.*");
+}
+
 void LLMeshRepository::shutdown()
 {
 	LL_INFOS(LOG_MESH) << "Shutting down mesh repository." << LL_ENDL;
@@ -2457,6 +2718,109 @@ S32 LLMeshRepository::loadMesh(LLVOVolume* vobj, const LLVolumeParams& mesh_para
 	return detail;
 }
 
+// Pixel area over distance of the best placed object waiting on a request, its radius
+// standing in for the area until the object has been on screen. Negative when none of
+// the objects exists anymore.
+static F32 get_request_score(const std::set<LLUUID>& object_ids)
+{
+	F32 score = -1.f;
+	for (std::set<LLUUID>::const_iterator iter = object_ids.begin(); iter != object_ids.end(); ++iter)
+	{
+		LLViewerObject* object = gObjectList.findObject(*iter);
+		if (!object || object->isDead())
+		{
+			continue;
+		}
+
+		F32 cur_score = 0.f;
+		LLDrawable* drawable = object->mDrawable;
+		if (drawable)
+		{
+			cur_score = (object->getPixelArea() + drawable->getRadius()) / llmax(drawable->mDistanceWRTCamera, 1.f);
+		}
+		score = llmax(score, cur_score);
+	}
+	return score;
+}
+
+void LLMeshRepository::updateRequestPriorities()
+{
+	//cancel LOD loads nothing waits on anymore and score the others
+	std::map<LLUUID, F32> score_map;
+	for (U32 i = 0; i < 4; ++i)
+	{
+		for (mesh_load_map::iterator iter = mLoadingMeshes[i].begin(); iter != mLoadingMeshes[i].end(); )
+		{
+			F32 score = get_request_score(iter->second);
+			if (score < 0.f)
+			{
+				mLoadingMeshes[i].erase(iter++);
+				continue;
+			}
+			F32& max_score = score_map[iter->first.getSculptID()];
+			max_score = llmax(max_score, score);
+			++iter;
+		}
+	}
+
+	U32* depth = LLMeshRepoThread::sQueueDepth;
+	std::fill(depth, depth + LLMeshRepoThread::PRIORITY_COUNT, 0);
+
+	//requests not handed to the repo thread yet
+	for (std::vector<LLMeshRepoThread::LODRequest>::iterator iter = mPendingRequests.begin(); iter != mPendingRequests.end(); )
+	{
+		if (!mLoadingMeshes[iter->mLOD].count(iter->mMeshParams))
+		{
+			iter = mPendingRequests.erase(iter);
+			sLODPending--;
+			sCancelledRequests++;
+			continue;
+		}
+		iter->mScore = score_map[iter->mMeshParams.getSculptID()];
+		iter->mPriority = LLMeshRepoThread::getRequestPriority(iter->mScore);
+		depth[iter->mPriority]++;
+		++iter;
+	}
+	std::stable_sort(mPendingRequests.begin(), mPendingRequests.end(), LLMeshRepoThread::CompareScoreGreater());
+
+	//LOD requests waiting for a free slot in the repo thread
+	std::deque<LLMeshRepoThread::LODRequest>& lod_queue = mThread->mLODReqQ;
+	for (std::deque<LLMeshRepoThread::LODRequest>::iterator iter = lod_queue.begin(); iter != lod_queue.end(); )
+	{
+		if (!mLoadingMeshes[iter->mLOD].count(iter->mMeshParams))
+		{
+			iter = lod_queue.erase(iter);
+			sLODProcessing--;
+			sCancelledRequests++;
+			continue;
+		}
+		iter->mScore = score_map[iter->mMeshParams.getSculptID()];
+		iter->mPriority = LLMeshRepoThread::getRequestPriority(iter->mScore);
+		depth[iter->mPriority]++;
+		++iter;
+	}
+	std::stable_sort(lod_queue.begin(), lod_queue.end(), LLMeshRepoThread::CompareScoreGreater());
+
+	//header requests, along with the LODs that wait on them
+	std::deque<LLMeshRepoThread::HeaderRequest>& header_queue = mThread->mHeaderReqQ;
+	for (std::deque<LLMeshRepoThread::HeaderRequest>::iterator iter = header_queue.begin(); iter != header_queue.end(); )
+	{
+		std::map<LLUUID, F32>::iterator score = score_map.find(iter->mMeshParams.getSculptID());
+		if (score == score_map.end())
+		{
+			mThread->mPendingLOD.erase(iter->mMeshParams);
+			iter = header_queue.erase(iter);
+			sCancelledRequests++;
+			continue;
+		}
+		iter->mScore = score->second;
+		iter->mPriority = LLMeshRepoThread::getRequestPriority(iter->mScore);
+		depth[iter->mPriority]++;
+		++iter;
+	}
+	std::stable_sort(header_queue.begin(), header_queue.end(), LLMeshRepoThread::CompareScoreGreater());
+}
+
 void LLMeshRepository::notifyLoadedMeshes()
 { //called from main thread
 	static const LLCachedControl<U32> max_concurrent_requests("MeshMaxConcurrentRequests");
@@ -2555,65 +2919,38 @@ void LLMeshRepository::notifyLoadedMeshes()
 			mUploadErrorQ.pop();
 		}
 
+		updateRequestPriorities();
+
 		S32 push_count = LLMeshRepoThread::sMaxConcurrentRequests-(LLMeshRepoThread::sActiveHeaderRequests+LLMeshRepoThread::sActiveLODRequests);
 
 		push_count = llmin(push_count, (S32)mPendingRequests.size());
 
 		if (push_count > 0)
 		{
-			//calculate "score" for pending requests
-
-			//create score map
-			std::map<LLUUID, F32> score_map;
-
-			for (U32 i = 0; i < 4; ++i)
+			//mPendingRequests is sorted by score, send the best ones
+			for (S32 i = 0; i < push_count; ++i)
 			{
-				for (mesh_load_map::iterator iter = mLoadingMeshes[i].begin();  iter != mLoadingMeshes[i].end(); ++iter)
-				{
-					F32 max_score = 0.f;
-					for (std::set<LLUUID>::iterator obj_iter = iter->second.begin(); obj_iter != iter->second.end(); ++obj_iter)
-					{
-						LLViewerObject* object = gObjectList.findObject(*obj_iter);
-
-						if (object)
-						{
-							LLDrawable* drawable = object->mDrawable;
-							if (drawable)
-							{
-								F32 cur_score = drawable->getRadius()/llmax(drawable->mDistanceWRTCamera, 1.f);
-								max_score = llmax(max_score, cur_score);
-							}
-						}
-					}
-				
-					score_map[iter->first.getSculptID()] = max_score;
-				}
+				LLMeshRepoThread::LODRequest& request = mPendingRequests[i];
+				mThread->loadMeshLOD(request.mMeshParams, request.mLOD, request.mScore, request.mRequestTime);
 			}
+			mPendingRequests.erase(mPendingRequests.begin(), mPendingRequests.begin() + push_count);
+			LLMeshRepository::sLODPending -= push_count;
+		}
 
-			//set "score" for pending requests
-			for (std::vector<LLMeshRepoThread::LODRequest>::iterator iter = mPendingRequests.begin(); iter != mPendingRequests.end(); ++iter)
+		//send skin info requests, unless every object that wanted them is gone
+		while (!mPendingSkinRequests.empty())
+		{
+			const LLUUID& mesh_id = mPendingSkinRequests.front();
+			skin_load_map::iterator iter = mLoadingSkins.find(mesh_id);
+			if (iter != mLoadingSkins.end() && get_request_score(iter->second) < 0.f)
 			{
-				iter->mScore = score_map[iter->mMeshParams.getSculptID()];
+				mLoadingSkins.erase(iter);
+				sCancelledRequests++;
 			}
-
-			//sort by "score"
-			std::partial_sort(mPendingRequests.begin(), mPendingRequests.begin() + push_count,
-							  mPendingRequests.end(), LLMeshRepoThread::CompareScoreGreater());
-
-			while (!mPendingRequests.empty() && push_count > 0)
+			else
 			{
-				LLMeshRepoThread::LODRequest& request = mPendingRequests.front();
-				mThread->loadMeshLOD(request.mMeshParams, request.mLOD);
-				mPendingRequests.erase(mPendingRequests.begin());
-				LLMeshRepository::sLODPending--;
-				push_count--;
+				mThread->loadMeshSkinInfo(mesh_id);
 			}
-		}
-
-		//send skin info requests
-		while (!mPendingSkinRequests.empty())
-		{
-			mThread->loadMeshSkinInfo(mPendingSkinRequests.front());
 			mPendingSkinRequests.pop();
 		}
 	
@@ -28,6 +28,7 @@
 #define LL_MESH_REPOSITORY_H
 
 #include "llassettype.h"
+#include "llframetimer.h"
 #include "llmodel.h"
 #include "lluuid.h"
 #include "llviewertexture.h"
@@ -190,10 +191,13 @@ public:
 	class HeaderRequest
 	{ 
 	public:
-		const LLVolumeParams mMeshParams;
+		LLVolumeParams mMeshParams;
+		F32 mScore;
+		S32 mPriority;
+		F64 mRequestTime;
 
-		HeaderRequest(const LLVolumeParams&  mesh_params)
-			: mMeshParams(mesh_params)
+		HeaderRequest(const LLVolumeParams&  mesh_params, F32 score = 0.f)
+			: mMeshParams(mesh_params), mScore(score), mPriority(getRequestPriority(score)), mRequestTime(LLFrameTimer::getElapsedSeconds())
 		{
 		}
 
@@ -209,22 +213,40 @@ public:
 		LLVolumeParams  mMeshParams;
 		S32 mLOD;
 		F32 mScore;
+		S32 mPriority;
+		F64 mRequestTime;
 
-		LODRequest(const LLVolumeParams&  mesh_params, S32 lod)
-			: mMeshParams(mesh_params), mLOD(lod), mScore(0.f)
+		LODRequest(const LLVolumeParams&  mesh_params, S32 lod, F32 score = 0.f)
+			: mMeshParams(mesh_params), mLOD(lod), mScore(score), mPriority(getRequestPriority(score)), mRequestTime(LLFrameTimer::getElapsedSeconds())
 		{
 		}
 	};
 
 	struct CompareScoreGreater
 	{
-		bool operator()(const LODRequest& lhs, const LODRequest& rhs)
+		template<class T>
+		bool operator()(const T& lhs, const T& rhs) const
 		{
 			return lhs.mScore > rhs.mScore; // greatest = first
 		}
 	};
-	
 
+	//priority bands of requests, for the queue statistics
+	enum e_request_priority
+	{
+		PRIORITY_HIGH,
+		PRIORITY_NORMAL,
+		PRIORITY_LOW,
+		PRIORITY_COUNT
+	};
+
+	static S32 getRequestPriority(F32 score);
+
+	//number of queued requests and average seconds until they were fetched, per priority
+	static U32 sQueueDepth[PRIORITY_COUNT];
+	static F32 sQueueLatency[PRIORITY_COUNT];
+	static void recordQueueLatency(S32 priority, F64 request_time);
+	
 	class LoadedMesh
 	{
 	public:
@@ -264,11 +286,11 @@ public:
 	//queue of completed Decomposition info requests
 	std::queue<LLModel::Decomposition*> mDecompositionQ;
 
-	//queue of requested headers
-	std::queue<HeaderRequest> mHeaderReqQ;
+	//queue of requested headers, highest score first
+	std::deque<HeaderRequest> mHeaderReqQ;
 
-	//queue of requested LODs
-	std::queue<LODRequest> mLODReqQ;
+	//queue of requested LODs, highest score first
+	std::deque<LODRequest> mLODReqQ;
 
 	//queue of unavailable LODs (either asset doesn't exist or asset doesn't have desired LOD)
 	std::queue<LODRequest> mUnavailableQ;
@@ -288,7 +310,7 @@ public:
 	virtual void run();
 
 	void lockAndLoadMeshLOD(const LLVolumeParams& mesh_params, S32 lod);
-	void loadMeshLOD(const LLVolumeParams& mesh_params, S32 lod);
+	void loadMeshLOD(const LLVolumeParams& mesh_params, S32 lod, F32 score = 0.f, F64 request_time = 0.0);
 	bool fetchMeshHeader(const LLVolumeParams& mesh_params, U32& count);
 	bool fetchMeshLOD(const LLVolumeParams& mesh_params, S32 lod, U32& count);
 	bool headerReceived(const LLVolumeParams& mesh_params, U8* data, S32 data_size);
@@ -301,6 +323,17 @@ public:
 	bool getMeshHeaderInfo(const LLUUID& mesh_id, const char* block_name, MeshHeaderInfo& info);
 	bool loadInfoFromVFS(const LLUUID& mesh_id, MeshHeaderInfo& info, boost::function<bool(const LLUUID&, U8*, S32)> fn);
 
+	//optimized LOD faces on disk, empty mFaceCacheDir when MeshFaceCache is off.
+	//Set by LLMeshRepository::initFaceCache() after the thread started, only
+	//touch these with mMutex locked.
+	std::string mFaceCacheDir;
+	bool mFaceCacheReadOnly;
+	S64 mFaceCacheBytes;		//size of the cache, no more entries are saved once
+	S64 mFaceCacheMaxBytes;		//it reaches mFaceCacheMaxBytes
+	std::string getFaceCacheFilename(const std::string& dir, const LLVolumeParams& mesh_params, S32 lod) const;
+	bool loadFaceCache(const LLVolumeParams& mesh_params, S32 lod, const MeshHeaderInfo& info);
+	void saveFaceCache(const LLVolume* volume, const LLVolumeParams& mesh_params, S32 lod);
+
 	void notifyLoadedMeshes();
 	S32 getActualMeshLOD(const LLVolumeParams& mesh_params, S32 lod);
 	
@@ -442,6 +475,7 @@ public:
 	static U32 sCacheBytesRead;
 	static U32 sCacheBytesWritten;
 	static U32 sPeakKbps;
+	static U32 sCancelledRequests;
 	
 	static F32 getStreamingCost(LLSD& header, F32 radius, S32* bytes = NULL, S32* visible_bytes = NULL, S32 detail = -1, F32 *unscaled_value = NULL);
 
@@ -449,11 +483,18 @@ public:
 
 	void init();
 	void shutdown();
+	//call once the cache directory is known
+	void initFaceCache(bool read_only);
+	static void purgeFaceCache();
+	static S64 pruneFaceCache(const std::string& dir, S64 max_bytes, bool read_only);
 
 	//mesh management functions
 	S32 loadMesh(LLVOVolume* volume, const LLVolumeParams& mesh_params, S32 detail = 0, S32 last_lod = -1);
 	
 	void notifyLoadedMeshes();
+	//rescore and reorder the queued requests from the objects waiting on them, dropping
+	//the ones no object waits on anymore (called with mMeshMutex and mThread->mMutex held)
+	void updateRequestPriorities();
 	void notifyMeshLoaded(const LLVolumeParams& mesh_params, LLVolume* volume);
 	void notifyMeshUnavailable(const LLVolumeParams& mesh_params, S32 lod);
 	void notifySkinInfoReceived(LLMeshSkinInfo& info);
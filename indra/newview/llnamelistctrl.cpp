@@ -228,11 +228,7 @@ LLScrollListItem* LLNameListCtrl::addNameItemRow(
 		fullname.append(suffix);
 	}
 
-	LLScrollListCell* cell = item->getColumn(mNameColumnIndex);
-	if (cell)
-	{
-		cell->setValue(fullname);
-	}
+	item->setColumnValue(mNameColumnIndex, fullname);
 
 	dirtyColumns();
 
@@ -298,10 +294,9 @@ void LLNameListCtrl::onAvatarNameCache(const LLUUID& agent_id,
 	LLNameListItem* list_item = item.get();
 	if (list_item && list_item->getUUID() == agent_id)
 	{
-		LLScrollListCell* cell = list_item->getColumn(mNameColumnIndex);
-		if (cell)
+		if (list_item->hasColumn(mNameColumnIndex))
 		{
-			cell->setValue(name);
+			list_item->setColumnValue(mNameColumnIndex, name);
 			setNeedsSort();
 		}
 	}
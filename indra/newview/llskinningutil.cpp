@@ -31,10 +31,62 @@
 #include "llvoavatar.h"
 #include "llviewercontrol.h"
 #include "llmeshrepository.h"
+#include "llskinningkernel.h"
+#include "lljobpool.h"
+
+static const U32 MAX_SKINNING_THREADS = 8;
+
+LLTrace::BlockTimerStatHandle FTM_AVATAR_SKINNING("Avatar Skinning");
+
+namespace
+{
+	// One face's worth of skinning, see LLSkinningUtil::queueSkinning().
+	struct SkinningJob
+	{
+		const LLMatrix4a* mPalette;
+		U32 mPaletteSize;
+		const LLVector4a* mWeights;
+		const LLVector4a* mSrc;
+		LLVector4a* mDst;
+		U32 mCount;
+		LLVector3 mOffset;		// Not an LLVector4a, std::vector does not align it.
+		LLVector4a* mExtents;
+	};
+
+	typedef std::vector<SkinningJob> skinning_job_list_t;
+
+	LLJobPool* sSkinningPool = NULL;
+	skinning_job_list_t sSkinningJobs;
+
+	void run_skinning_job(void* data, U32 index)
+	{
+		const SkinningJob& job = (*(skinning_job_list_t*)data)[index];
+		LLVector4a offset;
+		offset.load3(job.mOffset.mV);
+		LLSkinningKernel::skinPositions(job.mPalette, job.mPaletteSize, job.mWeights, job.mSrc, job.mDst,
+										job.mCount, offset, job.mExtents[0], job.mExtents[1]);
+	}
+}
 
 // static
 void LLSkinningUtil::initClass()
 {
+	U32 thread_count = gSavedSettings.getU32("RiggedSkinningThreads");
+	if (!thread_count)
+	{
+		thread_count = LLJobPool::getDefaultThreadCount(1, MAX_SKINNING_THREADS);
+	}
+	thread_count = llmin(thread_count, MAX_SKINNING_THREADS);
+	sSkinningPool = new LLJobPool("skinning", thread_count);
+	LL_INFOS() << "Skinning threads: " << thread_count << LL_ENDL;
+}
+
+// static
+void LLSkinningUtil::cleanupClass()
+{
+	delete sSkinningPool;
+	sSkinningPool = NULL;
+	sSkinningJobs.clear();
 }
 
 // static
@@ -231,3 +283,37 @@ void LLSkinningUtil::getPerVertexSkinMatrix(
 	llassert(valid_weights);
 }
 
+
+// static
+void LLSkinningUtil::queueSkinning(const LLMatrix4a* palette, U32 palette_size, const LLVector4a* weights,
+								   const LLVector4a* src, LLVector4a* dst, U32 count,
+								   const LLVector4a& offset, LLVector4a* extents)
+{
+	SkinningJob job;
+	job.mPalette = palette;
+	job.mPaletteSize = palette_size;
+	job.mWeights = weights;
+	job.mSrc = src;
+	job.mDst = dst;
+	job.mCount = count;
+	job.mOffset.set(offset.getF32ptr());
+	job.mExtents = extents;
+	sSkinningJobs.push_back(job);
+}
+
+// static
+void LLSkinningUtil::finishSkinning()
+{
+	if (sSkinningPool)
+	{
+		sSkinningPool->run(run_skinning_job, &sSkinningJobs, sSkinningJobs.size());
+	}
+	else
+	{
+		for (U32 i = 0; i < sSkinningJobs.size(); ++i)
+		{
+			run_skinning_job(&sSkinningJobs, i);
+		}
+	}
+	sSkinningJobs.clear();
+}
@@ -27,14 +27,21 @@
 #ifndef LLSKINNINGUTIL_H
 #define LLSKINNINGUTIL_H
 
+#include "llfasttimer.h"
+
 class LLVOAvatar;
 class LLMeshSkinInfo;
 class LLMatrix4a;
+class LLVector4a;
+
+// Time spent skinning rigged meshes, recorded for each avatar in turn.
+extern LLTrace::BlockTimerStatHandle FTM_AVATAR_SKINNING;
 
 class LLSkinningUtil
 {
 public:
     static void initClass();
+    static void cleanupClass();
     static U32 getMaxJointCount();
     static U32 getMeshJointCount(const LLMeshSkinInfo *skin);
     static void scrubInvalidJoints(LLVOAvatar *avatar, LLMeshSkinInfo* skin);
@@ -42,6 +49,16 @@ public:
     static void checkSkinWeights(const LLVector4a* weights, U32 num_vertices, const LLMeshSkinInfo* skin);
     static void scrubSkinWeights(LLVector4a* weights, U32 num_vertices, const LLMeshSkinInfo* skin);
     static void getPerVertexSkinMatrix(const F32* weights, LLMatrix4a* mat, bool handle_bad_scale, LLMatrix4a& final_mat, U32 max_joints);
+
+    // Skinning on the worker pool (see LLSkinningKernel::skinPositions()).
+    // Jobs are queued from the main thread and run at the next
+    // finishSkinning(), which returns when all of them are done. The
+    // palette and the vertex arrays must stay valid until then. extents
+    // receives the min and max of the skinned positions.
+    static void queueSkinning(const LLMatrix4a* palette, U32 palette_size, const LLVector4a* weights,
+                              const LLVector4a* src, LLVector4a* dst, U32 count,
+                              const LLVector4a& offset, LLVector4a* extents);
+    static void finishSkinning();
 };
 
 #endif
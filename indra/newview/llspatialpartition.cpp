@@ -73,6 +73,8 @@ U32 gOctreeReserveCapacity;
 
 BOOL LLSpatialGroup::sNoDelete = FALSE;
 
+U32 LLSpatialPartition::sCullPass = 1;
+
 static F32 sLastMaxTexPriority = 1.f;
 static F32 sCurMaxTexPriority = 1.f;
 
@@ -540,7 +542,11 @@ LLSpatialGroup::LLSpatialGroup(OctreeNode* node, LLSpatialPartition* part) : LLO
 	mDistance(0.f),
 	mDepth(0.f),
 	mLastUpdateDistance(-1.f), 
-	mLastUpdateTime(gFrameTimeSeconds)
+	mLastUpdateTime(gFrameTimeSeconds),
+	mPrecullPass(0),
+	mPrecullObjectPass(0),
+	mPrecullRes(0),
+	mPrecullObjectRes(0)
 {
 	ll_assert_aligned(this,16);
 	
@@ -1026,6 +1032,70 @@ public:
 	}
 };
 
+//Runs the frustum checks of culler T the way its traversal would and stores
+//the results in the groups, without touching occlusion or the pipeline.
+template <class T>
+class LLOctreePrecull : public T
+{
+public:
+	LLOctreePrecull(LLCamera* camera)
+		: T(camera) { }
+
+	virtual bool earlyFail(LLViewerOctreeGroup* base_group)
+	{
+		return false;
+	}
+
+	virtual S32 frustumCheck(const LLViewerOctreeGroup* base_group)
+	{
+		LLSpatialGroup* group = (LLSpatialGroup*)base_group;
+		group->mPrecullRes = T::frustumCheck(group);
+		group->mPrecullPass = LLSpatialPartition::sCullPass;
+		return group->mPrecullRes;
+	}
+
+	virtual S32 frustumCheckObjects(const LLViewerOctreeGroup* base_group)
+	{
+		LLSpatialGroup* group = (LLSpatialGroup*)base_group;
+		group->mPrecullObjectRes = T::frustumCheckObjects(group);
+		group->mPrecullObjectPass = LLSpatialPartition::sCullPass;
+		return group->mPrecullObjectRes;
+	}
+
+	virtual void processGroup(LLViewerOctreeGroup* base_group)
+	{
+	}
+};
+
+//Culler T using the results of LLOctreePrecull<T> where there are any.
+template <class T>
+class LLOctreeCullPreculled : public T
+{
+public:
+	LLOctreeCullPreculled(LLCamera* camera)
+		: T(camera) { }
+
+	virtual S32 frustumCheck(const LLViewerOctreeGroup* base_group)
+	{
+		const LLSpatialGroup* group = (const LLSpatialGroup*)base_group;
+		if (group->mPrecullPass == LLSpatialPartition::sCullPass)
+		{
+			return group->mPrecullRes;
+		}
+		return T::frustumCheck(group);
+	}
+
+	virtual S32 frustumCheckObjects(const LLViewerOctreeGroup* base_group)
+	{
+		const LLSpatialGroup* group = (const LLSpatialGroup*)base_group;
+		if (group->mPrecullObjectPass == LLSpatialPartition::sCullPass)
+		{
+			return group->mPrecullObjectRes;
+		}
+		return T::frustumCheckObjects(group);
+	}
+};
+
 class LLOctreeCullVisExtents: public LLOctreeCullShadow
 {
 public:
@@ -1364,6 +1434,32 @@ S32 LLSpatialPartition::cull(LLCamera &camera, std::vector<LLDrawable *>* result
 	return 0;
 }
 S32 LLSpatialPartition::cull(LLCamera &camera, bool do_occlusion)
+{
+	rebound();
+
+	if (LLPipeline::sShadowRender)
+	{
+		LL_RECORD_BLOCK_TIME(FTM_FRUSTUM_CULL);
+		LLOctreeCullPreculled<LLOctreeCullShadow> culler(&camera);
+		culler.traverse(mOctree);
+	}
+	else if (mInfiniteFarClip || !LLPipeline::sUseFarClip)
+	{
+		LL_RECORD_BLOCK_TIME(FTM_FRUSTUM_CULL);		
+		LLOctreeCullPreculled<LLOctreeCullNoFarClip> culler(&camera);
+		culler.traverse(mOctree);
+	}
+	else
+	{
+		LL_RECORD_BLOCK_TIME(FTM_FRUSTUM_CULL);		
+		LLOctreeCullPreculled<LLOctreeCull> culler(&camera);
+		culler.traverse(mOctree);
+	}
+	
+	return 0;
+}
+
+void LLSpatialPartition::rebound()
 {
 #if LL_OCTREE_PARANOIA_CHECK
 	((LLSpatialGroup*)mOctree->getListener(0))->checkStates();
@@ -1377,27 +1473,26 @@ S32 LLSpatialPartition::cull(LLCamera &camera, bool do_occlusion)
 #if LL_OCTREE_PARANOIA_CHECK
 	((LLSpatialGroup*)mOctree->getListener(0))->validate();
 #endif
+}
 
+void LLSpatialPartition::precull(LLCamera& camera)
+{
+	//no fast timers here, this runs on the cull pool threads
 	if (LLPipeline::sShadowRender)
 	{
-		LL_RECORD_BLOCK_TIME(FTM_FRUSTUM_CULL);
-		LLOctreeCullShadow culler(&camera);
+		LLOctreePrecull<LLOctreeCullShadow> culler(&camera);
 		culler.traverse(mOctree);
 	}
 	else if (mInfiniteFarClip || !LLPipeline::sUseFarClip)
 	{
-		LL_RECORD_BLOCK_TIME(FTM_FRUSTUM_CULL);		
-		LLOctreeCullNoFarClip culler(&camera);
+		LLOctreePrecull<LLOctreeCullNoFarClip> culler(&camera);
 		culler.traverse(mOctree);
 	}
 	else
 	{
-		LL_RECORD_BLOCK_TIME(FTM_FRUSTUM_CULL);		
-		LLOctreeCull culler(&camera);
+		LLOctreePrecull<LLOctreeCull> culler(&camera);
 		culler.traverse(mOctree);
 	}
-	
-	return 0;
 }
 
 void pushVerts(LLDrawInfo* params, U32 mask)
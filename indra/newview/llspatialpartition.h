@@ -356,6 +356,13 @@ public:
 	
 	F32 mPixelArea;
 	F32 mRadius;
+
+	//frustum check results of LLSpatialPartition::precull(), valid while the
+	//matching pass equals LLSpatialPartition::sCullPass
+	U32 mPrecullPass;
+	U32 mPrecullObjectPass;
+	S32 mPrecullRes;
+	S32 mPrecullObjectRes;
 } LL_ALIGN_POSTFIX(64);
 
 inline LLSpatialGroup::eOcclusionState operator|(const LLSpatialGroup::eOcclusionState &a, const LLSpatialGroup::eOcclusionState &b) 
@@ -413,6 +420,8 @@ public:
 	BOOL visibleObjectsInFrustum(LLCamera& camera);
 	/*virtual*/ S32 cull(LLCamera &camera, bool do_occlusion=false); // Cull on arbitrary frustum
 	S32 cull(LLCamera &camera, std::vector<LLDrawable *>* results); // Cull on arbitrary frustum
+	void rebound(); // Rebound the octree, done by cull()
+	void precull(LLCamera& camera); // Frustum checks for the next cull() in this sCullPass, may run on a worker thread. Call rebound() first.
 	
 	BOOL isVisible(const LLVector3& v);
 	bool isHUDPartition() ;
@@ -438,6 +447,8 @@ public:
 	U32 mVertexDataMask;
 	F32 mSlopRatio; //percentage distance must change before drawables receive LOD update (default is 0.25);
 	BOOL mDepthMask; //if TRUE, objects in this partition will be written to depth during alpha rendering
+
+	static U32 sCullPass; //bumped by LLPipeline::updateCull() around preculled passes
 };
 
 // class for creating bridges between spatial partitions
@@ -761,6 +761,7 @@ bool idle_startup()
 
 			F32 dropPercent = gSavedSettings.getF32("PacketDropPercentage");
 			msg->mPacketRing->setDropPercentage(dropPercent);
+			msg->mPacketRing->setUseBatchReceive(gSavedSettings.getBOOL("PacketBatchReceive"));
 
             F32 inBandwidth = gSavedSettings.getF32("InBandwidth"); 
             F32 outBandwidth = gSavedSettings.getF32("OutBandwidth"); 
@@ -1654,6 +1655,15 @@ bool idle_startup()
 		// We should have an agent id by this point.
 		llassert(!(gAgentID == LLUUID::null));
 
+		// Read the inventory caches while the world comes up, loadSkeleton()
+		// picks them up when the skeletons are processed.
+		gInventory.startCacheLoad(gAgentID);
+		LLSD lib_owner = LLUserAuth::getInstance()->getResponse()["inventory-lib-owner"];
+		if (lib_owner.isDefined() && lib_owner[0]["agent_id"].isDefined())
+		{
+			gInventory.startCacheLoad(lib_owner[0]["agent_id"].asUUID());
+		}
+
 		// Finish agent initialization.  (Requires gSavedSettings, builds camera)
 		gAgent.init();
 		display_startup();
@@ -4281,4 +4291,5 @@ void transition_back_to_login_panel(const std::string& emsg)
 	// Bounce back to the login screen.
 	reset_login(); // calls LLStartUp::setStartupState( STATE_LOGIN_SHOW );
 	gSavedSettings.setBOOL("AutoLogin", FALSE);
+	gInventory.cancelCacheLoads();
 }
@@ -64,6 +64,88 @@ S32 LLSurface::sTextureSize = 256;
 S32 LLSurface::sTexelsUpdated = 0;
 F32 LLSurface::sTextureUpdateTime = 0.f;
 LLStat LLSurface::sTexelsUpdatedPerSecStat;
+LLSurfaceDecodeThread* LLSurface::sDecodeThread = NULL;
+
+//
+// Runs the IDCT of land patches off the main thread. The bit unpacking has to
+// walk each packet in order and stays on the main thread, which also applies
+// the finished heights (see LLSurface::updatePendingDecodes()).
+//
+class LLSurfaceDecodeThread : public LLQueuedThread
+{
+public:
+	class DecodeRequest : public QueuedRequest
+	{
+	protected:
+		/*virtual*/ ~DecodeRequest() {} // use deleteRequest()
+
+	public:
+		DecodeRequest(handle_t handle, const LLPatchDecompressor* decompressor,
+					  std::vector<LLPatchHeader>& headers, std::vector<S32>& patch_indices, std::vector<S32>& coefficients) :
+			QueuedRequest(handle, PRIORITY_NORMAL),
+			mDecompressor(decompressor)
+		{
+			mHeaders.swap(headers);
+			mPatchIndices.swap(patch_indices);
+			mCoefficients.swap(coefficients);
+		}
+
+		S32 getPatchSize() const								{ return mDecompressor->getSize(); }
+		S32 getCount() const									{ return (S32)mHeaders.size(); }
+		S32 getPatchIndex(S32 i) const							{ return mPatchIndices[i]; }
+		// Heights of patch i, getPatchSize() floats per row.
+		const F32* getHeights(S32 i) const						{ return &mHeights[i*getPatchSize()*getPatchSize()]; }
+
+		/*virtual*/ bool processRequest()
+		{
+			S32 size = getPatchSize();
+			S32 count = getCount();
+			std::vector<F32*> patches(count);
+
+			mHeights.resize(count*size*size);
+			for (S32 i = 0; i < count; i++)
+			{
+				patches[i] = &mHeights[i*size*size];
+			}
+			mDecompressor->decompress(&patches[0], size, &mCoefficients[0], &mHeaders[0], count);
+			return true;
+		}
+
+	private:
+		const LLPatchDecompressor* mDecompressor;
+		std::vector<LLPatchHeader> mHeaders;
+		std::vector<S32> mPatchIndices;		// Into LLSurface::mPatchList.
+		std::vector<S32> mCoefficients;
+		std::vector<F32> mHeights;
+	};
+
+public:
+	LLSurfaceDecodeThread() :
+		LLQueuedThread("SurfaceDecode"),
+		mNormalDecompressor(NORMAL_PATCH_SIZE),
+		mLargeDecompressor(LARGE_PATCH_SIZE)
+	{
+	}
+
+	// Takes over the contents of the vectors.
+	handle_t decode(S32 patch_size, std::vector<LLPatchHeader>& headers, std::vector<S32>& patch_indices, std::vector<S32>& coefficients)
+	{
+		handle_t handle = generateHandle();
+		const LLPatchDecompressor* decompressor = patch_size == LARGE_PATCH_SIZE ? &mLargeDecompressor : &mNormalDecompressor;
+		DecodeRequest* req = new DecodeRequest(handle, decompressor, headers, patch_indices, coefficients);
+		if (!addRequest(req))
+		{
+			req->deleteRequest();
+			return nullHandle();
+		}
+		update(0); // unpauses the thread
+		return handle;
+	}
+
+private:
+	LLPatchDecompressor mNormalDecompressor;
+	LLPatchDecompressor mLargeDecompressor;
+};
 
 // ---------------- LLSurface:: Public Members ---------------
 
@@ -111,6 +193,18 @@ LLSurface::LLSurface(U32 type, LLViewerRegion *regionp) :
 
 LLSurface::~LLSurface()
 {
+	while (sDecodeThread && !mPendingDecodes.empty())
+	{
+		LLQueuedThread::handle_t handle = mPendingDecodes.front();
+		mPendingDecodes.pop_front();
+		sDecodeThread->abortRequest(handle, true);
+		if (sDecodeThread->getRequestStatus(handle) == LLQueuedThread::STATUS_COMPLETE)
+		{
+			// Finished before the abort flag could have any effect.
+			sDecodeThread->completeRequest(handle);
+		}
+	}
+
 	delete [] mSurfaceZ;
 	mSurfaceZ = NULL;
 
@@ -148,6 +242,20 @@ LLSurface::~LLSurface()
 
 void LLSurface::initClasses()
 {
+	if (!sDecodeThread && gSavedSettings.getBOOL("TerrainDecodeThreaded"))
+	{
+		sDecodeThread = new LLSurfaceDecodeThread;
+	}
+}
+
+void LLSurface::cleanupClass()
+{
+	if (sDecodeThread)
+	{
+		sDecodeThread->shutdown();
+		delete sDecodeThread;
+		sDecodeThread = NULL;
+	}
 }
 
 void LLSurface::setRegion(LLViewerRegion *regionp)
@@ -819,6 +927,8 @@ void LLSurface::updatePatchVisibilities(LLAgent &agent)
 
 BOOL LLSurface::idleUpdate(F32 max_update_time)
 {
+	updatePendingDecodes();
+
 	if (!gPipeline.hasRenderType(LLPipeline::RENDER_TYPE_TERRAIN))
 	{
 		return FALSE;
@@ -863,13 +973,15 @@ void LLSurface::decompressDCTPatch(LLBitPack &bitpack, LLGroupHeader *gopp, BOOL
 
 	LLPatchHeader  ph;
 	S32 j, i;
-	S32 patch[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
-	LLSurfacePatch *patchp;
-
-	init_patch_decompressor(gopp->patch_size);
-	gopp->stride = mGridsPerEdge;
-	set_group_of_patch_header(gopp);
-
+	S32 patch_size = gopp->patch_size;
+	S32 patch_coefficients = patch_size*patch_size;
+	std::vector<LLPatchHeader> headers;
+	std::vector<S32> patch_indices;
+	std::vector<S32> coefficients;
+	BOOL bad_packet = FALSE;
+
+	// Unpack all patches of the packet first, so that they can be
+	// decompressed as one batch.
 	while (1)
 	{
 // <FS:CR> Aurora Sim
@@ -907,36 +1019,102 @@ void LLSurface::decompressDCTPatch(LLBitPack &bitpack, LLGroupHeader *gopp, BOOL
 				<< " quant_wbits " << (S32)ph.quant_wbits
 				<< " patchids " << (S32)ph.patchids
 				<< LL_ENDL;
-            LLAppViewer::instance()->badNetworkHandler();
-			return;
+			bad_packet = TRUE;
+			break;
 		}
 
-		patchp = &mPatchList[j*mPatchesPerEdge + i];
-
-
-		decode_patch(bitpack, patch);
-		decompress_patch(patchp->getDataZ(), patch, &ph);
+		headers.push_back(ph);
+		patch_indices.push_back(j*mPatchesPerEdge + i);
+		coefficients.resize(coefficients.size() + patch_coefficients);
+		decode_patch(bitpack, &coefficients[coefficients.size() - patch_coefficients]);
+	}
 
-		// Update edges for neighbors.  Need to guarantee that this gets done before we generate vertical stats.
-		patchp->updateNorthEdge();
-		patchp->updateEastEdge();
-		if (patchp->getNeighborPatch(WEST))
+	if (!headers.empty())
+	{
+		LLQueuedThread::handle_t handle = LLQueuedThread::nullHandle();
+		if (sDecodeThread && (patch_size == NORMAL_PATCH_SIZE || patch_size == LARGE_PATCH_SIZE))
 		{
-			patchp->getNeighborPatch(WEST)->updateEastEdge();
+			handle = sDecodeThread->decode(patch_size, headers, patch_indices, coefficients);
 		}
-		if (patchp->getNeighborPatch(SOUTHWEST))
+		if (handle != LLQueuedThread::nullHandle())
 		{
-			patchp->getNeighborPatch(SOUTHWEST)->updateEastEdge();
-			patchp->getNeighborPatch(SOUTHWEST)->updateNorthEdge();
+			mPendingDecodes.push_back(handle);
 		}
-		if (patchp->getNeighborPatch(SOUTH))
+		else
 		{
-			patchp->getNeighborPatch(SOUTH)->updateNorthEdge();
+			init_patch_decompressor(patch_size);
+			gopp->stride = mGridsPerEdge;
+			set_group_of_patch_header(gopp);
+
+			for (S32 k = 0; k < (S32)headers.size(); k++)
+			{
+				LLSurfacePatch *patchp = &mPatchList[patch_indices[k]];
+				decompress_patch(patchp->getDataZ(), &coefficients[k*patch_coefficients], &headers[k]);
+				finishPatchDecode(patchp);
+			}
 		}
+	}
 
-		// Dirty patch statistics, and flag that the patch has data.
-		patchp->dirtyZ();
-		patchp->setHasReceivedData();
+	if (bad_packet)
+	{
+		LLAppViewer::instance()->badNetworkHandler();
+	}
+}
+
+void LLSurface::finishPatchDecode(LLSurfacePatch *patchp)
+{
+	// Update edges for neighbors.  Need to guarantee that this gets done before we generate vertical stats.
+	patchp->updateNorthEdge();
+	patchp->updateEastEdge();
+	if (patchp->getNeighborPatch(WEST))
+	{
+		patchp->getNeighborPatch(WEST)->updateEastEdge();
+	}
+	if (patchp->getNeighborPatch(SOUTHWEST))
+	{
+		patchp->getNeighborPatch(SOUTHWEST)->updateEastEdge();
+		patchp->getNeighborPatch(SOUTHWEST)->updateNorthEdge();
+	}
+	if (patchp->getNeighborPatch(SOUTH))
+	{
+		patchp->getNeighborPatch(SOUTH)->updateNorthEdge();
+	}
+
+	// Dirty patch statistics, and flag that the patch has data.
+	patchp->dirtyZ();
+	patchp->setHasReceivedData();
+}
+
+void LLSurface::updatePendingDecodes()
+{
+	// Apply in arrival order, so that a later packet for the same patch wins.
+	while (sDecodeThread && !mPendingDecodes.empty())
+	{
+		LLQueuedThread::handle_t handle = mPendingDecodes.front();
+		LLQueuedThread::status_t status = sDecodeThread->getRequestStatus(handle);
+		if (status == LLQueuedThread::STATUS_QUEUED || status == LLQueuedThread::STATUS_INPROGRESS)
+		{
+			break;
+		}
+		mPendingDecodes.pop_front();
+
+		LLSurfaceDecodeThread::DecodeRequest* req = (LLSurfaceDecodeThread::DecodeRequest*)sDecodeThread->getRequest(handle);
+		if (req && status == LLQueuedThread::STATUS_COMPLETE)
+		{
+			S32 size = req->getPatchSize();
+			for (S32 k = 0; k < req->getCount(); k++)
+			{
+				LLSurfacePatch *patchp = &mPatchList[req->getPatchIndex(k)];
+				const F32 *heights = req->getHeights(k);
+				F32 *datap = patchp->getDataZ();
+				for (S32 row = 0; row < size; row++)
+				{
+					memcpy(datap + row*mGridsPerEdge, heights + row*size, size*sizeof(F32));
+				}
+				finishPatchDecode(patchp);
+			}
+		}
+		sDecodeThread->completeRequest(handle);
 	}
 }
 
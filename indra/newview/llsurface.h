@@ -41,6 +41,9 @@
 #include "llvowater.h"
 #include "llpatchvertexarray.h"
 #include "llviewertexture.h"
+#include "llqueuedthread.h"
+
+#include <deque>
 
 class LLTimer;
 class LLUUID;
@@ -63,6 +66,7 @@ class LLViewerRegion;
 class LLSurfacePatch;
 class LLBitPack;
 class LLGroupHeader;
+class LLSurfaceDecodeThread;
 
 class LLSurface 
 {
@@ -71,6 +75,7 @@ public:
 	virtual ~LLSurface();
 
 	static void initClasses(); // Do class initialization for LLSurface and its child classes.
+	static void cleanupClass();
 
 	void create(const S32 surface_grid_width,
 				const S32 surface_patch_width,
@@ -193,6 +198,9 @@ protected:
 	
 	LLSurfacePatch *getPatch(const S32 x, const S32 y) const;
 
+	void finishPatchDecode(LLSurfacePatch *patchp);	// Updates edges and stats after new heights for patchp.
+	void updatePendingDecodes();					// Applies the heights decoded by sDecodeThread.
+
 protected:
 	LLVector3d	mOriginGlobal;		// In absolute frame
 	LLSurfacePatch *mPatchList;		// Array of all patches
@@ -227,9 +235,12 @@ protected:
 
 	S32			mSurfacePatchUpdateCount;					// Number of frames since last update.
 
+	std::deque<LLQueuedThread::handle_t> mPendingDecodes;	// Decode requests in arrival order.
+
 private:
 	LLViewerRegion *mRegionp; // Patch whose coordinate system this surface is using.
 	static S32	sTextureSize;				// Size of the surface texture
+	static LLSurfaceDecodeThread* sDecodeThread;	// NULL unless TerrainDecodeThreaded is set.
 };
 
 
@@ -41,6 +41,8 @@
 // Cache organization:
 // cache/texture.entries
 //  Unordered array of Entry structs
+// cache/texture.journal
+//  IndexedEntry records of the changes not yet written to texture.entries
 // cache/texture.cache
 //  First TEXTURE_CACHE_ENTRY_SIZE bytes of each texture in texture.entries in same order
 // cache/textures/[0-F]/UUID.texture
@@ -738,11 +740,12 @@ void LLTextureCacheWorker::endWork(S32 param, bool aborted)
 //////////////////////////////////////////////////////////////////////////////
 
 LLTextureCache::LLTextureCache(bool threaded)
-	: LLWorkerThread("TextureCache", threaded),
+	: LLWorkerThread("TextureCache", threaded, false, 1),
 	  mHeaderAPRFile(NULL),
 	  mReadOnly(TRUE), //do not allow to change the texture cache until setReadOnly() is called.
 	  mTexturesSizeTotal(0),
-	  mDoPurge(FALSE)
+	  mDoPurge(FALSE),
+	  mJournalRecords(0)
 {
 }
 
@@ -758,7 +761,7 @@ LLTextureCache::~LLTextureCache()
 S32 LLTextureCache::update(F32 max_time_ms)
 {
 	static LLFrameTimer timer;
-	static const F32 MAX_TIME_INTERVAL = 300.f; //seconds.
+	static const F32 JOURNAL_FLUSH_INTERVAL = 5.f; //seconds.
 
 	S32 res;
 	res = LLWorkerThread::update(max_time_ms);
@@ -795,10 +798,13 @@ S32 LLTextureCache::update(F32 max_time_ms)
 		responder->completed(success);
 	}
 	
-	if(!res && timer.getElapsedTimeF32() > MAX_TIME_INTERVAL)
+	if(timer.getElapsedTimeF32() > JOURNAL_FLUSH_INTERVAL)
 	{
 		timer.reset();
-		writeUpdatedEntries();
+		if (flushJournal() && !res)
+		{
+			writeUpdatedEntries(); // the journal grew too big, fold it into the entries file.
+		}
 	}
 
 	return res;
@@ -826,10 +832,8 @@ std::string LLTextureCache::getTextureFileName(const LLUUID& id)
 //debug
 BOOL LLTextureCache::isInCache(const LLUUID& id) 
 {
-	LLMutexLock lock(&mHeaderMutex);
-	id_map_t::const_iterator iter = mHeaderIDMap.find(id);
-	
-	return (iter != mHeaderIDMap.end()) ;
+	Entry entry;
+	return findIndexEntry(id, entry) >= 0;
 }
 
 //debug
@@ -875,11 +879,13 @@ BOOL LLTextureCache::isInLocal(const LLUUID& id)
 
 //static
 const S32 MAX_REASONABLE_FILE_SIZE = 512*1024*1024; // 512 MB
+const U32 MAX_JOURNAL_RECORDS = 16384; // fold the journal into texture.entries beyond this
 F32 LLTextureCache::sHeaderCacheVersion = 1.8f;
 U32 LLTextureCache::sCacheMaxEntries = MAX_REASONABLE_FILE_SIZE / TEXTURE_CACHE_ENTRY_SIZE;
 S64 LLTextureCache::sCacheMaxTexturesSize = 0; // no limit
 const char* entries_filename = "texture.entries";
 const char* cache_filename = "texture.cache";
+const char* journal_filename = "texture.journal";
 const char* old_textures_dirname = "textures";
 //change the location of the texture cache to prevent from being deleted by old version viewers.
 const char* textures_dirname = "texturecache";
@@ -890,6 +896,7 @@ void LLTextureCache::setDirNames(ELLPath location)
 
 	mHeaderEntriesFileName = gDirUtilp->getExpandedFilename(location, textures_dirname, entries_filename);
 	mHeaderDataFileName = gDirUtilp->getExpandedFilename(location, textures_dirname, cache_filename);
+	mJournalFileName = gDirUtilp->getExpandedFilename(location, textures_dirname, journal_filename);
 	mTexturesDirName = gDirUtilp->getExpandedFilename(location, textures_dirname);
 }
 
@@ -1038,13 +1045,7 @@ void LLTextureCache::writeEntriesHeader()
 //mHeaderMutex is locked before calling this.
 S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create)
 {
-	S32 idx = -1;
-	
-	id_map_t::iterator iter1 = mHeaderIDMap.find(id);
-	if (iter1 != mHeaderIDMap.end())
-	{
-		idx = iter1->second;
-	}
+	S32 idx = findIndexEntry(id, entry);
 
 	if (idx < 0)
 	{
@@ -1064,17 +1065,19 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
 			else
 			{
 				// Look for a still valid entry in the LRU
-				for (std::set<LLUUID>::iterator iter2 = mLRU.begin(); iter2 != mLRU.end();)
+				for (lru_map_t::iterator iter2 = mLRU.begin(); iter2 != mLRU.end();)
 				{
-					std::set<LLUUID>::iterator curiter2 = iter2++;
-					LLUUID oldid = *curiter2;
+					lru_map_t::iterator curiter2 = iter2++;
+					LLUUID oldid = curiter2->first;
+					U32 lru_time = curiter2->second;
 					// Erase entry from LRU regardless
 					mLRU.erase(curiter2);
-					// Look up entry and use it if it is valid
-					id_map_t::iterator iter3 = mHeaderIDMap.find(oldid);
-					if (iter3 != mHeaderIDMap.end() && iter3->second >= 0)
+					// Look up entry and use it if it is valid and was not accessed since the LRU was built
+					Entry oldentry;
+					S32 oldidx = findIndexEntry(oldid, oldentry);
+					if (oldidx >= 0 && oldentry.mTime == lru_time)
 					{
-						idx = iter3->second;
+						idx = oldidx;
 						removeCachedTexture(oldid);//remove the existing cached texture to release the entry index.
 						break;
 					}
@@ -1091,134 +1094,58 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
 			}
 		}
 	}
-	else
+	else if(entry.mImageSize <= entry.mBodySize)//it happens on 64-bit systems, do not know why
 	{
-		// Remove this entry from the LRU if it exists
-		mLRU.erase(id);
-		// Read the entry
-		idx_entry_map_t::iterator iter = mUpdatedEntryMap.find(idx);
-		if(iter != mUpdatedEntryMap.end())
-		{
-			entry = iter->second;
-		}
-		else
-		{
-			readEntryFromHeaderImmediately(idx, entry);
-		}
-		if(entry.mImageSize <= entry.mBodySize)//it happens on 64-bit systems, do not know why
-		{
-			LL_WARNS() << "corrupted entry: " << id << " entry image size: " << entry.mImageSize << " entry body size: " << entry.mBodySize << LL_ENDL;
+		LL_WARNS() << "corrupted entry: " << id << " entry image size: " << entry.mImageSize << " entry body size: " << entry.mBodySize << LL_ENDL;
 
-			//erase this entry and the cached texture from the cache.
-			std::string tex_filename = getTextureFileName(id);
-			removeEntry(idx, entry, tex_filename);
-			mUpdatedEntryMap.erase(idx);
-			idx = -1;
-		}
+		//erase this entry and the cached texture from the cache.
+		std::string tex_filename = getTextureFileName(id);
+		removeEntry(idx, entry, tex_filename);
+		idx = -1;
 	}
 	return idx;
 }
 
-//mHeaderMutex is locked before calling this.
-void LLTextureCache::writeEntryToHeaderImmediately(S32& idx, Entry& entry, bool write_header)
-{	
-	LLAPRFile* aprfile;
-	S32 bytes_written;
-	S32 offset = sizeof(EntriesInfo) + idx * sizeof(Entry);
-	if(write_header)
-	{
-		aprfile = openHeaderEntriesFile(false, 0);		
-		bytes_written = aprfile->write((U8*)&mHeaderEntriesInfo, sizeof(EntriesInfo));
-		if(bytes_written != sizeof(EntriesInfo))
-		{
-			clearCorruptedCache(); //clear the cache.
-			idx = -1; //mark the idx invalid.
-			return;
-		}
-
-		mHeaderAPRFile->seek(APR_SET, offset);
-	}
-	else
-	{
-		aprfile = openHeaderEntriesFile(false, offset);
-	}
-	bytes_written = aprfile->write((void*)&entry, (S32)sizeof(Entry));
-	if(bytes_written != sizeof(Entry))
-	{
-		clearCorruptedCache(); //clear the cache.
-		idx = -1; //mark the idx invalid.
-
-		return;
-	}
-
-	closeHeaderEntriesFile();
-	mUpdatedEntryMap.erase(idx);
-}
-
-//mHeaderMutex is locked before calling this.
-void LLTextureCache::readEntryFromHeaderImmediately(S32& idx, Entry& entry)
-{
-		S32 offset = sizeof(EntriesInfo) + idx * sizeof(Entry);
-		LLAPRFile* aprfile = openHeaderEntriesFile(true, offset);
-		S32 bytes_read = aprfile->read((void*)&entry, (S32)sizeof(Entry));
-		closeHeaderEntriesFile();
-
-	if(bytes_read != sizeof(Entry))
-	{
-		clearCorruptedCache(); //clear the cache.
-		idx = -1;//mark the idx invalid.
-	}
-}
-
-//mHeaderMutex is locked before calling this.
-//update an existing entry time stamp, delay writing.
+//the index shard of the entry is locked before calling this.
+//update an existing entry time stamp, only journal it when the cache is getting full.
 void LLTextureCache::updateEntryTimeStamp(S32 idx, Entry& entry)
 {
 	static const U32 MAX_ENTRIES_WITHOUT_TIME_STAMP = (U32)(LLTextureCache::sCacheMaxEntries * 0.75f);
 
-	if(mHeaderEntriesInfo.mEntries < MAX_ENTRIES_WITHOUT_TIME_STAMP)
-	{
-		return; //there are enough empty entry index space, no need to stamp time.
-	}
-
-	if (idx >= 0)
+	if (idx >= 0 && !mReadOnly)
 	{
-		if (!mReadOnly)
+		// Always stamp the in-memory entry: it takes the entry out of the LRU.
+		entry.mTime = time(NULL);
+		if(mHeaderEntriesInfo.mEntries >= MAX_ENTRIES_WITHOUT_TIME_STAMP)
 		{
-			entry.mTime = time(NULL);
-			mUpdatedEntryMap[idx] = entry;
+			appendJournalRecord(idx, entry);
 		}
 	}
 }
 
-//update an existing entry, write to header file immediately.
+//update an existing entry, journal the change immediately.
 bool LLTextureCache::updateEntry(S32& idx, Entry& entry, S32 new_image_size, S32 new_data_size)
 {
 	S32 new_body_size = llmax(0, new_data_size - TEXTURE_CACHE_ENTRY_SIZE);
 	
 	if(new_image_size == entry.mImageSize && new_body_size == entry.mBodySize)
-			{
+	{
 		return true; //nothing changed.
-			}
+	}
 	else 
 	{
 		bool purge = false;
 			
 		lockHeaders();
 
-		bool update_header = false;
 		if(entry.mImageSize < 0) //is a brand-new entry
-			{
-			mHeaderIDMap[entry.mID] = idx;
+		{
 			mTexturesSizeMap[entry.mID] = new_body_size;
 			mTexturesSizeTotal += new_body_size;
-			
-			// Update Header
-			update_header = true;
-			}
+		}
 		else if (entry.mBodySize != new_body_size)
 		{
-			//already in mHeaderIDMap.
+			//already in the index.
 			mTexturesSizeMap[entry.mID] = new_body_size;
 			mTexturesSizeTotal -= entry.mBodySize;
 			mTexturesSizeTotal += new_body_size;
@@ -1227,7 +1154,10 @@ bool LLTextureCache::updateEntry(S32& idx, Entry& entry, S32 new_image_size, S32
 		entry.mImageSize = new_image_size; 
 		entry.mBodySize = new_body_size;
 		
-		writeEntryToHeaderImmediately(idx, entry, update_header);
+		setIndexEntry(idx, entry);
+		// The entry must be on disk before its header is written to texture.cache,
+		// or a crash could leave the old owner of this index pointing at our data.
+		flushJournal();
 	
 		if (mTexturesSizeTotal > sCacheMaxTexturesSize)
 		{
@@ -1247,28 +1177,17 @@ bool LLTextureCache::updateEntry(S32& idx, Entry& entry, S32 new_image_size, S32
 
 U32 LLTextureCache::openAndReadEntries(std::vector<Entry>& entries)
 {
+	// Changes made to the in-memory index go to the entries file first.
+	writeUpdatedEntries();
+
 	U32 num_entries = mHeaderEntriesInfo.mEntries;
 
-	mHeaderIDMap.clear();
+	clearIndex();
 	mTexturesSizeMap.clear();
 	mFreeList.clear();
 	mTexturesSizeTotal = 0;
 
-	LLAPRFile* aprfile = NULL; 
-	if(mUpdatedEntryMap.empty())
-	{
-		aprfile = openHeaderEntriesFile(true, (S32)sizeof(EntriesInfo));
-	}
-	else //update the header file first.
-	{
-		aprfile = openHeaderEntriesFile(false, 0);
-		updatedHeaderEntriesFile();
-		if(!aprfile)
-		{
-			return 0;
-		}
-		aprfile->seek(APR_SET, (S32)sizeof(EntriesInfo));
-	}
+	LLAPRFile* aprfile = openHeaderEntriesFile(true, (S32)sizeof(EntriesInfo));
 	for (U32 idx=0; idx<num_entries; idx++)
 	{
 		Entry entry;
@@ -1281,19 +1200,39 @@ U32 LLTextureCache::openAndReadEntries(std::vector<Entry>& entries)
 			return 0;
 		}
 		entries.push_back(entry);
+	}
+	closeHeaderEntriesFile();
+
+	// Apply the changes journaled since texture.entries was last written.
+	S32 num_records = replayJournal(entries);
+	if (num_records < 0)
+	{
+		purgeAllTextures(false);
+		return 0;
+	}
+	else if (num_records > 0)
+	{
+		num_entries = entries.size();
+		mHeaderEntriesInfo.mEntries = num_entries;
+		writeEntriesHeader();
+		writeEntriesAndClose(entries);
+	}
+
+	for (U32 idx=0; idx<num_entries; idx++)
+	{
+		const Entry& entry = entries[idx];
 // 		LL_INFOS() << "ENTRY: " << entry.mTime << " TEX: " << entry.mID << " IDX: " << idx << " Size: " << entry.mImageSize << LL_ENDL;
 		if(entry.mImageSize > entry.mBodySize)
 		{
-			mHeaderIDMap[entry.mID] = idx;
-				mTexturesSizeMap[entry.mID] = entry.mBodySize;
-				mTexturesSizeTotal += entry.mBodySize;
-			}
+			setIndexEntry(idx, entry, false);
+			mTexturesSizeMap[entry.mID] = entry.mBodySize;
+			mTexturesSizeTotal += entry.mBodySize;
+		}
 		else
 		{
 			mFreeList.insert(idx);
 		}
 	}
-	closeHeaderEntriesFile();
 	return num_entries;
 }
 
@@ -1315,58 +1254,200 @@ void LLTextureCache::writeEntriesAndClose(const std::vector<Entry>& entries)
 			}
 		}
 		closeHeaderEntriesFile();
+		resetJournal(); // everything is in texture.entries now.
 	}
 }
 
+//fold the journal into the entries file.
 void LLTextureCache::writeUpdatedEntries()
 {
 	lockHeaders();
-	if (!mReadOnly && !mUpdatedEntryMap.empty())
+	if (!mReadOnly)
 	{
-		openHeaderEntriesFile(false, 0);
-		updatedHeaderEntriesFile();
-		closeHeaderEntriesFile();
+		mJournalFileMutex.lock();
+		mJournalMutex.lock();
+		bool dirty = mJournalRecords > 0 || !mJournalBuffer.empty();
+		mJournalMutex.unlock();
+		mJournalFileMutex.unlock();
+
+		if (dirty)
+		{
+			// Time stamps recorded while the entries are being written may be lost,
+			// which only affects the LRU order.
+			std::vector<Entry> entries;
+			getIndexEntries(entries);
+			writeEntriesHeader();
+			writeEntriesAndClose(entries);
+		}
 	}
 	unlockHeaders();
 }
 
-//mHeaderMutex is locked and mHeaderAPRFile is created before calling this.
-void LLTextureCache::updatedHeaderEntriesFile()
+//----------------------------------------------------------------------------
+// In-memory index. Lookups only lock the shard of the texture; any change of
+// the index also requires mHeaderMutex to be locked.
+
+S32 LLTextureCache::findIndexEntry(const LLUUID& id, Entry& entry)
+{
+	IndexShard& shard = getIndexShard(id);
+	LLMutexLock lock(&shard.mMutex);
+	index_map_t::const_iterator iter = shard.mEntries.find(id);
+	if (iter == shard.mEntries.end())
+	{
+		return -1;
+	}
+	entry = iter->second.mEntry;
+	return iter->second.mIndex;
+}
+
+void LLTextureCache::setIndexEntry(S32 idx, const Entry& entry, bool journal)
+{
+	IndexShard& shard = getIndexShard(entry.mID);
+	LLMutexLock lock(&shard.mMutex);
+	IndexedEntry& indexed = shard.mEntries[entry.mID];
+	indexed.mIndex = idx;
+	indexed.mEntry = entry;
+	if (journal)
+	{
+		appendJournalRecord(idx, entry);
+	}
+}
+
+void LLTextureCache::eraseIndexEntry(const LLUUID& id)
+{
+	IndexShard& shard = getIndexShard(id);
+	LLMutexLock lock(&shard.mMutex);
+	index_map_t::iterator iter = shard.mEntries.find(id);
+	if (iter != shard.mEntries.end())
+	{
+		appendJournalRecord(iter->second.mIndex, Entry(id, -1, 0, 0)); // free the index
+		shard.mEntries.erase(iter);
+	}
+}
+
+void LLTextureCache::clearIndex()
+{
+	for (S32 i = 0; i < INDEX_SHARDS; ++i)
+	{
+		LLMutexLock lock(&mIndexShards[i].mMutex);
+		mIndexShards[i].mEntries.clear();
+	}
+}
+
+void LLTextureCache::getIndexEntries(std::vector<Entry>& entries)
 {
-	if (!mReadOnly && !mUpdatedEntryMap.empty() && mHeaderAPRFile)
+	entries.clear();
+	entries.resize(mHeaderEntriesInfo.mEntries, Entry(LLUUID::null, -1, 0, 0));
+	for (S32 i = 0; i < INDEX_SHARDS; ++i)
 	{
-		//entriesInfo
-		mHeaderAPRFile->seek(APR_SET, 0);
-		S32 bytes_written = mHeaderAPRFile->write((U8*)&mHeaderEntriesInfo, sizeof(EntriesInfo));
-		if(bytes_written != sizeof(EntriesInfo))
+		LLMutexLock lock(&mIndexShards[i].mMutex);
+		for (index_map_t::const_iterator iter = mIndexShards[i].mEntries.begin(); iter != mIndexShards[i].mEntries.end(); ++iter)
 		{
-			clearCorruptedCache(); //clear the cache.
-			return;
-		}
-		
-		//write each updated entry
-		S32 entry_size = (S32)sizeof(Entry);
-		S32 prev_idx = -1;
-		S32 delta_idx;
-		for (idx_entry_map_t::iterator iter = mUpdatedEntryMap.begin(); iter != mUpdatedEntryMap.end(); ++iter)
-		{
-			delta_idx = iter->first - prev_idx - 1;
-			prev_idx = iter->first;
-			if(delta_idx)
+			if ((U32)iter->second.mIndex < entries.size())
 			{
-				mHeaderAPRFile->seek(APR_CUR, delta_idx * entry_size);
-			}
-			
-			bytes_written = mHeaderAPRFile->write((void*)(&iter->second), entry_size);
-			if(bytes_written != entry_size)
-			{
-				clearCorruptedCache(); //clear the cache.
-				return;
+				entries[iter->second.mIndex] = iter->second.mEntry;
 			}
 		}
-		mUpdatedEntryMap.clear();
 	}
 }
+
+//----------------------------------------------------------------------------
+// Journal. Records are buffered in memory and appended to the journal file
+// in batches; replaying them on top of texture.entries gives the index back.
+
+//the index shard of the entry or mHeaderMutex is locked before calling this.
+void LLTextureCache::appendJournalRecord(S32 idx, const Entry& entry)
+{
+	if (mReadOnly)
+	{
+		return;
+	}
+	IndexedEntry record;
+	record.mIndex = idx;
+	record.mEntry = entry;
+	LLMutexLock lock(&mJournalMutex);
+	mJournalBuffer.push_back(record);
+}
+
+//returns true when the journal file should be folded into texture.entries.
+bool LLTextureCache::flushJournal()
+{
+	LLMutexLock lock(&mJournalFileMutex);
+
+	std::vector<IndexedEntry> records;
+	mJournalMutex.lock();
+	records.swap(mJournalBuffer);
+	mJournalMutex.unlock();
+
+	if (!mReadOnly && !records.empty())
+	{
+		S32 size = (S32)(records.size() * sizeof(IndexedEntry));
+		S32 bytes_written = LLAPRFile::writeEx(mJournalFileName, (U8*)&records[0], -1, size);
+		if (bytes_written != size)
+		{
+			LL_WARNS("TextureCache") << "Failed to write texture cache journal: " << bytes_written << " / " << size << LL_ENDL;
+			mJournalRecords = MAX_JOURNAL_RECORDS; // a partial record would garble the journal, rewrite the entries.
+		}
+		else
+		{
+			mJournalRecords += records.size();
+		}
+	}
+	return mJournalRecords >= MAX_JOURNAL_RECORDS;
+}
+
+//mHeaderMutex is locked before calling this.
+//returns the number of records applied to entries, or -1 if the journal is corrupted.
+S32 LLTextureCache::replayJournal(std::vector<Entry>& entries)
+{
+	S32 file_size = LLAPRFile::size(mJournalFileName);
+	U32 num_records = file_size > 0 ? file_size / sizeof(IndexedEntry) : 0; // ignore a partially written last record
+	if (!num_records)
+	{
+		return 0;
+	}
+
+	std::vector<IndexedEntry> records(num_records);
+	S32 size = (S32)(num_records * sizeof(IndexedEntry));
+	S32 bytes_read = LLAPRFile::readEx(mJournalFileName, (U8*)&records[0], 0, size);
+	if (bytes_read != size)
+	{
+		LL_WARNS("TextureCache") << "Failed to read texture cache journal: " << bytes_read << " / " << size << LL_ENDL;
+		return -1;
+	}
+
+	const U32 max_entries = MAX_REASONABLE_FILE_SIZE / TEXTURE_CACHE_ENTRY_SIZE;
+	for (U32 i = 0; i < num_records; ++i)
+	{
+		const IndexedEntry& record = records[i];
+		if (record.mIndex < 0 || (U32)record.mIndex >= max_entries)
+		{
+			LL_WARNS("TextureCache") << "Corrupted texture cache journal, bad index " << record.mIndex << " at record " << i << LL_ENDL;
+			return -1;
+		}
+		if ((U32)record.mIndex >= entries.size())
+		{
+			entries.resize(record.mIndex + 1, Entry(LLUUID::null, -1, 0, 0));
+		}
+		entries[record.mIndex] = record.mEntry;
+	}
+	LL_INFOS("TextureCache") << "Replayed " << num_records << " texture cache journal records." << LL_ENDL;
+	return num_records;
+}
+
+void LLTextureCache::resetJournal()
+{
+	LLMutexLock lock(&mJournalFileMutex);
+	mJournalMutex.lock();
+	mJournalBuffer.clear();
+	mJournalMutex.unlock();
+	if (!mReadOnly && LLAPRFile::isExist(mJournalFileName))
+	{
+		LLAPRFile::remove(mJournalFileName);
+	}
+	mJournalRecords = 0;
+}
+
 //----------------------------------------------------------------------------
 
 // Called from either the main thread or the worker thread
@@ -1438,7 +1519,7 @@ void LLTextureCache::readHeaderCache()
 				S32 lru_entries = (S32)((F32)sCacheMaxEntries * TEXTURE_CACHE_LRU_SIZE);
 				for (std::set<lru_data_t>::iterator iter = lru.begin(); iter != lru.end(); ++iter)
 				{
-					mLRU.insert(entries[iter->second].mID);
+					mLRU[entries[iter->second].mID] = entries[iter->second].mTime;
 // 					LL_INFOS() << "LRU: " << iter->first << " : " << iter->second << LL_ENDL;
 					if (--lru_entries <= 0)
 						break;
@@ -1528,12 +1609,12 @@ void LLTextureCache::purgeAllTextures(bool purge_directories)
 			LLFile::rmdir(mTexturesDirName);
 		}
 	}
-	mHeaderIDMap.clear();
+	clearIndex();
 	mTexturesSizeMap.clear();
 	mTexturesSizeTotal = 0;
 	mFreeList.clear();
 	mTexturesSizeTotal = 0;
-	mUpdatedEntryMap.clear();
+	resetJournal();
 
 	// Info with 0 entries
 	mHeaderEntriesInfo.mVersion = sHeaderCacheVersion;
@@ -1593,16 +1674,16 @@ void LLTextureCache::purgeTextures(bool validate)
 	{
 		if (iter1->second > 0)
 		{
-			id_map_t::iterator iter2 = mHeaderIDMap.find(iter1->first);
-			if (iter2 != mHeaderIDMap.end())
+			Entry entry;
+			S32 idx = findIndexEntry(iter1->first, entry);
+			if (idx >= 0)
 			{
-				S32 idx = iter2->second;
 				time_idx_set.push_back(std::make_pair(entries[idx].mTime, idx));
 // 				LL_INFOS() << "TIME: " << entries[idx].mTime << " TEX: " << entries[idx].mID << " IDX: " << idx << " Size: " << entries[idx].mImageSize << LL_ENDL;
 			}
 			else
 			{
-				LL_ERRS() << "mTexturesSizeMap / mHeaderIDMap corrupted." << LL_ENDL ;
+				LL_ERRS() << "mTexturesSizeMap / index corrupted." << LL_ENDL ;
 			}
 		}
 	}
@@ -1711,14 +1792,27 @@ LLTextureCacheWorker* LLTextureCache::getWriter(handle_t handle)
 //////////////////////////////////////////////////////////////////////////////
 // Called from work thread
 
-// Reads imagesize from the header, updates timestamp
+// Reads imagesize from the index, updates timestamp
 S32 LLTextureCache::getHeaderCacheEntry(const LLUUID& id, Entry& entry)
 {
-	LLMutexLock lock(&mHeaderMutex);
-	S32 idx = openAndReadEntry(id, entry, false);
-	if (idx >= 0)
+	S32 idx = -1;
+	{
+		// Only lock the shard of this texture, so that concurrent reads do not serialize.
+		IndexShard& shard = getIndexShard(id);
+		LLMutexLock lock(&shard.mMutex);
+		index_map_t::iterator iter = shard.mEntries.find(id);
+		if (iter != shard.mEntries.end())
+		{
+			idx = iter->second.mIndex;
+			updateEntryTimeStamp(idx, iter->second.mEntry); // updates time
+			entry = iter->second.mEntry;
+		}
+	}
+	if (idx >= 0 && entry.mImageSize <= entry.mBodySize)
 	{
-		updateEntryTimeStamp(idx, entry); // updates time
+		// Let openAndReadEntry() deal with the corrupted entry.
+		LLMutexLock lock(&mHeaderMutex);
+		idx = openAndReadEntry(id, entry, false);
 	}
 	return idx;
 }
@@ -1881,7 +1975,7 @@ void LLTextureCache::removeCachedTexture(const LLUUID& id)
 		mTexturesSizeTotal -= mTexturesSizeMap[id];
 		mTexturesSizeMap.erase(id);
 	}
-	mHeaderIDMap.erase(id);
+	eraseIndexEntry(id);
 	LLAPRFile::remove(getTextureFileName(id));		
 }
 
@@ -1907,7 +2001,7 @@ void LLTextureCache::removeEntry(S32 idx, Entry& entry, std::string& filename)
 
 		entry.mImageSize = -1;
 		entry.mBodySize = 0;
-		mHeaderIDMap.erase(entry.mID);
+		eraseIndexEntry(entry.mID);
 		mTexturesSizeMap.erase(entry.mID);		
 		mFreeList.insert(idx);	
 	}
@@ -1932,7 +2026,6 @@ bool LLTextureCache::removeFromCache(const LLUUID& id)
 		removeEntry(idx, entry, tex_filename);
 		if (idx >= 0)
 		{			
-			writeEntryToHeaderImmediately(idx, entry);					
 			ret = true;
 		}
 
@@ -34,6 +34,8 @@
 
 #include "llworkerthread.h"
 
+#include <boost/unordered_map.hpp>
+
 class LLImageFormatted;
 class LLTextureCacheWorker;
 
@@ -68,6 +70,13 @@ private:
 		S32 mBodySize; // size of body file in body cache
 		U32 mTime; // seconds since 1/1/1970
 	};
+	// An entry together with its index in texture.entries.
+	// This is also the record format of the journal file.
+	struct IndexedEntry
+	{
+		S32 mIndex;
+		Entry mEntry;
+	};
 
 	
 public:
@@ -158,16 +167,26 @@ private:
 	void updateEntryTimeStamp(S32 idx, Entry& entry) ;
 	U32 openAndReadEntries(std::vector<Entry>& entries);
 	void writeEntriesAndClose(const std::vector<Entry>& entries);
-	void readEntryFromHeaderImmediately(S32& idx, Entry& entry) ;
-	void writeEntryToHeaderImmediately(S32& idx, Entry& entry, bool write_header = false) ;
 	void removeEntry(S32 idx, Entry& entry, std::string& filename);
 	void removeCachedTexture(const LLUUID& id) ;
 	S32 getHeaderCacheEntry(const LLUUID& id, Entry& entry);
 	S32 setHeaderCacheEntry(const LLUUID& id, Entry& entry, S32 imagesize, S32 datasize);
 	void writeUpdatedEntries() ;
-	void updatedHeaderEntriesFile() ;
 	void lockHeaders() { mHeaderMutex.lock(); }
 	void unlockHeaders() { mHeaderMutex.unlock(); }
+
+	// In-memory index of texture.entries
+	S32 findIndexEntry(const LLUUID& id, Entry& entry);
+	void setIndexEntry(S32 idx, const Entry& entry, bool journal = true);
+	void eraseIndexEntry(const LLUUID& id);
+	void clearIndex();
+	void getIndexEntries(std::vector<Entry>& entries);
+
+	// Journal of index changes not yet written to texture.entries
+	void appendJournalRecord(S32 idx, const Entry& entry);
+	bool flushJournal();
+	S32 replayJournal(std::vector<Entry>& entries);
+	void resetJournal();
 	
 private:
 	// Internal
@@ -193,9 +212,27 @@ private:
 	std::string mHeaderDataFileName;
 	EntriesInfo mHeaderEntriesInfo;
 	std::set<S32> mFreeList; // deleted entries
-	std::set<LLUUID> mLRU;
-	typedef std::map<LLUUID,S32> id_map_t;
-	id_map_t mHeaderIDMap;
+	typedef std::map<LLUUID,U32> lru_map_t;
+	lru_map_t mLRU; // id -> time stamp when the LRU was built
+	
+	// The index is split in shards so that workers looking up different
+	// textures do not contend; each shard has its own mutex.
+	typedef boost::unordered_map<LLUUID, IndexedEntry> index_map_t;
+	struct IndexShard
+	{
+		LLMutex mMutex;
+		index_map_t mEntries;
+	};
+	enum { INDEX_SHARDS = 16 };
+	IndexShard& getIndexShard(const LLUUID& id) { return mIndexShards[id.mData[0] & (INDEX_SHARDS - 1)]; }
+	IndexShard mIndexShards[INDEX_SHARDS];
+
+	// JOURNAL
+	std::string mJournalFileName;
+	LLMutex mJournalMutex; // protects mJournalBuffer
+	LLMutex mJournalFileMutex; // serializes writes to the journal file
+	std::vector<IndexedEntry> mJournalBuffer;
+	U32 mJournalRecords; // number of records in the journal file
 
 	// BODIES (TEXTURES minus headers)
 	std::string mTexturesDirName;
@@ -204,9 +241,6 @@ private:
 	S64 mTexturesSizeTotal;
 	LLAtomic32<bool> mDoPurge;
 
-	typedef std::map<S32, Entry> idx_entry_map_t;
-	idx_entry_map_t mUpdatedEntryMap;
-
 	// Statics
 	static F32 sHeaderCacheVersion;
 	static U32 sCacheMaxEntries;
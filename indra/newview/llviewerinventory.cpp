@@ -39,6 +39,7 @@
 #include "llfolderview.h"
 #include "llviewercontrol.h"
 #include "llconsole.h"
+#include "llinventorycache.h"
 #include "llinventorydefines.h"
 #include "llinventoryfunctions.h"
 #include "llinventorymodel.h"
@@ -514,6 +515,61 @@ bool LLViewerInventoryItem::exportFileLocal(LLFILE* fp) const
 	return true;
 }
 
+void LLViewerInventoryItem::packCacheRecord(LLInventoryCacheItemRecord& record, LLInventoryCacheStringPool& pool) const
+{
+	record.mUUID = mUUID;
+	record.mParentUUID = mParentUUID;
+	record.mCreatorID = mPermissions.getCreator();
+	record.mOwnerID = mPermissions.getOwner();
+	record.mLastOwnerID = mPermissions.getLastOwner();
+	record.mGroupID = mPermissions.getGroup();
+	record.mAssetUUID = mAssetUUID;
+	record.mMaskBase = mPermissions.getMaskBase();
+	record.mMaskOwner = mPermissions.getMaskOwner();
+	record.mMaskGroup = mPermissions.getMaskGroup();
+	record.mMaskEveryone = mPermissions.getMaskEveryone();
+	record.mMaskNextOwner = mPermissions.getMaskNextOwner();
+	record.mFlags = mFlags;
+	record.mSalePrice = mSaleInfo.getSalePrice();
+	record.mCreationDate = (S32)mCreationDate;
+	record.mType = (S8)mType;
+	record.mInventoryType = (S8)mInventoryType;
+	record.mSaleType = (S8)mSaleInfo.getSaleType();
+	record.mGroupOwned = mPermissions.isGroupOwned() ? 1 : 0;
+	pool.add(mName, record.mNameOffset, record.mNameSize);
+	pool.add(mDescription, record.mDescOffset, record.mDescSize);
+}
+
+bool LLViewerInventoryItem::unpackCacheRecord(const LLInventoryCacheItemRecord& record, const LLInventoryCacheBlock& block)
+{
+	if (!block.getString(record.mNameOffset, record.mNameSize, mName)
+		|| !block.getString(record.mDescOffset, record.mDescSize, mDescription))
+	{
+		return false;
+	}
+	mUUID = record.mUUID;
+	mParentUUID = record.mParentUUID;
+	mAssetUUID = record.mAssetUUID;
+	mFlags = record.mFlags;
+	mPermissions.init(record.mCreatorID, record.mOwnerID, record.mLastOwnerID, record.mGroupID);
+	mPermissions.yesReallySetOwner(record.mOwnerID, record.mGroupOwned != 0);
+	mPermissions.initMasks(record.mMaskBase, record.mMaskOwner, record.mMaskEveryone, record.mMaskGroup, record.mMaskNextOwner);
+	mType = (LLAssetType::EType)record.mType;
+	mInventoryType = (LLInventoryType::EType)record.mInventoryType;
+	// Same sanity check as LLInventoryItem::importFile()
+	if ((LLInventoryType::IT_NONE == mInventoryType)
+		|| !inventory_and_asset_types_match(mInventoryType, mType))
+	{
+		mInventoryType = LLInventoryType::defaultForAssetType(mType);
+	}
+	mPermissions.initMasks(mInventoryType);
+	mSaleInfo.setSaleType((LLSaleInfo::EForSale)record.mSaleType);
+	mSaleInfo.setSalePrice(record.mSalePrice);
+	mCreationDate = record.mCreationDate;
+	mIsComplete = false;
+	return true;
+}
+
 void LLViewerInventoryItem::updateParentOnServer(BOOL restamp) const
 {
 	LLMessageSystem* msg = gMessageSystem;
@@ -809,6 +865,32 @@ bool LLViewerInventoryCategory::exportFileLocal(LLFILE* fp) const
 	return true;
 }
 
+void LLViewerInventoryCategory::packCacheRecord(LLInventoryCacheCategoryRecord& record, LLInventoryCacheStringPool& pool) const
+{
+	record.mUUID = mUUID;
+	record.mParentUUID = mParentUUID;
+	record.mOwnerID = mOwnerID;
+	record.mPreferredType = mPreferredType;
+	record.mVersion = mVersion;
+	pool.add(mName, record.mNameOffset, record.mNameSize);
+}
+
+bool LLViewerInventoryCategory::unpackCacheRecord(const LLInventoryCacheBlock& block)
+{
+	const LLInventoryCacheCategoryRecord& record = *block.mCategory;
+	if (!block.getString(record.mNameOffset, record.mNameSize, mName))
+	{
+		return false;
+	}
+	mUUID = record.mUUID;
+	mParentUUID = record.mParentUUID;
+	mOwnerID = record.mOwnerID;
+	mVersion = record.mVersion;
+	mType = LLAssetType::AT_CATEGORY;
+	mPreferredType = (LLFolderType::EType)record.mPreferredType;
+	return true;
+}
+
 void LLViewerInventoryCategory::determineFolderType()
 {
 	/* Do NOT uncomment this code.  This is for future 2.1 support of ensembles.
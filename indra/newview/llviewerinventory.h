@@ -41,6 +41,10 @@
 
 class LLFolderView;
 class LLFolderBridge;
+struct LLInventoryCacheBlock;
+struct LLInventoryCacheCategoryRecord;
+struct LLInventoryCacheItemRecord;
+class LLInventoryCacheStringPool;
 class LLViewerInventoryCategory;
 
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
@@ -129,6 +133,9 @@ public:
 	// other than cacheing.
 	bool exportFileLocal(LLFILE* fp) const;
 	bool importFileLocal(LLFILE* fp);
+	// binary inventory cache records, see llinventorycache.h
+	void packCacheRecord(LLInventoryCacheItemRecord& record, LLInventoryCacheStringPool& pool) const;
+	bool unpackCacheRecord(const LLInventoryCacheItemRecord& record, const LLInventoryCacheBlock& block);
 
 	// new methods
 	BOOL isComplete() const { return mIsComplete; }
@@ -227,6 +234,8 @@ public:
 	// other than caching.
 	bool exportFileLocal(LLFILE* fp) const;
 	bool importFileLocal(LLFILE* fp);
+	void packCacheRecord(LLInventoryCacheCategoryRecord& record, LLInventoryCacheStringPool& pool) const;
+	bool unpackCacheRecord(const LLInventoryCacheBlock& block);
 	void determineFolderType();
 	void changeType(LLFolderType::EType new_folder_type);
 	virtual void unpackMessage(LLMessageSystem* msg, const char* block, S32 block_num = 0);
@@ -3840,6 +3840,7 @@ void process_chat_from_simulator(LLMessageSystem *msg, void **user_data)
 		else
 		{
 			chat.mFromName = LLCacheName::cleanFullName(from_name);
+			LLAvatarNameCache::prioritize(from_id);
 		}
 	}
 	else
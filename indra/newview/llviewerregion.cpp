@@ -113,6 +113,7 @@ public:
 	LLViewerRegionImpl(LLViewerRegion * region, LLHost const & host)
 		:	mHost(host),
 			mCompositionp(NULL),
+			mCacheReadHandle(LLQueuedThread::nullHandle()),
 			mEventPoll(NULL),
 			mSeedCapMaxAttempts(MAX_CAP_REQUEST_ATTEMPTS),
 			mSeedCapMaxAttemptsBeforeLogin(MAX_SEED_CAP_ATTEMPTS_BEFORE_LOGIN),
@@ -161,6 +162,7 @@ public:
 	// Cache ID is unique per-region, across renames, moving locations,
 	// etc.
 	LLUUID mCacheID;
+	LLVOCache::handle_t mCacheReadHandle;	// Pending prefetch of the object cache, if any.
 
 	CapabilityMap mCapabilities;
 	CapabilityMap mSecondCapabilitiesTracker; 
@@ -539,6 +541,10 @@ LLViewerRegion::~LLViewerRegion()
 	
 	std::for_each(mImpl->mObjectPartition.begin(), mImpl->mObjectPartition.end(), DeletePointer());
 
+	if (LLVOCache::hasInstance())
+	{
+		LLVOCache::getInstance()->abortPrefetch(mImpl->mCacheReadHandle);
+	}
 	saveObjectCache();
 
 	delete mImpl;
@@ -576,6 +582,21 @@ void LLViewerRegion::setRegionID(const LLUUID& region_id)
 	mImpl->mRegionID = region_id;
 }
 
+void LLViewerRegion::prefetchObjectCache()
+{
+	if (mCacheLoaded || mImpl->mCacheReadHandle != LLQueuedThread::nullHandle())
+	{
+		return;
+	}
+
+	// The cache id isn't known until the region handshake, so this
+	// reads whatever is cached for the handle; loadObjectCache() checks it.
+	if(LLVOCache::hasInstance())
+	{
+		mImpl->mCacheReadHandle = LLVOCache::getInstance()->prefetchFromCache(mHandle);
+	}
+}
+
 void LLViewerRegion::loadObjectCache()
 {
 	if (mCacheLoaded)
@@ -588,7 +609,15 @@ void LLViewerRegion::loadObjectCache()
 
 	if(LLVOCache::hasInstance())
 	{
-		LLVOCache::getInstance()->readFromCache(mHandle, mImpl->mCacheID, mImpl->mCacheMap) ;
+		if (mImpl->mCacheReadHandle != LLQueuedThread::nullHandle())
+		{
+			LLVOCache::getInstance()->finishPrefetch(mImpl->mCacheReadHandle, mHandle, mImpl->mCacheID, mImpl->mCacheMap);
+			mImpl->mCacheReadHandle = LLQueuedThread::nullHandle();
+		}
+		else
+		{
+			LLVOCache::getInstance()->readFromCache(mHandle, mImpl->mCacheID, mImpl->mCacheMap) ;
+		}
 	}
 }
 
@@ -607,7 +636,8 @@ void LLViewerRegion::saveObjectCache()
 
 	if(LLVOCache::hasInstance())
 	{
-		LLVOCache::getInstance()->writeToCache(mHandle, mImpl->mCacheID, mImpl->mCacheMap, mCacheDirty) ;
+		// Hands the entries over to the object cache, which writes them in the background.
+		LLVOCache::getInstance()->flushToCache(mHandle, mImpl->mCacheID, mImpl->mCacheMap, mCacheDirty) ;
 		mCacheDirty = FALSE;
 	}
 
@@ -1529,11 +1559,9 @@ LLViewerRegion::eCacheUpdateResult LLViewerRegion::cacheFullUpdate(LLViewerObjec
 			return CACHE_UPDATE_DUPE;
 		}
 
-		// Update the cache entry
-		mImpl->mCacheMap.erase(local_id);
-		delete entry;
-		entry = new LLVOCacheEntry(local_id, crc, dp);
-		mImpl->mCacheMap[local_id] = entry;
+		// Update the cache entry in place, so that the object cache knows
+		// it only has to write back the changed data.
+		entry->assignCRC(crc, dp);
 		return CACHE_UPDATE_CHANGED;
 	}
 
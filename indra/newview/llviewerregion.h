@@ -126,6 +126,7 @@ public:
 	}
 
 	// Call this after you have the region name and handle.
+	void prefetchObjectCache();
 	void loadObjectCache();
 	void saveObjectCache();
 
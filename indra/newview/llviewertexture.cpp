@@ -623,6 +623,7 @@ void LLViewerTexture::init(bool firstinit)
 	mMaxVirtualSizeResetInterval = 1;
 	mMaxVirtualSizeResetCounter = mMaxVirtualSizeResetInterval ;
 	mAdditionalDecodePriority = 0.f ;	
+	mPrioritySlot = -1;
 	mParcelMedia = NULL ;
 	
 	mNumVolumes = 0;
@@ -771,6 +772,11 @@ void LLViewerTexture::addTextureStats(F32 virtual_size, BOOL needs_gltexture) co
 	{
 		mMaxVirtualSize = virtual_size;
 	}	
+
+	if (mPrioritySlot >= 0)
+	{
+		gTextureList.setSlotVirtualSize(mPrioritySlot, mMaxVirtualSize);
+	}
 }
 
 void LLViewerTexture::resetTextureStats()
@@ -778,6 +784,11 @@ void LLViewerTexture::resetTextureStats()
 	mMaxVirtualSize = 0.0f ;
 	mAdditionalDecodePriority = 0.f ;	
 	mMaxVirtualSizeResetCounter = 0 ;
+
+	if (mPrioritySlot >= 0)
+	{
+		gTextureList.setSlotVirtualSize(mPrioritySlot, 0.f);
+	}
 }
 
 //virtual 
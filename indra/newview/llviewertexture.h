@@ -146,6 +146,10 @@ public:
 
 	virtual F32  getMaxVirtualSize() ;
 
+	// Slot of the texture in the decode priority arrays of gTextureList, -1 if none.
+	S32  getPrioritySlot() const { return mPrioritySlot; }
+	void setPrioritySlot(S32 slot) { mPrioritySlot = slot; }
+
 	LLFrameTimer* getLastReferencedTimer() {return &mLastReferencedTimer ;}
 	
 	S32 getFullWidth() const { return mFullWidth; }
@@ -196,6 +200,7 @@ protected:
 	mutable S32  mMaxVirtualSizeResetCounter ;
 	mutable S32  mMaxVirtualSizeResetInterval;
 	mutable F32 mAdditionalDecodePriority;  // priority add to mDecodePriority.
+	S32 mPrioritySlot;
 	LLFrameTimer mLastReferencedTimer;	
 
 	ll_face_list_t    mFaceList[LLRender::NUM_TEXTURE_CHANNELS]; //reverse pointer pointing to the faces using this image as texture
@@ -34,6 +34,7 @@
 #include "llviewerprecompiledheaders.h"
 
 #include <sys/stat.h>
+#include <algorithm>
 
 #include "llviewertexturelist.h"
 
@@ -325,6 +326,18 @@ void LLViewerTextureList::shutdown()
 	mLoadingStreamList.clear();
 	mCreateTextureList.clear();
 	
+	for (std::vector<LLViewerFetchedTexture*>::iterator iter = mSlotTextures.begin(); iter != mSlotTextures.end(); ++iter)
+	{
+		if (*iter)
+		{
+			(*iter)->setPrioritySlot(-1);
+		}
+	}
+	mSlotVirtualSize.clear();
+	mSlotUpdatedSize.clear();
+	mSlotTextures.clear();
+	mFreeSlots.clear();
+
 	mUUIDMap.clear();
 	
 	mImageList.clear();
@@ -677,11 +690,13 @@ void LLViewerTextureList::addImage(LLViewerFetchedTexture *new_image)
 	if (image)
 	{
 		LL_INFOS() << "Image with ID " << image_id << " already in list" << LL_ENDL;
+		freePrioritySlot(image);
 	}
 	sNumImages++;
 	
 	addImageToList(new_image);
 	mUUIDMap[image_id] = new_image;
+	allocPrioritySlot(new_image);
 }
 
 
@@ -694,12 +709,53 @@ void LLViewerTextureList::deleteImage(LLViewerFetchedTexture *image)
 			mCallbackList.erase(image);
 		}
 
+		freePrioritySlot(image);
 		llverify(mUUIDMap.erase(image->getID()) == 1);
 		sNumImages--;
 		removeImageFromList(image);
 	}
 }
 
+void LLViewerTextureList::allocPrioritySlot(LLViewerFetchedTexture *image)
+{
+	if (image->getPrioritySlot() >= 0)
+	{
+		return;
+	}
+	if (mFreeSlots.empty())
+	{
+		// Grow by a whole SSE register, free slots score zero in the pass.
+		S32 first = mSlotTextures.size();
+		mSlotVirtualSize.resize(first + 4, 0.f);
+		mSlotUpdatedSize.resize(first + 4, 0.f);
+		mSlotTextures.resize(first + 4, NULL);
+		for (S32 slot = first + 3; slot >= first; --slot)
+		{
+			mFreeSlots.push_back(slot);
+		}
+	}
+	S32 slot = mFreeSlots.back();
+	mFreeSlots.pop_back();
+	mSlotTextures[slot] = image;
+	mSlotVirtualSize[slot] = image->getMaxVirtualSize();
+	mSlotUpdatedSize[slot] = mSlotVirtualSize[slot];
+	image->setPrioritySlot(slot);
+}
+
+void LLViewerTextureList::freePrioritySlot(LLViewerFetchedTexture *image)
+{
+	S32 slot = image->getPrioritySlot();
+	if (slot < 0 || slot >= (S32)mSlotTextures.size() || mSlotTextures[slot] != image)
+	{
+		return;
+	}
+	image->setPrioritySlot(-1);
+	mSlotTextures[slot] = NULL;
+	mSlotVirtualSize[slot] = 0.f;
+	mSlotUpdatedSize[slot] = 0.f;
+	mFreeSlots.push_back(slot);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 
@@ -840,9 +896,20 @@ void LLViewerTextureList::updateImagesDecodePriorities()
         
         static const S32 MAX_PRIO_UPDATES = gSavedSettings.getS32("TextureFetchUpdatePriorities");         // default: 32
 		const size_t max_update_count = llmin((S32) (MAX_PRIO_UPDATES*MAX_PRIO_UPDATES*gFrameIntervalSeconds) + 1, MAX_PRIO_UPDATES);
+
+		// Textures whose size on screen changed the most get up to half of the
+		// priority updates. The round robin below spends the rest, at least
+		// half, so that inputs the stale pass does not see, like discard and
+		// boost levels, still reach every texture at least half as often as
+		// when the round robin had the whole budget.
+		const S32 stale_budget = (S32)max_update_count / 2;
+		S32 priority_budget = (S32)max_update_count - updateStalePriorities(stale_budget);
+
 		S32 update_counter = llmin(max_update_count, mUUIDMap.size());
 		uuid_map_t::iterator iter = mUUIDMap.upper_bound(mLastUpdateUUID);
-		while ((update_counter-- > 0) && !mUUIDMap.empty())
+		// Stop once the priority budget is spent rather than pass over textures
+		// without updating them.
+		while ((update_counter-- > 0) && (priority_budget > 0) && !mUUIDMap.empty())
 		{
 			if (iter == mUUIDMap.end())
 			{
@@ -914,21 +981,102 @@ void LLViewerTextureList::updateImagesDecodePriorities()
 			{
 				continue;
 			}
-			imagep->processTextureStats();
-			F32 old_priority = imagep->getDecodePriority();
-			F32 old_priority_test = llmax(old_priority, 0.0f);
-			F32 decode_priority = imagep->calcDecodePriority();
-			F32 decode_priority_test = llmax(decode_priority, 0.0f);
-			// Ignore < 20% difference
-			if ((decode_priority_test < old_priority_test * .8f) ||
-				(decode_priority_test > old_priority_test * 1.25f))
+			--priority_budget;
+			updateImageDecodePriority(imagep);
+		}
+	}
+}
+
+// Picks the (at most) max_count textures whose virtual size changed the most
+// since their last priority update and updates them. The square root of the
+// virtual size is the pixel term of calcDecodePriority() and picks the
+// desired discard level, so its relative change is what makes a priority stale.
+// Returns the number of priorities updated.
+S32 LLViewerTextureList::updateStalePriorities(S32 max_count)
+{
+	const S32 num_slots = mSlotTextures.size();
+	if (!num_slots || max_count <= 0)
+	{
+		return 0;
+	}
+
+	// Smaller changes do not move the priority past the 20% threshold.
+	const F32 MIN_STALE_SCORE = 0.1f;
+	mSlotScores.resize(num_slots);
+	mStaleSlots.clear();
+	const F32* now_sizes = &mSlotVirtualSize[0];
+	const F32* updated_sizes = &mSlotUpdatedSize[0];
+	F32* scores = &mSlotScores[0];
+	const __m128 one = _mm_set1_ps(1.f);
+	const __m128 min_score = _mm_set1_ps(MIN_STALE_SCORE);
+	for (S32 i = 0; i < num_slots; i += 4)
+	{
+		// |sqrt(now) - sqrt(updated)| / (max(sqrt(now), sqrt(updated)) + 1)
+		__m128 now = _mm_sqrt_ps(_mm_loadu_ps(now_sizes + i));
+		__m128 updated = _mm_sqrt_ps(_mm_loadu_ps(updated_sizes + i));
+		__m128 diff = _mm_max_ps(_mm_sub_ps(now, updated), _mm_sub_ps(updated, now));
+		__m128 scale = _mm_add_ps(_mm_max_ps(now, updated), one);
+		__m128 score = _mm_div_ps(diff, scale);
+		S32 stale = _mm_movemask_ps(_mm_cmpgt_ps(score, min_score));
+		if (stale)
+		{
+			_mm_storeu_ps(scores + i, score);
+			for (S32 lane = 0; lane < 4; ++lane)
 			{
-				removeImageFromList(imagep);
-				imagep->setDecodePriority(decode_priority);
-				addImageToList(imagep);
+				if (stale & (1 << lane))
+				{
+					mStaleSlots.push_back(i + lane);
+				}
 			}
 		}
 	}
+	if ((S32)mStaleSlots.size() > max_count)
+	{
+		std::nth_element(mStaleSlots.begin(), mStaleSlots.begin() + max_count, mStaleSlots.end(),
+						 [scores](S32 a, S32 b) { return scores[a] > scores[b]; });
+		mStaleSlots.resize(max_count);
+	}
+
+	const S32 min_refs = 3; // 1 for mImageList, 1 for mUUIDMap, 1 for local reference
+	S32 updated = 0;
+	for (std::vector<S32>::iterator iter = mStaleSlots.begin(); iter != mStaleSlots.end(); ++iter)
+	{
+		LLPointer<LLViewerFetchedTexture> imagep = mSlotTextures[*iter];
+		// Unused and deleted textures are left to the round robin.
+		if (imagep->getNumRefs() == min_refs || imagep->isDeleted() || imagep->isDeletionCandidate() ||
+			!imagep->isInImageList())
+		{
+			mSlotUpdatedSize[*iter] = mSlotVirtualSize[*iter];
+			continue;
+		}
+		updateImageDecodePriority(imagep);
+		++updated;
+	}
+	return updated;
+}
+
+void LLViewerTextureList::updateImageDecodePriority(LLViewerFetchedTexture *imagep)
+{
+	imagep->processTextureStats();
+	F32 old_priority = imagep->getDecodePriority();
+	F32 old_priority_test = llmax(old_priority, 0.0f);
+	F32 decode_priority = imagep->calcDecodePriority();
+	F32 decode_priority_test = llmax(decode_priority, 0.0f);
+	// Ignore < 20% difference
+	if ((decode_priority_test < old_priority_test * .8f) ||
+		(decode_priority_test > old_priority_test * 1.25f))
+	{
+		removeImageFromList(imagep);
+		imagep->setDecodePriority(decode_priority);
+		addImageToList(imagep);
+	}
+
+	// processTextureStats() may have clamped the size.
+	S32 slot = imagep->getPrioritySlot();
+	if (slot >= 0)
+	{
+		mSlotVirtualSize[slot] = mSlotUpdatedSize[slot] = imagep->getMaxVirtualSize();
+	}
 }
 
 /*
@@ -35,6 +35,7 @@
 #include "llui.h"
 #include <list>
 #include <set>
+#include <vector>
 
 const U32 LL_IMAGE_REZ_LOSSLESS_CUTOFF = 128;
 
@@ -128,6 +129,17 @@ private:
 	void addImageToList(LLViewerFetchedTexture *image);
 	void removeImageFromList(LLViewerFetchedTexture *image);
 
+	void allocPrioritySlot(LLViewerFetchedTexture *image);
+	void freePrioritySlot(LLViewerFetchedTexture *image);
+	S32  updateStalePriorities(S32 max_count);
+	void updateImageDecodePriority(LLViewerFetchedTexture *image);
+
+public:
+	// Called by textures in mUUIDMap whenever their max virtual size changes.
+	void setSlotVirtualSize(S32 slot, F32 size) { mSlotVirtualSize[slot] = size; }
+
+private:
+
 	LLViewerFetchedTexture * getImage(const LLUUID &image_id,									 
 									 FTType f_type = FTT_DEFAULT,
 									 BOOL usemipmap = TRUE,
@@ -193,6 +205,17 @@ private:
 	typedef std::set<LLPointer<LLViewerFetchedTexture>, LLViewerFetchedTexture::Compare> image_priority_list_t;	
 	image_priority_list_t mImageList;
 
+	// The decode priority input of every texture in mUUIDMap, one slot per
+	// texture, so the textures whose priority went stale are found in a single
+	// pass over these arrays instead of a walk over the textures. The arrays
+	// grow by four slots to keep the pass on whole SSE registers.
+	std::vector<F32> mSlotVirtualSize;		// current max virtual size
+	std::vector<F32> mSlotUpdatedSize;		// max virtual size at the last priority update
+	std::vector<LLViewerFetchedTexture*> mSlotTextures; // held by mUUIDMap
+	std::vector<S32> mFreeSlots;
+	std::vector<F32> mSlotScores;			// scratch for updateStalePriorities()
+	std::vector<S32> mStaleSlots;
+
 	// simply holds on to LLViewerFetchedTexture references to stop them from being purged too soon
 	std::set<LLPointer<LLViewerFetchedTexture> > mImagePreloads;
 
@@ -110,6 +110,7 @@
 #include "llimagebmp.h"
 #include "llimagej2c.h"
 #include "llimageworker.h"
+#include "lljobscheduler.h"
 #include "llkeyboard.h"
 #include "lllineeditor.h"
 #include "llmenugl.h"
@@ -169,6 +170,7 @@
 #include "llviewerstats.h"
 #include "llvoavatarself.h"
 #include "llvopartgroup.h"
+#include "llvolumebuildthread.h"
 #include "llvovolume.h"
 #include "llworld.h"
 #include "llworldmapview.h"
@@ -685,11 +687,43 @@ public:
 				addText(xpos, ypos, llformat("%d/%d Mesh LOD Pending/Processing", LLMeshRepository::sLODPending, LLMeshRepository::sLODProcessing));
 				ypos += y_inc;
 
+				const U32* depth = LLMeshRepoThread::sQueueDepth;
+				addText(xpos, ypos, llformat("%d/%d/%d Mesh Queue High/Normal/Low (%d Cancelled)", depth[LLMeshRepoThread::PRIORITY_HIGH],
+					depth[LLMeshRepoThread::PRIORITY_NORMAL], depth[LLMeshRepoThread::PRIORITY_LOW], LLMeshRepository::sCancelledRequests));
+				ypos += y_inc;
+
+				const F32* latency = LLMeshRepoThread::sQueueLatency;
+				addText(xpos, ypos, llformat("%.2f/%.2f/%.2f s Mesh Queue Latency High/Normal/Low", latency[LLMeshRepoThread::PRIORITY_HIGH],
+					latency[LLMeshRepoThread::PRIORITY_NORMAL], latency[LLMeshRepoThread::PRIORITY_LOW]));
+				ypos += y_inc;
+
 				addText(xpos, ypos, llformat("%.3f/%.3f MB Mesh Cache Read/Write ", LLMeshRepository::sCacheBytesRead/(1024.f*1024.f), LLMeshRepository::sCacheBytesWritten/(1024.f*1024.f)));
 
 				ypos += y_inc;
 			}
 
+			if (LLJobScheduler* scheduler = LLJobScheduler::getInstance())
+			{
+				addText(xpos, ypos, llformat("%d Job Scheduler Threads (%d Stolen Jobs)", scheduler->getThreadCount(), scheduler->getStolenJobs()));
+				ypos += y_inc;
+			}
+
+			LLQueuedThread* queues[] = { LLAppViewer::getTextureCache(), LLAppViewer::getImageDecodeThread(),
+										 LLAppViewer::getTextureFetch(), LLAppViewer::getVolumeBuildThread() };
+			const char* queue_names[] = { "Texture Cache", "Image Decode", "Texture Fetch", "Volume Build" };
+			for (U32 i = 0; i < LL_ARRAY_SIZE(queues); ++i)
+			{
+				if (queues[i])
+				{
+					F32 wait_time, run_time;
+					U32 processed;
+					queues[i]->getQueueStats(wait_time, run_time, processed);
+					addText(xpos, ypos, llformat("%.1f/%.1f ms %s Wait/Run (%d Pending, %d Done)", wait_time * 1000.f, run_time * 1000.f,
+						queue_names[i], queues[i]->getPending(), processed));
+					ypos += y_inc;
+				}
+			}
+
 			LLVertexBuffer::sBindCount = LLImageGL::sBindCount = 
 				LLVertexBuffer::sSetCount = LLImageGL::sUniqueCount =
 				gPipeline.mNumVisibleNodes = LLPipeline::sVisibleLightCount = 0;
@@ -110,6 +110,7 @@
 #include "floaterao.h"
 #include "llsdutil.h"
 
+#include "llskinningkernel.h"
 #include "llskinningutil.h"
 
 #include "llfloaterexploreanimations.h"
@@ -2141,7 +2142,7 @@ BOOL LLVOAvatar::lineSegmentIntersect(const LLVector4a& start, const LLVector4a&
 						LLDrawable* drawable = attached_object->mDrawable;
 						if (drawable->isState(LLDrawable::RIGGED))
 						{ //regenerate octree for rigged attachment
-							gPipeline.markRebuild(mDrawable, LLDrawable::REBUILD_RIGGED, TRUE);
+							gPipeline.markRebuild(drawable, LLDrawable::REBUILD_RIGGED, TRUE);
 						}
 					}
 				}
@@ -3700,6 +3701,7 @@ void LLVOAvatar::idleUpdateNameTagText(BOOL new_name)
 			{
 				// ...call this function back when the name arrives and force a rebuild
 				LLAvatarNameCache::get(getID(), boost::bind(&LLVOAvatar::clearNameTag, this));
+				LLAvatarNameCache::prioritize(getID());
 			}
 // [RLVa:KB] - Checked: 2010-10-31 (RLVa-1.2.2a) | Modified: RLVa-1.2.2a
 			else if (fRlvShowNames && !isSelf())
@@ -3726,6 +3728,7 @@ void LLVOAvatar::idleUpdateNameTagText(BOOL new_name)
 				// and force a rebuild
 				LLAvatarNameCache::get(getID(),
 					boost::bind(&LLVOAvatar::clearNameTag, this));
+				LLAvatarNameCache::prioritize(getID());
 			}
 
 // [RLVa:KB] - Checked: 2010-10-31 (RLVa-1.2.2a) | Modified: RLVa-1.2.2a
@@ -9762,6 +9765,8 @@ void LLVOAvatar::updateSoftwareSkinnedVertices(const LLMeshSkinInfo* skin, const
 
 	LLVector4a* norm = has_normal ? (LLVector4a*) normal.get() : NULL;
 
+	LL_RECORD_BLOCK_TIME(FTM_AVATAR_SKINNING);
+
 	//build matrix palette
 	LLMatrix4a mat[LL_MAX_JOINTS_PER_MESH_OBJECT];
 	U32 count = LLSkinningUtil::getMeshJointCount(skin);
@@ -9770,31 +9775,13 @@ void LLVOAvatar::updateSoftwareSkinnedVertices(const LLMeshSkinInfo* skin, const
 
 	LLMatrix4a bind_shape_matrix;
 	bind_shape_matrix.loadu(skin->mBindShapeMatrix);
+	LLSkinningKernel::premultiplyPalette(mat, count, bind_shape_matrix);
 
 	LLVector4a av_pos;
 	av_pos.load3(getPosition().mV);
 
-	const U32 max_joints = LLSkinningUtil::getMaxJointCount();
-	for (U32 j = 0; j < (U32)buffer->getNumVerts(); ++j)
-	{
-		LLMatrix4a final_mat;
-		LLSkinningUtil::getPerVertexSkinMatrix(weight[j].getF32ptr(), mat, false, final_mat, max_joints);
-
-		LLVector4a& v = vol_face.mPositions[j];
-
-		final_mat.mul(bind_shape_matrix);
-		final_mat.affineTransform(v, pos[j]);
-
-		pos[j].add(av_pos);
-
-		if (norm)
-		{
-			LLVector4a& n = vol_face.mNormals[j];
-			final_mat.invert();
-			final_mat.transpose();
-			final_mat.affineTransform(n, norm[j]);
-		}
-	}
+	LLSkinningKernel::skinPositionsNormals(mat, count, weight, vol_face.mPositions, norm ? vol_face.mNormals : NULL,
+										   pos, norm, buffer->getNumVerts(), av_pos);
 }
 
 U32 LLVOAvatar::getPartitionType() const
@@ -57,13 +57,35 @@ LLVOCacheEntry::LLVOCacheEntry(U32 local_id, U32 crc, LLDataPackerBinaryBuffer &
 	mCRC(crc),
 	mHitCount(0),
 	mDupeCount(0),
-	mCRCChangeCount(0)
+	mCRCChangeCount(0),
+	mDirty(TRUE),
+	mOnDisk(FALSE),
+	mCountsDirty(FALSE),
+	mRecordOffset(0)
 {
 	mBuffer = new U8[dp.getBufferSize()];
 	mDP.assignBuffer(mBuffer, dp.getBufferSize());
 	mDP = dp; //memcpy
 }
 
+LLVOCacheEntry::LLVOCacheEntry(U32 local_id, U32 crc, S32 hit_count, S32 dupe_count, S32 crc_change_count,
+							   LLMappedFileView* view, U8* data, S32 size, U32 record_offset)
+	:
+	mLocalID(local_id),
+	mCRC(crc),
+	mHitCount(hit_count),
+	mDupeCount(dupe_count),
+	mCRCChangeCount(crc_change_count),
+	mBuffer(NULL),
+	mMappedView(view),
+	mDirty(FALSE),
+	mOnDisk(TRUE),
+	mCountsDirty(FALSE),
+	mRecordOffset(record_offset)
+{
+	mDP.assignBuffer(data, size);
+}
+
 LLVOCacheEntry::LLVOCacheEntry()
 	:
 	mLocalID(0),
@@ -71,82 +93,35 @@ LLVOCacheEntry::LLVOCacheEntry()
 	mHitCount(0),
 	mDupeCount(0),
 	mCRCChangeCount(0),
-	mBuffer(NULL)
+	mBuffer(NULL),
+	mDirty(TRUE),
+	mOnDisk(FALSE),
+	mCountsDirty(FALSE),
+	mRecordOffset(0)
 {
 	mDP.assignBuffer(mBuffer, 0);
 }
 
-LLVOCacheEntry::LLVOCacheEntry(LLAPRFile* apr_file)
-	: mBuffer(NULL)
+LLVOCacheEntry::~LLVOCacheEntry()
 {
-	S32 size = -1;
-	BOOL success;
-
-	mDP.assignBuffer(mBuffer, 0);
-	success = check_read(apr_file, &mLocalID, sizeof(U32));
-	if(success)
-	{
-		success = check_read(apr_file, &mCRC, sizeof(U32));
-	}
-	if(success)
-	{
-		success = check_read(apr_file, &mHitCount, sizeof(S32));
-	}
-	if(success)
-	{
-		success = check_read(apr_file, &mDupeCount, sizeof(S32));
-	}
-	if(success)
-	{
-		success = check_read(apr_file, &mCRCChangeCount, sizeof(S32));
-	}
-	if(success)
-	{
-		success = check_read(apr_file, &size, sizeof(S32));
+	releaseBuffer();
+}
 
-	// Corruption in the cache entries
-	if ((size > 10000) || (size < 1))
-	{
-		// We've got a bogus size, skip reading it.
-		// We won't bother seeking, because the rest of this file
-		// is likely bogus, and will be tossed anyway.
-			LL_WARNS() << "Bogus cache entry, size " << size << ", aborting!" << LL_ENDL;
-			success = FALSE;
-		}
-	}
-	if(success && size > 0)
+void LLVOCacheEntry::releaseBuffer()
+{
+	if (mBuffer)
 	{
-		mBuffer = new U8[size];
-		success = check_read(apr_file, mBuffer, size);
-
-		if(success)
-		{
-			mDP.assignBuffer(mBuffer, size);
-		}
-		else
-		{
-			delete[] mBuffer ;
-			mBuffer = NULL ;
-		}
+		mDP.freeBuffer();
+		mBuffer = NULL;
 	}
-
-	if(!success)
+	else
 	{
-		mLocalID = 0;
-		mCRC = 0;
-		mHitCount = 0;
-		mDupeCount = 0;
-		mCRCChangeCount = 0;
-		mBuffer = NULL;
+		// Data points into the mapped cache file (or there is none).
+		mDP.assignBuffer(NULL, 0);
+		mMappedView = NULL;
 	}
 }
 
-LLVOCacheEntry::~LLVOCacheEntry()
-{
-	mDP.freeBuffer();
-}
-
-
 // New CRC means the object has changed.
 void LLVOCacheEntry::assignCRC(U32 crc, LLDataPackerBinaryBuffer &dp)
 {
@@ -156,8 +131,9 @@ void LLVOCacheEntry::assignCRC(U32 crc, LLDataPackerBinaryBuffer &dp)
 		mCRC = crc;
 		mHitCount = 0;
 		mCRCChangeCount++;
+		mDirty = TRUE;
 
-		mDP.freeBuffer();
+		releaseBuffer();
 		mBuffer = new U8[dp.getBufferSize()];
 		mDP.assignBuffer(mBuffer, dp.getBufferSize());
 		mDP = dp;
@@ -173,6 +149,7 @@ LLDataPackerBinaryBuffer *LLVOCacheEntry::getDP(U32 crc)
 		return NULL;
 	}
 	mHitCount++;
+	mCountsDirty = TRUE;
 	return &mDP;
 }
 
@@ -180,6 +157,7 @@ LLDataPackerBinaryBuffer *LLVOCacheEntry::getDP(U32 crc)
 void LLVOCacheEntry::recordHit()
 {
 	mHitCount++;
+	mCountsDirty = TRUE;
 }
 
 
@@ -190,54 +168,30 @@ void LLVOCacheEntry::dump() const
 		<< " hits " << mHitCount
 		<< " dupes " << mDupeCount
 		<< " change " << mCRCChangeCount
+		<< (mDirty ? " dirty" : "")
 		<< LL_ENDL;
 }
 
-BOOL LLVOCacheEntry::writeToFile(LLAPRFile* apr_file) const
-{
-	BOOL success;
-	success = check_write(apr_file, (void*)&mLocalID, sizeof(U32));
-	if(success)
-	{
-		success = check_write(apr_file, (void*)&mCRC, sizeof(U32));
-	}
-	if(success)
-	{
-		success = check_write(apr_file, (void*)&mHitCount, sizeof(S32));
-	}
-	if(success)
-	{
-		success = check_write(apr_file, (void*)&mDupeCount, sizeof(S32));
-	}
-	if(success)
-	{
-		success = check_write(apr_file, (void*)&mCRCChangeCount, sizeof(S32));
-	}
-	if(success)
-	{
-		S32 size = mDP.getBufferSize();
-		success = check_write(apr_file, (void*)&size, sizeof(S32));
-	
-		if(success)
-		{
-			success = check_write(apr_file, (void*)mBuffer, size);
-		}
-	}
-
-	return success ;
-}
-
 //-------------------------------------------------------------------
 //LLVOCache
 //-------------------------------------------------------------------
-// Format string used to construct filename for the object cache
-static const char OBJECT_CACHE_FILENAME[] = "objects_%d_%d.slc";
-
 const U32 MAX_NUM_OBJECT_ENTRIES = 128 ;
 const U32 MIN_ENTRIES_TO_PURGE = 16 ;
 const U32 INVALID_TIME = 0 ;
 const char* object_cache_dirname = "objectcache";
-const char* header_filename = "object.cache";
+const char* object_cache_filename = "objects.cache";
+// Files of the previous one-file-per-region format.
+const char* legacy_header_filename = "object.cache";
+const char* legacy_region_mask = "objects_*.slc";
+
+// Bump when the layout of the cache file changes.
+const U32 OBJECT_CACHE_FORMAT = 2;
+// Keep well clear of the S32 offsets used by LLAPRFile.
+const U32 MAX_OBJECT_CACHE_FILE_SIZE = 1024 * 1024 * 1024;
+// Don't bother compacting for less than this.
+const U32 MIN_DEAD_BYTES_TO_COMPACT = 16 * 1024 * 1024;
+// Same sanity limit as used for entries of the old format.
+const U32 MAX_OBJECT_DATA_SIZE = 10000;
 
 LLVOCache* LLVOCache::sInstance = NULL;
 
@@ -271,13 +225,23 @@ LLVOCache::LLVOCache():
 	mInitialized(FALSE),
 	mReadOnly(TRUE),
 	mNumEntries(0),
-	mCacheSize(1)
+	mCacheSize(1),
+	mThread(NULL)
 {
 	mEnabled = gSavedSettings.getBOOL("ObjectCacheEnabled");
+	mUsedEntryIndices.resize(MAX_NUM_OBJECT_ENTRIES, false);
 }
 
 LLVOCache::~LLVOCache()
 {
+	if(mThread)
+	{
+		// Let the pending writes finish.
+		mThread->waitForRequests();
+		mThread->shutdown();
+		delete mThread;
+		mThread = NULL;
+	}
 	if(mEnabled)
 	{
 		writeCacheHeader();
@@ -287,7 +251,7 @@ LLVOCache::~LLVOCache()
 
 void LLVOCache::setDirNames(ELLPath location)
 {
-	mHeaderFileName = gDirUtilp->getExpandedFilename(location, object_cache_dirname, header_filename);
+	mCacheFileName = gDirUtilp->getExpandedFilename(location, object_cache_dirname, object_cache_filename);
 	mObjectCacheDirName = gDirUtilp->getExpandedFilename(location, object_cache_dirname);
 }
 
@@ -327,10 +291,21 @@ void LLVOCache::initCache(ELLPath location, U32 size, U32 cache_version)
 			removeCache();
 		}
 	}	
+	else
+	{
+		// Nothing is mapped yet, this is the cheapest moment to reclaim space.
+		compactIfNeeded();
+	}
+
+	if(mEnabled && gSavedSettings.getBOOL("ObjectCacheThreaded"))
+	{
+		mThread = new LLVOCacheThread(this);
+	}
 }
 	
 void LLVOCache::removeCache(ELLPath location) 
 {
+	LLMutexLock lock(mMutex);
 	if(mReadOnly)
 	{
 		LL_WARNS() << "Not removing cache at " << location << ": Cache is currently in read-only mode." << LL_ENDL;
@@ -365,6 +340,19 @@ void LLVOCache::removeCache()
 	gDirUtilp->deleteFilesInDir(mObjectCacheDirName, mask); 
 
 	clearCacheInMemory() ;
+
+	mMetaInfo.mFormat = OBJECT_CACHE_FORMAT;
+	if (hasMappedViews())
+	{
+		// Where deleting a mapped file fails, the old data area must stay untouched.
+		mMetaInfo.mDataEnd = llmax(mMetaInfo.mDataEnd, getDataStart());
+		mMetaInfo.mDeadBytes = mMetaInfo.mDataEnd - getDataStart();
+	}
+	else
+	{
+		mMetaInfo.mDataEnd = getDataStart();
+		mMetaInfo.mDeadBytes = 0;
+	}
 	writeCacheHeader();
 }
 
@@ -394,6 +382,7 @@ void LLVOCache::removeEntry(HeaderEntryInfo* entry)
 
 void LLVOCache::removeEntry(U64 handle) 
 {
+	LLMutexLock lock(mMutex);
 	handle_entry_map_t::iterator iter = mHandleEntryMap.find(handle) ;
 	if(iter == mHandleEntryMap.end()) //no cache
 	{
@@ -415,18 +404,35 @@ void LLVOCache::clearCacheInMemory()
 		mHandleEntryMap.clear();
 		mNumEntries = 0 ;
 	}
-
+	mUsedEntryIndices.assign(MAX_NUM_OBJECT_ENTRIES, false);
 }
 
-void LLVOCache::getObjectCacheFilename(U64 handle, std::string& filename) 
+U32 LLVOCache::getDataStart() const
 {
-	U32 region_x, region_y;
+	return sizeof(HeaderMetaInfo) + MAX_NUM_OBJECT_ENTRIES * sizeof(HeaderEntryInfo);
+}
 
-	grid_from_region_handle(handle, &region_x, &region_y);
-	filename = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, object_cache_dirname,
-			   llformat(OBJECT_CACHE_FILENAME, region_x, region_y));
+S32 LLVOCache::allocateEntryIndex()
+{
+	for (S32 i = 0; i < (S32)MAX_NUM_OBJECT_ENTRIES; ++i)
+	{
+		if (!mUsedEntryIndices[i])
+		{
+			mUsedEntryIndices[i] = true;
+			return i;
+		}
+	}
+	return -1;
+}
 
-	return ;
+void LLVOCache::freeSegments(HeaderEntryInfo* entry)
+{
+	for (U32 i = 0; i < entry->mNumSegments; ++i)
+	{
+		mMetaInfo.mDeadBytes += entry->mSegments[i].mSize;
+	}
+	entry->mNumSegments = 0;
+	entry->mNumEntries = 0;
 }
 
 void LLVOCache::removeFromCache(HeaderEntryInfo* entry)
@@ -437,11 +443,11 @@ void LLVOCache::removeFromCache(HeaderEntryInfo* entry)
 		return ;
 	}
 
-	std::string filename;
-	getObjectCacheFilename(entry->mHandle, filename);
-	LLAPRFile::remove(filename);
+	freeSegments(entry);
 	entry->mTime = INVALID_TIME ;
 	updateEntry(entry) ; //update the head file.
+	updateMetaInfo();
+	mUsedEntryIndices[entry->mIndex] = false;
 }
 
 void LLVOCache::readCacheHeader()
@@ -456,19 +462,25 @@ void LLVOCache::readCacheHeader()
 	clearCacheInMemory();	
 
 	bool success = true ;
-	if (LLAPRFile::isExist(mHeaderFileName))
+	if (LLAPRFile::isExist(mCacheFileName))
 	{
-		LLAPRFile apr_file(mHeaderFileName, APR_READ|APR_BINARY);		
+		S32 file_size = 0;
+		LLAPRFile apr_file(mCacheFileName, APR_READ|APR_BINARY, &file_size);
 		
 		//read the meta element
 		success = check_read(&apr_file, &mMetaInfo, sizeof(HeaderMetaInfo)) ;
+		if(success && (mMetaInfo.mFormat != OBJECT_CACHE_FORMAT ||
+					   mMetaInfo.mDataEnd < getDataStart() || mMetaInfo.mDataEnd > (U32)file_size))
+		{
+			LL_WARNS() << "Object cache header is invalid or of an unknown format." << LL_ENDL;
+			success = false;
+		}
 		
 		if(success)
 		{
 			HeaderEntryInfo* entry = NULL ;
 			mNumEntries = 0 ;
-			U32 num_read = 0 ;
-			while(num_read++ < MAX_NUM_OBJECT_ENTRIES)
+			for(S32 index = 0; index < (S32)MAX_NUM_OBJECT_ENTRIES; ++index)
 			{
 				if(!entry)
 				{
@@ -478,9 +490,7 @@ void LLVOCache::readCacheHeader()
 								
 				if(!success) //failed
 				{
-					LL_WARNS() << "Error reading cache header entry. (entry_index=" << mNumEntries << ")" << LL_ENDL;
-					delete entry ;
-					entry = NULL ;
+					LL_WARNS() << "Error reading cache header entry. (entry_index=" << index << ")" << LL_ENDL;
 					break ;
 				}
 				else if(entry->mTime == INVALID_TIME)
@@ -488,30 +498,43 @@ void LLVOCache::readCacheHeader()
 					continue ; //an empty entry
 				}
 
-				entry->mIndex = mNumEntries++ ;
+				success = entry->mNumSegments <= MAX_NUM_SEGMENTS;
+				for(U32 i = 0; success && i < entry->mNumSegments; ++i)
+				{
+					const SegmentInfo& segment = entry->mSegments[i];
+					success = segment.mOffset >= getDataStart() && segment.mSize >= sizeof(SegmentHeader) &&
+							  segment.mOffset <= mMetaInfo.mDataEnd && segment.mSize <= mMetaInfo.mDataEnd - segment.mOffset;
+				}
+				if(!success)
+				{
+					LL_WARNS() << "Bogus cache header entry. (entry_index=" << index << ")" << LL_ENDL;
+					break;
+				}
+
+				entry->mIndex = index ;
+				mUsedEntryIndices[index] = true;
 				mHeaderEntryQueue.insert(entry) ;
 				mHandleEntryMap[entry->mHandle] = entry ;
 				entry = NULL ;
 			}
+			mNumEntries = mHandleEntryMap.size() ;
 			if(entry)
 			{
 				delete entry ;
 			}
 		}
-
-		//---------
-		//debug code
-		//----------
-		//std::string name ;
-		//for(header_entry_queue_t::iterator iter = mHeaderEntryQueue.begin() ; success && iter != mHeaderEntryQueue.end(); ++iter)
-		//{
-		//	getObjectCacheFilename((*iter)->mHandle, name) ;
-		//	LL_INFOS() << name << LL_ENDL ;
-		//}
-		//-----------
 	}
 	else
 	{
+		if (!mReadOnly)
+		{
+			// Clean up after the previous one-file-per-region format.
+			gDirUtilp->deleteFilesInDir(mObjectCacheDirName, legacy_region_mask);
+			LLFile::remove(gDirUtilp->add(mObjectCacheDirName, legacy_header_filename));
+		}
+		mMetaInfo.mFormat = OBJECT_CACHE_FORMAT;
+		mMetaInfo.mDataEnd = getDataStart();
+		mMetaInfo.mDeadBytes = 0;
 		writeCacheHeader() ;
 	}
 
@@ -543,32 +566,29 @@ void LLVOCache::writeCacheHeader()
 
 	bool success = true ;
 	{
-		LLAPRFile apr_file(mHeaderFileName, APR_CREATE|APR_WRITE|APR_BINARY);
+		// Never truncate: mapped segments may still refer to the data area.
+		LLAPRFile apr_file(mCacheFileName, APR_CREATE|APR_WRITE|APR_BINARY);
 
 		//write the meta element
 		success = check_write(&apr_file, &mMetaInfo, sizeof(HeaderMetaInfo)) ;
 
-
-		mNumEntries = 0 ;	
-		for(header_entry_queue_t::iterator iter = mHeaderEntryQueue.begin() ; success && iter != mHeaderEntryQueue.end(); ++iter)
+		//write all slots, empty ones included, so that the data area starts at a fixed offset.
+		std::vector<HeaderEntryInfo> slots(MAX_NUM_OBJECT_ENTRIES);
+		for(S32 i = 0; i < (S32)MAX_NUM_OBJECT_ENTRIES; ++i)
 		{
-			(*iter)->mIndex = mNumEntries++ ;
-			success = check_write(&apr_file, (void*)*iter, sizeof(HeaderEntryInfo));
+			slots[i].mIndex = i;
+			slots[i].mTime = INVALID_TIME;
 		}
-	
-		mNumEntries = mHeaderEntryQueue.size() ;
-		if(success && mNumEntries < MAX_NUM_OBJECT_ENTRIES)
+		for(header_entry_queue_t::iterator iter = mHeaderEntryQueue.begin() ; iter != mHeaderEntryQueue.end(); ++iter)
 		{
-			HeaderEntryInfo* entry = new HeaderEntryInfo() ;
-			entry->mTime = INVALID_TIME ;
-			for(S32 i = mNumEntries ; success && i < MAX_NUM_OBJECT_ENTRIES ; i++)
-			{
-				//fill the cache with the default entry.
-				success = check_write(&apr_file, entry, sizeof(HeaderEntryInfo)) ;			
-
-			}
-			delete entry ;
+			slots[(*iter)->mIndex] = **iter;
 		}
+		if(success)
+		{
+			success = check_write(&apr_file, &slots[0], MAX_NUM_OBJECT_ENTRIES * sizeof(HeaderEntryInfo));
+		}
+
+		mNumEntries = mHeaderEntryQueue.size() ;
 	}
 
 	if(!success)
@@ -581,12 +601,91 @@ void LLVOCache::writeCacheHeader()
 
 BOOL LLVOCache::updateEntry(const HeaderEntryInfo* entry)
 {
-	LLAPRFile apr_file(mHeaderFileName, APR_WRITE|APR_BINARY);
+	LLAPRFile apr_file(mCacheFileName, APR_WRITE|APR_BINARY);
 	apr_file.seek(APR_SET, entry->mIndex * sizeof(HeaderEntryInfo) + sizeof(HeaderMetaInfo)) ;
 
 	return check_write(&apr_file, (void*)entry, sizeof(HeaderEntryInfo)) ;
 }
 
+BOOL LLVOCache::updateMetaInfo()
+{
+	LLAPRFile apr_file(mCacheFileName, APR_WRITE|APR_BINARY);
+
+	return check_write(&apr_file, &mMetaInfo, sizeof(HeaderMetaInfo)) ;
+}
+
+BOOL LLVOCache::hasMappedViews()
+{
+	// Drop the views that are no longer referenced by any LLVOCacheEntry.
+	for (mapped_view_list_t::iterator iter = mMappedViews.begin(); iter != mMappedViews.end();)
+	{
+		if ((*iter)->getNumRefs() == 1)
+		{
+			iter = mMappedViews.erase(iter);
+		}
+		else
+		{
+			++iter;
+		}
+	}
+	return !mMappedViews.empty();
+}
+
+BOOL LLVOCache::readSegment(const SegmentInfo& segment, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map)
+{
+	LLPointer<LLMappedFileView> view = new LLMappedFileView(mCacheFileName, segment.mOffset, segment.mSize);
+	if (!view->isValid())
+	{
+		return FALSE;
+	}
+
+	U8* data = view->getData();
+	const SegmentHeader* header = (const SegmentHeader*)data;
+	if (header->mNumEntries > (segment.mSize - sizeof(SegmentHeader)) / sizeof(EntryRecord))
+	{
+		LL_WARNS() << "Bogus object cache segment, " << header->mNumEntries << " entries." << LL_ENDL;
+		return FALSE;
+	}
+
+	U32 index_end = sizeof(SegmentHeader) + header->mNumEntries * sizeof(EntryRecord);
+	const EntryRecord* records = (const EntryRecord*)(data + sizeof(SegmentHeader));
+	for (U32 i = 0; i < header->mNumEntries; ++i)
+	{
+		const EntryRecord& record = records[i];
+		// Corruption in the cache entries
+		if (!record.mLocalID || record.mDataSize < 1 || record.mDataSize > MAX_OBJECT_DATA_SIZE ||
+			record.mDataOffset < index_end || record.mDataOffset > segment.mSize ||
+			record.mDataSize > segment.mSize - record.mDataOffset)
+		{
+			LL_WARNS() << "Bogus cache entry, size " << record.mDataSize << ", aborting!" << LL_ENDL;
+			return FALSE;
+		}
+
+		LLVOCacheEntry* entry = new LLVOCacheEntry(record.mLocalID, record.mCRC, record.mHitCount, record.mDupeCount,
+												   record.mCRCChangeCount, view, data + record.mDataOffset, record.mDataSize,
+												   segment.mOffset + sizeof(SegmentHeader) + i * sizeof(EntryRecord));
+		LLVOCacheEntry*& slot = cache_entry_map[record.mLocalID];
+		delete slot;	// Superseded by a later segment.
+		slot = entry;
+	}
+
+	mMappedViews.push_back(view);
+	return TRUE;
+}
+
+BOOL LLVOCache::readSegments(HeaderEntryInfo* entry, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map)
+{
+	for(U32 i = 0; i < entry->mNumSegments; ++i)
+	{
+		if(!readSegment(entry->mSegments[i], cache_entry_map))
+		{
+			LL_WARNS() << "Aborting cache load for handle " << entry->mHandle << ", cache file corruption!" << LL_ENDL;
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
 void LLVOCache::readFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map) 
 {
 	if(!mEnabled)
@@ -596,6 +695,7 @@ void LLVOCache::readFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::voca
 	}
 	llassert_always(mInitialized);
 
+	LLMutexLock lock(mMutex);
 	handle_entry_map_t::iterator iter = mHandleEntryMap.find(handle) ;
 	if(iter == mHandleEntryMap.end()) //no cache
 	{
@@ -603,57 +703,133 @@ void LLVOCache::readFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::voca
 		return ;
 	}
 
+	HeaderEntryInfo* entry = iter->second;
 	bool success = true ;
+	if(entry->mCacheID != id)
 	{
-		std::string filename;
-		getObjectCacheFilename(handle, filename);
-		LLAPRFile apr_file(filename, APR_READ|APR_BINARY);
-	
-		LLUUID cache_id ;
-		success = check_read(&apr_file, cache_id.mData, UUID_BYTES) ;
-	
-		if(success)
-		{		
-			if(cache_id != id)
-			{
-				LL_INFOS() << "Cache ID doesn't match for this region, discarding"<< LL_ENDL;
-				success = false ;
-			}
-
-			if(success)
-			{
-				S32 num_entries;
-				success = check_read(&apr_file, &num_entries, sizeof(S32)) ;
-	
-				if(success)
-				{
-					for (S32 i = 0; i < num_entries; i++)
-					{
-						LLVOCacheEntry* entry = new LLVOCacheEntry(&apr_file);
-						if (!entry->getLocalID())
-						{
-							LL_WARNS() << "Aborting cache file load for " << filename << ", cache file corruption!" << LL_ENDL;
-							delete entry ;
-							success = false ;
-							break ;
-						}
-						cache_entry_map[entry->getLocalID()] = entry;
-					}
-				}
-			}
-		}		
+		LL_INFOS() << "Cache ID doesn't match for this region, discarding"<< LL_ENDL;
+		success = false ;
 	}
-	
+	else
+	{
+		success = readSegments(entry, cache_entry_map);
+	}
+
 	if(!success)
 	{
 		if(cache_entry_map.empty())
 		{
-			removeEntry(iter->second) ;
+			removeEntry(entry) ;
 		}
 	}
 
 	return ;
 }
+
+void LLVOCache::prefetchEntries(U64 handle, LLUUID& cache_id, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map) 
+{
+	if(!mEnabled)
+	{
+		return ;
+	}
+	llassert_always(mInitialized);
+
+	LLMutexLock lock(mMutex);
+	handle_entry_map_t::iterator iter = mHandleEntryMap.find(handle) ;
+	if(iter == mHandleEntryMap.end()) //no cache
+	{
+		return ;
+	}
+
+	HeaderEntryInfo* entry = iter->second;
+	cache_id = entry->mCacheID;
+	if(!readSegments(entry, cache_entry_map) && cache_entry_map.empty())
+	{
+		removeEntry(entry) ;
+	}
+}
+
+LLVOCache::handle_t LLVOCache::prefetchFromCache(U64 handle)
+{
+	if(!mThread)
+	{
+		return LLQueuedThread::nullHandle();
+	}
+	return mThread->prefetch(handle);
+}
+
+void LLVOCache::finishPrefetch(handle_t request, U64 handle, const LLUUID& id, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map)
+{
+	llassert_always(mThread && request != LLQueuedThread::nullHandle());
+
+	// Normally done long ago, since the prefetch was started when the region was created.
+	mThread->setPriority(request, LLQueuedThread::PRIORITY_URGENT);
+	if(!mThread->waitForResult(request, false))
+	{
+		return;
+	}
+
+	bool mismatch = false;
+	LLVOCacheThread::ReadRequest* req = (LLVOCacheThread::ReadRequest*)mThread->getRequest(request);
+	if(req)
+	{
+		LLVOCacheEntry::vocache_entry_map_t& entry_map = req->getEntryMap();
+		if(!entry_map.empty() && req->getCacheID() != id)
+		{
+			LL_INFOS() << "Cache ID doesn't match for this region, discarding"<< LL_ENDL;
+			mismatch = true;
+		}
+		else
+		{
+			for(LLVOCacheEntry::vocache_entry_map_t::iterator iter = entry_map.begin(); iter != entry_map.end(); ++iter)
+			{
+				if(!cache_entry_map.insert(*iter).second)
+				{
+					// The region already has something newer.
+					delete iter->second;
+				}
+			}
+			entry_map.clear();
+		}
+	}
+	// Deletes the request, and with it any entries that weren't taken.
+	mThread->completeRequest(request);
+
+	if(mismatch && cache_entry_map.empty())
+	{
+		removeEntry(handle);
+	}
+}
+
+void LLVOCache::abortPrefetch(handle_t request)
+{
+	if(!mThread || request == LLQueuedThread::nullHandle())
+	{
+		return;
+	}
+	mThread->abortRequest(request, true);
+	if(mThread->getRequestStatus(request) == LLQueuedThread::STATUS_COMPLETE)
+	{
+		// Finished before the abort flag could have any effect.
+		mThread->completeRequest(request);
+	}
+}
+
+void LLVOCache::flushToCache(U64 handle, const LLUUID& id, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map, BOOL dirty_cache)
+{
+	if(mThread)
+	{
+		mThread->flush(handle, id, cache_entry_map, dirty_cache);
+		return;
+	}
+
+	writeToCache(handle, id, cache_entry_map, dirty_cache);
+	for(LLVOCacheEntry::vocache_entry_map_t::iterator iter = cache_entry_map.begin(); iter != cache_entry_map.end(); ++iter)
+	{
+		delete iter->second;
+	}
+	cache_entry_map.clear();
+}
 	
 void LLVOCache::purgeEntries(U32 size)
 {
@@ -669,6 +845,79 @@ void LLVOCache::purgeEntries(U32 size)
 	mNumEntries = mHandleEntryMap.size() ;
 }
 
+BOOL LLVOCache::writeSegment(const std::vector<const LLVOCacheEntry*>& entries, SegmentInfo& segment)
+{
+	U32 num_entries = entries.size();
+	U32 size = sizeof(SegmentHeader) + num_entries * sizeof(EntryRecord);
+	for (U32 i = 0; i < num_entries; ++i)
+	{
+		size += entries[i]->getDataSize();
+	}
+	if (mMetaInfo.mDataEnd + size > MAX_OBJECT_CACHE_FILE_SIZE)
+	{
+		LL_WARNS() << "Object cache file is full." << LL_ENDL;
+		return FALSE;
+	}
+
+	// Assemble the whole segment so that it goes out in a single write.
+	std::vector<U8> buffer(size);
+	SegmentHeader* header = (SegmentHeader*)&buffer[0];
+	header->mNumEntries = num_entries;
+	header->mReserved = 0;
+	EntryRecord* records = (EntryRecord*)&buffer[sizeof(SegmentHeader)];
+	U32 data_offset = sizeof(SegmentHeader) + num_entries * sizeof(EntryRecord);
+	for (U32 i = 0; i < num_entries; ++i)
+	{
+		const LLVOCacheEntry* entry = entries[i];
+		EntryRecord& record = records[i];
+		record.mLocalID = entry->getLocalID();
+		record.mCRC = entry->getCRC();
+		record.mHitCount = entry->getHitCount();
+		record.mDupeCount = entry->getDupeCount();
+		record.mCRCChangeCount = entry->getCRCChangeCount();
+		record.mDataOffset = data_offset;
+		record.mDataSize = entry->getDataSize();
+		memcpy(&buffer[data_offset], entry->getData(), record.mDataSize);
+		data_offset += record.mDataSize;
+	}
+
+	{
+		LLAPRFile apr_file(mCacheFileName, APR_WRITE|APR_BINARY);
+		if (apr_file.seek(APR_SET, mMetaInfo.mDataEnd) != (S32)mMetaInfo.mDataEnd ||
+			!check_write(&apr_file, &buffer[0], size))
+		{
+			return FALSE;
+		}
+	}
+
+	segment.mOffset = mMetaInfo.mDataEnd;
+	segment.mSize = size;
+	mMetaInfo.mDataEnd += size;
+	return TRUE;
+}
+
+// The counts are statistics only, they are patched into the index records of
+// the existing segments rather than appending the unchanged objects again.
+BOOL LLVOCache::writeEntryCounts(const LLVOCacheEntry::vocache_entry_map_t& cache_entry_map)
+{
+	LLAPRFile apr_file(mCacheFileName, APR_WRITE|APR_BINARY);
+	for (LLVOCacheEntry::vocache_entry_map_t::const_iterator iter = cache_entry_map.begin(); iter != cache_entry_map.end(); ++iter)
+	{
+		const LLVOCacheEntry* entry = iter->second;
+		if (entry->isDirty() || !entry->hasDirtyCounts() || !entry->getRecordOffset())
+		{
+			continue;
+		}
+		S32 counts[2] = { entry->getHitCount(), entry->getDupeCount() };
+		S32 offset = entry->getRecordOffset() + offsetof(EntryRecord, mHitCount);
+		if (apr_file.seek(APR_SET, offset) != offset || !check_write(&apr_file, counts, sizeof(counts)))
+		{
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
 void LLVOCache::writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry::vocache_entry_map_t& cache_entry_map, BOOL dirty_cache) 
 {
 	if(!mEnabled)
@@ -684,6 +933,7 @@ void LLVOCache::writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry:
 		return ;
 	}	
 
+	LLMutexLock lock(mMutex);
 	HeaderEntryInfo* entry;
 	handle_entry_map_t::iterator iter = mHandleEntryMap.find(handle) ;
 	if(iter == mHandleEntryMap.end()) //new entry
@@ -696,9 +946,12 @@ void LLVOCache::writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry:
 		entry = new HeaderEntryInfo();
 		entry->mHandle = handle ;
 		entry->mTime = time(NULL) ;
-		entry->mIndex = mNumEntries++;
+		entry->mCacheID = id ;
+		entry->mIndex = allocateEntryIndex();
+		llassert_always(entry->mIndex >= 0);
 		mHeaderEntryQueue.insert(entry) ;
 		mHandleEntryMap[handle] = entry ;
+		mNumEntries = mHandleEntryMap.size() ;
 	}
 	else
 	{
@@ -712,47 +965,231 @@ void LLVOCache::writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry:
 		mHeaderEntryQueue.insert(entry) ;
 	}
 
+	if(!dirty_cache)
+	{
+		//update cache header
+		if(!updateEntry(entry))
+		{
+			LL_WARNS() << "Failed to update cache header index " << entry->mIndex << ". handle = " << handle << LL_ENDL;
+		}
+		LL_WARNS() << "Skipping write to cache for handle " << handle << ": cache not dirty" << LL_ENDL;
+		return ; //nothing changed, no need to update.
+	}
+
+	// Only the changed objects need to be appended, as long as every object
+	// that is on disk is still part of the region; otherwise the section is
+	// rewritten as a whole. The unchanged data is copied straight from the mapping.
+	U32 num_on_disk = 0;
+	for (LLVOCacheEntry::vocache_entry_map_t::const_iterator iter = cache_entry_map.begin(); iter != cache_entry_map.end(); ++iter)
+	{
+		if (iter->second->isOnDisk())
+		{
+			++num_on_disk;
+		}
+	}
+	bool append = entry->mCacheID == id && entry->mNumSegments > 0 && entry->mNumSegments < MAX_NUM_SEGMENTS &&
+				  num_on_disk == entry->mNumEntries;
+
+	std::vector<const LLVOCacheEntry*> entries;
+	entries.reserve(cache_entry_map.size());
+	for (LLVOCacheEntry::vocache_entry_map_t::const_iterator iter = cache_entry_map.begin(); iter != cache_entry_map.end(); ++iter)
+	{
+		if (!append || iter->second->isDirty())
+		{
+			entries.push_back(iter->second);
+		}
+	}
+
+	bool success = true ;
+	if (!entries.empty())
+	{
+		if (!append)
+		{
+			freeSegments(entry);
+		}
+
+		SegmentInfo segment;
+		success = writeSegment(entries, segment);
+		if (success)
+		{
+			entry->mSegments[entry->mNumSegments++] = segment;
+			entry->mNumEntries = cache_entry_map.size();
+			entry->mCacheID = id;
+		}
+	}
+
+	// The records of the unchanged objects are still those of the segments read.
+	if (success && append && !writeEntryCounts(cache_entry_map))
+	{
+		LL_WARNS() << "Failed to update object hit counts for handle " << handle << LL_ENDL;
+	}
+
 	//update cache header
-	if(!updateEntry(entry))
+	if(success && !(updateEntry(entry) && updateMetaInfo()))
 	{
 		LL_WARNS() << "Failed to update cache header index " << entry->mIndex << ". handle = " << handle << LL_ENDL;
-		return ; //update failed.
+		success = false ;
 	}
 
-	if(!dirty_cache)
+	if(!success)
 	{
-		LL_WARNS() << "Skipping write to cache for handle " << handle << ": cache not dirty" << LL_ENDL;
-		return ; //nothing changed, no need to update.
+		removeEntry(entry) ;
+		return ;
 	}
 
-	//write to cache file
-	bool success = true ;
+	compactIfNeeded();
+}
+
+void LLVOCache::compactIfNeeded()
+{
+	if (mReadOnly)
 	{
-		std::string filename;
-		getObjectCacheFilename(handle, filename);
-		LLAPRFile apr_file(filename, APR_CREATE|APR_WRITE|APR_BINARY);
-	
-		success = check_write(&apr_file, (void*)id.mData, UUID_BYTES) ;
+		return;
+	}
+	U32 live_bytes = mMetaInfo.mDataEnd - getDataStart() - mMetaInfo.mDeadBytes;
+	if (mMetaInfo.mDeadBytes < MIN_DEAD_BYTES_TO_COMPACT || mMetaInfo.mDeadBytes < live_bytes)
+	{
+		return;
+	}
+	if (hasMappedViews())
+	{
+		// The data area can't be moved while objects are decoded from it; try again later.
+		return;
+	}
 
-	
-		if(success)
+	LL_INFOS() << "Compacting object cache, reclaiming " << mMetaInfo.mDeadBytes << " bytes." << LL_ENDL;
+
+	// Copy all live segments, in order, to a new file and swap it in.
+	std::string temp_filename = mCacheFileName + ".tmp";
+	bool success = true;
+	U32 data_end = getDataStart();
+	{
+		LLAPRFile old_file(mCacheFileName, APR_READ|APR_BINARY);
+		LLAPRFile new_file(temp_filename, APR_CREATE|APR_WRITE|APR_TRUNCATE|APR_BINARY);
+		success = new_file.seek(APR_SET, data_end) == (S32)data_end;
+		std::vector<U8> buffer;
+		for (header_entry_queue_t::iterator iter = mHeaderEntryQueue.begin(); success && iter != mHeaderEntryQueue.end(); ++iter)
 		{
-			S32 num_entries = cache_entry_map.size() ;
-			success = check_write(&apr_file, &num_entries, sizeof(S32));
-	
-			for (LLVOCacheEntry::vocache_entry_map_t::const_iterator iter = cache_entry_map.begin(); success && iter != cache_entry_map.end(); ++iter)
+			HeaderEntryInfo* entry = *iter;
+			for (U32 i = 0; success && i < entry->mNumSegments; ++i)
 			{
-				success = iter->second->writeToFile(&apr_file) ;
+				SegmentInfo& segment = entry->mSegments[i];
+				buffer.resize(segment.mSize);
+				success = old_file.seek(APR_SET, segment.mOffset) == (S32)segment.mOffset &&
+						  check_read(&old_file, &buffer[0], segment.mSize) &&
+						  check_write(&new_file, &buffer[0], segment.mSize);
+				segment.mOffset = data_end;
+				data_end += segment.mSize;
 			}
 		}
 	}
 
-	if(!success)
+	if (success)
 	{
-		removeEntry(entry) ;
+		LLFile::remove(mCacheFileName);
+		success = LLFile::rename(temp_filename, mCacheFileName) == 0;
+	}
+	if (!success)
+	{
+		LL_WARNS() << "Failed to compact the object cache." << LL_ENDL;
+		LLFile::remove(temp_filename);
+		// The in-memory offsets were already moved; start over.
+		removeCache();
+		return;
+	}
 
+	mMetaInfo.mDataEnd = data_end;
+	mMetaInfo.mDeadBytes = 0;
+	writeCacheHeader();
+}
+
+//-------------------------------------------------------------------
+//LLVOCacheThread
+//-------------------------------------------------------------------
+
+LLVOCacheThread::LLVOCacheThread(LLVOCache* cache, bool threaded) :
+	LLQueuedThread("VOCache", threaded),
+	mCache(cache)
+{
+}
+
+LLVOCacheThread::handle_t LLVOCacheThread::prefetch(U64 region_handle)
+{
+	handle_t handle = generateHandle();
+	ReadRequest* req = new ReadRequest(mCache, handle, PRIORITY_NORMAL, region_handle);
+	if (!addRequest(req))
+	{
+		req->deleteRequest();
+		return nullHandle();
 	}
+	return handle;
+}
 
-	return ;
+void LLVOCacheThread::flush(U64 region_handle, const LLUUID& id, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map, BOOL dirty_cache)
+{
+	// Writes go before reads, so that a region that is re-entered right away reads back what was just written.
+	handle_t handle = generateHandle();
+	WriteRequest* req = new WriteRequest(mCache, handle, PRIORITY_HIGH, region_handle, id, cache_entry_map, dirty_cache);
+	if (!addRequest(req))
+	{
+		LL_WARNS() << "Object cache thread is shutting down, dropping cache for handle " << region_handle << LL_ENDL;
+		req->deleteRequest();
+	}
+}
+
+void LLVOCacheThread::waitForRequests()
+{
+	while (getPending() > 0 || !mIdleThread)
+	{
+		update(0);
+		ms_sleep(1);
+	}
+}
+
+//-------------------------------------------------------------------
+
+LLVOCacheThread::ReadRequest::ReadRequest(LLVOCache* cache, handle_t handle, U32 priority, U64 region_handle) :
+	QueuedRequest(handle, priority),
+	mCache(cache),
+	mRegionHandle(region_handle)
+{
+}
+
+LLVOCacheThread::ReadRequest::~ReadRequest()
+{
+	for (LLVOCacheEntry::vocache_entry_map_t::iterator iter = mEntryMap.begin(); iter != mEntryMap.end(); ++iter)
+	{
+		delete iter->second;
+	}
+}
+
+bool LLVOCacheThread::ReadRequest::processRequest()
+{
+	mCache->prefetchEntries(mRegionHandle, mCacheID, mEntryMap);
+	return true;
+}
+
+LLVOCacheThread::WriteRequest::WriteRequest(LLVOCache* cache, handle_t handle, U32 priority, U64 region_handle, const LLUUID& id,
+											LLVOCacheEntry::vocache_entry_map_t& cache_entry_map, BOOL dirty_cache) :
+	QueuedRequest(handle, priority, FLAG_AUTO_COMPLETE),
+	mCache(cache),
+	mRegionHandle(region_handle),
+	mCacheID(id),
+	mDirty(dirty_cache)
+{
+	mEntryMap.swap(cache_entry_map);
 }
 
+LLVOCacheThread::WriteRequest::~WriteRequest()
+{
+	for (LLVOCacheEntry::vocache_entry_map_t::iterator iter = mEntryMap.begin(); iter != mEntryMap.end(); ++iter)
+	{
+		delete iter->second;
+	}
+}
+
+bool LLVOCacheThread::WriteRequest::processRequest()
+{
+	mCache->writeToCache(mRegionHandle, mCacheID, mEntryMap, mDirty);
+	return true;
+}
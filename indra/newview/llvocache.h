@@ -36,6 +36,8 @@
 #include "lluuid.h"
 #include "lldatapacker.h"
 #include "lldir.h"
+#include "llmappedfile.h"
+#include "llqueuedthread.h"
 
 
 //---------------------------------------------------------------------------
@@ -46,25 +48,42 @@ class LLVOCacheEntry
 {
 public:
 	LLVOCacheEntry(U32 local_id, U32 crc, LLDataPackerBinaryBuffer &dp);
-	LLVOCacheEntry(LLAPRFile* apr_file);
+	// Entry whose data lives in a mapped section of the object cache file.
+	// The data is not copied; the entry keeps the view alive instead.
+	// record_offset is the file offset of its index record.
+	LLVOCacheEntry(U32 local_id, U32 crc, S32 hit_count, S32 dupe_count, S32 crc_change_count,
+				   LLMappedFileView* view, U8* data, S32 size, U32 record_offset);
 	LLVOCacheEntry();
 	~LLVOCacheEntry();
 
 	U32 getLocalID() const			{ return mLocalID; }
 	U32 getCRC() const				{ return mCRC; }
 	S32 getHitCount() const			{ return mHitCount; }
+	S32 getDupeCount() const		{ return mDupeCount; }
 	S32 getCRCChangeCount() const	{ return mCRCChangeCount; }
+	const U8* getData() const		{ return mDP.getBuffer(); }
+	S32 getDataSize() const			{ return mDP.getBufferSize(); }
+	// TRUE when the data changed since it was read from (or never was in) the object cache.
+	BOOL isDirty() const			{ return mDirty; }
+	// TRUE when this local id is present in the region's section of the object cache.
+	BOOL isOnDisk() const			{ return mOnDisk; }
+	// TRUE when the hit or dupe count of a clean entry changed since it was read.
+	BOOL hasDirtyCounts() const		{ return mCountsDirty; }
+	// File offset of the index record of a clean entry, 0 if there is none.
+	U32 getRecordOffset() const		{ return mRecordOffset; }
 
 	void dump() const;
-	BOOL writeToFile(LLAPRFile* apr_file) const;
 	void assignCRC(U32 crc, LLDataPackerBinaryBuffer &dp);
 	LLDataPackerBinaryBuffer *getDP(U32 crc);
 	void recordHit();
-	void recordDupe() { mDupeCount++; }
+	void recordDupe() { mDupeCount++; mCountsDirty = TRUE; }
 
 public:
 	typedef std::map<U32, LLVOCacheEntry*>	vocache_entry_map_t;
 
+private:
+	void releaseBuffer();
+
 protected:
 	U32							mLocalID;
 	U32							mCRC;
@@ -72,28 +91,146 @@ protected:
 	S32							mDupeCount;
 	S32							mCRCChangeCount;
 	LLDataPackerBinaryBuffer	mDP;
-	U8							*mBuffer;
+	U8							*mBuffer;		// Owned buffer, NULL when mDP points into mMappedView.
+	LLPointer<LLMappedFileView>	mMappedView;
+	BOOL						mDirty;
+	BOOL						mOnDisk;
+	BOOL						mCountsDirty;
+	U32							mRecordOffset;
+};
+
+class LLVOCache;
+
+//
+// Runs the file I/O of LLVOCache off the main thread: region caches are
+// prefetched as soon as the region handle is known, and written back
+// when the region goes away.
+//
+class LLVOCacheThread : public LLQueuedThread
+{
+public:
+	class ReadRequest : public QueuedRequest
+	{
+	protected:
+		/*virtual*/ ~ReadRequest(); // use deleteRequest()
+
+	public:
+		ReadRequest(LLVOCache* cache, handle_t handle, U32 priority, U64 region_handle);
+
+		const LLUUID& getCacheID() const							{ return mCacheID; }
+		LLVOCacheEntry::vocache_entry_map_t& getEntryMap()			{ return mEntryMap; }
+
+		/*virtual*/ bool processRequest();
+
+	private:
+		LLVOCache* mCache;
+		U64 mRegionHandle;
+		LLUUID mCacheID;
+		LLVOCacheEntry::vocache_entry_map_t mEntryMap;
+	};
+
+	class WriteRequest : public QueuedRequest
+	{
+	protected:
+		/*virtual*/ ~WriteRequest(); // use deleteRequest()
+
+	public:
+		// Takes over the entries of cache_entry_map, leaving it empty.
+		WriteRequest(LLVOCache* cache, handle_t handle, U32 priority, U64 region_handle, const LLUUID& id,
+					 LLVOCacheEntry::vocache_entry_map_t& cache_entry_map, BOOL dirty_cache);
+
+		/*virtual*/ bool processRequest();
+
+	private:
+		LLVOCache* mCache;
+		U64 mRegionHandle;
+		LLUUID mCacheID;
+		LLVOCacheEntry::vocache_entry_map_t mEntryMap;
+		BOOL mDirty;
+	};
+
+public:
+	LLVOCacheThread(LLVOCache* cache, bool threaded = true);
+
+	handle_t prefetch(U64 region_handle);
+	void flush(U64 region_handle, const LLUUID& id, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map, BOOL dirty_cache);
+	// Blocks until all queued requests are done.
+	void waitForRequests();
+
+private:
+	LLVOCache* mCache;
 };
 
 //
-//Note: LLVOCache is not thread-safe
+// LLVOCache serializes access to its state with a mutex, so that
+// LLVOCacheThread can do the actual reading and writing.
+//
+// All regions share one cache file. It starts with a HeaderMetaInfo, followed by
+// a fixed table of MAX_NUM_OBJECT_ENTRIES HeaderEntryInfo slots, one per cached
+// region, followed by the data area. A region's objects are stored in up to
+// MAX_NUM_SEGMENTS segments in the data area; each segment is a SegmentHeader,
+// an index of EntryRecords sorted by local id, and the packed object data.
+// Segments are only ever appended and their object data is never rewritten in
+// place, so that it can be used straight from a memory mapping for as long as
+// the region is alive. Later segments of a region override earlier ones.
+// The one exception are the hit and dupe counts of an EntryRecord, which
+// writeEntryCounts() updates in place for the objects that did not change.
+// They are statistics only: they are copied into the LLVOCacheEntry when a
+// segment is read and never read through a live view again, and a torn
+// write leaves every offset and size of the segment intact.
 //
 class LLVOCache
 {
 private:
+	enum
+	{
+		MAX_NUM_SEGMENTS = 4
+	};
+
+	struct SegmentInfo
+	{
+		SegmentInfo() : mOffset(0), mSize(0) {}
+		U32 mOffset;
+		U32 mSize;
+	};
+
 	struct HeaderEntryInfo
 	{
-		HeaderEntryInfo() : mIndex(0), mHandle(0), mTime(0) {}
+		HeaderEntryInfo() : mIndex(0), mHandle(0), mTime(0), mNumEntries(0), mNumSegments(0) {}
 		S32 mIndex;
 		U64 mHandle ;
 		U32 mTime ;
+		LLUUID mCacheID;
+		U32 mNumEntries;		// Number of distinct local ids over all segments.
+		U32 mNumSegments;
+		SegmentInfo mSegments[MAX_NUM_SEGMENTS];
 	};
 
 	struct HeaderMetaInfo
 	{
-		HeaderMetaInfo() : mVersion(0){}
+		HeaderMetaInfo() : mVersion(0), mFormat(0), mDataEnd(0), mDeadBytes(0) {}
 
 		U32 mVersion;
+		U32 mFormat;
+		U32 mDataEnd;			// End of the last segment; new segments are appended here.
+		U32 mDeadBytes;			// Bytes in the data area that are no longer referenced.
+	};
+
+	struct SegmentHeader
+	{
+		U32 mNumEntries;
+		U32 mReserved;
+	};
+
+	struct EntryRecord
+	{
+		U32 mLocalID;
+		U32 mCRC;
+		S32 mHitCount;
+		S32 mDupeCount;
+		S32 mCRCChangeCount;
+		U32 mDataOffset;		// Relative to the start of the segment.
+		U32 mDataSize;
 	};
 
 	struct header_entry_less
@@ -110,10 +247,13 @@ private:
 	};
 	typedef std::set<HeaderEntryInfo*, header_entry_less> header_entry_queue_t;
 	typedef std::map<U64, HeaderEntryInfo*> handle_entry_map_t;
+	typedef std::vector<LLPointer<LLMappedFileView> > mapped_view_list_t;
 private:
 	LLVOCache() ;
 
 public:
+	typedef LLQueuedThread::handle_t handle_t;
+
 	~LLVOCache() ;
 
 	void initCache(ELLPath location, U32 size, U32 cache_version) ;
@@ -123,12 +263,22 @@ public:
 	void writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry::vocache_entry_map_t& cache_entry_map, BOOL dirty_cache) ;
 	void removeEntry(U64 handle) ;
 
+	// Asynchronous versions of the above. When the cache thread is disabled,
+	// prefetchFromCache does nothing and flushToCache writes synchronously.
+	handle_t prefetchFromCache(U64 handle) ;
+	// Waits for the prefetch to finish if needed, and adds its entries to cache_entry_map if the cache id matches.
+	void finishPrefetch(handle_t request, U64 handle, const LLUUID& id, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map) ;
+	void abortPrefetch(handle_t request) ;
+	// Takes over (and eventually deletes) the entries of cache_entry_map.
+	void flushToCache(U64 handle, const LLUUID& id, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map, BOOL dirty_cache) ;
+
+	// Reads all entries of a region without checking the cache id; returns the cache id that is on disk.
+	void prefetchEntries(U64 handle, LLUUID& cache_id, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map) ;
+
 	void setReadOnly(BOOL read_only) {mReadOnly = read_only;} 
 
 private:
 	void setDirNames(ELLPath location);	
-	// determine the cache filename for the region from the region handle	
-	void getObjectCacheFilename(U64 handle, std::string& filename);
 	void removeFromCache(HeaderEntryInfo* entry);
 	void readCacheHeader();
 	void writeCacheHeader();
@@ -137,6 +287,16 @@ private:
 	void removeEntry(HeaderEntryInfo* entry) ;
 	void purgeEntries(U32 size);
 	BOOL updateEntry(const HeaderEntryInfo* entry);
+	BOOL updateMetaInfo();
+	S32  allocateEntryIndex();
+	U32  getDataStart() const;
+	void freeSegments(HeaderEntryInfo* entry);
+	BOOL readSegments(HeaderEntryInfo* entry, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map);
+	BOOL readSegment(const SegmentInfo& segment, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map);
+	BOOL writeSegment(const std::vector<const LLVOCacheEntry*>& entries, SegmentInfo& segment);
+	BOOL writeEntryCounts(const LLVOCacheEntry::vocache_entry_map_t& cache_entry_map);
+	BOOL hasMappedViews();
+	void compactIfNeeded();
 	
 private:
 	BOOL                 mEnabled;
@@ -145,10 +305,14 @@ private:
 	HeaderMetaInfo       mMetaInfo;
 	U32                  mCacheSize;
 	U32                  mNumEntries;
-	std::string          mHeaderFileName ;
+	std::string          mCacheFileName ;
 	std::string          mObjectCacheDirName;
 	header_entry_queue_t mHeaderEntryQueue;
 	handle_entry_map_t   mHandleEntryMap;	
+	std::vector<bool>    mUsedEntryIndices;
+	mapped_view_list_t   mMappedViews;		// Views handed out to LLVOCacheEntry objects.
+	LLMutex              mMutex;
+	LLVOCacheThread*     mThread;
 
 	static LLVOCache* sInstance ;
 public:
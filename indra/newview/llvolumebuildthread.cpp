@@ -0,0 +1,159 @@
+/**
+ * @file llvolumebuildthread.cpp
+ * @brief Generates shared prim volumes for LOD switches off the main thread.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "llvolumebuildthread.h"
+
+#include "llprimitive.h"
+#include "llviewerobjectlist.h"
+#include "llvolumemgr.h"
+#include "llvovolume.h"
+
+//----------------------------------------------------------------------------
+
+// MAIN THREAD
+LLVolumeBuildThread::LLVolumeBuildThread(bool threaded)
+	: LLQueuedThread("volumebuild", threaded, false, 1)
+{
+}
+
+//virtual
+LLVolumeBuildThread::~LLVolumeBuildThread()
+{
+	// Volumes built after the last notifyBuiltVolumes() were never shared.
+	for (built_list_t::iterator iter = mBuiltVolumes.begin(); iter != mBuiltVolumes.end(); ++iter)
+	{
+		iter->first->unref();
+	}
+	mBuiltVolumes.clear();
+}
+
+// MAIN THREAD
+bool LLVolumeBuildThread::buildVolume(const LLVolumeParams& params, S32 detail, const LLUUID& object_id)
+{
+	volume_key_t key(params, detail);
+	pending_map_t::iterator iter = mPendingVolumes.find(key);
+	if (iter == mPendingVolumes.end())
+	{
+		if (LLPrimitive::getVolumeManager()->hasVolume(params, detail))
+		{
+			return false;
+		}
+		BuildRequest* req = new BuildRequest(generateHandle(), params, detail, this);
+		if (!addRequest(req))
+		{
+			// Quitting
+			req->deleteRequest();
+			return false;
+		}
+		iter = mPendingVolumes.insert(std::make_pair(key, std::set<LLUUID>())).first;
+	}
+	iter->second.insert(object_id);
+	return true;
+}
+
+// WORKER THREAD
+void LLVolumeBuildThread::addBuiltVolume(LLVolume* volume, S32 detail)
+{
+	LLMutexLock lock(&mBuiltMutex);
+	mBuiltVolumes.push_back(std::make_pair(volume, detail));
+}
+
+// MAIN THREAD
+void LLVolumeBuildThread::notifyBuiltVolumes()
+{
+	built_list_t built;
+	{
+		LLMutexLock lock(&mBuiltMutex);
+		built.swap(mBuiltVolumes);
+	}
+
+	LLVolumeMgr* volume_manager = LLPrimitive::getVolumeManager();
+	for (built_list_t::iterator iter = built.begin(); iter != built.end(); ++iter)
+	{
+		LLVolume* volume = iter->first;
+		pending_map_t::iterator pending = mPendingVolumes.find(volume_key_t(volume->getParams(), iter->second));
+		// If no object uses these params anymore the group is gone and the
+		// volume is dropped, a later switch to it builds it again.
+		volume_manager->addVolume(volume, iter->second);
+		volume->unref(); // the reference taken in processRequest()
+
+		if (pending == mPendingVolumes.end())
+		{
+			continue;
+		}
+
+		for (std::set<LLUUID>::iterator obj_id = pending->second.begin(); obj_id != pending->second.end(); ++obj_id)
+		{
+			LLViewerObject* objectp = gObjectList.findObject(*obj_id);
+			if (objectp && !objectp->isDead() && objectp->getPCode() == LL_PCODE_VOLUME)
+			{
+				((LLVOVolume*)objectp)->notifyVolumeBuilt();
+			}
+		}
+		mPendingVolumes.erase(pending);
+	}
+}
+
+//----------------------------------------------------------------------------
+
+LLVolumeBuildThread::BuildRequest::BuildRequest(handle_t handle, const LLVolumeParams& params, S32 detail, LLVolumeBuildThread* owner)
+	: LLQueuedThread::QueuedRequest(handle, LLQueuedThread::PRIORITY_NORMAL, FLAG_AUTO_COMPLETE),
+	  mParams(params),
+	  mDetail(detail),
+	  mOwner(owner),
+	  mVolume(NULL)
+{
+}
+
+LLVolumeBuildThread::BuildRequest::~BuildRequest()
+{
+	if (mVolume)
+	{
+		mVolume->unref();
+	}
+}
+
+// WORKER THREAD
+bool LLVolumeBuildThread::BuildRequest::processRequest()
+{
+	// LLRefCount is not thread safe, the single reference taken here moves
+	// to the main thread with the pointer.
+	mVolume = new LLVolume(mParams, LLVolumeLODGroup::getVolumeScaleFromDetail(mDetail));
+	mVolume->ref();
+	return true;
+}
+
+// WORKER THREAD
+void LLVolumeBuildThread::BuildRequest::finishRequest(bool completed)
+{
+	if (completed && mVolume)
+	{
+		mOwner->addBuiltVolume(mVolume, mDetail);
+		mVolume = NULL;
+	}
+}
@@ -0,0 +1,86 @@
+/**
+ * @file llvolumebuildthread.h
+ * @brief Generates shared prim volumes for LOD switches off the main thread.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLVOLUMEBUILDTHREAD_H
+#define LL_LLVOLUMEBUILDTHREAD_H
+
+#include "llqueuedthread.h"
+#include "lluuid.h"
+#include "llvolume.h"
+
+#include <map>
+#include <set>
+#include <vector>
+
+// Builds the LLVolume of a LOD an object is switching to, so the path,
+// profile and volume faces are not generated on the main thread. The object
+// keeps its current LOD until notifyBuiltVolumes() hands the new volume to
+// LLVolumeMgr and rebuilds it.
+class LLVolumeBuildThread : public LLQueuedThread
+{
+	class BuildRequest : public LLQueuedThread::QueuedRequest
+	{
+	protected:
+		virtual ~BuildRequest(); // use deleteRequest()
+
+	public:
+		BuildRequest(handle_t handle, const LLVolumeParams& params, S32 detail, LLVolumeBuildThread* owner);
+
+		/*virtual*/ bool processRequest();
+		/*virtual*/ void finishRequest(bool completed);
+
+	private:
+		LLVolumeParams mParams;
+		S32 mDetail;
+		LLVolumeBuildThread* mOwner;
+		LLVolume* mVolume; // referenced until handed to mOwner
+	};
+
+public:
+	LLVolumeBuildThread(bool threaded = true);
+	virtual ~LLVolumeBuildThread();
+
+	// MAIN THREAD
+	// Returns true if the volume of params at detail is being built, object_id
+	// is then rebuilt when it is ready. Returns false if LLVolumeMgr has it.
+	bool buildVolume(const LLVolumeParams& params, S32 detail, const LLUUID& object_id);
+
+	// MAIN THREAD
+	void notifyBuiltVolumes();
+
+private:
+	void addBuiltVolume(LLVolume* volume, S32 detail);
+
+	typedef std::pair<LLVolumeParams, S32> volume_key_t;
+	typedef std::map<volume_key_t, std::set<LLUUID> > pending_map_t;
+	pending_map_t mPendingVolumes; // main thread only
+
+	typedef std::vector<std::pair<LLVolume*, S32> > built_list_t;
+	built_list_t mBuiltVolumes;
+	LLMutex mBuiltMutex;
+};
+
+#endif // LL_LLVOLUMEBUILDTHREAD_H
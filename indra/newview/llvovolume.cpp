@@ -61,6 +61,7 @@
 #include "llspatialpartition.h"
 #include "llhudmanager.h"
 #include "llflexibleobject.h"
+#include "llskinningkernel.h"
 #include "llskinningutil.h"
 #include "llsky.h"
 #include "lltexturefetch.h"
@@ -78,6 +79,8 @@
 #include "llmediaentry.h"
 #include "llmediadataclient.h"
 #include "llmeshrepository.h"
+#include "llappviewer.h"
+#include "llvolumebuildthread.h"
 #include "llagent.h"
 #include "llviewermediafocus.h"
 #include "lldatapacker.h"
@@ -1013,6 +1016,18 @@ BOOL LLVOVolume::setVolume(const LLVolumeParams &params_in, const S32 detail, bo
 
 	}
 
+	// A LOD switch of a shared prim volume keeps the current LOD while the
+	// volume build thread generates the new one, see notifyVolumeBuilt().
+	if (lod != last_lod && last_lod >= 0 && !mVolumeImpl && !isSculpted() && !mSculptChanged
+		&& mDrawable.notNull() && volume_params == mVolumep->getParams())
+	{
+		LLVolumeBuildThread* build_thread = LLAppViewer::getVolumeBuildThread();
+		if (build_thread && build_thread->buildVolume(volume_params, lod, getID()))
+		{
+			lod = last_lod;
+		}
+	}
+
 	if ((LLPrimitive::setVolume(volume_params, lod, (mVolumeImpl && mVolumeImpl->isVolumeUnique()))) || mSculptChanged)
 	{
 		mFaceMappingChanged = TRUE;
@@ -1119,6 +1134,16 @@ void LLVOVolume::notifyMeshLoaded()
 	gPipeline.markRebuild(mDrawable, LLDrawable::REBUILD_GEOMETRY, TRUE);
 }
 
+void LLVOVolume::notifyVolumeBuilt()
+{
+	if (mDrawable.notNull())
+	{
+		// lodOrSculptChanged() now finds the volume of mLOD in the volume manager.
+		mLODChanged = TRUE;
+		gPipeline.markRebuild(mDrawable, LLDrawable::REBUILD_VOLUME, FALSE);
+	}
+}
+
 // sculpt replaces generate() for sculpted surfaces
 void LLVOVolume::sculpt()
 {	
@@ -4033,7 +4058,22 @@ void LLVOVolume::clearRiggedVolume()
 	}
 }
 
+static LLTrace::BlockTimerStatHandle FTM_SKIN_RIGGED("Skin");
+static LLTrace::BlockTimerStatHandle FTM_RIGGED_OCTREE("Octree");
+
 void LLVOVolume::updateRiggedVolume(bool force_update)
+{
+	if (queueRiggedVolumeUpdate(force_update))
+	{
+		{
+			LL_RECORD_BLOCK_TIME(FTM_SKIN_RIGGED);
+			LLSkinningUtil::finishSkinning();
+		}
+		finishRiggedVolumeUpdate();
+	}
+}
+
+bool LLVOVolume::queueRiggedVolumeUpdate(bool force_update)
 {
 	//Update mRiggedVolume to match current animation frame of avatar. 
 	//Also update position/size in octree.  
@@ -4042,7 +4082,7 @@ void LLVOVolume::updateRiggedVolume(bool force_update)
 	{
 		clearRiggedVolume();
 		
-		return;
+		return false;
 	}
 
 	LLVolume* volume = getVolume();
@@ -4052,7 +4092,7 @@ void LLVOVolume::updateRiggedVolume(bool force_update)
 	if (!skin)
 	{
 		clearRiggedVolume();
-		return;
+		return false;
 	}
 
 	LLVOAvatar* avatar = getAvatar();
@@ -4060,7 +4100,7 @@ void LLVOVolume::updateRiggedVolume(bool force_update)
 	if (!avatar)
 	{
 		clearRiggedVolume();
-		return;
+		return false;
 	}
 
 	if (!mRiggedVolume)
@@ -4070,15 +4110,21 @@ void LLVOVolume::updateRiggedVolume(bool force_update)
 		updateRelativeXform();
 	}
 
-	mRiggedVolume->update(skin, avatar, volume);
-
+	return mRiggedVolume->queueUpdate(skin, avatar, volume);
 }
 
-static LLTrace::BlockTimerStatHandle FTM_SKIN_RIGGED("Skin");
-static LLTrace::BlockTimerStatHandle FTM_RIGGED_OCTREE("Octree");
+void LLVOVolume::finishRiggedVolumeUpdate()
+{
+	if (mRiggedVolume.notNull())
+	{
+		mRiggedVolume->finishUpdate();
+	}
+}
 
-void LLRiggedVolume::update(const LLMeshSkinInfo* skin, LLVOAvatar* avatar, const LLVolume* volume)
+bool LLRiggedVolume::queueUpdate(const LLMeshSkinInfo* skin, LLVOAvatar* avatar, const LLVolume* volume)
 {
+	LL_RECORD_BLOCK_TIME(FTM_AVATAR_SKINNING);
+
 	bool copy = false;
 	if (volume->getNumVolumeFaces() != getNumVolumeFaces())
 	{ 
@@ -4102,16 +4148,24 @@ void LLRiggedVolume::update(const LLMeshSkinInfo* skin, LLVOAvatar* avatar, cons
 		copyVolumeFaces(volume);	
 	}
 
-	//build matrix palette
-	static const size_t kMaxJoints = LL_MAX_JOINTS_PER_MESH_OBJECT;
-
-	LLMatrix4a mat[kMaxJoints];
+	//build matrix palette, with the bind shape matrix applied so that the
+	//skinning kernel needs one transform per joint and vertex
 	U32 maxJoints = LLSkinningUtil::getMeshJointCount(skin);
-	LLSkinningUtil::initSkinningMatrixPalette(mat, maxJoints, skin, avatar, true);
+	mPalette.resize(maxJoints);
+	if (!maxJoints)
+	{
+		return false;
+	}
+	LLSkinningUtil::initSkinningMatrixPalette(&mPalette[0], maxJoints, skin, avatar, true);
+
+	LLMatrix4a bind_shape_matrix;
+	bind_shape_matrix.loadu(skin->mBindShapeMatrix);
+	LLSkinningKernel::premultiplyPalette(&mPalette[0], maxJoints, bind_shape_matrix);
 
 	LLVector4a av_pos;
 	av_pos.load3(avatar->getPosition().mV);
 
+	mSkinnedFaces.clear();
 	for (S32 i = 0; i < volume->getNumVolumeFaces(); ++i)
 	{
 		const LLVolumeFace& vol_face = volume->getVolumeFace(i);
@@ -4125,47 +4179,30 @@ void LLRiggedVolume::update(const LLMeshSkinInfo* skin, LLVOAvatar* avatar, cons
 			continue;
 		}
 		LLSkinningUtil::checkSkinWeights(weight, dst_face.mNumVertices, skin);
-		LLMatrix4a bind_shape_matrix;
-		bind_shape_matrix.loadu(skin->mBindShapeMatrix);
 
 		LLVector4a* pos = dst_face.mPositions;
 
-		if( pos && dst_face.mExtents )
+		if( pos && dst_face.mExtents && dst_face.mNumVertices > 0)
 		{
-			LL_RECORD_BLOCK_TIME(FTM_SKIN_RIGGED);
-
-			U32 max_joints = LLSkinningUtil::getMaxJointCount();
-			for (U32 j = 0; j < (U32)dst_face.mNumVertices; ++j)
-			{
-				LLMatrix4a final_mat;
-				LLSkinningUtil::getPerVertexSkinMatrix(weight[j].getF32ptr(), mat, false, final_mat, max_joints);
-				
-				LLVector4a& v = vol_face.mPositions[j];
-				LLVector4a t;
-				LLVector4a dst;
-				bind_shape_matrix.affineTransform(v, t);
-				final_mat.affineTransform(t, dst);
-				pos[j] = dst;
-
-				pos[j].add(av_pos);
-			}
-
-			//update bounding box
-			LLVector4a& min = dst_face.mExtents[0];
-			LLVector4a& max = dst_face.mExtents[1];
+			LLSkinningUtil::queueSkinning(&mPalette[0], maxJoints, weight, vol_face.mPositions, pos,
+										  dst_face.mNumVertices, av_pos, dst_face.mExtents);
+		}
+		mSkinnedFaces.push_back(i);
+	}
 
-			min = pos[0];
-			max = pos[1];
+	return !mSkinnedFaces.empty();
+}
 
-			for (U32 j = 1; j < (U32)dst_face.mNumVertices; ++j)
-			{
-				min.setMin(min, pos[j]);
-				max.setMax(max, pos[j]);
-			}
+void LLRiggedVolume::finishUpdate()
+{
+	for (U32 i = 0; i < mSkinnedFaces.size(); ++i)
+	{
+		LLVolumeFace& dst_face = mVolumeFaces[mSkinnedFaces[i]];
 
+		if (dst_face.mPositions && dst_face.mExtents && dst_face.mNumVertices > 0)
+		{
 			dst_face.mCenter->setAdd(dst_face.mExtents[0], dst_face.mExtents[1]);
 			dst_face.mCenter->mul(0.5f);
-
 		}
 
 		{
@@ -4173,10 +4210,6 @@ void LLRiggedVolume::update(const LLMeshSkinInfo* skin, LLVOAvatar* avatar, cons
 			delete dst_face.mOctree;
 			dst_face.mOctree = NULL;
 
-			LLVector4a size;
-			size.setSub(dst_face.mExtents[1], dst_face.mExtents[0]);
-			size.splat(size.getLength3().getF32()*0.5f);
-			
 			dst_face.createOctree(1.f);
 		}
 	}
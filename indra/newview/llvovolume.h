@@ -40,6 +40,8 @@
 #include "llapr.h"
 #include "m3math.h"		// LLMatrix3
 #include "m4math.h"		// LLMatrix4
+#include "llalignedarray.h"
+#include "llmatrix4a.h"
 #include <map>
 
 class LLViewerTextureAnim;
@@ -67,7 +69,19 @@ public:
 	{
 	}
 
-	void update(const LLMeshSkinInfo* skin, LLVOAvatar* avatar, const LLVolume* src_volume);
+	// Skins src_volume into this volume in two steps, so that the faces of
+	// many rigged volumes can be skinned on the skinning pool at once.
+	// queueUpdate() returns false if
+	// there is nothing to skin, otherwise finishUpdate() must be called after
+	// LLSkinningUtil::finishSkinning(). src_volume must not change in between.
+	bool queueUpdate(const LLMeshSkinInfo* skin, LLVOAvatar* avatar, const LLVolume* src_volume);
+	void finishUpdate();
+
+private:
+	// Joint matrices of the last queueUpdate(), bind shape included.
+	LLAlignedArray<LLMatrix4a, 64> mPalette;
+	// Faces the last queueUpdate() skinned.
+	std::vector<S32> mSkinnedFaces;
 };
 
 // Base class for implementations of the volume - Primitive, Flexible Object, etc.
@@ -318,6 +332,7 @@ public:
 	void setSculptChanged(BOOL has_changed) { mSculptChanged = has_changed; }
 
 	void notifyMeshLoaded();
+	void notifyVolumeBuilt();
 	
 	// Returns 'true' iff the media data for this object is in flight
 	bool isMediaDataBeingFetched() const;
@@ -332,6 +347,10 @@ public:
 
 	//rigged volume update (for raycasting)
 	void updateRiggedVolume(bool force_update = false);
+	// updateRiggedVolume() in two steps (see LLRiggedVolume::queueUpdate()).
+	// Used by LLPipeline::updateGeom() for the REBUILD_RIGGED drawables.
+	bool queueRiggedVolumeUpdate(bool force_update = false);
+	void finishRiggedVolumeUpdate();
 	LLRiggedVolume* getRiggedVolume();
 
 	//returns true if volume should be treated as a rigged volume
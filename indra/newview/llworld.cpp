@@ -240,6 +240,9 @@ LLViewerRegion* LLWorld::addRegion(const U64 &region_handle, const LLHost &host)
 	mActiveRegionList.push_back(regionp);
 	mCulledRegionList.push_back(regionp);
 
+	// Start reading the object cache now, it's needed as soon as the handshake arrives.
+	regionp->prefetchObjectCache();
+
 
 	// Find all the adjacent regions, and attach them.
 	// Generate handles for all of the adjacent regions, and attach them in the correct way.
@@ -41,6 +41,7 @@
 #include "llviewercontrol.h"
 #include "llfasttimer.h"
 #include "llfontgl.h"
+#include "lljobpool.h"
 #include "llmemory.h"
 #include "llnamevalue.h"
 #include "llpointer.h"
@@ -75,8 +76,10 @@
 #include "llhudtext.h"
 #include "lllightconstants.h"
 #include "llmeshrepository.h"
+#include "llvolumebuildthread.h"
 #include "llresmgr.h"
 #include "llselectmgr.h"
+#include "llskinningutil.h"
 #include "llsky.h"
 #include "lltracker.h"
 #include "lltool.h"
@@ -156,6 +159,7 @@ const U32 NOISE_MAP_RES = 256;
 const U32 AUX_VB_MASK = LLVertexBuffer::MAP_VERTEX | LLVertexBuffer::MAP_TEXCOORD0 | LLVertexBuffer::MAP_TEXCOORD1;
 // Max number of occluders to search for. JC
 const S32 MAX_OCCLUDER_COUNT = 2;
+const U32 MAX_CULL_THREADS = 4;
 
 extern S32 gBoxFrame;
 //extern BOOL gHideSelectedObjects;
@@ -353,6 +357,7 @@ LLPipeline::LLPipeline() :
 	mMeanBatchSize(0),
 	mTrianglesDrawn(0),
 	mNumVisibleNodes(0),
+	mCullThreads(NULL),
 	mInitialized(FALSE),
 	mTransformFeedbackPrimitives(0),
 	mRenderDebugFeatureMask(0),
@@ -399,6 +404,12 @@ void LLPipeline::init()
 	sRenderAttachedLights = gSavedSettings.getBOOL("RenderAttachedLights");
 	sRenderAttachedParticles = gSavedSettings.getBOOL("RenderAttachedParticles");
 
+	U32 cull_threads = llmin(gSavedSettings.getU32("RenderCullThreads"), LLJobPool::getDefaultThreadCount(0, MAX_CULL_THREADS));
+	if (cull_threads)
+	{
+		mCullThreads = new LLJobPool("cull", cull_threads);
+	}
+
 	mInitialized = TRUE;
 	
 	stop_glerror();
@@ -560,6 +571,9 @@ void LLPipeline::cleanup()
 	mAuxScreenRectVB = NULL;
 
 	mCubeVB = NULL;
+
+	delete mCullThreads;
+	mCullThreads = NULL;
 }
 
 //============================================================================
@@ -2204,6 +2218,74 @@ BOOL LLPipeline::getVisibleExtents(LLCamera& camera, LLVector3& min, LLVector3&
 }
 
 static LLTrace::BlockTimerStatHandle FTM_CULL("Object Culling");
+static LLTrace::BlockTimerStatHandle FTM_PRECULL("Frustum Precull");
+
+namespace
+{
+	// One partition's frustum checks, see LLSpatialPartition::precull().
+	struct PrecullJob
+	{
+		LLSpatialPartition* mPartition;
+		const LLCamera* mCamera;
+		S32 mWaterClip;
+		F32 mWaterHeight;
+	};
+
+	typedef std::vector<PrecullJob> precull_job_list_t;
+
+	void precull_partition(void* data, U32 index)
+	{
+		const PrecullJob& job = (*(precull_job_list_t*)data)[index];
+		//every job gets its own camera for the user clip plane of its region
+		LLCamera camera(*job.mCamera);
+		if (job.mWaterClip != 0)
+		{
+			LLPlane plane(LLVector3(0,0, (F32) -job.mWaterClip), (F32) job.mWaterClip*job.mWaterHeight);
+			camera.setUserClipPlane(plane);
+		}
+		else
+		{
+			camera.disableUserClipPlane();
+		}
+		job.mPartition->precull(camera);
+	}
+}
+
+void LLPipeline::precull(LLCamera& camera, S32 water_clip)
+{
+	LL_RECORD_BLOCK_TIME(FTM_PRECULL);
+
+	static precull_job_list_t jobs;
+	jobs.clear();
+
+	for (LLWorld::region_list_t::const_iterator iter = LLWorld::getInstance()->getRegionList().begin(); 
+			iter != LLWorld::getInstance()->getRegionList().end(); ++iter)
+	{
+		LLViewerRegion* region = *iter;
+		for (U32 i = 0; i < LLViewerRegion::NUM_PARTITIONS; i++)
+		{
+			LLSpatialPartition* part = region->getSpatialPartition(i);
+			if (part && hasRenderType(part->mDrawableType))
+			{
+				//rebound() records a fast timer, keep it on this thread
+				part->rebound();
+
+				PrecullJob job;
+				job.mPartition = part;
+				job.mCamera = &camera;
+				job.mWaterClip = water_clip;
+				job.mWaterHeight = region->getWaterHeight();
+				jobs.push_back(job);
+			}
+		}
+	}
+
+	//a single partition is not worth waking the pool, cull() checks it itself
+	if (jobs.size() > 1)
+	{
+		mCullThreads->run(precull_partition, &jobs, jobs.size());
+	}
+}
 
 void LLPipeline::updateCull(LLCamera& camera, LLCullResult& result, S32 water_clip, LLPlane* planep)
 {
@@ -2292,6 +2374,14 @@ void LLPipeline::updateCull(LLCamera& camera, LLCullResult& result, S32 water_cl
 		}
 		mCubeVB->setBuffer(LLVertexBuffer::MAP_VERTEX);
 	}
+
+	//frustum check the partitions on the cull threads first, the loop below
+	//then only does occlusion and the cull result in the usual order
+	++LLSpatialPartition::sCullPass;
+	if (mCullThreads)
+	{
+		precull(camera, water_clip);
+	}
 	
 	for (LLWorld::region_list_t::const_iterator iter = LLWorld::getInstance()->getRegionList().begin(); 
 			iter != LLWorld::getInstance()->getRegionList().end(); ++iter)
@@ -2320,6 +2410,8 @@ void LLPipeline::updateCull(LLCamera& camera, LLCullResult& result, S32 water_cl
 		}
 	}
 
+	++LLSpatialPartition::sCullPass;
+
 	if (bound_shader)
 	{
 		gOcclusionCubeProgram.unbind();
@@ -2550,6 +2642,89 @@ BOOL LLPipeline::updateDrawableGeom(LLDrawable* drawablep, BOOL priority)
 	return update_complete;
 }
 
+static LLTrace::BlockTimerStatHandle FTM_UPDATE_RIGGED_GEOM("Update Rigged Geom");
+
+// Number of drawables updateGeom() rebuilds from mBuildQ2 no matter how long
+// it takes.
+static S32 get_build_q2_min_count(S32 size)
+{
+	S32 min_count = 16;
+	if (size > 1024)
+	{
+		min_count = llclamp((S32) (size * (F32) size/4096), 16, size);
+	}
+	return min_count;
+}
+
+// Skins the REBUILD_RIGGED volumes of the build queues together, so that
+// their faces are spread over the skinning pool instead of being skinned one
+// volume at a time in LLVOVolume::updateGeometry(). Everything is joined here,
+// before updateGeom() goes on and long before rebuildGroups().
+// Of mBuildQ2 only the drawables updateGeom() rebuilds regardless of its time
+// budget are skinned here, the ones it may reach after that are skinned in
+// updateGeometry() as before.
+void LLPipeline::updateRiggedGeom()
+{
+	LL_RECORD_BLOCK_TIME(FTM_UPDATE_RIGGED_GEOM);
+
+	std::vector<LLVOVolume*> queued;
+	for (LLDrawable::drawable_list_t::iterator iter = mBuildQ1.begin(); iter != mBuildQ1.end(); ++iter)
+	{
+		queueRiggedGeom(*iter, queued);
+	}
+
+	// Drawables in both queues are handled with mBuildQ1, updateGeom() takes
+	// them out of mBuildQ2 before it goes through it.
+	S32 size = 0;
+	for (LLDrawable::drawable_list_t::iterator iter = mBuildQ2.begin(); iter != mBuildQ2.end(); ++iter)
+	{
+		if (!(*iter)->isState(LLDrawable::IN_REBUILD_Q1))
+		{
+			++size;
+		}
+	}
+
+	// updateGeom() stops after more than min_count live drawables at the earliest.
+	S32 count = get_build_q2_min_count(size) + 1;
+	for (LLDrawable::drawable_list_t::iterator iter = mBuildQ2.begin(); iter != mBuildQ2.end() && count > 0; ++iter)
+	{
+		LLDrawable* drawablep = *iter;
+		if (drawablep->isDead() || drawablep->isState(LLDrawable::IN_REBUILD_Q1))
+		{
+			continue;
+		}
+		--count;
+		queueRiggedGeom(drawablep, queued);
+	}
+
+	if (queued.empty())
+	{
+		return;
+	}
+
+	LLSkinningUtil::finishSkinning();
+
+	for (std::vector<LLVOVolume*>::iterator iter = queued.begin(); iter != queued.end(); ++iter)
+	{
+		LLVOVolume* volume = *iter;
+		volume->finishRiggedVolumeUpdate();
+		volume->genBBoxes(FALSE);
+		volume->mDrawable->clearState(LLDrawable::REBUILD_RIGGED);
+	}
+}
+
+void LLPipeline::queueRiggedGeom(LLDrawable* drawablep, std::vector<LLVOVolume*>& queued)
+{
+	if (drawablep && !drawablep->isDead() && drawablep->isState(LLDrawable::REBUILD_RIGGED))
+	{
+		LLVOVolume* volume = drawablep->getVOVolume();
+		if (volume && volume->queueRiggedVolumeUpdate())
+		{
+			queued.push_back(volume);
+		}
+	}
+}
+
 static LLTrace::BlockTimerStatHandle FTM_SEED_VBO_POOLS("Seed VBO Pool");
 
 static LLTrace::BlockTimerStatHandle FTM_UPDATE_GL("Update GL");
@@ -2642,6 +2817,10 @@ void LLPipeline::rebuildPriorityGroups()
 	assertInitialized();
 
 	gMeshRepo.notifyLoadedMeshes();
+	if (LLAppViewer::getVolumeBuildThread())
+	{
+		LLAppViewer::getVolumeBuildThread()->notifyBuiltVolumes();
+	}
 
 	mGroupQ1Locked = true;
 	// Iterate through all drawables on the priority build queue,
@@ -2729,6 +2908,8 @@ void LLPipeline::updateGeom(F32 max_dtime)
 	// for now, only LLVOVolume does this to throttle LOD changes
 	LLVOVolume::preUpdateGeom();
 
+	updateRiggedGeom();
+
 	// Iterate through all drawables on the priority build queue,
 	for (LLDrawable::drawable_list_t::iterator iter = mBuildQ1.begin();
 		 iter != mBuildQ1.end();)
@@ -2760,12 +2941,7 @@ void LLPipeline::updateGeom(F32 max_dtime)
 	}
 		
 	// Iterate through some drawables on the non-priority build queue
-	S32 min_count = 16;
-	S32 size = (S32) mBuildQ2.size();
-	if (size > 1024)
-	{
-		min_count = llclamp((S32) (size * (F32) size/4096), 16, size);
-	}
+	S32 min_count = get_build_q2_min_count((S32) mBuildQ2.size());
 		
 	S32 count = 0;
 	
@@ -3118,6 +3294,10 @@ void LLPipeline::stateSort(LLCamera& camera, LLCullResult &result)
 
 	//LLVertexBuffer::unbind();
 
+	// Unlike the frustum checks in updateCull() this stays on the main thread:
+	// updateDistance() switches LODs and markRebuild()s into mBuildQ1/mBuildQ2,
+	// markVisible() fills the shared visible lists and rebuildMesh() maps
+	// vertex buffers.
 	grabReferences(result);
 	for (LLCullResult::sg_iterator iter = sCull->beginDrawableGroups(); iter != sCull->endDrawableGroups(); ++iter)
 	{
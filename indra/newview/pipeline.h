@@ -64,8 +64,10 @@ class LLCubeMap;
 class LLCullResult;
 class LLVOAvatar;
 class LLVOPartGroup;
+class LLVOVolume;
 class LLGLSLShader;
 class LLDrawPoolAlpha;
+class LLJobPool;
 
 class LLMeshResponder;
 
@@ -422,6 +424,9 @@ private:
 	void addToQuickLookup( LLDrawPool* new_poolp );
 	void removeFromQuickLookup( LLDrawPool* poolp );
 	BOOL updateDrawableGeom(LLDrawable* drawable, BOOL priority);
+	void updateRiggedGeom();
+	void queueRiggedGeom(LLDrawable* drawablep, std::vector<LLVOVolume*>& queued);
+	void precull(LLCamera& camera, S32 water_clip); //frustum checks for updateCull on mCullThreads
 	void assertInitializedDoError();
 	bool assertInitialized() { const bool is_init = isInit(); if (!is_init) assertInitializedDoError(); return is_init; };
 	void hideDrawable( LLDrawable *pDrawable );
@@ -608,6 +613,9 @@ public:
 	LLPointer<LLVertexBuffer> mCubeVB;
 
 private:
+	//runs the frustum checks of updateCull, NULL if RenderCullThreads is 0
+	LLJobPool*				mCullThreads;
+
 	//sun shadow map
 	LLRenderTarget			mShadow[6];
 	std::vector<LLVector3>	mShadowFrustPoints[4];
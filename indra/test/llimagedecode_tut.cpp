@@ -0,0 +1,146 @@
+/**
+ * @file llimagedecode_tut.cpp
+ * @brief Decode throughput of the LLImageDecodeThread pool.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+// Replays a directory of J2C files through LLImageDecodeThread with
+// increasing pool sizes and reports the decodes per second of each.
+// The directory is taken from the LL_DECODE_BENCH_DIR environment
+// variable; the test is skipped when it is not set.
+
+#include "linden_common.h"
+#include "lltut.h"
+
+#include "lldiriterator.h"
+#include "llimagej2c.h"
+#include "llimageworker.h"
+#include "lltimer.h"
+
+#include <cstdlib>
+#include <iostream>
+
+namespace tut
+{
+	class decode_bench_responder : public LLImageDecodeThread::Responder
+	{
+	public:
+		decode_bench_responder(LLAtomicS32* done, LLAtomicS32* failed) : mDone(done), mFailed(failed) {}
+		virtual void completed(bool success, LLImageRaw* raw, LLImageRaw* aux)
+		{
+			if (!success)
+			{
+				(*mFailed)++;
+			}
+			(*mDone)++;
+		}
+	private:
+		LLAtomicS32* mDone;
+		LLAtomicS32* mFailed;
+	};
+
+	struct imagedecode_test
+	{
+		imagedecode_test()
+		{
+			LLImage::initClass();
+		}
+		~imagedecode_test()
+		{
+			LLImage::cleanupClass();
+		}
+
+		// Decodes all files once with a pool of pool_size threads, returns the elapsed seconds.
+		F64 decodeAll(const std::vector<std::string>& files, U32 pool_size, S32& failed)
+		{
+			LLImageDecodeThread* thread = new LLImageDecodeThread(true, pool_size);
+			LLAtomicS32 done(0);
+			LLAtomicS32 failures(0);
+
+			std::vector<LLPointer<LLImageJ2C> > images;
+			for (std::vector<std::string>::const_iterator iter = files.begin(); iter != files.end(); ++iter)
+			{
+				LLPointer<LLImageJ2C> image = new LLImageJ2C;
+				if (image->load(*iter))
+				{
+					images.push_back(image);
+				}
+				else
+				{
+					failures++;
+				}
+			}
+
+			LLTimer timer;
+			for (std::vector<LLPointer<LLImageJ2C> >::iterator iter = images.begin(); iter != images.end(); ++iter)
+			{
+				thread->decodeImage(*iter, LLQueuedThread::PRIORITY_NORMAL, 0, FALSE,
+									new decode_bench_responder(&done, &failures));
+			}
+			while (done < (S32)images.size())
+			{
+				thread->update(1.f);
+				ms_sleep(1);
+			}
+			F64 elapsed = timer.getElapsedTimeF64();
+
+			thread->shutdown();
+			delete thread;
+			failed = failures;
+			return elapsed;
+		}
+	};
+	typedef test_group<imagedecode_test> imagedecode_group_t;
+	typedef imagedecode_group_t::object imagedecode_object_t;
+	tut::imagedecode_group_t imagedecode_instance("imagedecode");
+
+	template<> template<>
+	void imagedecode_object_t::test<1>()
+	{
+		const char* dir = getenv("LL_DECODE_BENCH_DIR");
+		if (!dir)
+		{
+			skip("set LL_DECODE_BENCH_DIR to a directory of .j2c files to run the decode benchmark.");
+		}
+
+		std::vector<std::string> files;
+		std::string name;
+		LLDirIterator iter(dir, "*.j2c");
+		while (iter.next(name))
+		{
+			files.push_back(std::string(dir) + "/" + name);
+		}
+		ensure("no .j2c files found in LL_DECODE_BENCH_DIR", !files.empty());
+
+		const U32 pool_sizes[] = { 1, 2, 4, 8, 16 };
+		for (U32 i = 0; i < LL_ARRAY_SIZE(pool_sizes); ++i)
+		{
+			S32 failed = 0;
+			F64 elapsed = decodeAll(files, pool_sizes[i], failed);
+			std::cout << "imagedecode: " << pool_sizes[i] << " threads, "
+					  << files.size() << " files, " << failed << " failed, "
+					  << (elapsed > 0.0 ? files.size() / elapsed : 0.0) << " decodes/s" << std::endl;
+			ensure_equals("decode failures", failed, 0);
+		}
+	}
+}
@@ -0,0 +1,90 @@
+/**
+ * @file lljobpool_tut.cpp
+ * @brief LLJobPool batches.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "lltut.h"
+
+#include "lljobpool.h"
+
+#include <vector>
+
+namespace tut
+{
+	struct jobpool_test
+	{
+		// Every job adds its index + 1 to its own slot.
+		static void addIndex(void* data, U32 index)
+		{
+			(*(std::vector<U32>*)data)[index] += index + 1;
+		}
+
+		static void runBatches(LLJobPool& pool)
+		{
+			const U32 sizes[] = { 0, 1, 2, 7, 100, 5000 };
+			for (U32 s = 0; s < LL_ARRAY_SIZE(sizes); ++s)
+			{
+				std::vector<U32> results(sizes[s], 0);
+				// Twice, so the second batch reuses the woken threads.
+				for (U32 pass = 0; pass < 2; ++pass)
+				{
+					pool.run(addIndex, results.empty() ? NULL : &results, sizes[s]);
+				}
+				for (U32 i = 0; i < results.size(); ++i)
+				{
+					ensure_equals("job ran twice", results[i], 2 * (i + 1));
+				}
+			}
+		}
+	};
+	typedef test_group<jobpool_test> jobpool_group_t;
+	typedef jobpool_group_t::object jobpool_object_t;
+	tut::jobpool_group_t jobpool_instance("jobpool");
+
+	template<> template<>
+	void jobpool_object_t::test<1>()
+	{
+		// Without threads run() does every job itself.
+		LLJobPool pool("jobpool test", 0);
+		ensure_equals("threads", pool.getThreadCount(), 0U);
+		runBatches(pool);
+	}
+
+	template<> template<>
+	void jobpool_object_t::test<2>()
+	{
+		// Every job of every batch runs exactly once before run() returns.
+		LLJobPool pool("jobpool test", 3);
+		ensure_equals("threads", pool.getThreadCount(), 3U);
+		runBatches(pool);
+	}
+
+	template<> template<>
+	void jobpool_object_t::test<3>()
+	{
+		ensure("capped", LLJobPool::getDefaultThreadCount(0, 2) <= 2);
+		ensure_equals("all reserved", LLJobPool::getDefaultThreadCount(10000, 8), 0U);
+	}
+}
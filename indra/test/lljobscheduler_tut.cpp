@@ -0,0 +1,217 @@
+/**
+ * @file lljobscheduler_tut.cpp
+ * @brief LLQueuedThreads running their requests on the shared LLJobScheduler.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+
+#include "linden_common.h"
+#include "lltut.h"
+
+#include "lljobscheduler.h"
+#include "llqueuedthread.h"
+#include "lltimer.h"
+
+namespace tut
+{
+	struct jobscheduler_test
+	{
+		// Completes after the given number of time slices.
+		class SliceRequest : public LLQueuedThread::QueuedRequest
+		{
+		public:
+			SliceRequest(LLQueuedThread::handle_t handle, U32 priority, S32 slices, LLAtomicU32* completed)
+				: LLQueuedThread::QueuedRequest(handle, priority, LLQueuedThread::FLAG_AUTO_COMPLETE),
+				  mSlices(slices),
+				  mCompleted(completed)
+			{
+			}
+
+			/*virtual*/ bool processRequest()		{ return --mSlices <= 0; }
+			/*virtual*/ void finishRequest(bool completed)
+			{
+				if (completed)
+				{
+					(*mCompleted)++;
+				}
+			}
+
+		protected:
+			/*virtual*/ ~SliceRequest() {}
+
+		private:
+			S32 mSlices;
+			LLAtomicU32* mCompleted;
+		};
+
+		class TestQueue : public LLQueuedThread
+		{
+		public:
+			TestQueue(U32 shared_jobs) : LLQueuedThread("scheduler test", true, false, shared_jobs) {}
+
+			void add(U32 priority, S32 slices, LLAtomicU32* completed)
+			{
+				addRequest(new SliceRequest(generateHandle(), priority, slices, completed));
+			}
+		};
+
+		// Queues count requests of mixed priorities and lengths.
+		static void addRequests(TestQueue& queue, U32 count, LLAtomicU32* completed)
+		{
+			const U32 priorities[] = { LLQueuedThread::PRIORITY_LOW, LLQueuedThread::PRIORITY_NORMAL, LLQueuedThread::PRIORITY_HIGH };
+			for (U32 i = 0; i < count; ++i)
+			{
+				queue.add(priorities[i % 3] + i, i % 4 + 1, completed);
+			}
+		}
+
+		static bool waitFor(LLAtomicU32& completed, U32 count)
+		{
+			LLTimer timer;
+			while (completed < count)
+			{
+				if (timer.getElapsedTimeF32() > 30.f)
+				{
+					return false;
+				}
+				ms_sleep(1);
+			}
+			return true;
+		}
+	};
+	typedef test_group<jobscheduler_test> jobscheduler_group_t;
+	typedef jobscheduler_group_t::object jobscheduler_object_t;
+	tut::jobscheduler_group_t jobscheduler_instance("jobscheduler");
+
+	template<> template<>
+	void jobscheduler_object_t::test<1>()
+	{
+		// Queues of different concurrency share the workers, every request
+		// completes exactly once, time sliced ones included.
+		LLJobScheduler::initClass(3);
+		{
+			TestQueue serial(1);
+			TestQueue parallel(4);
+			ensure_equals("serial jobs", serial.getSharedJobs(), 1U);
+			ensure_equals("parallel jobs", parallel.getSharedJobs(), 4U);
+
+			LLAtomicU32 serial_done(0), parallel_done(0);
+			addRequests(serial, 300, &serial_done);
+			addRequests(parallel, 1000, &parallel_done);
+			ensure("serial done", waitFor(serial_done, 300));
+			ensure("parallel done", waitFor(parallel_done, 1000));
+			ms_sleep(10);
+			ensure_equals("serial once", (U32)serial_done, 300U);
+			ensure_equals("parallel once", (U32)parallel_done, 1000U);
+
+			F32 wait_time, run_time;
+			U32 processed;
+			parallel.getQueueStats(wait_time, run_time, processed);
+			// Every slice counts.
+			ensure("processed", processed >= 1000);
+			ensure_equals("pending", parallel.getPending(), 0);
+		}
+		LLJobScheduler::cleanupClass();
+	}
+
+	template<> template<>
+	void jobscheduler_object_t::test<2>()
+	{
+		// Requests of a paused queue are not scheduled, shutting down drops them.
+		LLJobScheduler::initClass(2);
+		{
+			TestQueue queue(2);
+			queue.pause();
+			LLAtomicU32 completed(0);
+			addRequests(queue, 50, &completed);
+			ms_sleep(10);
+			ensure_equals("paused", (U32)completed, 0U);
+			queue.shutdown();
+			ensure("stopped", queue.isStopped());
+			ensure_equals("dropped", (U32)completed, 0U);
+		}
+		LLJobScheduler::cleanupClass();
+	}
+
+	template<> template<>
+	void jobscheduler_object_t::test<3>()
+	{
+		// Without a scheduler the queue runs its own thread.
+		ensure("no scheduler", LLJobScheduler::getInstance() == NULL);
+		TestQueue queue(4);
+		ensure_equals("own thread", queue.getSharedJobs(), 0U);
+		LLAtomicU32 completed(0);
+		addRequests(queue, 100, &completed);
+		ensure("done", waitFor(completed, 100));
+	}
+
+	// Counts its jobs, the first one blocks until released.
+	struct CountingClient : public LLJobScheduler::Client
+	{
+		CountingClient() : mRuns(0), mRelease(0) {}
+		/*virtual*/ void runJob()
+		{
+			if (!mRuns++)
+			{
+				while (!mRelease)
+				{
+					ms_sleep(1);
+				}
+			}
+		}
+		LLAtomicU32 mRuns;
+		LLAtomicU32 mRelease;
+	};
+
+	template<> template<>
+	void jobscheduler_object_t::test<4>()
+	{
+		// Jobs no worker took yet are taken back, in any lane.
+		LLJobScheduler::initClass(1);
+		{
+			CountingClient blocker, client;
+			LLJobScheduler* scheduler = LLJobScheduler::getInstance();
+			scheduler->submit(&blocker, LLJobScheduler::LANE_HIGH);
+			LLTimer timer;
+			while (!blocker.mRuns && timer.getElapsedTimeF32() < 30.f)
+			{
+				ms_sleep(1);
+			}
+			ensure("blocking", blocker.mRuns == 1);
+			scheduler->submit(&client, LLJobScheduler::LANE_LOW);
+			scheduler->submit(&client, LLJobScheduler::LANE_NORMAL);
+			scheduler->submit(&blocker, LLJobScheduler::LANE_NORMAL);
+			ensure_equals("cancelled", scheduler->cancel(&client), 2U);
+			ensure_equals("none left", scheduler->cancel(&client), 0U);
+			blocker.mRelease = 1;
+			timer.reset();
+			while (blocker.mRuns < 2 && timer.getElapsedTimeF32() < 30.f)
+			{
+				ms_sleep(1);
+			}
+			ensure_equals("others run", (U32)blocker.mRuns, 2U);
+			ensure_equals("never ran", (U32)client.mRuns, 0U);
+		}
+		LLJobScheduler::cleanupClass();
+	}
+}
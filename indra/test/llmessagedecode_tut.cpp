@@ -0,0 +1,318 @@
+/**
+ * @file llmessagedecode_tut.cpp
+ * @brief Zero code expansion and template message decoding tests.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+// Test 3 replays a batch of ObjectUpdate shaped packets through zero code
+// expansion and LLTemplateMessageReader and reports packets per second.
+// It is skipped unless LL_MESSAGE_BENCH is set to the number of packets
+// to replay.
+
+#include "linden_common.h"
+#include "lltut.h"
+
+#include "message.h"
+#include "llmessagetemplate.h"
+#include "lltemplatemessagebuilder.h"
+#include "lltemplatemessagereader.h"
+#include "message_prehash.h"
+#include "lltimer.h"
+#include "v3math.h"
+
+#include <cstdlib>
+#include <iostream>
+
+namespace tut
+{
+	static LLTemplateMessageBuilder::message_template_name_map_t decodeNameMap;
+	static LLTemplateMessageReader::message_template_number_map_t decodeNumberMap;
+
+	// Byte at a time expansion, as the message system did it before.
+	static std::vector<U8> reference_expand(const std::vector<U8>& in)
+	{
+		std::vector<U8> out;
+		size_t i = 0;
+		for (; i < in.size() && i < LL_PACKET_ID_SIZE; ++i)
+		{
+			out.push_back(in[i]);
+		}
+		while (i < in.size())
+		{
+			U8 c = in[i++];
+			out.push_back(c);
+			if (c)
+			{
+				continue;
+			}
+			while (i < in.size() && !in[i])
+			{
+				out.insert(out.end(), 256, 0);
+				++i;
+			}
+			if (i < in.size())
+			{
+				out.insert(out.end(), in[i] - 1, 0);
+				++i;
+			}
+		}
+		return out;
+	}
+
+	struct messagedecode_test
+	{
+		messagedecode_test()
+		{
+			static bool init = false;
+			if (!init)
+			{
+				const F32 circuit_heartbeat_interval = 5;
+				const F32 circuit_timeout = 100;
+				start_messaging_system("notafile", 13035,
+									   1, 0, 0,
+									   false,
+									   "notasharedsecret",
+									   NULL,
+									   false,
+									   circuit_heartbeat_interval,
+									   circuit_timeout);
+				init = true;
+			}
+		}
+
+		void ensureExpands(const char* msg, const std::vector<U8>& in)
+		{
+			std::vector<U8> expected = reference_expand(in);
+			std::vector<U8> out(MAX_BUFFER_SIZE);
+			S32 size = LLMessageSystem::zeroCodeExpandBuffer(&in[0], in.size(), &out[0], out.size());
+			ensure_equals(msg, size, (S32)expected.size());
+			ensure(msg, std::equal(expected.begin(), expected.end(), out.begin()));
+		}
+
+		// A single region block, a variable block of fixed size objects and
+		// a variable block with a variable size field, like ObjectUpdate.
+		static LLMessageTemplate* objectUpdateTemplate()
+		{
+			LLMessageTemplate* templatep = new LLMessageTemplate(_PREHASH_TestMessage, 1, MFT_HIGH);
+			LLMessageBlock* region = new LLMessageBlock(_PREHASH_Test0, MBT_SINGLE);
+			region->addVariable(const_cast<char*>(_PREHASH_Test0), MVT_U64, 8);
+			region->addVariable(const_cast<char*>(_PREHASH_Test1), MVT_U16, 2);
+			templatep->addBlock(region);
+			LLMessageBlock* objects = new LLMessageBlock(_PREHASH_Test1, MBT_VARIABLE);
+			objects->addVariable(const_cast<char*>(_PREHASH_Test0), MVT_U32, 4);
+			objects->addVariable(const_cast<char*>(_PREHASH_Test1), MVT_LLUUID, 16);
+			objects->addVariable(const_cast<char*>(_PREHASH_Test2), MVT_LLVector3, 12);
+			templatep->addBlock(objects);
+			LLMessageBlock* blobs = new LLMessageBlock(_PREHASH_Test2, MBT_VARIABLE);
+			blobs->addVariable(const_cast<char*>(_PREHASH_Test0), MVT_U32, 4);
+			blobs->addVariable(const_cast<char*>(_PREHASH_Test1), MVT_VARIABLE, 2);
+			templatep->addBlock(blobs);
+			templatep->setHandlerFunc(null_message_callback, NULL);
+			decodeNameMap[_PREHASH_TestMessage] = templatep;
+			decodeNumberMap[1] = templatep;
+			return templatep;
+		}
+
+		// Builds and zero codes one packet carrying object_count objects.
+		static std::vector<U8> buildPacket(S32 seed, S32 object_count)
+		{
+			LLTemplateMessageBuilder builder(decodeNameMap);
+			builder.newMessage(_PREHASH_TestMessage);
+			builder.nextBlock(_PREHASH_Test0);
+			builder.addU64(_PREHASH_Test0, 1099511628032000ULL);
+			builder.addU16(_PREHASH_Test1, 65535);
+			for (S32 i = 0; i < object_count; ++i)
+			{
+				builder.nextBlock(_PREHASH_Test1);
+				builder.addU32(_PREHASH_Test0, seed * 100 + i);
+				LLUUID id;
+				id.generate();
+				builder.addUUID(_PREHASH_Test1, id);
+				builder.addVector3(_PREHASH_Test2, LLVector3((F32)i, 0.f, 22.5f));
+			}
+			for (S32 i = 0; i < object_count; ++i)
+			{
+				builder.nextBlock(_PREHASH_Test2);
+				builder.addU32(_PREHASH_Test0, i);
+				U8 blob[60];
+				memset(blob, 0, sizeof(blob));
+				blob[i % sizeof(blob)] = (U8)(seed + i);
+				builder.addBinaryData(_PREHASH_Test1, blob, sizeof(blob));
+			}
+
+			U8 buffer[MAX_BUFFER_SIZE];
+			memset(buffer, 0, LL_PACKET_ID_SIZE);
+			U32 size = builder.buildMessage(buffer, MAX_BUFFER_SIZE, 0);
+			U8* packet = buffer;
+			builder.compressMessage(packet, size);
+			return std::vector<U8>(packet, packet + size);
+		}
+	};
+	typedef test_group<messagedecode_test> messagedecode_group_t;
+	typedef messagedecode_group_t::object messagedecode_object_t;
+	tut::messagedecode_group_t messagedecode_instance("messagedecode");
+
+	template<> template<>
+	void messagedecode_object_t::test<1>()
+	{
+		// zero runs at the ends, wrap bytes, and literal runs across 16 byte boundaries
+		const U8 header[LL_PACKET_ID_SIZE] = { 0, 0, 0, 0, 1, 0 };
+		std::vector<U8> in(header, header + LL_PACKET_ID_SIZE);
+		ensureExpands("header only", in);
+
+		std::vector<U8> run = in;
+		run.push_back(0);
+		ensureExpands("trailing zero", run);
+		run.push_back(0);
+		ensureExpands("trailing wrap", run);
+		run.push_back(3);
+		ensureExpands("wrap and count", run);
+
+		std::vector<U8> literal = in;
+		for (S32 i = 1; i < 100; ++i)
+		{
+			literal.push_back((U8)i);
+			ensureExpands("literal", literal);
+		}
+
+		for (S32 pass = 0; pass < 200; ++pass)
+		{
+			std::vector<U8> random = in;
+			S32 length = rand() % 1200;
+			for (S32 i = 0; i < length; ++i)
+			{
+				// Mostly literals with some short zero runs, the way ObjectUpdate looks.
+				if (rand() % 5)
+				{
+					random.push_back((U8)(1 + rand() % 255));
+				}
+				else
+				{
+					random.push_back(0);
+					random.push_back((U8)(1 + rand() % 40));
+				}
+			}
+			ensureExpands("random", random);
+		}
+	}
+
+	template<> template<>
+	void messagedecode_object_t::test<2>()
+	{
+		// an over long expansion is refused
+		std::vector<U8> in(LL_PACKET_ID_SIZE, 0);
+		in.push_back(0);
+		in.push_back(200);
+		U8 out[64];
+		ensure_equals("overflow", LLMessageSystem::zeroCodeExpandBuffer(&in[0], in.size(), out, sizeof(out)), -1);
+
+		// built packets expand and decode to what was added
+		LLMessageTemplate* templatep = objectUpdateTemplate();
+		std::vector<U8> packet = buildPacket(7, 5);
+		std::vector<U8> expanded(MAX_BUFFER_SIZE);
+		U8* data = &packet[0];
+		S32 size = packet.size();
+		if (data[0] & LL_ZERO_CODE_FLAG)
+		{
+			data[0] &= ~LL_ZERO_CODE_FLAG;
+			size = LLMessageSystem::zeroCodeExpandBuffer(data, size, &expanded[0], expanded.size());
+			data = &expanded[0];
+		}
+		ensure("expanded", size > 0);
+
+		LLTemplateMessageReader reader(decodeNumberMap);
+		ensure("valid", reader.validateMessage(data, size, LLHost()));
+		ensure("read", reader.readMessage(data, LLHost()));
+		ensure_equals("objects", reader.getNumberOfBlocks(_PREHASH_Test1), 5);
+		ensure_equals("blobs", reader.getNumberOfBlocks(_PREHASH_Test2), 5);
+		U64 handle;
+		reader.getU64(_PREHASH_Test0, _PREHASH_Test0, handle);
+		ensure("region handle", handle == 1099511628032000ULL);
+		U32 id;
+		reader.getU32(_PREHASH_Test1, _PREHASH_Test0, id, 3);
+		ensure_equals("object id", id, (U32)703);
+		LLVector3 pos;
+		reader.getVector3(_PREHASH_Test1, _PREHASH_Test2, pos, 4);
+		ensure_equals("object pos", pos.mV[VX], 4.f);
+		ensure_equals("blob size", reader.getSize(_PREHASH_Test2, 2, _PREHASH_Test1), 60);
+		U8 blob[60];
+		reader.getBinaryData(_PREHASH_Test2, _PREHASH_Test1, blob, sizeof(blob), 2);
+		ensure_equals("blob data", blob[2], (U8)9);
+		reader.clearMessage();
+		delete templatep;
+	}
+
+	template<> template<>
+	void messagedecode_object_t::test<3>()
+	{
+		const char* count = getenv("LL_MESSAGE_BENCH");
+		if (!count)
+		{
+			skip("set LL_MESSAGE_BENCH to a packet count to run the message decode benchmark.");
+		}
+		S32 packet_count = llmax(atoi(count), 1);
+
+		LLMessageTemplate* templatep = objectUpdateTemplate();
+		std::vector<std::vector<U8> > packets;
+		for (S32 i = 0; i < 64; ++i)
+		{
+			packets.push_back(buildPacket(i, 1 + i % 12));
+		}
+
+		LLTemplateMessageReader reader(decodeNumberMap);
+		std::vector<U8> expanded(MAX_BUFFER_SIZE);
+		std::vector<U8> work(MAX_BUFFER_SIZE);
+		S64 bytes = 0;
+		F64 expand_time = 0.0;
+		LLTimer timer;
+		for (S32 i = 0; i < packet_count; ++i)
+		{
+			const std::vector<U8>& packet = packets[i % packets.size()];
+			std::copy(packet.begin(), packet.end(), work.begin());
+			U8* data = &work[0];
+			S32 size = packet.size();
+			bytes += size;
+
+			F64 start = timer.getElapsedTimeF64();
+			if (data[0] & LL_ZERO_CODE_FLAG)
+			{
+				data[0] &= ~LL_ZERO_CODE_FLAG;
+				size = LLMessageSystem::zeroCodeExpandBuffer(data, size, &expanded[0], expanded.size());
+				data = &expanded[0];
+			}
+			expand_time += timer.getElapsedTimeF64() - start;
+
+			if (reader.validateMessage(data, size, LLHost()))
+			{
+				reader.readMessage(data, LLHost());
+			}
+			reader.clearMessage();
+		}
+		F64 elapsed = timer.getElapsedTimeF64();
+
+		std::cout << "messagedecode: " << packet_count << " packets, " << bytes << " bytes, "
+				  << (elapsed > 0.0 ? packet_count / elapsed : 0.0) << " packets/s, "
+				  << (elapsed > 0.0 ? 100.0 * expand_time / elapsed : 0.0) << "% in zero code expansion" << std::endl;
+		delete templatep;
+	}
+}
@@ -0,0 +1,177 @@
+/**
+ * @file llnamestore_tut.cpp
+ * @brief LLNameStore appends, lookups and damaged files.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+
+#include "linden_common.h"
+#include "lltut.h"
+
+#include "llfile.h"
+#include "llnamestore.h"
+
+#include <boost/bind.hpp>
+#include <sstream>
+
+namespace tut
+{
+	struct namestore_test
+	{
+		std::string mFilename;
+		LLUUID mAgent, mGroup, mAvatar;
+
+		namestore_test()
+		{
+			LLUUID random;
+			random.generate();
+			std::ostringstream oStr;
+#if LL_WINDOWS
+			oStr << "llnamestore-test-" << random;
+#else
+			oStr << "/tmp/llnamestore-test-" << random;
+#endif
+			mFilename = oStr.str();
+			mAgent.generate();
+			mGroup.generate();
+			mAvatar.generate();
+		}
+
+		~namestore_test()
+		{
+			LLFile::remove_nowarn(mFilename);
+		}
+
+		static LLNameStore::Record makeRecord(const std::string& a, const std::string& b = std::string())
+		{
+			LLNameStore::Record record;
+			record.mFlags = 1;
+			record.mTimes[0] = 1234.5;
+			// Far enough ahead that opening the store does not compact it.
+			record.mDropAfter = (F64)time(NULL) + 30.0 * 24.0 * 60.0 * 60.0;
+			record.mStrings.push_back(a);
+			if (!b.empty())
+			{
+				record.mStrings.push_back(b);
+			}
+			return record;
+		}
+
+		static bool matchName(const LLNameStore::Record& record, const std::string& name)
+		{
+			return !record.mStrings.empty() && record.mStrings[0] == name;
+		}
+
+		void fill(LLNameStore& store)
+		{
+			store.put(LLNameStore::KIND_AGENT, mAgent, makeRecord("Fred", "Resident"));
+			store.put(LLNameStore::KIND_GROUP, mGroup, makeRecord("Builders"));
+			store.put(LLNameStore::KIND_AVATAR_NAME, mAvatar, makeRecord("fred.smith", std::string("Fr\0ed", 5)));
+		}
+	};
+	typedef test_group<namestore_test> namestore_group_t;
+	typedef namestore_group_t::object namestore_object_t;
+	tut::namestore_group_t namestore_instance("namestore");
+
+	template<> template<>
+	void namestore_object_t::test<1>()
+	{
+		// Records are found before and after they were written.
+		{
+			LLNameStore store;
+			ensure("no file yet", !store.open(mFilename));
+			fill(store);
+			LLNameStore::Record record;
+			ensure("pending", store.find(LLNameStore::KIND_AGENT, mAgent, record));
+			ensure("flush", store.flush());
+			store.close();
+		}
+
+		LLNameStore store;
+		ensure("reopen", store.open(mFilename));
+		ensure_equals("records", store.getNumRecords(), 3U);
+		LLNameStore::Record record;
+		ensure("agent", store.find(LLNameStore::KIND_AGENT, mAgent, record));
+		ensure_equals("agent strings", record.mStrings.size(), (size_t)2);
+		ensure_equals("first", record.mStrings[0], std::string("Fred"));
+		ensure_equals("last", record.mStrings[1], std::string("Resident"));
+		ensure_equals("flags", record.mFlags, 1U);
+		ensure_equals("time", record.mTimes[0], 1234.5);
+		ensure("avatar", store.find(LLNameStore::KIND_AVATAR_NAME, mAvatar, record));
+		ensure_equals("embedded nul", record.mStrings[1], std::string("Fr\0ed", 5));
+		ensure("kinds are separate", !store.find(LLNameStore::KIND_GROUP, mAgent, record));
+
+		LLUUID id;
+		ensure("find by name", store.findIf(LLNameStore::KIND_GROUP, boost::bind(&matchName, _2, std::string("Builders")), id));
+		ensure_equals("found id", id, mGroup);
+		ensure("unknown name", !store.findIf(LLNameStore::KIND_GROUP, boost::bind(&matchName, _2, std::string("Fred")), id));
+	}
+
+	template<> template<>
+	void namestore_object_t::test<2>()
+	{
+		// Appended records replace and erase the ones already in the file.
+		{
+			LLNameStore store;
+			store.open(mFilename);
+			fill(store);
+			store.close();
+		}
+		{
+			LLNameStore store;
+			ensure("open", store.open(mFilename));
+			store.put(LLNameStore::KIND_AGENT, mAgent, makeRecord("Fred", "Smith"));
+			store.erase(LLNameStore::KIND_GROUP, mGroup);
+			LLNameStore::Record record;
+			ensure("erased before flush", !store.find(LLNameStore::KIND_GROUP, mGroup, record));
+			store.close();
+		}
+
+		LLNameStore store;
+		ensure("reopen", store.open(mFilename));
+		ensure_equals("records", store.getNumRecords(), 2U);
+		LLNameStore::Record record;
+		ensure("agent", store.find(LLNameStore::KIND_AGENT, mAgent, record));
+		ensure_equals("replaced", record.mStrings[1], std::string("Smith"));
+		ensure("erased", !store.find(LLNameStore::KIND_GROUP, mGroup, record));
+		ensure("kept", store.find(LLNameStore::KIND_AVATAR_NAME, mAvatar, record));
+	}
+
+	template<> template<>
+	void namestore_object_t::test<3>()
+	{
+		// A damaged file is ignored and replaced at the next flush.
+		{
+			llofstream file(mFilename);
+			file << "not a name store, but long enough to hold a header";
+		}
+		LLNameStore store;
+		ensure("damaged", !store.open(mFilename));
+		fill(store);
+		ensure("flush", store.flush());
+		store.close();
+		ensure("rewritten", store.open(mFilename));
+		LLNameStore::Record record;
+		ensure("group", store.find(LLNameStore::KIND_GROUP, mGroup, record));
+	}
+}
@@ -0,0 +1,284 @@
+/**
+ * @file llpatchdecode_tut.cpp
+ * @brief Terrain patch decoding: bit unpacking and the SSE2 IDCT.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+// Test 4 codes a region's worth of land patches and times the bit
+// unpacking, the scalar and SSE2 IDCT, and the batched LLPatchDecompressor.
+// It is skipped unless LL_PATCH_BENCH is set to the number of passes.
+
+#include "linden_common.h"
+#include "lltut.h"
+
+#include "bitpack.h"
+#include "indra_constants.h"
+#include "patch_code.h"
+#include "patch_dct.h"
+#include "lltimer.h"
+#include "v3math.h"
+
+#include <cstdlib>
+#include <iostream>
+
+namespace tut
+{
+	struct patchdecode_test
+	{
+		patchdecode_test()
+		{
+			srand(1234);
+		}
+		~patchdecode_test()
+		{
+			set_patch_idct_sse2(TRUE);
+		}
+
+		// Quantized coefficients the way the simulator sends them: the
+		// low frequencies set, the tail zero.
+		static void randomPatch(S32* cpatch, S32 size, S32 non_zero)
+		{
+			for (S32 i = 0; i < size*size; ++i)
+			{
+				cpatch[i] = i < non_zero ? rand() % 201 - 100 : 0;
+			}
+		}
+
+		static LLPatchHeader randomHeader()
+		{
+			LLPatchHeader ph;
+			ph.dc_offset = (F32)(rand() % 100);
+			ph.range = (U16)(1 + rand() % 200);
+			ph.quant_wbits = 0x38;
+			ph.patchids = 0;
+			return ph;
+		}
+
+		// Codes count patches of 16x16 into a LayerData style bitstream.
+		static std::vector<U8> codePatches(const std::vector<S32>& coefficients, std::vector<LLPatchHeader>& headers)
+		{
+			const S32 coeffs = NORMAL_PATCH_SIZE*NORMAL_PATCH_SIZE;
+			std::vector<U8> buffer(coefficients.size()*4 + 64);
+			std::vector<S32> patch(coeffs);
+			LLBitPack bitpack(&buffer[0], buffer.size());
+			LLGroupHeader gh;
+			gh.stride = NORMAL_PATCH_SIZE;
+			gh.patch_size = NORMAL_PATCH_SIZE;
+			gh.layer_type = LAND_LAYER_CODE;
+
+			init_patch_coding(bitpack);
+			code_patch_group_header(bitpack, &gh);
+			for (U32 i = 0; i < headers.size(); ++i)
+			{
+				std::copy(coefficients.begin() + i*coeffs, coefficients.begin() + (i + 1)*coeffs, patch.begin());
+				headers[i].patchids = i % 256;
+				code_patch_header(bitpack, &headers[i], &patch[0]);
+				code_patch(bitpack, &patch[0], 0);
+			}
+			code_end_of_data(bitpack);
+			buffer.resize(bitpack.flushBitPack());
+			return buffer;
+		}
+	};
+	typedef test_group<patchdecode_test> patchdecode_group_t;
+	typedef patchdecode_group_t::object patchdecode_object_t;
+	tut::patchdecode_group_t patchdecode_instance("patchdecode");
+
+	template<> template<>
+	void patchdecode_object_t::test<1>()
+	{
+		// bitUnpackU32 reads the same bits as bitUnpack.
+		std::vector<U8> buffer(4096);
+		for (U32 i = 0; i < buffer.size(); ++i)
+		{
+			buffer[i] = (U8)rand();
+		}
+		LLBitPack bytewise(&buffer[0], buffer.size());
+		LLBitPack bitwise(&buffer[0], buffer.size());
+		for (S32 i = 0; i < 800; ++i)
+		{
+			U32 bits = rand() % 33;
+			U32 expected = 0;
+			bitwise.bitUnpack((U8*)&expected, bits);
+			ensure_equals("bitUnpackU32", bytewise.bitUnpackU32(bits), expected);
+		}
+		ensure_equals("position", bytewise.mBufferSize, bitwise.mBufferSize);
+	}
+
+	template<> template<>
+	void patchdecode_object_t::test<2>()
+	{
+		// Coding and decoding a group of patches gives back the coefficients.
+		const S32 coeffs = NORMAL_PATCH_SIZE*NORMAL_PATCH_SIZE;
+		const S32 count = 40;
+		std::vector<S32> coefficients(count*coeffs);
+		std::vector<LLPatchHeader> headers(count);
+		for (S32 i = 0; i < count; ++i)
+		{
+			randomPatch(&coefficients[i*coeffs], NORMAL_PATCH_SIZE, i == 0 ? coeffs : 1 + rand() % 80);
+			headers[i] = randomHeader();
+		}
+		std::vector<U8> buffer = codePatches(coefficients, headers);
+
+		LLBitPack bitpack(&buffer[0], buffer.size());
+		LLGroupHeader gh;
+		LLPatchHeader ph;
+		std::vector<S32> patch(coeffs);
+		init_patch_decoding(bitpack);
+		decode_patch_group_header(bitpack, &gh);
+		ensure_equals("patch size", (S32)gh.patch_size, (S32)NORMAL_PATCH_SIZE);
+		for (S32 i = 0; i < count; ++i)
+		{
+			decode_patch_header(bitpack, &ph);
+			ensure_equals("patch id", ph.patchids, headers[i].patchids);
+			decode_patch(bitpack, &patch[0]);
+			ensure("coefficients", std::equal(patch.begin(), patch.end(), coefficients.begin() + i*coeffs));
+		}
+		decode_patch_header(bitpack, &ph);
+		ensure_equals("end of patches", (S32)ph.quant_wbits, (S32)END_OF_PATCHES);
+	}
+
+	template<> template<>
+	void patchdecode_object_t::test<3>()
+	{
+		// The SSE2 IDCT and LLPatchDecompressor agree with the scalar IDCT.
+		const S32 sizes[] = { NORMAL_PATCH_SIZE, LARGE_PATCH_SIZE };
+		for (U32 s = 0; s < LL_ARRAY_SIZE(sizes); ++s)
+		{
+			S32 size = sizes[s];
+			LLPatchDecompressor decompressor(size);
+			LLGroupHeader gh;
+			gh.stride = size;
+			gh.patch_size = size;
+			init_patch_decompressor(size);
+			set_group_of_patch_header(&gh);
+
+			std::vector<S32> cpatch(size*size);
+			std::vector<F32> scalar(size*size), sse2(size*size), batched(size*size);
+			for (S32 i = 0; i < 50; ++i)
+			{
+				randomPatch(&cpatch[0], size, i == 0 ? 0 : 1 + rand() % (size*size));
+				LLPatchHeader ph = randomHeader();
+
+				set_patch_idct_sse2(FALSE);
+				decompress_patch(&scalar[0], &cpatch[0], &ph);
+				set_patch_idct_sse2(TRUE);
+				decompress_patch(&sse2[0], &cpatch[0], &ph);
+				F32* out = &batched[0];
+				decompressor.decompress(&out, size, &cpatch[0], &ph, 1);
+
+				for (S32 j = 0; j < size*size; ++j)
+				{
+					ensure_approximately_equals("sse2", sse2[j], scalar[j], 12);
+					ensure_approximately_equals("batched", batched[j], scalar[j], 12);
+				}
+			}
+		}
+	}
+
+	template<> template<>
+	void patchdecode_object_t::test<4>()
+	{
+		const char* passes_env = getenv("LL_PATCH_BENCH");
+		if (!passes_env)
+		{
+			skip("set LL_PATCH_BENCH to a pass count to run the patch decode benchmark.");
+		}
+		S32 passes = llmax(atoi(passes_env), 1);
+
+		// One region of land: 16x16 patches of 16x16.
+		const S32 size = NORMAL_PATCH_SIZE;
+		const S32 coeffs = size*size;
+		const S32 count = 256;
+		std::vector<S32> coefficients(count*coeffs);
+		std::vector<LLPatchHeader> headers(count);
+		for (S32 i = 0; i < count; ++i)
+		{
+			randomPatch(&coefficients[i*coeffs], size, 10 + rand() % 60);
+			headers[i] = randomHeader();
+		}
+		std::vector<U8> buffer = codePatches(coefficients, headers);
+
+		const S32 stride = size*16 + 1;
+		std::vector<F32> heights(stride*stride);
+		std::vector<F32*> patches(count);
+		for (S32 i = 0; i < count; ++i)
+		{
+			patches[i] = &heights[(i / 16)*size*stride + (i % 16)*size];
+		}
+		LLGroupHeader gh;
+		gh.stride = stride;
+		gh.patch_size = size;
+		init_patch_decompressor(size);
+		set_group_of_patch_header(&gh);
+		LLPatchDecompressor decompressor(size);
+
+		LLTimer timer;
+		for (S32 pass = 0; pass < passes; ++pass)
+		{
+			LLBitPack bitpack(&buffer[0], buffer.size());
+			LLGroupHeader decoded_gh;
+			LLPatchHeader ph;
+			decode_patch_group_header(bitpack, &decoded_gh);
+			for (S32 i = 0; i < count; ++i)
+			{
+				decode_patch_header(bitpack, &ph);
+				decode_patch(bitpack, &coefficients[i*coeffs]);
+			}
+		}
+		F64 unpack_time = timer.getElapsedTimeAndResetF64();
+
+		set_patch_idct_sse2(FALSE);
+		for (S32 pass = 0; pass < passes; ++pass)
+		{
+			for (S32 i = 0; i < count; ++i)
+			{
+				decompress_patch(patches[i], &coefficients[i*coeffs], &headers[i]);
+			}
+		}
+		F64 scalar_time = timer.getElapsedTimeAndResetF64();
+
+		set_patch_idct_sse2(TRUE);
+		for (S32 pass = 0; pass < passes; ++pass)
+		{
+			for (S32 i = 0; i < count; ++i)
+			{
+				decompress_patch(patches[i], &coefficients[i*coeffs], &headers[i]);
+			}
+		}
+		F64 sse2_time = timer.getElapsedTimeAndResetF64();
+
+		for (S32 pass = 0; pass < passes; ++pass)
+		{
+			decompressor.decompress(&patches[0], stride, &coefficients[0], &headers[0], count);
+		}
+		F64 batch_time = timer.getElapsedTimeAndResetF64();
+
+		F64 total = (F64)passes*count;
+		std::cout << "patchdecode: " << passes << " passes of " << count << " patches, "
+				  << (unpack_time > 0.0 ? total / unpack_time : 0.0) << " unpacked/s, "
+				  << (scalar_time > 0.0 ? total / scalar_time : 0.0) << " scalar IDCT/s, "
+				  << (sse2_time > 0.0 ? total / sse2_time : 0.0) << " SSE2 IDCT/s, "
+				  << (batch_time > 0.0 ? total / batch_time : 0.0) << " batched/s" << std::endl;
+	}
+}
@@ -0,0 +1,184 @@
+/**
+ * @file llsdarena_tut.cpp
+ * @brief LLSDArenaScope and the binary LLSD parser.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+// Test 3 times binary parses with and without the arena and reports the
+// resident memory the parsed trees hold. It is skipped unless LL_LLSD_BENCH
+// is set to the number of passes. LL_LLSD_BENCH_FILE may name a captured
+// binary LLSD payload to parse instead of the generated inventory-like one.
+
+#include "linden_common.h"
+#include "lltut.h"
+
+#include "llformat.h"
+#include "llmemory.h"
+#include "llsd.h"
+#include "llsdserialize.h"
+#include "lltimer.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace tut
+{
+	struct sdarena_test
+	{
+		~sdarena_test()
+		{
+			LLSDArenaScope::setEnabled(true);
+		}
+
+		// An array of count inventory-item-like maps.
+		static LLSD makeItems(S32 count)
+		{
+			LLSD items = LLSD::emptyArray();
+			for (S32 i = 0; i < count; ++i)
+			{
+				LLUUID id;
+				for (S32 j = 0; j < UUID_BYTES; ++j)
+				{
+					id.mData[j] = (U8)(i * 31 + j);
+				}
+				LLSD item;
+				item["item_id"] = id;
+				item["name"] = llformat("Inventory item %d", i);
+				item["type"] = i % 20;
+				item["sale_price"] = 1.5 * i;
+				item["flags"] = LLSD::emptyArray();
+				item["flags"].append(i);
+				item["flags"].append(true);
+				items.append(item);
+			}
+			return items;
+		}
+
+		static std::string toBinary(const LLSD& sd)
+		{
+			std::ostringstream ostr;
+			LLSDSerialize::toBinary(sd, ostr);
+			return ostr.str();
+		}
+
+		static LLSD fromBinary(const std::string& buffer)
+		{
+			LLSD sd;
+			std::istringstream istr(buffer);
+			LLSDSerialize::fromBinary(sd, istr, buffer.size());
+			return sd;
+		}
+	};
+	typedef test_group<sdarena_test> sdarena_group_t;
+	typedef sdarena_group_t::object sdarena_object_t;
+	tut::sdarena_group_t sdarena_instance("sdarena");
+
+	template<> template<>
+	void sdarena_object_t::test<1>()
+	{
+		// Values built in a scope outlive it, shared or copied.
+		LLSD kept;
+		LLSD first;
+		{
+			LLSDArenaScope arena;
+			LLSD items = makeItems(500);
+			kept = items[250];
+			first = items[0]["name"];
+			items[100]["name"] = "renamed";
+			ensure_equals("renamed", items[100]["name"].asString(), std::string("renamed"));
+		}
+		ensure_equals("kept name", kept["name"].asString(), std::string("Inventory item 250"));
+		ensure_equals("kept type", kept["type"].asInteger(), 250 % 20);
+		ensure_equals("first name", first.asString(), std::string("Inventory item 0"));
+
+		// Modifying a value the scope left behind detaches it as usual.
+		kept["name"] = "changed";
+		ensure_equals("changed", kept["name"].asString(), std::string("changed"));
+	}
+
+	template<> template<>
+	void sdarena_object_t::test<2>()
+	{
+		// The binary parser gives the same tree with and without the arena.
+		std::string buffer = toBinary(makeItems(2000));
+		LLSDArenaScope::setEnabled(false);
+		LLSD heap = fromBinary(buffer);
+		LLSDArenaScope::setEnabled(true);
+		LLSD arena = fromBinary(buffer);
+		ensure_equals("size", arena.size(), 2000);
+		ensure("heap round trip", toBinary(heap) == buffer);
+		ensure("arena round trip", toBinary(arena) == buffer);
+
+		// A truncated stream still fails cleanly.
+		LLSD truncated = fromBinary(buffer.substr(0, buffer.size() / 2));
+		ensure("truncated", truncated.isUndefined());
+	}
+
+	template<> template<>
+	void sdarena_object_t::test<3>()
+	{
+		const char* passes_env = getenv("LL_LLSD_BENCH");
+		if (!passes_env)
+		{
+			skip("set LL_LLSD_BENCH to a pass count to run the binary LLSD parse benchmark.");
+		}
+		S32 passes = llmax(atoi(passes_env), 1);
+
+		std::string buffer;
+		const char* file = getenv("LL_LLSD_BENCH_FILE");
+		if (file)
+		{
+			std::ifstream istr(file, std::ios::binary);
+			std::ostringstream ostr;
+			ostr << istr.rdbuf();
+			buffer = ostr.str();
+			ensure("LL_LLSD_BENCH_FILE is empty", !buffer.empty());
+		}
+		else
+		{
+			buffer = toBinary(makeItems(50000));
+		}
+
+		for (S32 enabled = 0; enabled < 2; ++enabled)
+		{
+			LLSDArenaScope::setEnabled(enabled != 0);
+			std::vector<LLSD> results(passes);
+			U64 rss = LLMemory::getCurrentRSS();
+			LLTimer timer;
+			for (S32 pass = 0; pass < passes; ++pass)
+			{
+				results[pass] = fromBinary(buffer);
+			}
+			F64 elapsed = timer.getElapsedTimeF64();
+			S64 held = (S64)LLMemory::getCurrentRSS() - (S64)rss;
+			ensure("parse failed", results[0].isDefined());
+
+			std::cout << "sdarena: arena " << (enabled ? "on" : "off") << ", "
+					  << passes << " parses of " << buffer.size() << " bytes, "
+					  << (elapsed > 0.0 ? passes * buffer.size() / elapsed / 1048576.0 : 0.0) << " MB/s, "
+					  << held / passes / 1024 << " KB resident per tree" << std::endl;
+		}
+	}
+}
@@ -648,6 +648,71 @@ namespace tut
 			v.size() + 1);
 	}
 
+	class TestLLSDStreamVisitor : public LLSDStreamVisitor
+	{
+	public:
+		bool shouldSplit(const path_t& path)
+		{
+			return path.size() == 2 && path[0].asString() == "folders";
+		}
+		void visit(const path_t& path, const LLSD& value)
+		{
+			mIndices.push_back(path[1].asInteger());
+			mValues.push_back(value);
+		}
+
+		std::vector<S32> mIndices;
+		std::vector<LLSD> mValues;
+	};
+
+	template<> template<>
+	void TestLLSDXMLParsingObject::test<4>()
+	{
+		// test chunked parsing with a visitor taking values out
+		std::string xml =
+			"<?xml version=\"1.0\" ?><llsd><map>"
+				"<key>amy</key><integer>23</integer>"
+				"<key>folders</key><array>"
+					"<map><key>name</key><string>first</string>"
+						"<key>items</key><array><integer>1</integer><integer>2</integer></array></map>"
+					"<map><key>name</key><string>second</string></map>"
+					"<map><key>name</key><string>third</string></map>"
+				"</array>"
+				"<key>cam</key><real>1.23</real>"
+			"</map></llsd>trailing junk";
+
+		for (size_t chunk = 1; chunk < xml.size(); chunk += 13)
+		{
+			TestLLSDStreamVisitor visitor;
+			LLPointer<LLSDXMLParser> parser = new LLSDXMLParser;
+			parser->setVisitor(&visitor);
+			for (size_t offset = 0; offset < xml.size(); offset += chunk)
+			{
+				ensure("chunk", parser->parseChunk(xml.data() + offset, (int)llmin(chunk, xml.size() - offset)));
+			}
+			LLSD rest;
+			ensure("count", parser->finishChunks(rest) > 0);
+
+			ensure_equals("visited", visitor.mValues.size(), (size_t)3);
+			ensure_equals("second index", visitor.mIndices[1], 1);
+			ensure_equals("first name", visitor.mValues[0]["name"].asString(), std::string("first"));
+			ensure_equals("first items", visitor.mValues[0]["items"].size(), 2);
+			ensure_equals("third name", visitor.mValues[2]["name"].asString(), std::string("third"));
+
+			ensure_equals("amy", rest["amy"].asInteger(), 23);
+			ensure_equals("cam", rest["cam"].asReal(), 1.23);
+			ensure_equals("folders left", rest["folders"].size(), 0);
+		}
+
+		// a broken document fails however it is cut
+		LLPointer<LLSDXMLParser> parser = new LLSDXMLParser(false);
+		std::string broken = xml.substr(0, 80) + "</array>";
+		parser->parseChunk(broken.data(), (int)broken.size());
+		LLSD rest;
+		ensure_equals("broken", parser->finishChunks(rest), (S32)LLSDParser::PARSE_FAILURE);
+		ensure("broken result", rest.isUndefined());
+	}
+
 	/*
 	TODO:
 		test XML parsing
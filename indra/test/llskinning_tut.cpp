@@ -0,0 +1,278 @@
+/**
+ * @file llskinning_tut.cpp
+ * @brief LLSkinningKernel against per-vertex skinning.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+// Test 3 times the per-vertex blended-matrix skinning the viewer used to do
+// against LLSkinningKernel over a mesh-sized face. It is skipped unless
+// LL_SKINNING_BENCH is set to the number of passes.
+
+#include "linden_common.h"
+#include "lltut.h"
+
+#include "llmath.h"
+#include "llmatrix4a.h"
+#include "llskinningkernel.h"
+#include "lltimer.h"
+
+#include <cstdlib>
+#include <iostream>
+
+namespace tut
+{
+	struct skinning_test
+	{
+		enum { PALETTE_SIZE = 32 };
+
+		LLMatrix4a mPalette[PALETTE_SIZE];
+		LLMatrix4a mBindShape;
+		LLVector4a mOffset;
+
+		skinning_test()
+		{
+			srand(4321);
+			for (S32 i = 0; i < PALETTE_SIZE; ++i)
+			{
+				mPalette[i] = randomAffine();
+			}
+			mBindShape = randomAffine();
+			mOffset.set(128.f, 64.f, 22.f);
+		}
+
+		static F32 frand(F32 range)
+		{
+			return ((F32)rand() / (F32)RAND_MAX - 0.5f) * 2.f * range;
+		}
+
+		static LLMatrix4a randomAffine()
+		{
+			LLMatrix4a m;
+			m.setIdentity();
+			for (S32 c = 0; c < 3; ++c)
+			{
+				for (S32 r = 0; r < 3; ++r)
+				{
+					m.getF32ptr()[c*4 + r] += frand(0.3f);
+				}
+				m.getF32ptr()[12 + c] = frand(2.f);
+			}
+			return m;
+		}
+
+		// Packed joint.weight influences the way LLVolumeFace::mWeights
+		// holds them, with one to four joints per vertex.
+		static void randomVertices(std::vector<LLVector4a>& weights, std::vector<LLVector4a>& positions,
+								   std::vector<LLVector4a>& normals, U32 count)
+		{
+			weights.resize(count);
+			positions.resize(count);
+			normals.resize(count);
+			for (U32 i = 0; i < count; ++i)
+			{
+				F32 w[4] = { 0.f, 0.f, 0.f, 0.f };
+				S32 joints = 1 + rand() % 4;
+				for (S32 k = 0; k < joints; ++k)
+				{
+					w[k] = (F32)(rand() % PALETTE_SIZE) + 0.05f + 0.9f * (F32)rand() / (F32)RAND_MAX;
+				}
+				weights[i].set(w[0], w[1], w[2], w[3]);
+				positions[i].set(frand(1.f), frand(1.f), frand(1.f), 1.f);
+				normals[i].set(frand(1.f), frand(1.f), frand(1.f));
+				normals[i].normalize3fast();
+			}
+		}
+
+		// LLSkinningUtil::getPerVertexSkinMatrix() followed by the bind
+		// shape and av_pos steps of LLVOAvatar::updateSoftwareSkinnedVertices().
+		void referenceSkin(const LLVector4a& weights, const LLVector4a& src, const LLVector4a& src_normal,
+						   LLVector4a& dst, LLVector4a& dst_normal) const
+		{
+			const F32* w = weights.getF32ptr();
+			S32 idx[4];
+			F32 wght[4];
+			F32 scale = 0.f;
+			for (S32 k = 0; k < 4; ++k)
+			{
+				idx[k] = (S32)floorf(w[k]);
+				wght[k] = w[k] - floorf(w[k]);
+				scale += wght[k];
+			}
+
+			LLMatrix4a final_mat;
+			final_mat.clear();
+			for (S32 k = 0; k < 4; ++k)
+			{
+				LLMatrix4a m;
+				m.setMul(mPalette[idx[k]], wght[k] / scale);
+				final_mat.add(m);
+			}
+			final_mat.mul(mBindShape);
+			final_mat.affineTransform(src, dst);
+			dst.add(mOffset);
+
+			final_mat.invert();
+			final_mat.transpose();
+			final_mat.affineTransform(src_normal, dst_normal);
+		}
+	};
+	typedef test_group<skinning_test> skinning_group_t;
+	typedef skinning_group_t::object skinning_object_t;
+	tut::skinning_group_t skinning_instance("skinning");
+
+	template<> template<>
+	void skinning_object_t::test<1>()
+	{
+		// Both kernels agree with the per-vertex path, including the
+		// partial group of four at the end.
+		const U32 count = 1023;
+		std::vector<LLVector4a> weights, positions, normals;
+		randomVertices(weights, positions, normals, count);
+
+		LLMatrix4a palette[PALETTE_SIZE];
+		std::copy(mPalette, mPalette + PALETTE_SIZE, palette);
+		LLSkinningKernel::premultiplyPalette(palette, PALETTE_SIZE, mBindShape);
+
+		std::vector<LLVector4a> skinned(count), skinned_both(count), skinned_normals(count);
+		LLVector4a min, max;
+		LLSkinningKernel::skinPositions(palette, PALETTE_SIZE, &weights[0], &positions[0], &skinned[0], count, mOffset, min, max);
+		LLSkinningKernel::skinPositionsNormals(palette, PALETTE_SIZE, &weights[0], &positions[0], &normals[0],
+											   &skinned_both[0], &skinned_normals[0], count, mOffset);
+
+		LLVector4a expected_min, expected_max;
+		for (U32 i = 0; i < count; ++i)
+		{
+			LLVector4a pos, normal;
+			referenceSkin(weights[i], positions[i], normals[i], pos, normal);
+			ensure("position", skinned[i].equals3(pos, 1e-4f));
+			ensure("position with normals", skinned_both[i].equals3(pos, 1e-4f));
+			ensure("normal", skinned_normals[i].equals3(normal, 1e-3f));
+
+			if (i == 0)
+			{
+				expected_min = pos;
+				expected_max = pos;
+			}
+			expected_min.setMin(expected_min, pos);
+			expected_max.setMax(expected_max, pos);
+		}
+		ensure("min", min.equals3(expected_min, 1e-4f));
+		ensure("max", max.equals3(expected_max, 1e-4f));
+	}
+
+	template<> template<>
+	void skinning_object_t::test<2>()
+	{
+		// Out of range joints are clamped and zero weights give the first
+		// joint instead of dividing by zero.
+		LLMatrix4a palette[2];
+		palette[0].setIdentity();
+		palette[1] = mPalette[1];
+
+		LLVector4a weights[2];
+		weights[0].set(40.5f, 0.f, 0.f, 0.f);
+		weights[1].set(0.f, 0.f, 0.f, 0.f);
+		LLVector4a positions[2];
+		positions[0].set(1.f, 2.f, 3.f, 1.f);
+		positions[1].set(-1.f, 0.5f, 2.f, 1.f);
+		LLVector4a skinned[2];
+		LLVector4a min, max;
+		LLVector4a zero;
+		zero.clear();
+		LLSkinningKernel::skinPositions(palette, 2, weights, positions, skinned, 2, zero, min, max);
+
+		LLVector4a expected;
+		palette[1].affineTransform(positions[0], expected);
+		ensure("clamped", skinned[0].equals3(expected, 1e-5f));
+		ensure("unweighted", skinned[1].equals3(positions[1], 1e-5f));
+	}
+
+	template<> template<>
+	void skinning_object_t::test<3>()
+	{
+		const char* passes_env = getenv("LL_SKINNING_BENCH");
+		if (!passes_env)
+		{
+			skip("set LL_SKINNING_BENCH to a pass count to run the skinning benchmark.");
+		}
+		S32 passes = llmax(atoi(passes_env), 1);
+
+		// About one avatar's worth of mesh clothing.
+		const U32 count = 65536;
+		std::vector<LLVector4a> weights, positions, normals;
+		randomVertices(weights, positions, normals, count);
+		std::vector<LLVector4a> skinned(count), skinned_normals(count);
+
+		LLTimer timer;
+		for (S32 pass = 0; pass < passes; ++pass)
+		{
+			for (U32 i = 0; i < count; ++i)
+			{
+				const F32* w = weights[i].getF32ptr();
+				LLMatrix4a final_mat;
+				final_mat.clear();
+				F32 scale = 0.f;
+				for (S32 k = 0; k < 4; ++k)
+				{
+					scale += w[k] - floorf(w[k]);
+				}
+				for (S32 k = 0; k < 4; ++k)
+				{
+					LLMatrix4a m;
+					m.setMul(mPalette[(S32)floorf(w[k])], (w[k] - floorf(w[k])) / scale);
+					final_mat.add(m);
+				}
+				LLVector4a t;
+				mBindShape.affineTransform(positions[i], t);
+				final_mat.affineTransform(t, skinned[i]);
+				skinned[i].add(mOffset);
+			}
+		}
+		F64 reference_time = timer.getElapsedTimeAndResetF64();
+
+		LLMatrix4a palette[PALETTE_SIZE];
+		LLVector4a min, max;
+		for (S32 pass = 0; pass < passes; ++pass)
+		{
+			std::copy(mPalette, mPalette + PALETTE_SIZE, palette);
+			LLSkinningKernel::premultiplyPalette(palette, PALETTE_SIZE, mBindShape);
+			LLSkinningKernel::skinPositions(palette, PALETTE_SIZE, &weights[0], &positions[0], &skinned[0], count, mOffset, min, max);
+		}
+		F64 kernel_time = timer.getElapsedTimeAndResetF64();
+
+		for (S32 pass = 0; pass < passes; ++pass)
+		{
+			std::copy(mPalette, mPalette + PALETTE_SIZE, palette);
+			LLSkinningKernel::premultiplyPalette(palette, PALETTE_SIZE, mBindShape);
+			LLSkinningKernel::skinPositionsNormals(palette, PALETTE_SIZE, &weights[0], &positions[0], &normals[0],
+												   &skinned[0], &skinned_normals[0], count, mOffset);
+		}
+		F64 normals_time = timer.getElapsedTimeAndResetF64();
+
+		F64 total = (F64)passes * count;
+		std::cout << "skinning: " << passes << " passes of " << count << " vertices, "
+				  << (reference_time > 0.0 ? total / reference_time / 1000000.0 : 0.0) << " M/s per vertex, "
+				  << (kernel_time > 0.0 ? total / kernel_time / 1000000.0 : 0.0) << " M/s kernel, "
+				  << (normals_time > 0.0 ? total / normals_time / 1000000.0 : 0.0) << " M/s kernel with normals" << std::endl;
+	}
+}
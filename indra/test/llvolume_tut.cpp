@@ -0,0 +1,247 @@
+/**
+ * @file llvolume_tut.cpp
+ * @brief LLVolume mesh face decoding and packing.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "lltut.h"
+
+#include "llsdserialize.h"
+#include "llvolume.h"
+
+#include <cstring>
+#include <sstream>
+
+namespace tut
+{
+	struct volume_test
+	{
+		// A hollow box, its faces optimized like unpacked mesh faces.
+		static LLPointer<LLVolume> makeVolume()
+		{
+			LLVolumeParams params;
+			params.setType(LL_PCODE_PROFILE_SQUARE, LL_PCODE_PATH_LINE);
+			params.setHollow(0.5f);
+			LLPointer<LLVolume> volume = new LLVolume(params, 1.f);
+			volume->cacheOptimize();
+			return volume;
+		}
+
+		static bool sameBytes(const void* a, const void* b, size_t size)
+		{
+			return (!a && !b) || (a && b && !memcmp(a, b, size));
+		}
+
+		static LLSD::Binary packU16(const U16* values, U32 count)
+		{
+			LLSD::Binary binary(count * sizeof(U16));
+			memcpy(&binary[0], values, binary.size());
+			return binary;
+		}
+
+		static LLSD domain(F32 min, F32 max, S32 count)
+		{
+			LLSD sd;
+			for (S32 i = 0; i < count; ++i)
+			{
+				sd["Min"][i] = min;
+				sd["Max"][i] = max;
+			}
+			return sd;
+		}
+
+		// Quantized vertex i of the mesh in makeMesh().
+		static void getVertex(U32 i, U16* pos, U16* norm, U16* tc)
+		{
+			pos[0] = i * 9000; pos[1] = 65535 - i * 5000; pos[2] = (i & 1) * 65535;
+			norm[0] = 0; norm[1] = 32768; norm[2] = 65535 - i * 1000;
+			tc[0] = i * 10000; tc[1] = 65535 - i * 10000;
+		}
+
+		// A mesh LOD with one rigged face of five vertices and one without geometry.
+		static LLSD makeMesh()
+		{
+			U16 pos[15], norm[15], tc[10];
+			for (U32 i = 0; i < 5; ++i)
+			{
+				getVertex(i, pos + 3 * i, norm + 3 * i, tc + 2 * i);
+			}
+			const U16 indices[] = { 0, 1, 2, 2, 1, 3, 3, 1, 4 };
+			// Joint, weight, end: one to four influences per vertex.
+			const U8 weights[] = { 1, 0xFF, 0x7F, 0xFF,
+								   2, 0x00, 0x80, 3, 0x00, 0x80, 0xFF,
+								   4, 0x00, 0x40, 5, 0x00, 0x40, 6, 0x00, 0x40, 0xFF,
+								   1, 0x00, 0x40, 2, 0x00, 0x40, 3, 0x00, 0x40, 4, 0x00, 0x40,
+								   7, 0xFF, 0xFF, 0xFF };
+
+			LLSD face;
+			face["Position"] = packU16(pos, 15);
+			face["Normal"] = packU16(norm, 15);
+			face["TexCoord0"] = packU16(tc, 10);
+			face["TriangleList"] = packU16(indices, LL_ARRAY_SIZE(indices));
+			face["Weights"] = LLSD::Binary(weights, weights + sizeof(weights));
+			face["PositionDomain"] = domain(-2.f, 2.f, 3);
+			face["TexCoord0Domain"] = domain(0.f, 1.f, 2);
+			face["Unknown"] = LLSD::emptyArray();
+			face["Unknown"].append("skipped");
+
+			LLSD empty;
+			empty["NoGeometry"] = true;
+
+			LLSD mdl = LLSD::emptyArray();
+			mdl.append(face);
+			mdl.append(empty);
+			return mdl;
+		}
+
+		static bool unpack(LLVolume* volume, const std::string& zipped)
+		{
+			std::istringstream stream(zipped);
+			return volume->unpackVolumeFaces(stream, zipped.size());
+		}
+	};
+	typedef test_group<volume_test> volume_group_t;
+	typedef volume_group_t::object volume_object_t;
+	tut::volume_group_t volume_instance("volume");
+
+	template<> template<>
+	void volume_object_t::test<1>()
+	{
+		// Every stream survives a round trip, the optional ones included.
+		LLPointer<LLVolume> volume = makeVolume();
+		ensure("faces", volume->getNumVolumeFaces() > 1);
+		LLVolumeFace& rigged = const_cast<LLVolumeFace&>(volume->getVolumeFace(0));
+		rigged.allocateWeights(rigged.mNumVertices);
+		rigged.allocateTangents(rigged.mNumVertices);
+		for (S32 i = 0; i < rigged.mNumVertices; ++i)
+		{
+			rigged.mWeights[i].set(i, 0.5f, 0.f, 0.f);
+			rigged.mTangents[i].set(0.f, 1.f, 0.f, 1.f);
+		}
+
+		std::stringstream stream;
+		ensure("pack", volume->packOptimizedVolumeFaces(stream));
+
+		LLPointer<LLVolume> copy = new LLVolume(volume->getParams(), 1.f);
+		ensure("unpack", copy->unpackOptimizedVolumeFaces(stream));
+		ensure_equals("face count", copy->getNumVolumeFaces(), volume->getNumVolumeFaces());
+		for (S32 f = 0; f < volume->getNumVolumeFaces(); ++f)
+		{
+			const LLVolumeFace& a = volume->getVolumeFace(f);
+			const LLVolumeFace& b = copy->getVolumeFace(f);
+			ensure_equals("vertices", b.mNumVertices, a.mNumVertices);
+			ensure_equals("indices", b.mNumIndices, a.mNumIndices);
+			ensure("optimized", b.mOptimized);
+			ensure("extents", sameBytes(a.mExtents, b.mExtents, 2 * sizeof(LLVector4a)));
+			ensure("tc extents", sameBytes(a.mTexCoordExtents, b.mTexCoordExtents, 2 * sizeof(LLVector2)));
+			ensure("positions", sameBytes(a.mPositions, b.mPositions, a.mNumVertices * sizeof(LLVector4a)));
+			ensure("normals", sameBytes(a.mNormals, b.mNormals, a.mNumVertices * sizeof(LLVector4a)));
+			ensure("tex coords", sameBytes(a.mTexCoords, b.mTexCoords, a.mNumVertices * sizeof(LLVector2)));
+			ensure("index data", sameBytes(a.mIndices, b.mIndices, a.mNumIndices * sizeof(U16)));
+			ensure("weights", sameBytes(a.mWeights, b.mWeights, a.mNumVertices * sizeof(LLVector4a)));
+			ensure("tangents", sameBytes(a.mTangents, b.mTangents, a.mNumVertices * sizeof(LLVector4a)));
+		}
+	}
+
+	template<> template<>
+	void volume_object_t::test<2>()
+	{
+		LLPointer<LLVolume> volume = makeVolume();
+		std::stringstream stream;
+		ensure("pack", volume->packOptimizedVolumeFaces(stream));
+		std::string data = stream.str();
+
+		// Truncated entries are rejected.
+		std::istringstream truncated(data.substr(0, data.size() - 1));
+		LLPointer<LLVolume> copy = new LLVolume(volume->getParams(), 1.f);
+		ensure("truncated", !copy->unpackOptimizedVolumeFaces(truncated));
+		ensure_equals("no faces left", copy->getNumVolumeFaces(), 0);
+
+		// So are indices past the vertices of their face.
+		const LLVolumeFace& face = volume->getVolumeFace(volume->getNumVolumeFaces() - 1);
+		std::string corrupt = data;
+		memset(&corrupt[corrupt.size() - face.mNumIndices * sizeof(U16)], 0xFF, sizeof(U16));
+		std::istringstream bad_index(corrupt);
+		ensure("bad index", !copy->unpackOptimizedVolumeFaces(bad_index));
+
+		// Faces that were not optimized are not packed.
+		LLPointer<LLVolume> raw = new LLVolume(volume->getParams(), 1.f);
+		std::stringstream raw_stream;
+		ensure("unoptimized", !raw->packOptimizedVolumeFaces(raw_stream));
+	}
+
+	template<> template<>
+	void volume_object_t::test<3>()
+	{
+		// Mesh LOD faces decode to the dequantized vertices, in whatever
+		// order the vertex cache optimization left them.
+		LLSD mdl = makeMesh();
+		std::string zipped = zip_llsd(mdl);
+		LLVolumeParams params;
+		params.setType(LL_PCODE_PROFILE_SQUARE, LL_PCODE_PATH_LINE);
+		LLPointer<LLVolume> volume = new LLVolume(params, 1.f);
+		ensure("unpack", unpack(volume, zipped));
+		ensure_equals("faces", volume->getNumVolumeFaces(), 2);
+
+		const LLVolumeFace& face = volume->getVolumeFace(0);
+		ensure_equals("vertices", face.mNumVertices, 5);
+		ensure_equals("indices", face.mNumIndices, 9);
+		ensure("weights", face.mWeights != NULL);
+		const S32 first_joint[] = { 1, 2, 4, 1, 7 };
+		U32 found = 0;
+		for (U32 i = 0; i < 5; ++i)
+		{
+			U16 pos[3], norm[3], tc[2];
+			getVertex(i, pos, norm, tc);
+			for (S32 v = 0; v < face.mNumVertices; ++v)
+			{
+				const F32* p = face.mPositions[v].getF32ptr();
+				if (fabsf(p[0] - (pos[0] / 65535.f * 4.f - 2.f)) > 1e-5f ||
+					fabsf(p[1] - (pos[1] / 65535.f * 4.f - 2.f)) > 1e-5f ||
+					fabsf(p[2] - (pos[2] / 65535.f * 4.f - 2.f)) > 1e-5f)
+				{
+					continue;
+				}
+				found |= 1 << i;
+				const F32* n = face.mNormals[v].getF32ptr();
+				ensure_distance("normal y", n[1], norm[1] / 65535.f * 2.f - 1.f, 1e-5f);
+				ensure_distance("normal z", n[2], norm[2] / 65535.f * 2.f - 1.f, 1e-5f);
+				ensure_distance("tc s", face.mTexCoords[v].mV[0], tc[0] / 65535.f, 1e-5f);
+				ensure_distance("tc t", face.mTexCoords[v].mV[1], tc[1] / 65535.f, 1e-5f);
+				const F32* w = face.mWeights[v].getF32ptr();
+				ensure_equals("first joint", (S32)w[0], first_joint[i]);
+			}
+		}
+		ensure_equals("every vertex", found, 0x1FU);
+
+		const LLVolumeFace& empty = volume->getVolumeFace(1);
+		ensure_equals("no geometry", empty.mNumVertices, 1);
+
+		// Damaged blocks fail instead of decoding garbage.
+		LLPointer<LLVolume> damaged = new LLVolume(params, 1.f);
+		ensure("truncated", !unpack(damaged, zipped.substr(0, zipped.size() / 2)));
+		LLSD no_faces = LLSD::emptyArray();
+		ensure("no faces", !unpack(damaged, zip_llsd(no_faces)));
+	}
+}